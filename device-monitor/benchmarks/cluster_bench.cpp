@@ -0,0 +1,99 @@
+#include "cluster_ring.h"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+
+// 一致性哈希环基准测试（不需要MQTT broker）
+// 1. 查询耗时：大量设备ID的归属查询平均耗时
+// 2. 均衡度：各成员分到的设备数与平均值的最大偏差
+// 3. 迁移比例：加入或离开一个成员时改变归属的设备比例（理想值约 1/N）
+// 用法: cluster_bench [设备数量] [成员数量] [每个成员的虚拟节点数]
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::vector<std::string> memberIds(size_t count) {
+    std::vector<std::string> members;
+    for (size_t i = 0; i < count; ++i) {
+        members.push_back("server" + std::to_string(i + 1));
+    }
+    return members;
+}
+
+std::vector<std::string> owners(const ClusterRing& ring, const std::vector<std::string>& devices) {
+    std::vector<std::string> result;
+    result.reserve(devices.size());
+    for (const auto& device : devices) {
+        result.push_back(ring.owner(device));
+    }
+    return result;
+}
+
+double movedFraction(const std::vector<std::string>& before, const std::vector<std::string>& after) {
+    size_t moved = 0;
+    for (size_t i = 0; i < before.size(); ++i) {
+        moved += before[i] != after[i];
+    }
+    return static_cast<double>(moved) / before.size();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t device_count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    size_t member_count = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 4;
+    size_t virtual_nodes = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : ClusterRing::DEFAULT_VIRTUAL_NODES;
+    if (device_count == 0 || member_count < 2) {
+        std::cerr << "need at least one device and two members" << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> devices;
+    devices.reserve(device_count);
+    for (size_t i = 0; i < device_count; ++i) {
+        devices.push_back("sensor" + std::to_string(i));
+    }
+
+    ClusterRing ring(virtual_nodes);
+    ring.setMembers(memberIds(member_count));
+
+    auto start = Clock::now();
+    size_t checksum = 0;
+    for (const auto& device : devices) {
+        checksum += ring.owner(device).size();
+    }
+    double lookup_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / device_count;
+
+    std::vector<std::string> base = owners(ring, devices);
+    std::map<std::string, size_t> counts;
+    for (const auto& owner : base) {
+        counts[owner]++;
+    }
+    double mean = static_cast<double>(device_count) / member_count;
+    double max_deviation = 0;
+    for (const auto& pair : counts) {
+        max_deviation = std::max(max_deviation, std::abs(pair.second - mean) / mean);
+    }
+
+    ring.setMembers(memberIds(member_count + 1));
+    double join = movedFraction(base, owners(ring, devices));
+    ring.setMembers(memberIds(member_count - 1));
+    double leave = movedFraction(base, owners(ring, devices));
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << device_count << " devices, " << member_count << " members x " << virtual_nodes << " virtual nodes"
+              << " (checksum " << checksum << ")" << std::endl;
+    std::cout << "  lookup: " << lookup_ns << " ns/device" << std::endl;
+    std::cout << "  balance: max deviation from mean " << max_deviation * 100 << "%" << std::endl;
+    std::cout << "  join one member: " << join * 100 << "% moved (ideal " << 100.0 / (member_count + 1) << "%)"
+              << std::endl;
+    std::cout << "  leave one member: " << leave * 100 << "% moved (ideal " << 100.0 / member_count << "%)"
+              << std::endl;
+    return 0;
+}
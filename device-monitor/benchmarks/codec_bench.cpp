@@ -0,0 +1,168 @@
+#include "message_codec.h"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+
+// 消息编解码基准测试（无需MQTT broker）
+// 对典型的状态、心跳、命令和响应消息，比较原有的流式JSON路径、JSON编解码器和CBOR编解码器的
+// 编码后大小以及每条消息的编码/解码耗时；数值帧为结构声明模式下与状态消息等价的上报
+// 用法: codec_bench [迭代次数]
+
+namespace {
+
+Json::Value statusMessage() {
+    Json::Value status;
+    status["device_id"] = "sensor-000123";
+    status["device_type"] = "temperature_sensor";
+    status["status"] = "online";
+    status["timestamp"] = static_cast<Json::Int64>(1700000000);
+    status["uptime"] = static_cast<Json::Int64>(86400);
+    status["codec"] = "json";
+    static const char* names[] = {"temperature", "humidity", "pressure", "battery", "voltage", "rssi"};
+    static const char* units[] = {"C", "%", "hPa", "%", "V", "dBm"};
+    for (int i = 0; i < 6; ++i) {
+        Json::Value property;
+        property["value"] = 20.5 + i * 3.25;
+        property["unit"] = units[i];
+        property["writable"] = i % 2 == 0;
+        status["properties"][names[i]] = property;
+    }
+    status["properties"]["firmware"]["value"] = "1.4.2";
+    status["properties"]["firmware"]["unit"] = "";
+    status["properties"]["firmware"]["writable"] = false;
+    return status;
+}
+
+// 结构声明模式下与上面状态消息等价的数值帧：[结构哈希, 时间戳, 状态, 按属性名排序的值...]
+Json::Value valueFrameMessage() {
+    Json::Value status = statusMessage();
+    Json::Value frame(Json::arrayValue);
+    frame.append(static_cast<Json::UInt64>(0x9ae16a3b2f90404full));
+    frame.append(status["timestamp"]);
+    frame.append(status["status"]);
+    for (const auto& property : status["properties"]) {
+        frame.append(property["value"]);
+    }
+    return frame;
+}
+
+Json::Value heartbeatMessage() {
+    Json::Value heartbeat;
+    heartbeat["device_id"] = "sensor-000123";
+    heartbeat["timestamp"] = static_cast<Json::Int64>(1700000000);
+    heartbeat["status"] = "alive";
+    return heartbeat;
+}
+
+Json::Value commandMessage() {
+    Json::Value command;
+    command["command_id"] = "server001_1700000000_42";
+    command["command_type"] = "set_property";
+    command["parameters"]["property"] = "target_temperature";
+    command["parameters"]["value"] = 22.5;
+    command["timestamp"] = static_cast<Json::Int64>(1700000000);
+    return command;
+}
+
+Json::Value responseMessage() {
+    Json::Value response;
+    response["command_id"] = "server001_1700000000_42";
+    response["success"] = true;
+    response["timestamp"] = static_cast<Json::Int64>(1700000001);
+    response["result"]["property"] = "target_temperature";
+    response["result"]["value"] = 22.5;
+    return response;
+}
+
+double nanosPerOp(std::chrono::steady_clock::time_point start, size_t ops) {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / ops;
+}
+
+// 编码器接口改造前的路径：每条消息构造写入器/解析器并经过字符串流
+void benchmarkLegacy(const Json::Value& message, size_t iterations) {
+    std::string payload;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        Json::StreamWriterBuilder builder;
+        payload = Json::writeString(builder, message);
+    }
+    double encode_ns = nanosPerOp(start, iterations);
+
+    Json::Value decoded;
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        Json::CharReaderBuilder builder;
+        std::string errors;
+        std::istringstream stream(payload);
+        if (!Json::parseFromStream(builder, stream, &decoded, &errors)) {
+            std::cerr << "Legacy decode failed: " << errors << std::endl;
+            std::exit(1);
+        }
+    }
+    double decode_ns = nanosPerOp(start, iterations);
+
+    std::cout << std::setw(14) << "json (stream)" << std::setw(10) << payload.size()
+              << std::setw(14) << encode_ns << std::setw(14) << decode_ns << std::endl;
+}
+
+void benchmarkCodec(const MessageCodec& codec, const Json::Value& message, size_t iterations) {
+    std::string payload;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        payload = codec.encode(message);
+    }
+    double encode_ns = nanosPerOp(start, iterations);
+
+    Json::Value decoded;
+    std::string errors;
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        if (!MessageCodec::decodeAny(payload, decoded, &errors)) {
+            std::cerr << codec.name() << " decode failed: " << errors << std::endl;
+            std::exit(1);
+        }
+    }
+    double decode_ns = nanosPerOp(start, iterations);
+
+    if (decoded != message) {
+        std::cerr << codec.name() << " round trip mismatch" << std::endl;
+        std::exit(1);
+    }
+
+    std::cout << std::setw(14) << codec.name() << std::setw(10) << payload.size()
+              << std::setw(14) << encode_ns << std::setw(14) << decode_ns << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t iterations = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+
+    struct Sample {
+        const char* name;
+        Json::Value message;
+    };
+    std::vector<Sample> samples = {
+        {"status", statusMessage()},
+        {"value frame", valueFrameMessage()},
+        {"heartbeat", heartbeatMessage()},
+        {"command", commandMessage()},
+        {"response", responseMessage()},
+    };
+
+    std::cout << std::left << std::fixed << std::setprecision(1);
+    for (const auto& sample : samples) {
+        std::cout << sample.name << " message" << std::endl;
+        std::cout << std::setw(14) << "codec" << std::setw(10) << "bytes"
+                  << std::setw(14) << "encode(ns)" << std::setw(14) << "decode(ns)" << std::endl;
+        benchmarkLegacy(sample.message, iterations);
+        benchmarkCodec(MessageCodec::get(MessageFormat::JSON), sample.message, iterations);
+        benchmarkCodec(MessageCodec::get(MessageFormat::CBOR), sample.message, iterations);
+        std::cout << std::endl;
+    }
+    return 0;
+}
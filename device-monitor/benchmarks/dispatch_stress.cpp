@@ -0,0 +1,179 @@
+#include "mqtt_client.h"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <cstdlib>
+
+// MQTT客户端回调分发压力测试（无需MQTT broker）
+// 1. 分发开销：按服务端的四个路由直接驱动消息回调，测量每条消息的分发耗时，
+//    并在另一线程持续注册回调（替换处理函数集合）时再次测量，记录注册的最大耗时
+// 2. 重入：处理函数中注册新的路由和回调不会死锁
+// 3. 慢处理函数：处理函数阻塞期间，注册回调和自动重连按时进行
+// 用法: dispatch_stress [消息数量] [慢处理函数阻塞秒数]
+
+namespace {
+
+// 通过派生类调用受保护的 mosquitto 回调入口，模拟消息循环线程
+class DispatchProbe : public MqttClient {
+public:
+    using MqttClient::MqttClient;
+    using MqttClient::onMessage;
+};
+
+using Clock = std::chrono::steady_clock;
+
+double elapsedNanos(Clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+struct Message {
+    std::string topic;
+    std::string payload;
+    mosquitto_message raw{};
+
+    Message(std::string t, std::string p) : topic(std::move(t)), payload(std::move(p)) {
+        raw.topic = &topic[0];
+        raw.payload = &payload[0];
+        raw.payloadlen = static_cast<int>(payload.size());
+        raw.qos = 1;
+    }
+};
+
+void registerServerRoutes(MqttClient& client, std::atomic<uint64_t>& delivered) {
+    static const char* filters[] = {"device/+/status", "device/+/response", "device/+/heartbeat", "device/+/schema"};
+    for (const char* filter : filters) {
+        client.addRoute(filter, [&delivered](const TopicCaptures& captures, const MessageView& message) {
+            if (!captures[0].empty() && !message.payload.empty()) {
+                delivered.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+}
+
+double dispatchNanos(DispatchProbe& client, Message& message, size_t count) {
+    auto start = Clock::now();
+    for (size_t i = 0; i < count; ++i) {
+        DispatchProbe::onMessage(nullptr, &client, &message.raw);
+    }
+    return elapsedNanos(start) / count;
+}
+
+bool measureDispatch(size_t count) {
+    DispatchProbe client("dispatch_probe");
+    std::atomic<uint64_t> delivered{0};
+    registerServerRoutes(client, delivered);
+    Message message("device/sensor-000123/heartbeat", R"({"device_id":"sensor-000123","status":"alive","timestamp":1700000000})");
+
+    dispatchNanos(client, message, count / 10 + 1);
+    double quiet_ns = dispatchNanos(client, message, count);
+
+    // 另一线程持续替换处理函数集合
+    std::atomic<bool> churning{true};
+    std::atomic<uint64_t> swaps{0};
+    double max_register_ns = 0;
+    std::thread churn([&]() {
+        while (churning.load(std::memory_order_relaxed) && swaps.load(std::memory_order_relaxed) < 5000) {
+            auto start = Clock::now();
+            client.setConnectionCallback([](bool) {});
+            max_register_ns = std::max(max_register_ns, elapsedNanos(start));
+            swaps.fetch_add(1, std::memory_order_relaxed);
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    });
+    double churn_ns = dispatchNanos(client, message, count);
+    churning = false;
+    churn.join();
+
+    std::cout << "dispatch overhead" << std::endl;
+    std::cout << std::left << std::fixed << std::setprecision(1);
+    std::cout << std::setw(36) << "  idle registry" << quiet_ns << " ns/msg" << std::endl;
+    std::cout << std::setw(36) << "  concurrent registration" << churn_ns << " ns/msg (" << swaps.load()
+              << " handler set swaps, max register " << max_register_ns / 1000.0 << " us)" << std::endl;
+
+    uint64_t expected = count / 10 + 1 + 2 * count;
+    if (delivered.load() != expected) {
+        std::cerr << "delivered " << delivered.load() << " of " << expected << " messages" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool checkReentrancy() {
+    DispatchProbe client("reentrancy_probe");
+    std::atomic<int> added_route_calls{0};
+    std::atomic<int> fallback_calls{0};
+
+    // 处理函数中注册新的路由和未匹配消息回调
+    client.addRoute("probe/register", [&](const TopicCaptures&, const MessageView&) {
+        client.addRoute("probe/added", [&](const TopicCaptures&, const MessageView&) {
+            added_route_calls.fetch_add(1);
+        });
+        client.setMessageViewCallback([&](const MessageView&) {
+            fallback_calls.fetch_add(1);
+        });
+    });
+
+    Message reg("probe/register", "x");
+    Message added("probe/added", "x");
+    Message other("probe/other", "x");
+    DispatchProbe::onMessage(nullptr, &client, &reg.raw);
+    DispatchProbe::onMessage(nullptr, &client, &added.raw);
+    DispatchProbe::onMessage(nullptr, &client, &other.raw);
+
+    bool ok = added_route_calls.load() == 1 && fallback_calls.load() == 1;
+    std::cout << "reentrant registration from a handler: " << (ok ? "ok" : "FAILED") << std::endl;
+    return ok;
+}
+
+bool checkSlowHandler(int block_seconds) {
+    DispatchProbe client("slow_probe");
+    client.setAutoReconnect(true, 1);
+    // 间隔上限等于初始间隔：第一次在1秒内随机，之后固定每秒一次，检查结果不受抖动影响
+    client.setReconnectBackoff(1000, 1000);
+    client.start();
+
+    std::atomic<bool> handler_entered{false};
+    client.addRoute("probe/slow", [&](const TopicCaptures&, const MessageView&) {
+        handler_entered = true;
+        std::this_thread::sleep_for(std::chrono::seconds(block_seconds));
+    });
+
+    Message slow("probe/slow", "x");
+    std::thread loop([&]() {
+        DispatchProbe::onMessage(nullptr, &client, &slow.raw);
+    });
+    while (!handler_entered) {
+        std::this_thread::yield();
+    }
+
+    // 处理函数阻塞期间注册回调并观察自动重连
+    uint64_t attempts_before = client.reconnectAttempts();
+    auto start = Clock::now();
+    client.setConnectionCallback([](bool) {});
+    double register_us = elapsedNanos(start) / 1000.0;
+    loop.join();
+    uint64_t attempts = client.reconnectAttempts() - attempts_before;
+    client.stop();
+
+    // 重连间隔固定为1秒，阻塞期间至少应完成 block_seconds - 1 次尝试
+    bool ok = register_us < 100000.0 && attempts + 1 >= static_cast<uint64_t>(block_seconds);
+    std::cout << "slow handler blocking " << block_seconds << " s: register took " << std::setprecision(1)
+              << register_us << " us, " << attempts << " reconnect attempts while blocked: "
+              << (ok ? "ok" : "FAILED") << std::endl;
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+    int block_seconds = argc > 2 ? std::atoi(argv[2]) : 3;
+
+    bool ok = measureDispatch(count);
+    ok = checkReentrancy() && ok;
+    ok = checkSlowHandler(block_seconds) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,103 @@
+#include "device_registry.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// 心跳快速路径基准测试（无需MQTT broker）
+// 单线程测量：分片加锁更新路径 vs 句柄驻留+原子时间戳快速路径，并统计每次心跳的内存分配次数
+// 用法: heartbeat_bench [设备数量] [心跳次数]
+
+namespace {
+std::atomic<uint64_t> g_allocations{0};
+}
+
+void* operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+namespace {
+
+struct Result {
+    double rate;
+    double allocs_per_op;
+};
+
+template <typename Fn>
+Result measure(size_t ops, Fn&& fn) {
+    uint64_t allocs_before = g_allocations.load();
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < ops; ++i) {
+        fn(i);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    uint64_t allocs = g_allocations.load() - allocs_before;
+    return Result{ops / seconds, static_cast<double>(allocs) / ops};
+}
+
+void print(const char* name, const Result& result) {
+    std::cout << std::left << std::setw(34) << name
+              << std::setw(16) << static_cast<uint64_t>(result.rate)
+              << std::fixed << std::setprecision(3) << result.allocs_per_op << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t device_count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 50000;
+    size_t ops = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 10000000;
+
+    std::vector<std::string> ids;
+    ids.reserve(device_count);
+    for (size_t i = 0; i < device_count; ++i) {
+        ids.push_back("device" + std::to_string(i));
+    }
+
+    DeviceRegistry registry(64, device_count);
+    std::vector<DeviceHandle> handles;
+    handles.reserve(device_count);
+    for (const auto& id : ids) {
+        registry.update(id, [](DeviceStatus& status) { status.status = "online"; });
+        handles.push_back(registry.intern(id));
+    }
+
+    std::cout << "Devices: " << device_count << ", heartbeats: " << ops << " (single thread)" << std::endl;
+    std::cout << std::left << std::setw(34) << "path" << std::setw(16) << "heartbeats/s" << "allocs/heartbeat" << std::endl;
+
+    print("locked update + system_clock", measure(ops, [&](size_t i) {
+        registry.update(ids[i % device_count], [](DeviceStatus& status) {
+            status.last_seen = std::chrono::system_clock::now();
+        });
+    }));
+
+    uint64_t slow_paths = 0;
+    print("findHandle + atomic touch", measure(ops, [&](size_t i) {
+        DeviceHandle handle = registry.findHandle(ids[i % device_count]);
+        if (!registry.touch(handle, DeviceRegistry::nowTicks())) {
+            ++slow_paths;
+        }
+    }));
+
+    print("pre-resolved handle + touch", measure(ops, [&](size_t i) {
+        registry.touch(handles[i % device_count], DeviceRegistry::nowTicks());
+    }));
+
+    std::cout << "Slow-path transitions: " << slow_paths << std::endl;
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include "property_history.h"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+
+// 属性历史基准测试
+// 1. 写入和查询开销：多个设备、多个属性写满环形缓冲区后测量每次写入、范围查询和降采样的耗时
+// 2. 时间回退：设备时钟回拨的数值帧、接收时间与采样时间混用时，范围查询仍返回全部样本且按时间排序
+// 用法: history_bench [设备数量] [每属性样本数量]
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char* PROPERTIES[] = {"temperature", "humidity", "pressure", "voltage"};
+
+double elapsedNanos(Clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+bool measure(size_t devices, size_t samples) {
+    PropertyHistory history(samples);
+    const int64_t base_ms = 1700000000000;
+
+    auto start = Clock::now();
+    for (size_t i = 0; i < samples; ++i) {
+        for (size_t device = 0; device < devices; ++device) {
+            for (const char* property : PROPERTIES) {
+                history.record(static_cast<DeviceHandle>(device), property, base_ms + static_cast<int64_t>(i) * 1000,
+                               static_cast<double>(i));
+            }
+        }
+    }
+    double writes = static_cast<double>(samples) * devices * 4;
+    double record_ns = elapsedNanos(start) / writes;
+
+    // 查询最近十分之一时间范围
+    int64_t to_ms = base_ms + static_cast<int64_t>(samples - 1) * 1000;
+    int64_t from_ms = to_ms - static_cast<int64_t>(samples / 10) * 1000;
+    size_t returned = 0;
+    start = Clock::now();
+    for (size_t device = 0; device < devices; ++device) {
+        returned += history.query(static_cast<DeviceHandle>(device), "humidity", from_ms, to_ms).size();
+    }
+    double query_ns = elapsedNanos(start) / devices;
+
+    size_t buckets = 0;
+    start = Clock::now();
+    for (size_t device = 0; device < devices; ++device) {
+        buckets += history.downsample(static_cast<DeviceHandle>(device), "humidity", base_ms, to_ms,
+                                      static_cast<int64_t>(samples / 60 + 1) * 1000).size();
+    }
+    double downsample_ns = elapsedNanos(start) / devices;
+
+    bool ok = returned == devices * (samples / 10 + 1) && buckets > 0;
+    std::cout << std::fixed << std::setprecision(1) << devices << " devices x 4 properties x " << samples
+              << " samples (" << history.memoryUsage() / (1024 * 1024) << " MiB)" << std::endl;
+    std::cout << "  record: " << record_ns << " ns, query: " << query_ns / 1000.0 << " us, downsample: "
+              << downsample_ns / 1000.0 << " us: " << (ok ? "ok" : "FAILED") << std::endl;
+    return ok;
+}
+
+bool checkBackwardsTimestamps() {
+    PropertyHistory history(16);
+    const DeviceHandle handle = 0;
+    const int64_t now_ms = 1700000000000;
+
+    // 状态消息按接收时间记录，随后的数值帧带回拨的设备采样时间，再之后设备时钟恢复
+    history.record(handle, "temperature", now_ms, 20.0);
+    history.record(handle, "temperature", now_ms - 60000, 21.0);
+    history.record(handle, "temperature", now_ms - 30000, 22.0);
+    history.record(handle, "temperature", now_ms + 1000, 23.0);
+
+    std::vector<HistorySample> samples = history.query(handle, "temperature", now_ms, now_ms + 1000);
+    bool sorted = true;
+    for (size_t i = 1; i < samples.size(); ++i) {
+        sorted = sorted && samples[i - 1].timestamp_ms <= samples[i].timestamp_ms;
+    }
+    std::vector<HistoryBucket> buckets = history.downsample(handle, "temperature", now_ms, now_ms + 1000, 2000);
+    bool ok = sorted && samples.size() == 4 && samples[1].value == 21.0 && samples[2].value == 22.0 &&
+              samples[3].value == 23.0 && buckets.size() == 1 && buckets[0].count == 4;
+    std::cout << "value frames with device clock stepping back " << samples.size() << " samples in range: "
+              << (ok ? "ok" : "FAILED") << std::endl;
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t devices = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000;
+    size_t samples = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1024;
+
+    bool ok = measure(devices, samples);
+    ok = checkBackwardsTimestamps() && ok;
+    return ok ? 0 : 1;
+}
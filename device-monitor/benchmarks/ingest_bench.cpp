@@ -0,0 +1,148 @@
+#include "server.h"
+#include "mqtt_client.h"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <cstdlib>
+
+// 服务端入站吞吐基准测试（需要MQTT broker，例如本地 mosquitto）
+// 对每个入站连接数量（0 表示原有的单连接订阅）启动一个服务端，多个发布线程以 QoS 1 向大量设备的状态主题
+// 发布完整状态消息，统计服务端处理完全部消息（设备状态回调次数）的耗时和吞吐。
+// 服务端逐条打印状态日志，测量期间关闭标准输出。
+// 用法: ingest_bench [broker地址] [端口] [每个发布线程的消息数] [发布线程数] [入站连接数...]
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const size_t DEVICES_PER_PUBLISHER = 1000;
+
+double elapsedSeconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+std::string statusPayload(size_t sequence) {
+    return R"({"status":"online","device_type":"sensor","full":true,"version":)" + std::to_string(sequence) +
+           R"(,"properties":{"temperature":21.5,"humidity":40}})";
+}
+
+bool waitConnected(const std::vector<std::unique_ptr<MqttClient>>& clients) {
+    auto start = Clock::now();
+    for (const auto& client : clients) {
+        while (!client->isConnected() && elapsedSeconds(start) < 10) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        if (!client->isConnected()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool measure(const std::string& host, int port, size_t connections, size_t per_publisher, size_t publishers) {
+    std::atomic<uint64_t> processed{0};
+    Server server("ingest_bench_" + std::to_string(connections), host, port);
+    server.setIngestConnections(connections);
+    server.setDeviceStatusCallback([&](const std::string&, const DeviceStatus&) {
+        processed.fetch_add(1, std::memory_order_relaxed);
+    });
+
+    std::streambuf* console = std::cout.rdbuf(nullptr);
+    bool started = server.start();
+
+    std::vector<std::unique_ptr<MqttClient>> clients;
+    for (size_t p = 0; p < publishers; ++p) {
+        clients.push_back(std::make_unique<MqttClient>("ingest_bench_pub_" + std::to_string(p), host, port));
+        clients.back()->setPublishQueueLimit(per_publisher);
+        started = started && clients.back()->connect();
+        clients.back()->start();
+    }
+    if (!started || !waitConnected(clients)) {
+        std::cout.rdbuf(console);
+        std::cerr << "failed to connect to " << host << ":" << port << std::endl;
+        for (auto& client : clients) {
+            client->stop();
+        }
+        server.stop();
+        return false;
+    }
+    // 等待服务端的订阅（共享订阅组的全部成员）生效
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+
+    uint64_t total = static_cast<uint64_t>(per_publisher) * publishers;
+    auto start = Clock::now();
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < publishers; ++p) {
+        threads.emplace_back([&, p]() {
+            for (size_t i = 0; i < per_publisher; ++i) {
+                std::string topic = "device/bench-" + std::to_string(p) + "-" +
+                                    std::to_string(i % DEVICES_PER_PUBLISHER) + "/status";
+                while (!clients[p]->publishAsync(topic, statusPayload(i), 1)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double publish_seconds = elapsedSeconds(start);
+
+    // 处理进度停滞5秒视为结束（broker 可能丢弃积压的消息）
+    uint64_t last = 0;
+    auto last_progress = Clock::now();
+    while (processed.load() < total && Clock::now() - last_progress < std::chrono::seconds(5)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        if (processed.load() != last) {
+            last = processed.load();
+            last_progress = Clock::now();
+        }
+    }
+    double seconds = elapsedSeconds(start);
+    if (processed.load() < total) {
+        seconds = std::chrono::duration<double>(last_progress - start).count();
+    }
+
+    for (auto& client : clients) {
+        client->stop();
+    }
+    server.stop();
+    std::cout.rdbuf(console);
+
+    std::cout << std::left << std::fixed << std::setprecision(1);
+    std::cout << "  " << std::setw(28)
+              << (connections == 0 ? std::string("single connection") : std::to_string(connections) + " shared connections")
+              << processed.load() << "/" << total << " status messages in " << std::setprecision(2) << seconds
+              << " s, " << std::setprecision(1) << processed.load() / seconds / 1e3 << " k msg/s (published in "
+              << std::setprecision(2) << publish_seconds << " s)" << std::endl;
+    return processed.load() == total;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string host = argc > 1 ? argv[1] : "localhost";
+    int port = argc > 2 ? std::atoi(argv[2]) : 1883;
+    size_t per_publisher = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 100000;
+    size_t publishers = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 4;
+    std::vector<size_t> connection_counts;
+    for (int i = 5; i < argc; ++i) {
+        connection_counts.push_back(std::strtoull(argv[i], nullptr, 10));
+    }
+    if (connection_counts.empty()) {
+        connection_counts = {0, 1, 2, 4, 8};
+    }
+
+    std::cout << publishers << " publishers x " << per_publisher << " qos1 status messages against " << host << ":"
+              << port << std::endl;
+    bool ok = true;
+    for (size_t connections : connection_counts) {
+        ok = measure(host, port, connections, per_publisher, publishers) && ok;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,151 @@
+#include "ingress_pool.h"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdlib>
+
+// 入站工作线程池降载压力测试（无需MQTT broker）
+// 1. 降载投递开销：工作线程阻塞时持续投递同一批设备的状态，测量合并状态时每条消息的投递耗时
+// 2. 降载语义：排队中的关键帧和增量不被后续状态取代，被合并的状态不会越过其间到达的结构声明和命令响应
+// 用法: ingress_stress [消息数量]
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const size_t CAPACITY = 64;
+
+struct Processed {
+    IngressKind kind;
+    std::string device_id;
+    std::string payload;
+};
+
+// 第一条消息阻塞工作线程，直到 release() 被调用；之后记录处理的消息
+class GatedHandler {
+public:
+    void operator()(const IngressMessage& message) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!m_entered) {
+            m_entered = true;
+            m_cv.notify_all();
+            m_cv.wait(lock, [this]() { return m_released; });
+            return;
+        }
+        m_processed.push_back(Processed{message.kind, message.device_id, message.payload});
+    }
+
+    void waitEntered() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [this]() { return m_entered; });
+    }
+
+    void release() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_released = true;
+        m_cv.notify_all();
+    }
+
+    std::vector<Processed> processed(const std::string& device_id) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::vector<Processed> result;
+        for (const auto& message : m_processed) {
+            if (message.device_id == device_id) {
+                result.push_back(message);
+            }
+        }
+        return result;
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_entered = false;
+    bool m_released = false;
+    std::vector<Processed> m_processed;
+};
+
+// 阻塞唯一的工作线程并用其他设备的心跳把积压推到高水位，之后的投递都处于降载模式
+void enterShedding(IngressPool& pool, GatedHandler& handler) {
+    pool.start();
+    pool.submit(IngressKind::STATUS, "gate", "{}");
+    handler.waitEntered();
+    for (size_t i = 0; i + 1 < CAPACITY - CAPACITY / 4; ++i) {
+        pool.submit(IngressKind::HEARTBEAT, "filler-" + std::to_string(i), "{}");
+    }
+}
+
+bool measureShedding(size_t count) {
+    GatedHandler handler;
+    IngressPool pool(1, CAPACITY, [&handler](const IngressMessage& message) { handler(message); });
+    enterShedding(pool, handler);
+
+    const size_t devices = CAPACITY / 8;
+    std::vector<std::string> ids;
+    for (size_t i = 0; i < devices; ++i) {
+        ids.push_back("sensor-" + std::to_string(i));
+    }
+    std::string payload = R"({"status":"online","properties":{"temperature":21.5}})";
+
+    auto start = Clock::now();
+    for (size_t i = 0; i < count; ++i) {
+        pool.submit(IngressKind::STATUS, ids[i % devices], payload);
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    IngressStats stats = pool.stats();
+    handler.release();
+    pool.stop();
+
+    // 除每个设备第一条外全部被合并，积压不超过容量
+    bool ok = stats.coalesced_statuses == count - devices && stats.queue_depth <= CAPACITY &&
+              handler.processed(ids[0]).size() == 1;
+    std::cout << std::fixed << std::setprecision(1) << "coalescing " << count << " statuses over " << devices
+              << " devices: " << seconds * 1e9 / count << " ns/msg, " << stats.coalesced_statuses
+              << " coalesced, depth " << stats.queue_depth << ": " << (ok ? "ok" : "FAILED") << std::endl;
+    return ok;
+}
+
+bool checkVersionedAndOrdering() {
+    GatedHandler handler;
+    IngressPool pool(1, CAPACITY, [&handler](const IngressMessage& message) { handler(message); });
+    enterShedding(pool, handler);
+
+    const std::string keyframe = R"({"full":true,"properties":{"temperature":{"value":21.5}},"status":"online","version":7})";
+    const std::string delta = R"({"full":false,"properties":{"temperature":{"value":22}},"status":"online","version":8})";
+    const std::string first = R"({"status":"online","properties":{"temperature":1}})";
+    const std::string last = R"({"status":"online","properties":{"temperature":2}})";
+    pool.submit(IngressKind::STATUS, "device-1", keyframe);
+    pool.submit(IngressKind::STATUS, "device-1", delta);
+    pool.submit(IngressKind::STATUS, "device-1", first);
+    pool.submit(IngressKind::SCHEMA, "device-1", "{}");
+    pool.submit(IngressKind::RESPONSE, "device-1", "{}");
+    pool.submit(IngressKind::STATUS, "device-1", last);
+    IngressStats stats = pool.stats();
+    handler.release();
+    pool.stop();
+
+    // 关键帧和增量都保留，first 被 last 取代，last 排在结构声明和命令响应之后
+    std::vector<Processed> processed = handler.processed("device-1");
+    bool ok = stats.shedding_workers == 1 && stats.coalesced_statuses == 1 && processed.size() == 5 &&
+              processed[0].payload == keyframe && processed[1].payload == delta &&
+              processed[2].kind == IngressKind::SCHEMA && processed[3].kind == IngressKind::RESPONSE &&
+              processed[4].payload == last;
+    std::cout << "keyframe, delta, status, schema, response, status while shedding: " << processed.size()
+              << " processed, " << stats.coalesced_statuses << " coalesced: " << (ok ? "ok" : "FAILED") << std::endl;
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+
+    bool ok = measureShedding(count);
+    ok = checkVersionedAndOrdering() && ok;
+    return ok ? 0 : 1;
+}
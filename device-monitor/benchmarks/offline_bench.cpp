@@ -0,0 +1,146 @@
+#include "offline_spool.h"
+#include "mqtt_client.h"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <cstdlib>
+#include <unistd.h>
+
+// 离线发布缓冲基准测试（不需要MQTT broker）
+// 1. 写入：状态消息追加到内存映射环形文件的每条耗时和吞吐（文件写满后每次追加都要丢弃最旧的消息）
+// 2. 读取：按重放顺序读取并移除每条消息的耗时
+// 3. 恢复：重新打开写满的文件时逐条校验并恢复的耗时
+// 4. 转存：未连接的 MqttClient 异步发布后由网络线程转存到文件的吞吐（内存中只保留少量消息）
+// 5. 旧值丢弃：断线期间每台设备的心跳（只保留最新值）和状态交替写入，重放前丢弃被取代的心跳
+// 用法: offline_bench [消息数] [文件容量MiB] [缓冲文件路径]
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double elapsedSeconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+const std::string PAYLOAD =
+    R"({"device_id":"sensor-000123","status":"online","properties":{"temperature":{"value":23.5,"unit":"°C"}},"timestamp":1700000000})";
+
+OfflineSpool::Record statusRecord(size_t device) {
+    OfflineSpool::Record record;
+    record.topic = "device/sensor-" + std::to_string(device) + "/status";
+    record.payload = PAYLOAD;
+    record.qos = 1;
+    return record;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    size_t capacity = (argc > 2 ? std::strtoull(argv[2], nullptr, 10) : OfflineSpool::DEFAULT_CAPACITY >> 20) << 20;
+    std::string path = argc > 3 ? argv[3] : "/tmp/offline_bench.spool";
+    if (count == 0) {
+        std::cerr << "need at least one message" << std::endl;
+        return 1;
+    }
+    unlink(path.c_str());
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << count << " messages of " << PAYLOAD.size() << " bytes, " << (capacity >> 20) << " MiB ring file "
+              << path << std::endl;
+
+    // 1. 写入
+    OfflineSpool spool;
+    if (!spool.open(path, capacity)) {
+        return 1;
+    }
+    OfflineSpool::Record record = statusRecord(0);
+    auto start = Clock::now();
+    for (size_t i = 0; i < count; ++i) {
+        spool.push(record);
+    }
+    double push_seconds = elapsedSeconds(start);
+    std::cout << "  push: " << push_seconds * 1e9 / count << " ns/msg ("
+              << count / push_seconds / 1e6 << "M msg/s), " << spool.size() << " kept, "
+              << spool.dropped() << " oldest dropped" << std::endl;
+
+    // 3. 恢复（在读取之前，文件处于写满状态）
+    size_t kept = spool.size();
+    spool.close();
+    start = Clock::now();
+    if (!spool.open(path, capacity)) {
+        return 1;
+    }
+    double recover_ms = elapsedSeconds(start) * 1000;
+
+    // 2. 读取
+    start = Clock::now();
+    size_t checksum = 0;
+    while (spool.front(record)) {
+        checksum += record.payload.size();
+        spool.pop();
+    }
+    double pop_seconds = elapsedSeconds(start);
+    std::cout << "  front+pop: " << pop_seconds * 1e9 / kept << " ns/msg (checksum " << checksum << ")" << std::endl;
+    std::cout << "  recovery: " << spool.recovered() << " messages in " << recover_ms << " ms" << std::endl;
+    spool.close();
+
+    // 4. 转存：网络线程运行但未连接，超出内存限额的消息写入文件
+    unlink(path.c_str());
+    {
+        MqttClient client("offline_bench");
+        client.setPublishQueueLimit(count + 1);
+        if (!client.setOfflineBuffer(path, capacity, 100)) {
+            return 1;
+        }
+        client.start();
+        size_t spill_count = std::min<size_t>(count, 200000);
+        start = Clock::now();
+        for (size_t i = 0; i < spill_count; ++i) {
+            client.publishAsync(record.topic, PAYLOAD, 1);
+        }
+        while (client.publishQueueStats().spooled + 100 < spill_count) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        double spill_seconds = elapsedSeconds(start);
+        PublishQueueStats stats = client.publishQueueStats();
+        std::cout << "  spill via MqttClient: " << spill_count / spill_seconds / 1e6 << "M msg/s, "
+                  << stats.spooled << " spooled, " << stats.depth << " in memory" << std::endl;
+        client.stop();
+    }
+    unlink(path.c_str());
+
+    // 5. 旧值丢弃：100台设备，每条状态之间穿插一次心跳
+    if (!spool.open(path, capacity)) {
+        return 1;
+    }
+    const size_t devices = 100;
+    size_t written = 0;
+    for (size_t i = 0; written + 2 <= count && spool.dropped() == 0; ++i, written += 2) {
+        OfflineSpool::Record heartbeat;
+        heartbeat.topic = "device/sensor-" + std::to_string(i % devices) + "/heartbeat";
+        heartbeat.payload = R"({"device_id":"sensor-000123","timestamp":1700000000})";
+        heartbeat.latest_only = true;
+        spool.push(heartbeat);
+        spool.push(statusRecord(i % devices));
+    }
+    size_t buffered = spool.size();
+    size_t replayed = 0;
+    size_t stale = 0;
+    while (spool.front(record)) {
+        if (spool.frontSuperseded()) {
+            ++stale;
+        } else {
+            ++replayed;
+        }
+        spool.pop();
+    }
+    std::cout << "  stale drop: " << buffered << " buffered, " << stale << " superseded heartbeats dropped, "
+              << replayed << " replayed (" << 100.0 * stale / buffered << "% less traffic)" << std::endl;
+    spool.close();
+    unlink(path.c_str());
+    return 0;
+}
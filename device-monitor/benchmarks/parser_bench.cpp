@@ -0,0 +1,263 @@
+#include "json_scanner.h"
+#include "message_codec.h"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <chrono>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// 入站消息解析基准测试（无需MQTT broker）
+// 对设备上报的状态（完整/增量）、服务端下发的命令和设备返回的响应，比较三种取字段的方式：
+//   stream     改造前：复制到字符串流，构建整条消息的 Json::Value 树后取字段
+//   decodeAny  线程复用的 jsoncpp 解析器构建 Json::Value 树后取字段
+//   scanner    在原始负载上就地扫描，只把属性/参数转换为 Json::Value
+// 输出每条消息的耗时和内存分配次数，并校验两种方式取得的字段一致
+// 用法: parser_bench [迭代次数]
+
+namespace {
+std::atomic<uint64_t> g_allocations{0};
+}
+
+void* operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+namespace {
+
+// 各类消息中处理函数使用的字段
+struct Fields {
+    std::string command_id;
+    std::string command_type;
+    std::string codec;
+    std::string status;
+    std::string device_type;
+    bool full = true;
+    uint64_t version = 0;
+    Json::Value body;       // 属性、命令参数或完整响应
+
+    bool operator==(const Fields& other) const {
+        return command_id == other.command_id && command_type == other.command_type && codec == other.codec &&
+               status == other.status && device_type == other.device_type && full == other.full &&
+               version == other.version && body == other.body;
+    }
+};
+
+enum class Kind { STATUS, COMMAND, RESPONSE };
+
+std::string compact(const Json::Value& message) {
+    return MessageCodec::get(MessageFormat::JSON).encode(message);
+}
+
+Json::Value statusMessage(bool full) {
+    Json::Value status;
+    status["device_id"] = "sensor-000123";
+    status["device_type"] = "temperature_sensor";
+    status["status"] = "online";
+    status["timestamp"] = static_cast<Json::Int64>(1700000000);
+    status["uptime"] = static_cast<Json::Int64>(86400);
+    status["codec"] = "json";
+    status["full"] = full;
+    status["version"] = static_cast<Json::UInt64>(42);
+    static const char* names[] = {"temperature", "humidity", "pressure", "battery", "voltage", "rssi"};
+    static const char* units[] = {"C", "%", "hPa", "%", "V", "dBm"};
+    for (int i = 0; i < (full ? 6 : 2); ++i) {
+        Json::Value& property = status["properties"][names[i]];
+        property["value"] = 20.5 + i * 3.25;
+        if (full) {
+            property["unit"] = units[i];
+            property["writable"] = i % 2 == 0;
+        }
+    }
+    if (full) {
+        status["properties"]["firmware"]["value"] = "1.4.2";
+        status["properties"]["firmware"]["unit"] = "";
+        status["properties"]["firmware"]["writable"] = false;
+    }
+    return status;
+}
+
+Json::Value commandMessage() {
+    Json::Value command;
+    command["command_id"] = "server001_1700000000_42";
+    command["command_type"] = "set_property";
+    command["parameters"]["property"] = "target_temperature";
+    command["parameters"]["value"] = 22.5;
+    command["timestamp"] = static_cast<Json::Int64>(1700000000);
+    return command;
+}
+
+Json::Value responseMessage() {
+    Json::Value response;
+    response["command_id"] = "server001_1700000000_42";
+    response["success"] = true;
+    response["timestamp"] = static_cast<Json::Int64>(1700000001);
+    response["result"]["property"] = "target_temperature";
+    response["result"]["value"] = 22.5;
+    return response;
+}
+
+// 与处理函数回退路径相同的取字段方式
+void readFields(Kind kind, Json::Value& root, Fields& fields) {
+    switch (kind) {
+    case Kind::STATUS:
+        fields.codec = root.get("codec", "").asString();
+        fields.status = root.get("status", "unknown").asString();
+        fields.device_type = root.get("device_type", "").asString();
+        fields.full = root.get("full", true).asBool();
+        fields.version = root.get("version", 0).asUInt64();
+        fields.body.swap(root["properties"]);
+        break;
+    case Kind::COMMAND:
+        fields.command_id = root.get("command_id", "").asString();
+        fields.command_type = root.get("command_type", "").asString();
+        fields.body = root.get("parameters", Json::Value());
+        break;
+    case Kind::RESPONSE:
+        fields.command_id = root.get("command_id", "").asString();
+        fields.body.swap(root);
+        break;
+    }
+}
+
+bool parseStream(Kind kind, const std::string& payload, Fields& fields) {
+    Json::CharReaderBuilder builder;
+    Json::Value root;
+    std::string errors;
+    std::istringstream stream(payload);
+    if (!Json::parseFromStream(builder, stream, &root, &errors)) {
+        return false;
+    }
+    readFields(kind, root, fields);
+    return true;
+}
+
+bool parseDecodeAny(Kind kind, const std::string& payload, Fields& fields) {
+    Json::Value root;
+    std::string errors;
+    if (!MessageCodec::decodeAny(payload, root, &errors)) {
+        return false;
+    }
+    readFields(kind, root, fields);
+    return true;
+}
+
+// 与处理函数快速路径相同的取字段方式；with_response 表示响应需要交给回调（构建完整响应值）
+bool parseScanner(Kind kind, const std::string& payload, Fields& fields, bool with_response) {
+    JsonScanner::ObjectReader reader(payload);
+    std::string_view key;
+    std::string_view value;
+    while (reader.next(key, value)) {
+        bool ok = true;
+        if (key == "command_id") {
+            ok = JsonScanner::toString(value, fields.command_id);
+        } else if (kind == Kind::COMMAND && key == "command_type") {
+            ok = JsonScanner::toString(value, fields.command_type);
+        } else if (kind == Kind::COMMAND && key == "parameters") {
+            ok = JsonScanner::toValue(value, fields.body);
+        } else if (kind == Kind::STATUS) {
+            if (key == "status") {
+                ok = JsonScanner::toString(value, fields.status);
+            } else if (key == "codec") {
+                ok = JsonScanner::toString(value, fields.codec);
+            } else if (key == "device_type") {
+                ok = JsonScanner::toString(value, fields.device_type);
+            } else if (key == "full") {
+                ok = JsonScanner::toBool(value, fields.full);
+            } else if (key == "version") {
+                ok = JsonScanner::toUInt64(value, fields.version);
+            } else if (key == "properties") {
+                ok = JsonScanner::toValue(value, fields.body);
+            }
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    if (kind == Kind::RESPONSE && with_response && !JsonScanner::toValue(payload, fields.body)) {
+        return false;
+    }
+    return reader.ok();
+}
+
+struct Result {
+    double nanos;
+    double allocs_per_op;
+};
+
+template <typename Fn>
+Result measure(size_t iterations, Fn&& fn) {
+    fn();
+    uint64_t allocs_before = g_allocations.load();
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        if (!fn()) {
+            std::cerr << "parse failed" << std::endl;
+            std::exit(1);
+        }
+    }
+    double nanos = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    uint64_t allocs = g_allocations.load() - allocs_before;
+    return Result{nanos / iterations, static_cast<double>(allocs) / iterations};
+}
+
+void print(const char* name, const Result& result) {
+    std::cout << std::left << std::setw(22) << name
+              << std::setw(14) << std::fixed << std::setprecision(1) << result.nanos
+              << std::setprecision(2) << result.allocs_per_op << std::endl;
+}
+
+void run(const char* name, Kind kind, const Json::Value& message, size_t iterations, bool with_response = false) {
+    std::string payload = compact(message);
+
+    // 校验就地扫描取得的字段与完整解码一致
+    Fields expected;
+    Fields actual;
+    if (!parseDecodeAny(kind, payload, expected) || !parseScanner(kind, payload, actual, true) || !(expected == actual)) {
+        std::cerr << name << ": scanner fields differ from jsoncpp" << std::endl;
+        std::exit(1);
+    }
+
+    std::cout << name << " (" << payload.size() << " bytes)" << std::endl;
+    std::cout << std::left << std::setw(22) << "path" << std::setw(14) << "ns/msg" << "allocs/msg" << std::endl;
+    print("stream", measure(iterations, [&]() {
+        Fields fields;
+        return parseStream(kind, payload, fields);
+    }));
+    print("decodeAny", measure(iterations, [&]() {
+        Fields fields;
+        return parseDecodeAny(kind, payload, fields);
+    }));
+    print("scanner", measure(iterations, [&]() {
+        Fields fields;
+        return parseScanner(kind, payload, fields, with_response);
+    }));
+    std::cout << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t iterations = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+
+    run("full status", Kind::STATUS, statusMessage(true), iterations);
+    run("delta status", Kind::STATUS, statusMessage(false), iterations);
+    run("command", Kind::COMMAND, commandMessage(), iterations);
+    run("response (command_id only)", Kind::RESPONSE, responseMessage(), iterations);
+    run("response (with callback)", Kind::RESPONSE, responseMessage(), iterations, true);
+    return 0;
+}
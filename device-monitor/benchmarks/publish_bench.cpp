@@ -0,0 +1,183 @@
+#include "mqtt_client.h"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <cstdlib>
+
+// 异步发布队列基准测试
+// 不需要MQTT broker的部分（客户端未连接，消息留在队列中）：
+// 1. 入队开销：1/2/4/8 个发布线程同时调用 publishAsync 的每条耗时
+// 2. 合并：网络线程运行时，多个线程向少量只保留最新值的主题持续发布，排队深度不超过主题数，
+//    被替换的消息都收到 COALESCED 完成回调
+// 3. 容量：超出队列容量的消息被拒绝入队
+// 指定 broker 时额外比较多个线程同步发布和异步发布（QoS 0 / QoS 1 带完成回调）的吞吐
+// 用法: publish_bench [每线程消息数] [broker地址 端口]
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double elapsedSeconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+const std::string PAYLOAD = R"({"device_id":"sensor-000123","status":"alive","timestamp":1700000000})";
+
+template <typename Fn>
+double runProducers(int threads, Fn&& fn) {
+    std::vector<std::thread> producers;
+    auto start = Clock::now();
+    for (int t = 0; t < threads; ++t) {
+        producers.emplace_back([&fn, t]() { fn(t); });
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    return elapsedSeconds(start);
+}
+
+bool measureEnqueue(size_t per_thread) {
+    std::cout << "enqueue cost (not connected, network thread idle)" << std::endl;
+    std::cout << std::left << std::fixed << std::setprecision(1);
+    bool ok = true;
+    for (int threads : {1, 2, 4, 8}) {
+        MqttClient client("publish_bench_enqueue");
+        client.setPublishQueueLimit(per_thread * threads);
+        double seconds = runProducers(threads, [&](int t) {
+            std::string topic = "device/sensor-" + std::to_string(t) + "/status";
+            for (size_t i = 0; i < per_thread; ++i) {
+                client.publishAsync(topic, PAYLOAD, 1);
+            }
+        });
+        PublishQueueStats stats = client.publishQueueStats();
+        double total = static_cast<double>(per_thread) * threads;
+        std::cout << "  " << threads << " producers: " << std::setw(8) << seconds * 1e9 / total * threads
+                  << " ns/msg per thread, " << total / seconds / 1e6 << " M msg/s" << std::endl;
+        ok = ok && stats.depth == per_thread * threads && stats.enqueued == stats.depth;
+    }
+    return ok;
+}
+
+bool checkCoalescing(size_t per_thread) {
+    const int threads = 4;
+    const int topics = 64;
+    MqttClient client("publish_bench_coalesce");
+    client.setPublishQueueLimit(per_thread * threads);
+    client.start();
+
+    std::atomic<uint64_t> coalesced_callbacks{0};
+    runProducers(threads, [&](int t) {
+        for (size_t i = 0; i < per_thread; ++i) {
+            std::string topic = "device/sensor-" + std::to_string((i + t) % topics) + "/heartbeat";
+            client.publishAsync(topic, PAYLOAD, 0, false, true, [&](PublishResult result) {
+                if (result == PublishResult::COALESCED) {
+                    coalesced_callbacks.fetch_add(1, std::memory_order_relaxed);
+                }
+            });
+        }
+    });
+
+    // 等待网络线程取走入队栈中的消息
+    PublishQueueStats stats = client.publishQueueStats();
+    for (int i = 0; i < 100 && stats.depth > static_cast<size_t>(topics); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        stats = client.publishQueueStats();
+    }
+    client.stop();
+    stats = client.publishQueueStats();
+
+    bool ok = stats.depth == static_cast<size_t>(topics) && stats.coalesced == stats.enqueued - stats.depth &&
+              coalesced_callbacks.load() == stats.coalesced;
+    std::cout << "coalescing " << stats.enqueued << " latest-value messages over " << topics << " topics: depth "
+              << stats.depth << " (peak " << stats.max_depth << "), " << stats.coalesced << " coalesced: "
+              << (ok ? "ok" : "FAILED") << std::endl;
+    return ok;
+}
+
+bool checkLimit() {
+    MqttClient client("publish_bench_limit");
+    client.setPublishQueueLimit(1000);
+    size_t accepted = 0;
+    for (int i = 0; i < 1500; ++i) {
+        accepted += client.publishAsync("device/sensor-1/status", PAYLOAD, 1) ? 1 : 0;
+    }
+    PublishQueueStats stats = client.publishQueueStats();
+    bool ok = accepted == 1000 && stats.rejected == 500 && stats.depth == 1000;
+    std::cout << "queue limit 1000: accepted " << accepted << ", rejected " << stats.rejected << ": "
+              << (ok ? "ok" : "FAILED") << std::endl;
+    return ok;
+}
+
+bool measureBroker(const std::string& host, int port, size_t per_thread) {
+    const int threads = 4;
+    MqttClient client("publish_bench_broker", host, port);
+    client.setPublishQueueLimit(per_thread * threads);
+    if (!client.connect()) {
+        return false;
+    }
+    client.start();
+    for (int i = 0; i < 50 && !client.isConnected(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    if (!client.isConnected()) {
+        std::cerr << "broker did not accept the connection" << std::endl;
+        return false;
+    }
+
+    double total = static_cast<double>(per_thread) * threads;
+    std::cout << std::endl << threads << " producers against " << host << ":" << port << std::endl;
+
+    double seconds = runProducers(threads, [&](int t) {
+        std::string topic = "bench/publish/" + std::to_string(t);
+        for (size_t i = 0; i < per_thread; ++i) {
+            client.publish(topic, PAYLOAD, 0);
+        }
+    });
+    std::cout << "  sync publish qos0      " << total / seconds / 1e3 << " k msg/s" << std::endl;
+
+    for (int qos : {0, 1}) {
+        std::atomic<uint64_t> completed{0};
+        auto start = Clock::now();
+        runProducers(threads, [&](int t) {
+            std::string topic = "bench/publish/" + std::to_string(t);
+            for (size_t i = 0; i < per_thread; ++i) {
+                while (!client.publishAsync(topic, PAYLOAD, qos, false, false, [&](PublishResult result) {
+                    if (result == PublishResult::SENT) {
+                        completed.fetch_add(1, std::memory_order_relaxed);
+                    }
+                })) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+        double enqueue_seconds = elapsedSeconds(start);
+        while (completed.load() < per_thread * threads && elapsedSeconds(start) < 60) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        double complete_seconds = elapsedSeconds(start);
+        PublishQueueStats stats = client.publishQueueStats();
+        std::cout << "  async publish qos" << qos << "     " << total / complete_seconds / 1e3 << " k msg/s completed ("
+                  << total / enqueue_seconds / 1e3 << " k msg/s enqueued, " << stats.batches << " batches so far, peak depth "
+                  << stats.max_depth << ")" << std::endl;
+    }
+    client.stop();
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t per_thread = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+
+    bool ok = measureEnqueue(per_thread);
+    ok = checkCoalescing(per_thread) && ok;
+    ok = checkLimit() && ok;
+    if (argc > 3) {
+        ok = measureBroker(argv[2], std::atoi(argv[3]), per_thread / 10) && ok;
+    }
+    return ok ? 0 : 1;
+}
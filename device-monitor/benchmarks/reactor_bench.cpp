@@ -0,0 +1,202 @@
+#include "mqtt_client.h"
+#include "mqtt_reactor.h"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <algorithm>
+#include <cstdlib>
+#include <sys/resource.h>
+
+// 共享反应器基准测试
+// 不需要MQTT broker的部分：
+// 1. 线程数：N 个客户端各自使用网络线程，与 N 个客户端共用少量反应器线程的进程线程数
+// 2. 定时器：反应器模式下每个客户端带状态上报和心跳两个1秒周期定时器，回调中异步发布，
+//    统计触发次数和相对计划时间的延迟
+// 指定 broker 时额外测量 N 个客户端经反应器连接完成的耗时和异步发布吞吐
+// 用法: reactor_bench [客户端数量] [反应器线程数] [broker地址 端口]
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+int processThreads() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 8, "Threads:") == 0) {
+            return std::atoi(line.c_str() + 8);
+        }
+    }
+    return -1;
+}
+
+// 每个客户端至少需要一个套接字，线程模式还需要一个唤醒管道
+void raiseFileLimit() {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+std::string clientId(size_t i) {
+    return "reactor_bench_" + std::to_string(i);
+}
+
+void measureThreadMode(size_t count) {
+    int before = processThreads();
+    std::vector<std::unique_ptr<MqttClient>> clients;
+    for (size_t i = 0; i < count; ++i) {
+        clients.push_back(std::make_unique<MqttClient>(clientId(i)));
+        clients.back()->setAutoReconnect(true, 3600);
+        clients.back()->start();
+    }
+    int during = processThreads();
+    for (auto& client : clients) {
+        client->stop();
+    }
+    std::cout << "thread per client: " << count << " clients -> " << during - before << " threads" << std::endl;
+}
+
+bool measureReactorMode(size_t count, size_t threads, int seconds) {
+    MqttReactor reactor(threads);
+    int before = processThreads();
+    reactor.start();
+
+    std::vector<std::unique_ptr<MqttClient>> clients;
+    for (size_t i = 0; i < count; ++i) {
+        clients.push_back(std::make_unique<MqttClient>(clientId(i)));
+        clients.back()->setReactor(&reactor);
+        clients.back()->setAutoReconnect(true, 3600);
+        clients.back()->start();
+    }
+
+    // 每个客户端两个1秒周期定时器，回调中异步发布只保留最新值的消息
+    std::mutex lateness_mutex;
+    std::vector<double> lateness_ms;
+    std::atomic<uint64_t> fired{0};
+    std::vector<uint64_t> timers;
+    auto start = Clock::now();
+    for (size_t i = 0; i < count; ++i) {
+        MqttClient* client = clients[i].get();
+        for (const char* kind : {"status", "heartbeat"}) {
+            std::string topic = "device/" + clientId(i) + "/" + kind;
+            auto scheduled = std::make_shared<Clock::time_point>(Clock::now() + std::chrono::seconds(1));
+            timers.push_back(reactor.addTimer(std::chrono::seconds(1), [&, client, topic, scheduled]() {
+                double late = std::chrono::duration<double, std::milli>(Clock::now() - *scheduled).count();
+                *scheduled += std::chrono::seconds(1);
+                client->publishAsync(topic, R"({"status":"alive"})", 0, false, true);
+                fired.fetch_add(1, std::memory_order_relaxed);
+                std::lock_guard<std::mutex> lock(lateness_mutex);
+                lateness_ms.push_back(late);
+            }));
+        }
+    }
+    int during = processThreads();
+    std::this_thread::sleep_for(std::chrono::seconds(seconds) + std::chrono::milliseconds(200));
+
+    for (uint64_t id : timers) {
+        reactor.cancelTimer(id);
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    size_t depth = 0;
+    for (auto& client : clients) {
+        depth += client->publishQueueStats().depth;
+    }
+    size_t attached = reactor.clientCount();
+    for (auto& client : clients) {
+        client->stop();
+    }
+    size_t detached = reactor.clientCount();
+    reactor.stop();
+
+    std::sort(lateness_ms.begin(), lateness_ms.end());
+    double p50 = lateness_ms.empty() ? 0 : lateness_ms[lateness_ms.size() / 2];
+    double p99 = lateness_ms.empty() ? 0 : lateness_ms[lateness_ms.size() * 99 / 100];
+    double max = lateness_ms.empty() ? 0 : lateness_ms.back();
+    uint64_t expected = static_cast<uint64_t>(count) * 2 * seconds;
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "reactor (" << threads << " threads): " << count << " clients, " << timers.size() << " timers -> "
+              << during - before << " threads" << std::endl;
+    std::cout << "  " << fired.load() << " timer callbacks in " << elapsed << " s (expected >= " << expected
+              << "), lateness p50 " << p50 << " ms, p99 " << p99 << " ms, max " << max << " ms" << std::endl;
+    std::cout << "  queued latest-value messages while disconnected: " << depth << " (" << count * 2 << " topics)"
+              << std::endl;
+
+    bool ok = during - before == static_cast<int>(threads) && fired.load() >= expected && depth == count * 2 &&
+              attached == count && detached == 0;
+    std::cout << "  " << (ok ? "ok" : "FAILED") << std::endl;
+    return ok;
+}
+
+bool measureBroker(size_t count, size_t threads, const std::string& host, int port) {
+    MqttReactor reactor(threads);
+    reactor.start();
+    std::vector<std::unique_ptr<MqttClient>> clients;
+    auto start = Clock::now();
+    for (size_t i = 0; i < count; ++i) {
+        clients.push_back(std::make_unique<MqttClient>(clientId(i), host, port));
+        clients.back()->setReactor(&reactor);
+        clients.back()->start();
+        if (!clients.back()->connect()) {
+            return false;
+        }
+    }
+    auto all_connected = [&]() {
+        return std::all_of(clients.begin(), clients.end(), [](const auto& c) { return c->isConnected(); });
+    };
+    while (!all_connected() && Clock::now() - start < std::chrono::seconds(60)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    double connect_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    if (!all_connected()) {
+        std::cerr << "not all clients connected within 60 s" << std::endl;
+        return false;
+    }
+
+    const size_t per_client = 1000;
+    std::atomic<uint64_t> completed{0};
+    start = Clock::now();
+    for (size_t n = 0; n < per_client; ++n) {
+        for (size_t i = 0; i < count; ++i) {
+            while (!clients[i]->publishAsync("bench/reactor/" + std::to_string(i), "x", 1, false, false,
+                                              [&](PublishResult) { completed.fetch_add(1, std::memory_order_relaxed); })) {
+                std::this_thread::yield();
+            }
+        }
+    }
+    while (completed.load() < per_client * count && Clock::now() - start < std::chrono::seconds(120)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    double publish_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::cout << std::endl << count << " clients on " << threads << " reactor threads against " << host << ":" << port
+              << ": connected in " << connect_seconds << " s, " << per_client * count / publish_seconds / 1e3
+              << " k qos1 msg/s acknowledged, " << processThreads() << " process threads" << std::endl;
+    for (auto& client : clients) {
+        client->stop();
+    }
+    return completed.load() == per_client * count;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000;
+    size_t threads = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 2;
+    raiseFileLimit();
+
+    measureThreadMode(count);
+    bool ok = measureReactorMode(count, threads, 3);
+    if (argc > 4) {
+        ok = measureBroker(count, threads, argv[3], std::atoi(argv[4])) && ok;
+    }
+    return ok ? 0 : 1;
+}
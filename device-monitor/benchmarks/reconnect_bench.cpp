@@ -0,0 +1,135 @@
+#include "reconnect_backoff.h"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <deque>
+#include <queue>
+#include <functional>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+
+// 重连风暴基准测试（不需要MQTT broker，离散事件模拟）
+// 模拟 N 个客户端同时断线，broker 停机一段时间后恢复；恢复后 broker 每秒最多完成一定数量的连接握手，
+// 超出容量的连接尝试失败，客户端按各自的策略等待后重试。比较两种策略：
+// 1. 固定间隔：所有客户端按相同的间隔同步重试（原重连线程的行为）
+// 2. 去相关抖动的指数退避（ReconnectBackoff，与 MqttClient 使用的实现相同）
+// 输出：broker 恢复后全部客户端重新连接所需时间、单个客户端恢复时间的中位数和P99、
+//       恢复后每100毫秒连接尝试数的峰值、失败的尝试次数，以及退避计算的耗时
+// 用法: reconnect_bench [客户端数量] [停机秒数] [broker每秒握手容量] [初始间隔毫秒] [间隔上限毫秒]
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int64_t WINDOW_MS = 100;
+
+struct Result {
+    int64_t full_recovery_ms = 0;   // broker 恢复到最后一个客户端连接的时间
+    int64_t p50_ms = 0;             // 单个客户端恢复时间中位数
+    int64_t p99_ms = 0;             // 单个客户端恢复时间P99
+    uint32_t peak_attempts = 0;     // 恢复后每个窗口连接尝试数的峰值
+    uint64_t failed_attempts = 0;   // 失败的连接尝试
+};
+
+// delay(client) 返回客户端下一次重试前的等待（毫秒），所有客户端在时刻0断线
+Result simulate(size_t clients, int64_t outage_ms, uint32_t per_window,
+                const std::function<int64_t(size_t)>& delay) {
+    using Event = std::pair<int64_t, size_t>;
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+    for (size_t i = 0; i < clients; ++i) {
+        events.emplace(delay(i), i);
+    }
+
+    Result result;
+    std::vector<uint32_t> attempts;     // 每个窗口的连接尝试数
+    std::vector<uint32_t> accepted;     // 每个窗口完成的握手数
+    std::vector<int64_t> recovered;
+    recovered.reserve(clients);
+    while (!events.empty()) {
+        Event event = events.top();
+        events.pop();
+        size_t window = static_cast<size_t>(event.first / WINDOW_MS);
+        if (window >= attempts.size()) {
+            attempts.resize(window + 1, 0);
+            accepted.resize(window + 1, 0);
+        }
+        attempts[window]++;
+        if (event.first >= outage_ms && accepted[window] < per_window) {
+            accepted[window]++;
+            recovered.push_back(event.first - outage_ms);
+            continue;
+        }
+        result.failed_attempts++;
+        events.emplace(event.first + delay(event.second), event.second);
+    }
+
+    std::sort(recovered.begin(), recovered.end());
+    result.full_recovery_ms = recovered.back();
+    result.p50_ms = recovered[recovered.size() / 2];
+    result.p99_ms = recovered[std::min(recovered.size() - 1, recovered.size() * 99 / 100)];
+    for (size_t window = static_cast<size_t>(outage_ms / WINDOW_MS); window < attempts.size(); ++window) {
+        result.peak_attempts = std::max(result.peak_attempts, attempts[window]);
+    }
+    return result;
+}
+
+void print(const char* name, const Result& result) {
+    std::cout << "  " << std::left << std::setw(16) << name << std::right
+              << " full recovery " << std::setw(8) << result.full_recovery_ms / 1000.0 << " s"
+              << "  p50 " << std::setw(7) << result.p50_ms / 1000.0 << " s"
+              << "  p99 " << std::setw(7) << result.p99_ms / 1000.0 << " s"
+              << "  peak " << std::setw(5) << result.peak_attempts << " attempts/100ms"
+              << "  failed " << result.failed_attempts << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t clients = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 5000;
+    int64_t outage_ms = (argc > 2 ? std::strtoll(argv[2], nullptr, 10) : 30) * 1000;
+    uint32_t capacity = argc > 3 ? static_cast<uint32_t>(std::strtoul(argv[3], nullptr, 10)) : 2000;
+    int initial_ms = argc > 4 ? std::atoi(argv[4]) : 5000;
+    int max_ms = argc > 5 ? std::atoi(argv[5]) : ReconnectBackoff::DEFAULT_MAX_MS;
+    uint32_t per_window = static_cast<uint32_t>(capacity * WINDOW_MS / 1000);
+    if (clients == 0 || per_window == 0 || initial_ms <= 0) {
+        std::cerr << "need at least one client, 10 handshakes per second and a positive interval" << std::endl;
+        return 1;
+    }
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << clients << " clients, broker down " << outage_ms / 1000 << " s, "
+              << capacity << " handshakes/s, initial " << initial_ms << " ms, cap " << max_ms << " ms" << std::endl;
+
+    // 固定间隔：所有客户端同时断线，按相同间隔同步重试
+    Result fixed = simulate(clients, outage_ms, per_window, [&](size_t) {
+        return static_cast<int64_t>(initial_ms);
+    });
+    print("fixed interval", fixed);
+
+    // 去相关抖动：每个客户端独立的退避状态和随机数
+    std::deque<ReconnectBackoff> backoffs;
+    for (size_t i = 0; i < clients; ++i) {
+        backoffs.emplace_back(initial_ms, max_ms, i + 1);
+    }
+    Result jittered = simulate(clients, outage_ms, per_window, [&](size_t client) {
+        return static_cast<int64_t>(backoffs[client].next().count());
+    });
+    print("jittered backoff", jittered);
+
+    // 退避计算耗时
+    ReconnectBackoff backoff(initial_ms, max_ms, 1);
+    const size_t iterations = 10000000;
+    int64_t checksum = 0;
+    auto start = Clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        if ((i & 7) == 0) {
+            backoff.reset();
+        }
+        checksum += backoff.next().count();
+    }
+    double next_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations;
+    std::cout << "  backoff next(): " << next_ns << " ns/call (checksum " << checksum << ")" << std::endl;
+    return 0;
+}
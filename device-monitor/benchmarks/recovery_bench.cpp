@@ -0,0 +1,128 @@
+#include "device_registry.h"
+#include "registry_store.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <thread>
+
+// 注册表持久化基准测试（无需MQTT broker）
+// 对每个注册表规模：填充设备 -> 写快照 -> 追加一批WAL更新 -> 在空注册表中恢复，报告各阶段耗时
+// 用法: recovery_bench [数据目录] [最大设备数量] [WAL更新占设备数的百分比]
+
+namespace {
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+uint64_t directoryBytes(const std::string& path) {
+    uint64_t total = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(path)) {
+        if (entry.is_regular_file()) {
+            total += entry.file_size();
+        }
+    }
+    return total;
+}
+
+void fillStatus(DeviceStatus& status, size_t index, int round) {
+    static const char* types[] = {"sensor", "actuator", "gateway", "camera"};
+    status.status = index % 10 == 0 ? "offline" : "online";
+    status.device_type = types[index % 4];
+    Json::Value properties;
+    properties["temperature"] = 20.0 + (index % 100) * 0.1 + round;
+    properties["humidity"] = static_cast<int>(40 + index % 30);
+    properties["firmware"] = "1.4.2";
+    status.properties = properties;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string data_dir = argc > 1 ? argv[1] : "recovery_bench_data";
+    size_t max_devices = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1000000;
+    size_t update_percent = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 10;
+
+    std::cout << std::left << std::setw(10) << "devices"
+              << std::setw(14) << "snapshot(s)"
+              << std::setw(12) << "wal recs"
+              << std::setw(12) << "disk(MB)"
+              << std::setw(14) << "recovery(s)"
+              << "devices/s" << std::endl;
+
+    for (size_t device_count = 10000; device_count <= max_devices; device_count *= 10) {
+        std::filesystem::remove_all(data_dir);
+
+        // 填充注册表并写入快照
+        double snapshot_seconds = 0.0;
+        size_t updates = device_count * update_percent / 100;
+        {
+            DeviceRegistry registry(64, device_count);
+            RegistryStore store(data_dir);
+            store.setSnapshotInterval(0);
+            if (!store.open(registry)) {
+                return 1;
+            }
+
+            for (size_t i = 0; i < device_count; ++i) {
+                registry.update("device" + std::to_string(i), [&](DeviceStatus& status) {
+                    fillStatus(status, i, 0);
+                });
+            }
+            auto start = std::chrono::steady_clock::now();
+            store.snapshot();
+            snapshot_seconds = secondsSince(start);
+
+            // 快照之后的修改只存在于WAL中，恢复时需要重放
+            for (size_t i = 0; i < updates; ++i) {
+                size_t index = (i * 7919) % device_count;
+                registry.update("device" + std::to_string(index), [&](DeviceStatus& status) {
+                    fillStatus(status, index, 1);
+                    store.logUpsert(status);
+                });
+            }
+
+            // 模拟崩溃：不写最终快照，只保证WAL已落盘
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            RegistryStoreStats stats = store.stats();
+            if (stats.wal_records != updates) {
+                std::cerr << "Unexpected WAL record count: " << stats.wal_records << std::endl;
+            }
+            std::filesystem::copy(data_dir, data_dir + ".crash");
+        }
+        std::filesystem::remove_all(data_dir);
+        std::filesystem::rename(data_dir + ".crash", data_dir);
+        uint64_t disk_bytes = directoryBytes(data_dir);
+
+        // 在空注册表中恢复
+        DeviceRegistry registry(64);
+        RegistryStore store(data_dir);
+        store.setSnapshotInterval(0);
+        auto start = std::chrono::steady_clock::now();
+        if (!store.open(registry)) {
+            return 1;
+        }
+        double recovery_seconds = secondsSince(start);
+        RegistryStoreStats stats = store.stats();
+
+        if (registry.size() != device_count || stats.replayed_records != updates) {
+            std::cerr << "Recovery mismatch: " << registry.size() << " devices, "
+                      << stats.replayed_records << " records replayed" << std::endl;
+            return 1;
+        }
+
+        std::cout << std::left << std::setw(10) << device_count
+                  << std::setw(14) << std::fixed << std::setprecision(3) << snapshot_seconds
+                  << std::setw(12) << updates
+                  << std::setw(12) << std::setprecision(1) << disk_bytes / 1048576.0
+                  << std::setw(14) << std::setprecision(3) << recovery_seconds
+                  << static_cast<uint64_t>(device_count / recovery_seconds) << std::endl;
+    }
+
+    std::filesystem::remove_all(data_dir);
+    return 0;
+}
@@ -0,0 +1,109 @@
+#include "device_registry.h"
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdlib>
+
+// 设备注册表心跳吞吐基准测试
+// 对比单锁 std::map（旧实现）与分片注册表在不同写入线程数下的心跳吞吐
+// 用法: registry_bench [设备数量] [每线程心跳次数] [最大线程数]
+
+namespace {
+
+// 旧实现：单个互斥锁保护的 std::map
+class LegacyRegistry {
+public:
+    void heartbeat(const std::string& device_id) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        DeviceStatus& status = m_devices[device_id];
+        status.device_id = device_id;
+        status.last_seen = std::chrono::system_clock::now();
+        if (status.status == "offline" || status.status.empty()) {
+            status.status = "online";
+        }
+    }
+
+private:
+    std::map<std::string, DeviceStatus> m_devices;
+    std::mutex m_mutex;
+};
+
+void shardedHeartbeat(DeviceRegistry& registry, const std::string& device_id) {
+    registry.update(device_id, [](DeviceStatus& status) {
+        status.last_seen = std::chrono::system_clock::now();
+        if (status.status == "offline" || status.status.empty()) {
+            status.status = "online";
+        }
+    });
+}
+
+template <typename Fn>
+double runThreads(int threads, size_t ops_per_thread, const std::vector<std::string>& ids, Fn&& heartbeat) {
+    std::vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            std::mt19937 gen(static_cast<unsigned>(t + 1));
+            std::uniform_int_distribution<size_t> dist(0, ids.size() - 1);
+            for (size_t i = 0; i < ops_per_thread; ++i) {
+                heartbeat(ids[dist(gen)]);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return static_cast<double>(threads) * ops_per_thread / seconds;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t device_count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 50000;
+    size_t ops_per_thread = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 500000;
+    int max_threads = argc > 3 ? std::atoi(argv[3]) : static_cast<int>(std::thread::hardware_concurrency());
+    if (max_threads < 1) {
+        max_threads = 1;
+    }
+
+    std::vector<std::string> ids;
+    ids.reserve(device_count);
+    for (size_t i = 0; i < device_count; ++i) {
+        ids.push_back("device" + std::to_string(i));
+    }
+
+    std::cout << "Devices: " << device_count << ", heartbeats per thread: " << ops_per_thread << std::endl;
+    std::cout << std::left << std::setw(10) << "threads"
+              << std::setw(20) << "map+mutex (op/s)"
+              << std::setw(20) << "sharded (op/s)"
+              << "speedup" << std::endl;
+
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        LegacyRegistry legacy;
+        DeviceRegistry sharded(64, device_count);
+        for (const auto& id : ids) {
+            legacy.heartbeat(id);
+            shardedHeartbeat(sharded, id);
+        }
+
+        double legacy_rate = runThreads(threads, ops_per_thread, ids,
+            [&legacy](const std::string& id) { legacy.heartbeat(id); });
+        double sharded_rate = runThreads(threads, ops_per_thread, ids,
+            [&sharded](const std::string& id) { shardedHeartbeat(sharded, id); });
+
+        std::cout << std::left << std::setw(10) << threads
+                  << std::setw(20) << static_cast<uint64_t>(legacy_rate)
+                  << std::setw(20) << static_cast<uint64_t>(sharded_rate)
+                  << std::fixed << std::setprecision(2) << sharded_rate / legacy_rate << "x" << std::endl;
+    }
+
+    return 0;
+}
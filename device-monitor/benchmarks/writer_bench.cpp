@@ -0,0 +1,259 @@
+#include "message_writer.h"
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <string>
+#include <chrono>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// 流式消息写入基准测试（无需MQTT broker）
+// 对状态、心跳、命令和响应四种固定结构的消息，比较“构建临时Json::Value树 + 每条消息新建StreamWriterBuilder”
+// 与“MessageWriter直接写入线程复用缓冲区”的耗时和每条消息的内存分配次数，并校验JSON输出逐字节一致
+// 用法: writer_bench [迭代次数]
+
+namespace {
+std::atomic<uint64_t> g_allocations{0};
+}
+
+void* operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+namespace {
+
+// 与设备端属性表相同的结构
+struct Property {
+    Json::Value value;
+    std::string unit;
+    bool writable;
+};
+
+struct Fixture {
+    std::string device_id = "sensor-000123";
+    std::string device_type = "temperature_sensor";
+    std::string status = "online";
+    std::string command_id = "server001_1700000000_42";
+    std::string command_type = "set_property";
+    std::map<std::string, Property> properties;
+    Json::Value parameters;
+    Json::Value result;
+    int64_t timestamp = 1700000000;
+
+    Fixture() {
+        static const char* names[] = {"battery", "humidity", "pressure", "rssi", "temperature", "voltage"};
+        static const char* units[] = {"%", "%", "hPa", "dBm", "C", "V"};
+        for (int i = 0; i < 6; ++i) {
+            properties[names[i]] = Property{Json::Value(20.5 + i * 3.25), units[i], i % 2 == 0};
+        }
+        properties["firmware"] = Property{Json::Value("1.4.2"), "", false};
+        parameters["property"] = "target_temperature";
+        parameters["value"] = 22.5;
+        result = parameters;
+    }
+};
+
+// 改造前的做法：构建Json::Value树再序列化
+Json::Value buildStatus(const Fixture& f) {
+    Json::Value status;
+    status["device_id"] = f.device_id;
+    status["device_type"] = f.device_type;
+    status["status"] = f.status;
+    status["timestamp"] = static_cast<Json::Int64>(f.timestamp);
+    status["uptime"] = static_cast<Json::Int64>(86400);
+    status["codec"] = "json";
+    Json::Value properties;
+    for (const auto& pair : f.properties) {
+        Json::Value prop;
+        prop["value"] = pair.second.value;
+        prop["unit"] = pair.second.unit;
+        prop["writable"] = pair.second.writable;
+        properties[pair.first] = prop;
+    }
+    status["properties"] = properties;
+    return status;
+}
+
+Json::Value buildHeartbeat(const Fixture& f) {
+    Json::Value heartbeat;
+    heartbeat["device_id"] = f.device_id;
+    heartbeat["status"] = f.status;
+    heartbeat["timestamp"] = static_cast<Json::Int64>(f.timestamp);
+    return heartbeat;
+}
+
+Json::Value buildCommand(const Fixture& f) {
+    Json::Value command;
+    command["command_id"] = f.command_id;
+    command["command_type"] = f.command_type;
+    command["parameters"] = f.parameters;
+    command["timestamp"] = static_cast<Json::Int64>(f.timestamp);
+    return command;
+}
+
+Json::Value buildResponse(const Fixture& f) {
+    Json::Value response;
+    response["command_id"] = f.command_id;
+    response["success"] = true;
+    response["timestamp"] = static_cast<Json::Int64>(f.timestamp);
+    response["result"] = f.result;
+    return response;
+}
+
+// 流式写入，与设备端和服务端的写法相同（键按字节序）
+void writeStatus(MessageWriter& w, const Fixture& f) {
+    w.beginObject(7);
+    w.key("codec");
+    w.writeString("json");
+    w.key("device_id");
+    w.writeString(f.device_id);
+    w.key("device_type");
+    w.writeString(f.device_type);
+    w.key("properties");
+    w.beginObject(f.properties.size());
+    for (const auto& pair : f.properties) {
+        w.key(pair.first);
+        w.beginObject(3);
+        w.key("unit");
+        w.writeString(pair.second.unit);
+        w.key("value");
+        w.writeValue(pair.second.value);
+        w.key("writable");
+        w.writeBool(pair.second.writable);
+        w.endObject();
+    }
+    w.endObject();
+    w.key("status");
+    w.writeString(f.status);
+    w.key("timestamp");
+    w.writeInt(f.timestamp);
+    w.key("uptime");
+    w.writeInt(86400);
+    w.endObject();
+}
+
+void writeHeartbeat(MessageWriter& w, const Fixture& f) {
+    w.beginObject(3);
+    w.key("device_id");
+    w.writeString(f.device_id);
+    w.key("status");
+    w.writeString(f.status);
+    w.key("timestamp");
+    w.writeInt(f.timestamp);
+    w.endObject();
+}
+
+void writeCommand(MessageWriter& w, const Fixture& f) {
+    w.beginObject(4);
+    w.key("command_id");
+    w.writeString(f.command_id);
+    w.key("command_type");
+    w.writeString(f.command_type);
+    w.key("parameters");
+    w.writeValue(f.parameters);
+    w.key("timestamp");
+    w.writeInt(f.timestamp);
+    w.endObject();
+}
+
+void writeResponse(MessageWriter& w, const Fixture& f) {
+    w.beginObject(4);
+    w.key("command_id");
+    w.writeString(f.command_id);
+    w.key("result");
+    w.writeValue(f.result);
+    w.key("success");
+    w.writeBool(true);
+    w.key("timestamp");
+    w.writeInt(f.timestamp);
+    w.endObject();
+}
+
+struct Result {
+    double nanos;
+    double allocs_per_op;
+    size_t bytes;
+};
+
+template <typename Fn>
+Result measure(size_t iterations, Fn&& fn) {
+    size_t bytes = fn();    // 预热：线程缓冲区增长到稳定容量
+    uint64_t allocs_before = g_allocations.load();
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        bytes = fn();
+    }
+    double nanos = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    uint64_t allocs = g_allocations.load() - allocs_before;
+    return Result{nanos / iterations, static_cast<double>(allocs) / iterations, bytes};
+}
+
+void print(const char* name, const Result& result) {
+    std::cout << std::left << std::setw(28) << name
+              << std::setw(10) << result.bytes
+              << std::setw(14) << std::fixed << std::setprecision(1) << result.nanos
+              << std::setprecision(2) << result.allocs_per_op << std::endl;
+}
+
+template <typename Build, typename Write>
+void run(const char* name, const Fixture& fixture, size_t iterations, Build&& build, Write&& write) {
+    // 校验流式JSON与jsoncpp紧凑输出逐字节一致
+    Json::StreamWriterBuilder compact;
+    compact["indentation"] = "";
+    std::string expected = Json::writeString(compact, build(fixture));
+    std::string& check = MessageWriter::threadBuffer();
+    MessageWriter check_writer(MessageFormat::JSON, check);
+    write(check_writer, fixture);
+    if (check != expected) {
+        std::cerr << name << ": output differs from jsoncpp\n" << expected << "\n" << check << std::endl;
+        std::exit(1);
+    }
+
+    std::cout << name << " message" << std::endl;
+    std::cout << std::left << std::setw(28) << "path" << std::setw(10) << "bytes"
+              << std::setw(14) << "ns/msg" << "allocs/msg" << std::endl;
+    print("Json::Value + builder", measure(iterations, [&]() {
+        Json::StreamWriterBuilder builder;
+        std::string payload = Json::writeString(builder, build(fixture));
+        return payload.size();
+    }));
+    print("MessageWriter json", measure(iterations, [&]() {
+        std::string& payload = MessageWriter::threadBuffer();
+        MessageWriter writer(MessageFormat::JSON, payload);
+        write(writer, fixture);
+        return payload.size();
+    }));
+    print("MessageWriter cbor", measure(iterations, [&]() {
+        std::string& payload = MessageWriter::threadBuffer();
+        MessageWriter writer(MessageFormat::CBOR, payload);
+        write(writer, fixture);
+        return payload.size();
+    }));
+    std::cout << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t iterations = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+    Fixture fixture;
+
+    run("status", fixture, iterations, buildStatus, writeStatus);
+    run("heartbeat", fixture, iterations, buildHeartbeat, writeHeartbeat);
+    run("command", fixture, iterations, buildCommand, writeCommand);
+    run("response", fixture, iterations, buildResponse, writeResponse);
+    return 0;
+}
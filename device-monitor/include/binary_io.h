@@ -0,0 +1,39 @@
+#ifndef BINARY_IO_H
+#define BINARY_IO_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+/**
+ * 按本机字节序从任意对齐的地址读取定长数值
+ * @param data 数据起始地址
+ * @return 读取的数值
+ */
+template <typename T>
+T loadValue(const char* data) {
+    T value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+/**
+ * 按本机字节序向任意对齐的地址写入定长数值
+ * @param data 目标地址
+ * @param value 要写入的数值
+ */
+template <typename T>
+void storeValue(char* data, T value) {
+    std::memcpy(data, &value, sizeof(value));
+}
+
+/**
+ * 计算 CRC-32（IEEE），按8字节切片查表
+ * 注册表日志/快照和离线缓存的每条记录在写入与恢复时都要校验
+ * @param data 数据起始地址
+ * @param length 数据长度
+ * @return 校验值
+ */
+uint32_t crc32(const char* data, size_t length);
+
+#endif // BINARY_IO_H
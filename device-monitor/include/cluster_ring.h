@@ -0,0 +1,78 @@
+#ifndef CLUSTER_RING_H
+#define CLUSTER_RING_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * 一致性哈希环
+ * 每个成员以 "<成员ID>#<序号>" 在64位哈希环上放置若干虚拟节点，键归属于其哈希值顺时针方向的第一个虚拟节点，
+ * 成员加入或离开时只有约 1/N 的键改变归属。哈希函数不依赖标准库实现，同一集群的各个进程计算结果一致。
+ *
+ * 成员变化时构建新的不可变环并原子替换，查询无锁、不分配内存；
+ * 旧环保留到析构（成员变化很少），保证并发查询期间访问的环始终有效。
+ */
+class ClusterRing {
+public:
+    static constexpr size_t DEFAULT_VIRTUAL_NODES = 128;   // 每个成员的默认虚拟节点数量
+
+    /**
+     * 构造函数
+     * @param virtual_nodes 每个成员的虚拟节点数量
+     */
+    explicit ClusterRing(size_t virtual_nodes = DEFAULT_VIRTUAL_NODES);
+
+    /**
+     * 析构函数
+     */
+    ~ClusterRing();
+
+    ClusterRing(const ClusterRing&) = delete;
+    ClusterRing& operator=(const ClusterRing&) = delete;
+
+    /**
+     * 替换成员集合
+     * @param members 成员ID（顺序和重复不影响结果）
+     * @return 成员集合是否发生变化
+     */
+    bool setMembers(std::vector<std::string> members);
+
+    /**
+     * 获取成员集合
+     * @return 成员ID（已排序）
+     */
+    std::vector<std::string> members() const;
+
+    /**
+     * 查询键的归属成员
+     * @param key 键（设备ID）
+     * @return 成员ID，没有成员时为空字符串；引用在环的生命周期内有效
+     */
+    const std::string& owner(std::string_view key) const;
+
+    /**
+     * 计算键在环上的位置
+     * @param key 键
+     * @return 64位哈希值
+     */
+    static uint64_t hash(std::string_view key);
+
+private:
+    // 不可变的环：虚拟节点按哈希值排序，member为成员下标
+    struct Ring {
+        std::vector<std::string> members;
+        std::vector<std::pair<uint64_t, uint32_t>> points;
+    };
+
+    size_t m_virtual_nodes;                         // 每个成员的虚拟节点数量
+    std::atomic<const Ring*> m_ring;                // 当前的环
+    std::vector<std::unique_ptr<Ring>> m_versions;  // 所有构建过的环（由m_mutex保护）
+    mutable std::mutex m_mutex;                     // 串行化成员变化
+};
+
+#endif // CLUSTER_RING_H
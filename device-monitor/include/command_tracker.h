@@ -0,0 +1,184 @@
+#ifndef COMMAND_TRACKER_H
+#define COMMAND_TRACKER_H
+
+#include "latency_histogram.h"
+#include <string>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <json/json.h>
+
+/**
+ * 控制命令结构
+ */
+struct ControlCommand {
+    std::string command_id;             // 命令ID
+    std::string device_id;              // 目标设备ID
+    std::string command_type;           // 命令类型
+    Json::Value parameters;             // 命令参数
+    std::chrono::system_clock::time_point timestamp; // 时间戳
+
+    ControlCommand() : timestamp(std::chrono::system_clock::now()) {}
+};
+
+/**
+ * 命令发送选项
+ */
+struct CommandOptions {
+    int timeout_ms = 0;                 // 响应超时（毫秒），0表示使用默认值
+    int max_retries = 0;                // 超时后以相同command_id重发的最大次数
+    int qos = 1;                        // 服务质量等级
+};
+
+/**
+ * 待响应命令跟踪器
+ * 按截止时间排序管理待响应命令：超时后按配置重发或触发超时回调，
+ * 收到响应时按命令类型记录往返延迟直方图。待响应命令数量有上限，内存占用有界
+ */
+class CommandTracker {
+public:
+    // 命令发布函数类型（用于重发），timeout_ms 为本次发送的响应超时
+    using PublishFunction = std::function<bool(const ControlCommand& command, const std::string& topic,
+                                               const std::string& payload, int qos, int timeout_ms)>;
+    // 命令超时回调函数类型
+    using TimeoutCallback = std::function<void(const ControlCommand& command, int attempts)>;
+
+    /**
+     * 构造函数
+     * @param max_pending 待响应命令数量上限，超出时提前淘汰截止时间最早的命令
+     * @param default_timeout_ms 默认响应超时（毫秒）
+     */
+    explicit CommandTracker(size_t max_pending = 100000, int default_timeout_ms = 30000);
+
+    /**
+     * 析构函数
+     */
+    ~CommandTracker();
+
+    /**
+     * 启动超时处理线程
+     */
+    void start();
+
+    /**
+     * 停止超时处理线程
+     */
+    void stop();
+
+    /**
+     * 设置重发使用的发布函数
+     * @param publisher 发布函数
+     */
+    void setPublisher(PublishFunction publisher);
+
+    /**
+     * 设置命令超时回调
+     * @param callback 回调函数
+     */
+    void setTimeoutCallback(TimeoutCallback callback);
+
+    /**
+     * 设置默认响应超时
+     * @param timeout_ms 超时时间（毫秒）
+     */
+    void setDefaultTimeout(int timeout_ms);
+
+    /**
+     * 获取默认响应超时
+     * @return 超时时间（毫秒）
+     */
+    int defaultTimeout() const;
+
+    /**
+     * 开始跟踪一条已发送（或即将发送）的命令
+     * @param command 命令信息
+     * @param topic 发布主题
+     * @param payload 序列化后的命令内容（重发时原样使用）
+     * @param options 发送选项
+     */
+    void track(const ControlCommand& command,
+               const std::string& topic,
+               const std::string& payload,
+               const CommandOptions& options);
+
+    /**
+     * 命令收到响应，结束跟踪并记录往返延迟
+     * @param command_id 命令ID
+     * @param command 输出的命令信息（可为nullptr）
+     * @return 命令是否处于待响应状态
+     */
+    bool complete(const std::string& command_id, ControlCommand* command = nullptr);
+
+    /**
+     * 取消跟踪（例如首次发送失败）
+     * @param command_id 命令ID
+     */
+    void cancel(const std::string& command_id);
+
+    /**
+     * 获取待响应命令数量
+     * @return 命令数量
+     */
+    size_t pendingCount() const;
+
+    /**
+     * 获取各命令类型的往返延迟统计
+     * @return 命令类型到延迟统计的映射
+     */
+    std::map<std::string, LatencySummary> latencyStats() const;
+
+private:
+    using DeadlineIndex = std::multimap<int64_t, std::string>;
+
+    struct PendingEntry {
+        ControlCommand command;
+        std::string topic;
+        std::string payload;
+        int qos = 1;
+        int attempts = 1;               // 已发送次数
+        int max_retries = 0;
+        int64_t timeout_ns = 0;
+        int64_t first_sent_ns = 0;      // 首次发送时刻（延迟从此刻计算）
+        DeadlineIndex::iterator deadline_it;
+    };
+
+    struct RetryItem {
+        ControlCommand command;
+        std::string topic;
+        std::string payload;
+        int qos;
+        int timeout_ms;
+    };
+
+    struct TimeoutItem {
+        ControlCommand command;
+        int attempts;
+    };
+
+    static int64_t nowNanos();
+    void expiryLoop();
+    void collectDue(int64_t now_ns, std::vector<RetryItem>& retries, std::vector<TimeoutItem>& timeouts);
+    void erase(std::unordered_map<std::string, PendingEntry>::iterator it);
+
+    std::unordered_map<std::string, PendingEntry> m_pending;   // 待响应命令
+    DeadlineIndex m_deadlines;                                  // 截止时间索引
+    std::unordered_map<std::string, LatencyHistogram> m_latency; // 各命令类型延迟直方图
+
+    size_t m_max_pending;                           // 待响应命令数量上限
+    int m_default_timeout_ms;                       // 默认响应超时
+
+    PublishFunction m_publisher;                    // 重发使用的发布函数
+    TimeoutCallback m_timeout_callback;             // 超时回调
+
+    bool m_running;                                 // 运行状态
+    std::thread m_expiry_thread;                    // 超时处理线程
+    mutable std::mutex m_mutex;                     // 互斥锁
+    std::condition_variable m_cv;                   // 条件变量
+};
+
+#endif // COMMAND_TRACKER_H
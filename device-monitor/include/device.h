@@ -2,7 +2,11 @@
 #define DEVICE_H
 
 #include "mqtt_client.h"
+#include "message_codec.h"
+#include "property_schema.h"
+#include "message_writer.h"
 #include <map>
+#include <set>
 #include <atomic>
 #include <thread>
 #include <chrono>
@@ -181,6 +185,69 @@ public:
      */
     void setHeartbeatInterval(int interval_seconds);
     
+    /**
+     * 使用共享反应器驱动设备（须在 start() 之前调用，反应器须比设备存活更久）
+     * 设置后MQTT客户端不创建网络线程，状态上报和心跳由反应器定时器触发，
+     * 设备不再创建任何线程，便于在一个进程中托管大量设备
+     * @param reactor 反应器，为空表示使用独立线程
+     */
+    void setReactor(MqttReactor* reactor);
+    
+    /**
+     * 设置增量状态上报
+     * 启用后每次上报只包含上次上报后变化的属性，并附带递增的版本号；
+     * 每隔 keyframe_interval 次上报、重新连接以及收到状态请求时发送完整关键帧
+     * @param enabled 是否启用
+     * @param keyframe_interval 关键帧间隔（上报次数）
+     */
+    void setDeltaReporting(bool enabled, int keyframe_interval = 10);
+    
+    /**
+     * 设置消息负载格式（需在start()之前调用）
+     * 状态、心跳和命令响应按该格式编码，并在状态消息中声明，服务端据此编码发往本设备的命令；
+     * 收到的命令按首字节自动识别格式
+     * @param format 负载格式
+     */
+    void setMessageFormat(MessageFormat format);
+    
+    /**
+     * 使用 MQTT v5 协议（需在connect()之前调用，broker 须支持 MQTT v5）
+     * 命令带有响应主题时响应发布到该主题，并原样带回命令的关联数据；心跳等 QoS 0 消息使用主题别名
+     * @param enable 是否启用
+     * @return 设置是否成功
+     */
+    bool setMqtt5(bool enable);
+    
+    /**
+     * 使用持久会话（需在start()之前调用）
+     * broker 在设备离线期间保留命令订阅并排队 QoS 1 命令，重连后投递；会话仍在时重连不再重新订阅
+     * @param enable 是否启用
+     * @param session_expiry 会话保留时间（秒，仅 MQTT v5）
+     * @return 设置是否成功
+     */
+    bool setPersistentSession(bool enable, uint32_t session_expiry = MqttClient::DEFAULT_SESSION_EXPIRY);
+    
+    /**
+     * 启用离线发布缓冲（需在start()之前调用）
+     * 断线期间的状态上报和心跳照常生成，超出内存限额的部分转存到内存映射的环形文件，
+     * 重连后按速率上限重放；心跳等只保留最新值的旧消息在重放前丢弃
+     * @param path 缓冲文件路径（已存在时恢复上次未发出的消息）
+     * @param capacity_bytes 文件数据区容量（字节），写满时丢弃最旧的消息
+     * @param replay_rate 每秒最多重放的消息数（0表示不限速）
+     * @return 设置是否成功
+     */
+    bool setOfflineBuffer(const std::string& path, size_t capacity_bytes = OfflineSpool::DEFAULT_CAPACITY,
+                          uint32_t replay_rate = 0);
+    
+    /**
+     * 设置结构声明上报模式
+     * 启用后先发布一次属性结构声明（名称、类型、单位、可写标志及结构哈希），
+     * 之后的状态上报只发送带结构哈希的按位置排列的属性值；结构变化或服务端索取时重新声明。
+     * 启用后增量上报不再生效
+     * @param enabled 是否启用
+     */
+    void setSchemaReporting(bool enabled);
+    
     /**
      * 获取设备ID
      * @return 设备ID
@@ -199,6 +266,19 @@ public:
      */
     void setDeviceStatus(const std::string& status);
     
+    /**
+     * 加入设备组，订阅 group/<组名>/command 接收群组命令
+     * @param group 组名（不能包含 '/'、'+'、'#'）
+     * @return 组名是否合法
+     */
+    bool joinGroup(const std::string& group);
+    
+    /**
+     * 退出设备组
+     * @param group 组名
+     */
+    void leaveGroup(const std::string& group);
+    
     /**
      * 获取设备状态
      * @return 当前状态
@@ -207,29 +287,41 @@ public:
 
 private:
     /**
-     * 处理MQTT消息
-     * @param topic 主题
-     * @param payload 消息内容
+     * 注册命令和状态请求主题路由
      */
-    void handleMessage(const std::string& topic, const std::string& payload);
+    void registerRoutes();
+    
+    /**
+     * 订阅已加入设备组的命令主题
+     */
+    void subscribeGroups();
     
     /**
      * 处理控制命令
-     * @param payload 命令内容
+     * @param message 命令消息（带有 MQTT v5 响应主题和关联数据时按其发送响应）
      */
-    void handleCommand(const std::string& payload);
+    void handleCommand(const MessageView& message);
     
     /**
      * 处理状态请求
      * @param payload 请求内容
      */
-    void handleStatusRequest(const std::string& payload);
+    void handleStatusRequest(std::string_view payload);
+    
+    /**
+     * 处理结构声明请求（服务端遇到未知结构哈希时发送）
+     * @param payload 请求内容
+     */
+    void handleSchemaRequest(std::string_view payload);
     
     /**
      * 发送命令响应
      * @param result 命令执行结果
+     * @param response_topic 命令指定的响应主题，为空时使用本设备的响应主题
+     * @param correlation_data 命令的关联数据，原样带回
      */
-    void sendCommandResponse(const CommandResult& result);
+    void sendCommandResponse(const CommandResult& result, std::string_view response_topic = std::string_view(),
+                             std::string_view correlation_data = std::string_view());
     
     /**
      * 状态上报线程函数
@@ -242,16 +334,51 @@ private:
     void heartbeatLoop();
     
     /**
-     * 构建状态消息
+     * 发送一次心跳
+     */
+    void sendHeartbeat();
+    
+    /**
+     * 按当前间隔添加反应器定时器（替换已有的定时器）
+     */
+    void scheduleReactorTimers();
+    
+    /**
+     * 取消反应器定时器
+     */
+    void cancelReactorTimers();
+    
+    /**
+     * 发布状态上报（增量模式下决定发送关键帧还是增量）
+     * @param keyframe 是否强制发送完整关键帧
+     */
+    void publishStatus(bool keyframe);
+    
+    /**
+     * 发布数值帧，结构变化时先发布结构声明（需持有上报锁）
+     * @return 是否发布成功
+     */
+    bool publishValueFrame();
+    
+    /**
+     * 构建完整状态消息（用于命令响应中的状态查询）
      * @return JSON格式的状态消息
      */
     Json::Value buildStatusMessage();
     
     /**
-     * 构建心跳消息
-     * @return JSON格式的心跳消息
+     * 流式写入状态消息（键按字节序写入）
+     * @param writer 消息写入器
+     * @param changed 只包含这些属性（属性名 -> 是否同时携带单位和可写标志），为空表示包含全部属性
+     * @param version 增量上报版本号，为空表示不写入版本和关键帧标志
+     */
+    void writeStatusMessage(MessageWriter& writer, const std::map<std::string, bool>* changed, const uint64_t* version);
+    
+    /**
+     * 流式写入心跳消息
+     * @param writer 消息写入器
      */
-    Json::Value buildHeartbeatMessage();
+    void writeHeartbeatMessage(MessageWriter& writer);
     
     /**
      * 处理连接状态变化
@@ -277,17 +404,42 @@ private:
     std::thread m_status_report_thread;             // 状态上报线程
     std::thread m_heartbeat_thread;                 // 心跳线程
     
+    MqttReactor* m_reactor;                         // 共享反应器（为空表示使用独立线程）
+    uint64_t m_status_timer;                        // 反应器状态上报定时器
+    uint64_t m_heartbeat_timer;                     // 反应器心跳定时器
+    
     mutable std::mutex m_properties_mutex;          // 属性互斥锁
     mutable std::mutex m_handlers_mutex;            // 处理器互斥锁
     
+    std::set<std::string> m_groups;                 // 已加入的设备组
+    std::set<std::string> m_routed_groups;          // 已注册路由的设备组（退出后路由保留）
+    std::mutex m_groups_mutex;                      // 设备组互斥锁
+    
     std::chrono::system_clock::time_point m_start_time; // 启动时间
     
+    // 增量状态上报（由上报锁保护）
+    bool m_delta_reporting;                         // 是否启用增量上报
+    int m_keyframe_interval;                        // 关键帧间隔（上报次数）
+    uint64_t m_status_version;                      // 状态上报版本号
+    int m_reports_since_keyframe;                   // 上一个关键帧之后的增量上报次数
+    bool m_force_keyframe;                          // 下一次上报必须是完整关键帧
+    std::mutex m_report_mutex;                      // 保证上报的构建顺序与发布顺序一致
+    std::map<std::string, bool> m_dirty_properties; // 上次上报后变化的属性 -> 单位或可写标志是否也变化（由属性锁保护）
+    
+    const MessageCodec* m_codec;                    // 出站消息编解码器
+    
+    // 结构声明上报（由上报锁保护）
+    bool m_schema_reporting;                        // 是否启用结构声明上报
+    uint64_t m_announced_schema;                    // 最近一次声明的结构哈希，0表示尚未声明
+    
     // MQTT主题定义
     std::string m_topic_command;                    // 命令接收主题
     std::string m_topic_status;                     // 状态上报主题
     std::string m_topic_response;                   // 响应发送主题
     std::string m_topic_heartbeat;                  // 心跳发送主题
     std::string m_topic_status_request;             // 状态请求主题
+    std::string m_topic_schema;                     // 结构声明发送主题
+    std::string m_topic_schema_request;             // 结构声明请求主题
 };
 
 #endif // DEVICE_H
\ No newline at end of file
@@ -0,0 +1,415 @@
+#ifndef DEVICE_REGISTRY_H
+#define DEVICE_REGISTRY_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <json/json.h>
+#include "message_codec.h"
+
+/**
+ * 设备状态信息结构
+ */
+struct DeviceStatus {
+    std::string device_id;              // 设备ID
+    std::string device_type;            // 设备类型
+    std::string status;                 // 设备状态（online/offline/error）
+    std::chrono::system_clock::time_point last_seen; // 最后活跃时间
+    Json::Value properties;             // 设备属性
+    uint64_t status_version;            // 最近一次状态上报的版本号（增量上报时用于检测丢失）
+    bool awaiting_keyframe;             // 检测到版本缺口后已索取完整上报，等待关键帧
+    int64_t keyframe_requested_ticks;   // 最近一次索取完整上报的时刻（DeviceRegistry::nowTicks()）
+    MessageFormat message_format;       // 设备声明的负载格式，向设备发送命令时使用
+    uint64_t schema_hash;               // 当前属性对应的结构哈希（数值帧上报），0表示完整状态上报
+
+    DeviceStatus()
+        : status("offline"), last_seen(std::chrono::system_clock::now()), status_version(0), awaiting_keyframe(false),
+          keyframe_requested_ticks(0), message_format(MessageFormat::JSON), schema_hash(0) {}
+};
+
+/**
+ * 设备句柄：设备ID首次建立记录时分配的稠密整数编号，在注册表生命周期内保持不变
+ */
+using DeviceHandle = uint32_t;
+
+/**
+ * 分片设备注册表
+ * 按设备ID哈希划分为N个分片，每个分片是一张独立加锁的开放寻址哈希表（线性探测），
+ * 不同设备的状态更新只在落入同一分片时才会互相竞争。
+ *
+ * 每个设备ID同时被驻留为稠密句柄，句柄对应扁平数组中的原子最后活跃时间戳和在线标志。
+ * 心跳快速路径只做无锁的句柄查找和一次原子写入，不加锁也不分配内存。
+ * 句柄不回收：删除设备（过期清理、集群移交）后句柄和设备ID保留，同一设备再次出现时沿用原句柄。
+ * 无锁快速路径、超时时间轮和属性历史都直接持有句柄，回收需要与它们额外同步，因此句柄数量等于
+ * 建立过记录的不同设备ID数量，上限为 MAX_HANDLES（每个句柄约60字节，含驻留表），
+ * 达到上限后新设备仍可建立记录，但没有句柄（心跳走加锁路径，不参与超时检测）。
+ *
+ * 注册表同时维护 状态->设备、设备类型->设备 和 (状态, 设备类型)->设备 三个二级索引，在每次修改后按需增量更新，
+ * 按状态、类型或两者组合的查询只访问命中的设备，耗时与结果数量成正比而与设备总数无关。
+ */
+class DeviceRegistry {
+public:
+    static constexpr DeviceHandle INVALID_HANDLE = 0xffffffffu; // 无效句柄
+    static constexpr size_t MAX_HANDLES = size_t(1) << 24;      // 句柄数量上限（句柄不回收，约1 GiB）
+    
+    /**
+     * 构造函数
+     * @param shard_count 分片数量（向上取整为2的幂）
+     * @param expected_devices 预期设备数量，用于预分配容量
+     */
+    explicit DeviceRegistry(size_t shard_count = 64, size_t expected_devices = 0);
+    
+    /**
+     * 析构函数
+     */
+    ~DeviceRegistry();
+    
+    DeviceRegistry(const DeviceRegistry&) = delete;
+    DeviceRegistry& operator=(const DeviceRegistry&) = delete;
+
+    /**
+     * 按预期设备数量预分配各分片容量，避免运行期扩容
+     * @param expected_devices 预期设备数量
+     */
+    void reserve(size_t expected_devices);
+
+    /**
+     * 在分片锁内更新设备状态，设备不存在时自动创建
+     * @param device_id 设备ID
+     * @param fn 更新函数，签名为 void(DeviceStatus&)
+     */
+    template <typename Fn>
+    void update(std::string_view device_id, Fn&& fn) {
+        uint64_t hash = hashKey(device_id);
+        Shard& shard = shardFor(hash);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        Slot& slot = findOrInsert(shard, hash, device_id);
+        refreshLastSeen(slot, ClockPair::now());
+        fn(slot.status);
+        syncDerivedState(slot);
+    }
+
+    /**
+     * 在分片锁内更新已存在的设备状态，设备不存在时不创建
+     * @param device_id 设备ID
+     * @param fn 更新函数，签名为 void(DeviceStatus&)
+     * @return 设备是否存在
+     */
+    template <typename Fn>
+    bool modify(std::string_view device_id, Fn&& fn) {
+        uint64_t hash = hashKey(device_id);
+        Shard& shard = shardFor(hash);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        Slot* slot = const_cast<Slot*>(find(shard, hash, device_id));
+        if (!slot) {
+            return false;
+        }
+        refreshLastSeen(*slot, ClockPair::now());
+        fn(slot->status);
+        syncDerivedState(*slot);
+        return true;
+    }
+
+    /**
+     * 在分片锁内读取设备状态
+     * @param device_id 设备ID
+     * @param fn 读取函数，签名为 void(const DeviceStatus&)
+     * @return 设备是否存在
+     */
+    template <typename Fn>
+    bool read(std::string_view device_id, Fn&& fn) const {
+        uint64_t hash = hashKey(device_id);
+        const Shard& shard = shardFor(hash);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        const Slot* slot = find(shard, hash, device_id);
+        if (!slot) {
+            return false;
+        }
+        refreshLastSeen(*slot, ClockPair::now());
+        fn(slot->status);
+        return true;
+    }
+
+    /**
+     * 获取设备状态副本
+     * @param device_id 设备ID
+     * @param out 输出的设备状态
+     * @return 设备是否存在
+     */
+    bool get(std::string_view device_id, DeviceStatus& out) const;
+
+    /**
+     * 检查设备是否存在
+     * @param device_id 设备ID
+     * @return 是否存在
+     */
+    bool contains(std::string_view device_id) const;
+
+    /**
+     * 删除设备
+     * @param device_id 设备ID
+     * @return 设备是否存在并被删除
+     */
+    bool erase(std::string_view device_id);
+
+    /**
+     * 在分片锁内检查后删除设备
+     * @param device_id 设备ID
+     * @param pred 判断函数，签名为 bool(const DeviceStatus&)，返回true时删除
+     * @return 设备是否存在并被删除
+     */
+    template <typename Pred>
+    bool eraseIf(std::string_view device_id, Pred&& pred) {
+        uint64_t hash = hashKey(device_id);
+        Shard& shard = shardFor(hash);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        Slot* slot = const_cast<Slot*>(find(shard, hash, device_id));
+        if (!slot) {
+            return false;
+        }
+        refreshLastSeen(*slot, ClockPair::now());
+        if (!pred(static_cast<const DeviceStatus&>(slot->status))) {
+            return false;
+        }
+        eraseSlot(shard, slot);
+        return true;
+    }
+
+    /**
+     * 逐分片遍历所有设备（遍历期间只持有当前分片的锁）
+     * @param fn 遍历函数，签名为 void(const DeviceStatus&)
+     */
+    void forEach(const std::function<void(const DeviceStatus&)>& fn) const;
+
+    /**
+     * 逐分片遍历并允许修改所有设备
+     * @param fn 遍历函数，签名为 void(DeviceStatus&)
+     */
+    void forEachMutable(const std::function<void(DeviceStatus&)>& fn);
+
+    /**
+     * 按状态和设备类型查询设备（使用二级索引）
+     * @param status 设备状态，为空表示不限
+     * @param device_type 设备类型，为空表示不限
+     * @return 匹配的设备ID（无序）
+     */
+    std::vector<std::string> findDevices(std::string_view status, std::string_view device_type = std::string_view()) const;
+
+    /**
+     * 按状态和设备类型统计设备数量（使用二级索引）
+     * @param status 设备状态，为空表示不限
+     * @param device_type 设备类型，为空表示不限
+     * @return 设备数量
+     */
+    size_t countDevices(std::string_view status, std::string_view device_type = std::string_view()) const;
+
+    /**
+     * 获取各状态的设备数量
+     * @return 状态到设备数量的映射
+     */
+    std::map<std::string, size_t> statusCounts() const;
+
+    /**
+     * 获取设备总数
+     * @return 设备数量
+     */
+    size_t size() const;
+
+    /**
+     * 获取分片数量
+     * @return 分片数量
+     */
+    size_t shardCount() const { return m_shards.size(); }
+    
+    /**
+     * 驻留设备ID，返回其稠密句柄（已存在时无锁返回，首次出现时加锁分配）
+     * 分配的句柄不会回收，只应为已建立或即将建立记录的设备调用；只需查询时使用 findHandle()
+     * @param device_id 设备ID
+     * @return 设备句柄，句柄耗尽时返回INVALID_HANDLE
+     */
+    DeviceHandle intern(std::string_view device_id);
+    
+    /**
+     * 无锁查找设备句柄
+     * @param device_id 设备ID
+     * @return 设备句柄，未驻留时返回INVALID_HANDLE
+     */
+    DeviceHandle findHandle(std::string_view device_id) const;
+    
+    /**
+     * 获取句柄对应的设备ID
+     * @param handle 设备句柄
+     * @return 设备ID
+     */
+    const std::string& deviceId(DeviceHandle handle) const;
+    
+    /**
+     * 记录设备活跃（心跳快速路径）：原子写入最后活跃时间戳
+     * @param handle 设备句柄
+     * @param now_ticks 当前时间（nowTicks()）
+     * @return 设备已处于在线状态时返回true；返回false表示调用方需要走慢路径处理上线
+     */
+    bool touch(DeviceHandle handle, int64_t now_ticks) {
+        HandleChunk* chunk = m_chunks[handle >> CHUNK_BITS].load(std::memory_order_acquire);
+        size_t index = handle & CHUNK_MASK;
+        chunk->last_seen[index].store(now_ticks);
+        return chunk->online[index].load() != 0;
+    }
+    
+    /**
+     * 获取设备最后活跃时间戳
+     * @param handle 设备句柄
+     * @return 最后活跃时间（nowTicks()时间基准）
+     */
+    int64_t lastSeenTicks(DeviceHandle handle) const;
+    
+    /**
+     * 获取已分配的句柄数量
+     * @return 句柄数量
+     */
+    size_t handleCount() const { return m_handle_count.load(std::memory_order_acquire); }
+    
+    /**
+     * 获取单调时钟的当前时间戳（纳秒）
+     * @return 时间戳
+     */
+    static int64_t nowTicks() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+private:
+    static constexpr unsigned CHUNK_BITS = 12;
+    static constexpr size_t CHUNK_SIZE = size_t(1) << CHUNK_BITS;
+    static constexpr size_t CHUNK_MASK = CHUNK_SIZE - 1;
+    static constexpr size_t MAX_CHUNKS = MAX_HANDLES / CHUNK_SIZE;
+    
+    // 句柄数据按块分配，块一经分配地址不变，快速路径无需加锁
+    struct HandleChunk {
+        std::atomic<int64_t> last_seen[CHUNK_SIZE];     // 最后活跃时间戳
+        std::atomic<uint8_t> online[CHUNK_SIZE];        // 在线标志（状态不为offline）
+        uint64_t hash[CHUNK_SIZE];                      // 设备ID哈希值
+        std::string device_id[CHUNK_SIZE];              // 设备ID
+        
+        HandleChunk() {
+            for (size_t i = 0; i < CHUNK_SIZE; ++i) {
+                last_seen[i].store(0, std::memory_order_relaxed);
+                online[i].store(0, std::memory_order_relaxed);
+            }
+        }
+    };
+    
+    // 句柄驻留表：只增不删的开放寻址表，槽位存放 句柄+1（0表示空槽）
+    struct InternTable {
+        size_t mask;
+        std::unique_ptr<std::atomic<uint32_t>[]> slots;
+        
+        explicit InternTable(size_t capacity)
+            : mask(capacity - 1), slots(new std::atomic<uint32_t>[capacity]) {
+            for (size_t i = 0; i < capacity; ++i) {
+                slots[i].store(0, std::memory_order_relaxed);
+            }
+        }
+    };
+    
+    // 单调时钟与系统时钟的对照，用于把时间戳换算为 system_clock 时间
+    struct ClockPair {
+        int64_t steady_ticks;
+        std::chrono::system_clock::time_point system_now;
+        
+        static ClockPair now() {
+            return ClockPair{nowTicks(), std::chrono::system_clock::now()};
+        }
+        
+        std::chrono::system_clock::time_point toSystem(int64_t ticks) const {
+            return system_now - std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                std::chrono::nanoseconds(steady_ticks - ticks));
+        }
+    };
+    
+    struct Slot {
+        uint64_t hash = 0;                  // 设备ID哈希值
+        bool used = false;                  // 槽位是否被占用
+        DeviceHandle handle = INVALID_HANDLE; // 设备句柄
+        std::string indexed_status;         // 已写入二级索引的状态
+        std::string indexed_type;           // 已写入二级索引的设备类型
+        mutable DeviceStatus status;        // 设备状态（status.device_id 即为键，last_seen 读取时由句柄时间戳刷新）
+    };
+
+    // 每个分片独占缓存行，避免相邻分片的锁产生伪共享
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;           // 分片互斥锁
+        std::vector<Slot> slots;            // 开放寻址槽位，容量为2的幂
+        size_t count = 0;                   // 已占用槽位数
+    };
+
+    static uint64_t hashKey(std::string_view device_id);
+    
+    HandleChunk& chunkFor(DeviceHandle handle) const {
+        return *m_chunks[handle >> CHUNK_BITS].load(std::memory_order_acquire);
+    }
+    
+    DeviceHandle probeIntern(const InternTable& table, uint64_t hash, std::string_view device_id) const;
+    void insertIntern(InternTable& table, uint64_t hash, DeviceHandle handle);
+    void refreshLastSeen(const Slot& slot, const ClockPair& clock) const;
+    void syncDerivedState(Slot& slot);
+    void unindex(const Slot& slot);
+    
+    using HandleSet = std::unordered_set<DeviceHandle>;
+    // 索引键的种类很少，使用带透明比较器的有序映射，按 string_view 查找时不构造临时字符串
+    using SecondaryIndex = std::map<std::string, HandleSet, std::less<>>;
+    
+    // (状态, 设备类型) 组合键的透明比较器
+    struct CompositeLess {
+        using is_transparent = void;
+        using View = std::pair<std::string_view, std::string_view>;
+        
+        static View view(const std::pair<std::string, std::string>& key) { return View(key.first, key.second); }
+        static View view(const View& key) { return key; }
+        
+        template <typename A, typename B>
+        bool operator()(const A& a, const B& b) const { return view(a) < view(b); }
+    };
+    using CompositeIndex = std::map<std::pair<std::string, std::string>, HandleSet, CompositeLess>;
+    
+    static void indexMove(SecondaryIndex& index, const std::string& from, const std::string& to, DeviceHandle handle);
+    static const HandleSet* indexLookup(const SecondaryIndex& index, std::string_view key);
+    // 按状态和/或设备类型查找匹配的设备集合（至少给出一个条件，调用方持有索引锁）
+    const HandleSet* lookup(std::string_view status, std::string_view device_type) const;
+    static void compositeMove(CompositeIndex& index, const std::string& from_status, const std::string& from_type,
+                              const std::string& to_status, const std::string& to_type, DeviceHandle handle);
+
+    Shard& shardFor(uint64_t hash) { return *m_shards[(hash >> 48) & m_shard_mask]; }
+    const Shard& shardFor(uint64_t hash) const { return *m_shards[(hash >> 48) & m_shard_mask]; }
+
+    static const Slot* find(const Shard& shard, uint64_t hash, std::string_view device_id);
+    Slot& findOrInsert(Shard& shard, uint64_t hash, std::string_view device_id);
+    void eraseSlot(Shard& shard, Slot* slot);
+    static void rehash(Shard& shard, size_t new_capacity);
+    static size_t capacityFor(size_t count);
+
+    std::vector<std::unique_ptr<Shard>> m_shards;   // 分片列表
+    size_t m_shard_mask;                            // 分片掩码
+    
+    std::unique_ptr<std::atomic<HandleChunk*>[]> m_chunks; // 句柄数据块
+    std::atomic<size_t> m_handle_count;             // 已分配句柄数量
+    std::atomic<InternTable*> m_intern_table;       // 当前句柄驻留表
+    std::vector<std::unique_ptr<InternTable>> m_intern_tables; // 所有驻留表（旧表保留到析构，供并发读者安全访问）
+    std::mutex m_intern_mutex;                      // 句柄分配互斥锁
+    
+    // 二级索引（加锁顺序：分片锁 -> 索引锁）
+    SecondaryIndex m_status_index;                  // 状态 -> 设备句柄
+    SecondaryIndex m_type_index;                    // 设备类型 -> 设备句柄
+    CompositeIndex m_status_type_index;             // (状态, 设备类型) -> 设备句柄（只包含类型非空的设备）
+    mutable std::mutex m_index_mutex;               // 索引互斥锁
+};
+
+#endif // DEVICE_REGISTRY_H
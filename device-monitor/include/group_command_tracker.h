@@ -0,0 +1,143 @@
+#ifndef GROUP_COMMAND_TRACKER_H
+#define GROUP_COMMAND_TRACKER_H
+
+#include "command_tracker.h"
+#include <string>
+#include <string_view>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <functional>
+#include <mutex>
+#include <json/json.h>
+
+/**
+ * 群组命令发送选项
+ */
+struct GroupCommandOptions {
+    int timeout_ms = 0;                 // 汇总超时（毫秒），0表示使用默认值
+    int qos = 1;                        // 服务质量等级
+    bool use_group_topic = false;       // 是否只向 group/<组名>/command 发布一次，由代理完成扇出
+};
+
+/**
+ * 群组命令汇总结果
+ */
+struct GroupCommandResult {
+    std::string command_id;                         // 命令ID（组内所有设备共用）
+    std::string group;                              // 组名
+    std::string command_type;                       // 命令类型
+    size_t target_count = 0;                        // 期望响应的设备数量（0表示成员未知）
+    size_t success_count = 0;                       // 成功响应数量
+    size_t failure_count = 0;                       // 失败响应数量
+    std::map<std::string, Json::Value> responses;   // 各设备的响应
+    std::vector<std::string> timed_out_devices;     // 超时未响应的设备
+    bool completed = false;                         // 是否所有期望设备都在超时前响应（成员未知时总是false）
+    bool timed_out = false;                         // 是否因到达截止时间交付
+    int64_t elapsed_ms = 0;                         // 从发送到汇总完成的耗时
+};
+
+/**
+ * 群组命令跟踪器
+ * 一条群组命令对应一个命令ID，按设备汇总响应；所有期望设备响应或到达截止时间时
+ * 通过回调交付汇总结果。成员未知（经群组主题广播且未给出设备列表）的命令在截止时间交付，结果记为超时。
+ * 截止时间和超时线程由内部的 CommandTracker 管理（每条群组命令登记为一条不重发的命令）
+ */
+class GroupCommandTracker {
+public:
+    // 汇总结果回调函数类型
+    using ResultCallback = std::function<void(const GroupCommandResult& result)>;
+
+    /**
+     * 构造函数
+     * @param default_timeout_ms 默认汇总超时（毫秒）
+     */
+    explicit GroupCommandTracker(int default_timeout_ms = 30000);
+
+    /**
+     * 析构函数
+     */
+    ~GroupCommandTracker();
+
+    /**
+     * 启动超时处理线程
+     */
+    void start();
+
+    /**
+     * 停止超时处理线程
+     */
+    void stop();
+
+    /**
+     * 设置汇总结果回调
+     * @param callback 回调函数
+     */
+    void setResultCallback(ResultCallback callback);
+
+    /**
+     * 设置默认汇总超时
+     * @param timeout_ms 超时时间（毫秒）
+     */
+    void setDefaultTimeout(int timeout_ms);
+
+    /**
+     * 开始跟踪一条群组命令（需在发送前调用，避免响应先于登记到达）
+     * @param command_id 命令ID
+     * @param group 组名
+     * @param command_type 命令类型
+     * @param device_ids 期望响应的设备，为空表示成员未知
+     * @param timeout_ms 汇总超时（毫秒），0表示使用默认值
+     */
+    void track(const std::string& command_id,
+               const std::string& group,
+               const std::string& command_type,
+               const std::vector<std::string>& device_ids,
+               int timeout_ms);
+
+    /**
+     * 记录设备响应
+     * @param command_id 命令ID
+     * @param device_id 设备ID
+     * @param response 响应内容
+     * @return 命令ID属于正在跟踪的群组命令返回true
+     */
+    bool complete(const std::string& command_id, std::string_view device_id, const Json::Value& response);
+
+    /**
+     * 判断命令ID是否属于正在跟踪的群组命令
+     * @param command_id 命令ID
+     * @return 是否正在跟踪
+     */
+    bool isPending(const std::string& command_id) const;
+
+    /**
+     * 取消跟踪
+     * @param command_id 命令ID
+     */
+    void cancel(const std::string& command_id);
+
+    /**
+     * 获取正在跟踪的群组命令数量
+     * @return 命令数量
+     */
+    size_t pendingCount() const;
+
+private:
+    struct GroupEntry {
+        GroupCommandResult result;
+        std::unordered_set<std::string> outstanding;   // 尚未响应的期望设备
+        std::chrono::steady_clock::time_point sent;    // 登记时刻
+    };
+
+    void onDeadline(const ControlCommand& command);
+    GroupCommandResult finish(std::unordered_map<std::string, GroupEntry>::iterator it, bool timed_out);
+
+    CommandTracker m_deadlines;                             // 截止时间和超时线程
+    std::unordered_map<std::string, GroupEntry> m_pending;  // 正在跟踪的群组命令
+    ResultCallback m_result_callback;                       // 汇总结果回调
+    mutable std::mutex m_mutex;                             // 保护 m_pending 和回调
+};
+
+#endif // GROUP_COMMAND_TRACKER_H
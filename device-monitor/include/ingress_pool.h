@@ -0,0 +1,165 @@
+#ifndef INGRESS_POOL_H
+#define INGRESS_POOL_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+/**
+ * 入站消息类型
+ */
+enum class IngressKind {
+    STATUS,         // 设备状态
+    RESPONSE,       // 命令响应
+    HEARTBEAT,      // 设备心跳
+    SCHEMA          // 设备属性结构声明
+};
+
+/**
+ * 入站消息
+ */
+struct IngressMessage {
+    IngressKind kind;                   // 消息类型
+    std::string device_id;              // 设备ID
+    std::string payload;                // 消息内容
+    std::string correlation_id;         // 命令响应的 MQTT v5 关联数据（没有时为空）
+    bool superseded = false;            // 已被同一设备更新的状态取代（工作线程跳过）
+};
+
+/**
+ * 入站队列统计
+ */
+struct IngressStats {
+    size_t queue_depth = 0;             // 当前排队（含正在处理批次）的消息数量
+    size_t queue_capacity = 0;          // 队列容量
+    uint64_t enqueued = 0;              // 已入队消息数量
+    uint64_t coalesced_heartbeats = 0;  // 被合并的心跳数量
+    uint64_t coalesced_statuses = 0;    // 被更新状态取代的旧状态数量
+    uint64_t dropped_heartbeats = 0;    // 队列已满丢弃的心跳数量
+    uint64_t dropped_statuses = 0;      // 队列已满丢弃的状态数量
+    size_t shedding_workers = 0;        // 处于降载模式的工作线程数量
+};
+
+/**
+ * 入站消息工作线程池
+ * MQTT消息循环线程只负责把消息投递到工作线程队列（多生产者单消费者），
+ * JSON解析和回调在工作线程中执行。按设备ID哈希选择工作线程，
+ * 同一设备的消息始终由同一线程按到达顺序处理。
+ *
+ * 每个工作线程的队列有容量上限并带有高低水位：积压超过高水位进入降载模式，
+ * 同一设备已有排队心跳或状态时合并新心跳，新状态取代排队中的旧状态（旧状态作废，新状态追加到队尾，
+ * 保持与其间到达的其他消息的顺序）；带版本号的增量和关键帧不参与状态合并；
+ * 达到容量上限时丢弃无法合并的心跳和状态；积压回落到低水位后退出降载模式。
+ * 命令响应和属性结构声明任何时候都不会被丢弃
+ */
+class IngressPool {
+public:
+    // 消息处理函数类型
+    using Handler = std::function<void(const IngressMessage& message)>;
+
+    /**
+     * 构造函数
+     * @param worker_count 工作线程数量
+     * @param queue_capacity 所有工作线程队列的总容量
+     * @param handler 消息处理函数（在工作线程中调用）
+     */
+    IngressPool(size_t worker_count, size_t queue_capacity, Handler handler);
+
+    /**
+     * 析构函数
+     */
+    ~IngressPool();
+
+    IngressPool(const IngressPool&) = delete;
+    IngressPool& operator=(const IngressPool&) = delete;
+
+    /**
+     * 启动工作线程
+     */
+    void start();
+
+    /**
+     * 停止工作线程，已入队的消息处理完毕后返回
+     */
+    void stop();
+
+    /**
+     * 投递消息到设备所属的工作线程
+     * @param kind 消息类型
+     * @param device_id 设备ID
+     * @param payload 消息内容（入队时复制，调用返回后不再引用）
+     * @param correlation_id 命令响应的关联数据（入队时复制）
+     * @return 消息被接收（入队或合并）返回true，线程池未运行或消息被丢弃返回false
+     */
+    bool submit(IngressKind kind, std::string_view device_id, std::string_view payload,
+                std::string_view correlation_id = std::string_view());
+
+    /**
+     * 获取工作线程数量
+     * @return 线程数量
+     */
+    size_t workerCount() const { return m_workers.size(); }
+
+    /**
+     * 获取所有队列中待处理的消息总数
+     * @return 消息数量
+     */
+    size_t queuedCount() const;
+    
+    /**
+     * 获取队列统计
+     * @return 统计信息
+     */
+    IngressStats stats() const;
+
+private:
+    static constexpr size_t NONE = static_cast<size_t>(-1);
+
+    // 降载模式下同一设备排队中的心跳和状态在队列中的位置
+    struct QueuedSlots {
+        size_t heartbeat = NONE;
+        size_t status = NONE;
+    };
+
+    struct alignas(64) Worker {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::vector<IngressMessage> queue;  // 待处理消息，消费者整批交换取走
+        size_t batch_size = 0;              // 正在处理的批次大小（计入积压，不含已作废的消息）
+        size_t superseded = 0;              // 队列中已作废的状态数量（不计入积压）
+        bool shedding = false;              // 是否处于降载模式
+        // 设备ID到排队位置（仅降载模式下维护），键引用队列中该设备首条被索引消息的设备ID，
+        // 队列扩容或被取走时重建或清空
+        std::unordered_map<std::string_view, QueuedSlots> slots;
+        bool stopping = false;
+        std::thread thread;
+    };
+
+    void workerLoop(Worker& worker);
+    void buildSlotIndex(Worker& worker);
+    void compactQueue(Worker& worker);
+    static bool isVersionedStatus(std::string_view payload);
+
+    std::vector<std::unique_ptr<Worker>> m_workers;  // 工作线程
+    size_t m_worker_capacity;                         // 单个工作线程的队列容量
+    size_t m_high_watermark;                          // 进入降载模式的积压水位
+    size_t m_low_watermark;                           // 退出降载模式的积压水位
+    Handler m_handler;                                // 消息处理函数
+    std::atomic<bool> m_running;                      // 运行状态
+    
+    std::atomic<uint64_t> m_enqueued;                 // 已入队消息数量
+    std::atomic<uint64_t> m_coalesced_heartbeats;     // 合并的心跳数量
+    std::atomic<uint64_t> m_coalesced_statuses;       // 被取代的旧状态数量
+    std::atomic<uint64_t> m_dropped_heartbeats;       // 丢弃的心跳数量
+    std::atomic<uint64_t> m_dropped_statuses;         // 丢弃的状态数量
+};
+
+#endif // INGRESS_POOL_H
@@ -0,0 +1,94 @@
+#ifndef JSON_SCANNER_H
+#define JSON_SCANNER_H
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <json/json.h>
+
+/**
+ * 就地JSON扫描器
+ * 入站的状态、命令和响应消息只用到少数已知字段，直接在原始负载上按 string_view 扫描，
+ * 只定位字段值的原始文本，不构建整条消息的 Json::Value 树，也不经过字符串流；
+ * 需要结构化数据的字段（如属性、命令参数）再单独转换为 Json::Value。
+ * 字符串扫描使用SSE2一次比较16字节查找引号和反斜杠。
+ *
+ * 只接受严格JSON的一个子集：无注释、顶层是对象且其后只有空白、顶层键不含转义、嵌套不超过64层、
+ * 整数不超出64位、浮点数不溢出、字符串不含代理对转义。接受的输入与 jsoncpp 的解析结果一致，
+ * 其他输入一律返回失败，调用方回退到 MessageCodec::decodeAny，行为与改造前相同。
+ */
+class JsonScanner {
+public:
+    static constexpr int MAX_DEPTH = 64;   // 最大嵌套层数
+
+    /**
+     * 顶层对象成员读取器
+     * 逐个返回成员的键和值的原始文本，值在返回前已完整校验语法；
+     * next() 返回false后用 ok() 区分正常结束和格式错误。
+     */
+    class ObjectReader {
+    public:
+        /**
+         * 构造函数
+         * @param text JSON文本（须在读取期间保持有效）
+         */
+        explicit ObjectReader(std::string_view text);
+
+        /**
+         * 读取下一个成员
+         * @param key 输出的键（不含引号）
+         * @param value 输出的值的原始文本
+         * @return 是否读到成员
+         */
+        bool next(std::string_view& key, std::string_view& value);
+
+        /**
+         * 判断是否已完整读取一个合法对象
+         * @return 是否成功
+         */
+        bool ok() const { return m_state == State::DONE; }
+
+    private:
+        enum class State { FIRST, MEMBERS, DONE, FAILED };
+
+        bool fail();
+
+        const char* m_pos;                  // 当前位置
+        const char* m_end;                  // 文本结束位置
+        State m_state;                      // 读取状态
+    };
+
+    /**
+     * 将字符串值的原始文本解码为字符串
+     * @param raw 值的原始文本（含引号）
+     * @param out 输出的字符串
+     * @return 是否是支持的字符串
+     */
+    static bool toString(std::string_view raw, std::string& out);
+
+    /**
+     * 将布尔值的原始文本转换为布尔值
+     * @param raw 值的原始文本
+     * @param out 输出的布尔值
+     * @return 是否是布尔值
+     */
+    static bool toBool(std::string_view raw, bool& out);
+
+    /**
+     * 将非负整数的原始文本转换为整数
+     * @param raw 值的原始文本
+     * @param out 输出的整数
+     * @return 是否是64位无符号整数
+     */
+    static bool toUInt64(std::string_view raw, uint64_t& out);
+
+    /**
+     * 将任意值的原始文本转换为 Json::Value（对象成员重复时后者覆盖前者，与 jsoncpp 一致）
+     * @param raw 值的原始文本
+     * @param out 输出的值
+     * @return 是否是支持的JSON值
+     */
+    static bool toValue(std::string_view raw, Json::Value& out);
+};
+
+#endif // JSON_SCANNER_H
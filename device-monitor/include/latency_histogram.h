@@ -0,0 +1,74 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+
+/**
+ * 延迟统计摘要
+ */
+struct LatencySummary {
+    uint64_t count = 0;                 // 样本数量
+    uint64_t min_us = 0;                // 最小值（微秒）
+    uint64_t max_us = 0;                // 最大值（微秒）
+    double mean_us = 0.0;               // 平均值（微秒）
+    uint64_t p50_us = 0;                // 50分位（微秒）
+    uint64_t p90_us = 0;                // 90分位（微秒）
+    uint64_t p99_us = 0;                // 99分位（微秒）
+};
+
+/**
+ * 对数线性延迟直方图
+ * 每个2的幂区间再细分为8个子桶（相对误差不超过12.5%），桶数固定，内存占用恒定
+ */
+class LatencyHistogram {
+public:
+    static constexpr unsigned SUB_BUCKET_BITS = 3;
+    static constexpr unsigned SUB_BUCKETS = 1u << SUB_BUCKET_BITS;
+    static constexpr size_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    LatencyHistogram();
+
+    /**
+     * 记录一个样本
+     * @param value_us 延迟（微秒）
+     */
+    void record(uint64_t value_us);
+
+    /**
+     * 获取指定分位的近似值
+     * @param percentile 分位（0-100）
+     * @return 该分位所在桶的上界（微秒）
+     */
+    uint64_t percentile(double percentile) const;
+
+    /**
+     * 获取统计摘要
+     * @return 统计摘要
+     */
+    LatencySummary summary() const;
+
+    /**
+     * 清空所有样本
+     */
+    void reset();
+
+    /**
+     * 获取样本数量
+     * @return 样本数量
+     */
+    uint64_t count() const { return m_count; }
+
+private:
+    static size_t bucketIndex(uint64_t value);
+    static uint64_t bucketUpperBound(size_t index);
+
+    std::array<uint64_t, BUCKET_COUNT> m_buckets;  // 各桶计数
+    uint64_t m_count;                               // 样本数量
+    uint64_t m_sum;                                 // 样本总和
+    uint64_t m_min;                                 // 最小值
+    uint64_t m_max;                                 // 最大值
+};
+
+#endif // LATENCY_HISTOGRAM_H
@@ -0,0 +1,78 @@
+#ifndef LIVENESS_WHEEL_H
+#define LIVENESS_WHEEL_H
+
+#include "device_registry.h"
+#include <vector>
+#include <mutex>
+#include <cstdint>
+
+/**
+ * 设备存活检测时间轮
+ * 哈希时间轮：每个设备句柄通过侵入式双向链表挂在其超时时刻对应的槽位上，
+ * 挂载、移除和到期处理均为O(1)，推进时只访问到期槽位而不扫描全部设备
+ */
+class LivenessWheel {
+public:
+    /**
+     * 构造函数
+     * @param slot_count 槽位数量
+     * @param tick_nanos 每个槽位代表的时间跨度（纳秒），即超时检测精度
+     */
+    explicit LivenessWheel(size_t slot_count = 512, int64_t tick_nanos = 1000000000);
+
+    /**
+     * 将设备挂到时间轮上；若已挂载且新的超时时刻更晚则保持不变（到期时再按最新活跃时间重新挂载）
+     * @param handle 设备句柄
+     * @param deadline_ticks 超时时刻（DeviceRegistry::nowTicks()时间基准）
+     */
+    void arm(DeviceHandle handle, int64_t deadline_ticks);
+
+    /**
+     * 将设备从时间轮上摘除
+     * @param handle 设备句柄
+     */
+    void disarm(DeviceHandle handle);
+
+    /**
+     * 推进时间轮到当前时刻，摘除并返回所有已到期的设备
+     * @param now_ticks 当前时刻
+     * @param expired 输出的到期设备句柄
+     */
+    void advance(int64_t now_ticks, std::vector<DeviceHandle>& expired);
+
+    /**
+     * 获取已挂载的设备数量
+     * @return 设备数量
+     */
+    size_t size() const;
+
+    /**
+     * 获取检测精度
+     * @return 每个槽位的时间跨度（纳秒）
+     */
+    int64_t tickNanos() const { return m_tick_nanos; }
+
+private:
+    static constexpr uint32_t NIL = 0xffffffffu;
+
+    // 侵入式链表节点，按设备句柄下标存放
+    struct Node {
+        uint32_t prev = NIL;
+        uint32_t next = NIL;
+        uint32_t bucket = 0;
+        int64_t deadline_tick = 0;
+        bool armed = false;
+    };
+
+    void link(DeviceHandle handle, int64_t deadline_tick);
+    void unlink(DeviceHandle handle);
+
+    std::vector<uint32_t> m_buckets;    // 各槽位链表头
+    std::vector<Node> m_nodes;          // 设备节点
+    int64_t m_tick_nanos;               // 槽位时间跨度
+    int64_t m_current_tick;             // 下一个待处理的刻度
+    size_t m_armed_count;               // 已挂载设备数量
+    mutable std::mutex m_mutex;         // 互斥锁
+};
+
+#endif // LIVENESS_WHEEL_H
@@ -0,0 +1,90 @@
+#ifndef MESSAGE_CODEC_H
+#define MESSAGE_CODEC_H
+
+#include <string>
+#include <string_view>
+#include <json/json.h>
+
+/**
+ * 消息负载格式
+ */
+enum class MessageFormat {
+    JSON,   // 文本JSON（默认，兼容旧设备）
+    CBOR    // 紧凑二进制（RFC 8949）
+};
+
+/**
+ * 消息编解码器
+ * 状态、心跳、命令和响应在内存中统一使用 Json::Value 表示，编解码器只负责与线上字节之间的转换。
+ *
+ * 所有消息的顶层都是对象或数组：JSON文本以 '{'、'[' 或空白开头，CBOR以数组、映射类型（0x80-0xbf）或标签开头，
+ * 两者的首字节不会重叠，因此接收方无需预先知道对端格式，按首字节即可选择解码器。
+ * 设备在状态消息中通过 "codec" 字段声明自己偏好的格式，服务端按该格式向设备发送命令。
+ */
+class MessageCodec {
+public:
+    virtual ~MessageCodec() = default;
+
+    /**
+     * 获取编解码器对应的格式
+     * @return 负载格式
+     */
+    virtual MessageFormat format() const = 0;
+
+    /**
+     * 获取格式名称（用于配置和协商）
+     * @return 格式名称，如 "json"、"cbor"
+     */
+    virtual const char* name() const = 0;
+
+    /**
+     * 编码消息
+     * @param message 消息内容
+     * @return 编码后的负载
+     */
+    virtual std::string encode(const Json::Value& message) const = 0;
+
+    /**
+     * 解码消息
+     * @param data 负载数据
+     * @param size 负载长度
+     * @param message 输出的消息内容
+     * @param errors 输出的错误信息（可为空）
+     * @return 是否成功
+     */
+    virtual bool decode(const char* data, size_t size, Json::Value& message, std::string* errors) const = 0;
+
+    /**
+     * 获取指定格式的编解码器（全局单例，线程安全）
+     * @param format 负载格式
+     * @return 编解码器
+     */
+    static const MessageCodec& get(MessageFormat format);
+
+    /**
+     * 按名称查找编解码器
+     * @param name 格式名称
+     * @return 编解码器，名称未知时返回nullptr
+     */
+    static const MessageCodec* find(const std::string& name);
+
+    /**
+     * 按首字节判断负载格式
+     * @param payload 负载
+     * @return 负载格式
+     */
+    static MessageFormat detect(std::string_view payload);
+
+    /**
+     * 自动识别格式并解码
+     * @param payload 负载
+     * @param message 输出的消息内容
+     * @param errors 输出的错误信息（可为空）
+     * @param format 输出识别到的格式（可为空）
+     * @return 是否成功
+     */
+    static bool decodeAny(std::string_view payload, Json::Value& message,
+                          std::string* errors, MessageFormat* format = nullptr);
+};
+
+#endif // MESSAGE_CODEC_H
@@ -0,0 +1,117 @@
+#ifndef MESSAGE_WRITER_H
+#define MESSAGE_WRITER_H
+
+#include "message_codec.h"
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <json/json.h>
+
+/**
+ * 流式消息写入器
+ * 状态、心跳、命令和响应的结构是固定的，发布时直接按字段顺序追加到输出缓冲区，
+ * 不构建临时的 Json::Value 树，也不为每条消息构造 Json::StreamWriterBuilder。
+ *
+ * JSON输出与 indentation 为空的 Json::StreamWriterBuilder 逐字节一致（17位有效数字、非ASCII字符输出为Unicode转义序列），
+ * 前提是调用方按字节序写入对象的键——jsoncpp 的对象按键排序输出。
+ * CBOR输出需要在开始对象和数组时给出成员数量，JSON输出忽略该数量。
+ *
+ * 配合 threadBuffer() 复用每个线程的缓冲区，稳定状态下发布一条消息不分配内存。
+ */
+class MessageWriter {
+public:
+    /**
+     * 构造函数
+     * @param format 输出格式
+     * @param out 输出缓冲区（追加写入）
+     */
+    MessageWriter(MessageFormat format, std::string& out);
+
+    /**
+     * 获取当前线程复用的输出缓冲区（已清空，保留容量）
+     * 在下一次调用前有效，调用方不能在使用期间再次获取
+     * @return 输出缓冲区
+     */
+    static std::string& threadBuffer();
+
+    /**
+     * 开始对象
+     * @param members 成员数量（CBOR需要）
+     */
+    void beginObject(size_t members);
+
+    /**
+     * 结束对象
+     */
+    void endObject();
+
+    /**
+     * 开始数组
+     * @param elements 元素数量（CBOR需要）
+     */
+    void beginArray(size_t elements);
+
+    /**
+     * 结束数组
+     */
+    void endArray();
+
+    /**
+     * 写入对象的键
+     * @param name 键名
+     */
+    void key(std::string_view name);
+
+    /**
+     * 写入字符串值
+     * @param text 字符串
+     */
+    void writeString(std::string_view text);
+
+    /**
+     * 写入有符号整数
+     * @param number 整数
+     */
+    void writeInt(int64_t number);
+
+    /**
+     * 写入无符号整数
+     * @param number 整数
+     */
+    void writeUInt(uint64_t number);
+
+    /**
+     * 写入浮点数
+     * @param number 浮点数
+     */
+    void writeDouble(double number);
+
+    /**
+     * 写入布尔值
+     * @param flag 布尔值
+     */
+    void writeBool(bool flag);
+
+    /**
+     * 写入空值
+     */
+    void writeNull();
+
+    /**
+     * 写入任意JSON值（对象成员按键排序）
+     * @param value JSON值
+     */
+    void writeValue(const Json::Value& value);
+
+private:
+    void separator();
+    void cborHead(uint8_t major, uint64_t argument);
+    void jsonString(std::string_view text);
+
+    MessageFormat m_format;                         // 输出格式
+    std::string& m_out;                             // 输出缓冲区
+    bool m_need_comma;                              // JSON：下一个元素前需要逗号
+    bool m_after_key;                               // JSON：刚写完键，下一个值前不加逗号
+};
+
+#endif // MESSAGE_WRITER_H
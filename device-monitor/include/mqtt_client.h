@@ -1,14 +1,20 @@
 #ifndef MQTT_CLIENT_H
 #define MQTT_CLIENT_H
 
+#include "topic_router.h"
+#include "reconnect_backoff.h"
+#include "offline_spool.h"
 #include <mosquitto.h>
 #include <string>
 #include <functional>
 #include <thread>
 #include <atomic>
 #include <mutex>
-#include <condition_variable>
 #include <chrono>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <unordered_map>
 
 /**
  * SSL/TLS配置结构体
@@ -34,15 +40,89 @@ struct AuthConfig {
     std::string password;                    // 密码
 };
 
+class MqttReactor;
+
+/**
+ * MQTT v5 发布属性（MQTT 3.1.1 连接下忽略）
+ */
+struct PublishProperties {
+    std::string response_topic;              // 响应主题，接收方把响应发布到该主题
+    std::string correlation_data;            // 关联数据，接收方在响应中原样带回（最长65535字节）
+    uint32_t message_expiry = 0;             // 消息过期时间（秒），broker 不再投递超时未送达的消息，0表示不过期
+};
+
+/**
+ * 异步发布结果
+ */
+enum class PublishResult {
+    SENT,                                    // QoS 0 已交给网络层；QoS 1/2 已收到服务器确认
+    COALESCED,                               // 发送前被同一主题的新值替换
+    SPOOLED,                                 // 内存队列超过限额，已转存到离线缓冲文件（之后重放，不再回调）
+    FAILED                                   // 被 mosquitto 拒绝（如负载过大、参数非法）
+};
+
+/**
+ * 异步发布队列统计
+ */
+struct PublishQueueStats {
+    size_t depth = 0;                        // 当前排队（尚未交给 mosquitto）的消息数
+    size_t max_depth = 0;                    // 排队消息数峰值
+    size_t inflight = 0;                     // 已发出、带完成回调且等待确认的 QoS 1/2 消息数
+    uint64_t enqueued = 0;                   // 累计入队
+    uint64_t sent = 0;                       // 累计交给 mosquitto
+    uint64_t coalesced = 0;                  // 累计被同一主题的新值替换
+    uint64_t rejected = 0;                   // 累计因队列已满拒绝入队
+    uint64_t failed = 0;                     // 累计发送失败
+    uint64_t batches = 0;                    // 累计发送批次
+    size_t spool_depth = 0;                  // 离线缓冲文件中待重放的消息数
+    uint64_t spooled = 0;                    // 累计转存到离线缓冲
+    uint64_t replayed = 0;                   // 累计从离线缓冲重放
+    uint64_t stale = 0;                      // 累计在重放前因同一主题已有更新的值而丢弃
+    uint64_t spool_dropped = 0;              // 累计因离线缓冲文件已满丢弃的最旧消息
+};
+
 /**
  * MQTT客户端基础类
  * 提供MQTT连接、消息发布/订阅、重连等基础功能
+ *
+ * 主题路由和回调函数保存在不可变的处理函数集合中：注册时复制当前集合、修改后原子替换，
+ * 消息和连接状态分发时无锁读取当前集合。处理函数执行期间不持有任何锁，
+ * 耗时的处理函数不会阻塞注册和重连，处理函数中也可以注册新的路由和回调。
+ * 被替换的旧集合在没有分发读取时（最后一个分发退出或下一次注册时）释放。
+ *
+ * 网络线程用 poll 等待 mosquitto 套接字和唤醒管道，自行驱动读、写和保活。
+ * 异步发布的消息压入无锁栈，由网络线程成批取出后按入队顺序调用 mosquitto_publish，
+ * 发布线程之间以及发布线程与网络线程之间不在 mosquitto 内部竞争；断线期间消息留在队列中，重连后发出。
+ *
+ * 设置反应器（MqttReactor）后客户端不创建网络线程，套接字读写、保活、
+ * 重连和异步发布都由反应器的线程驱动，线程数与客户端数量无关。
+ *
+ * 启用 MQTT v5 后发布可以带响应主题、关联数据和过期时间，收到的消息视图中带有对方设置的响应主题和关联数据；
+ * QoS 0 消息按主题自动分配主题别名（数量不超过 broker 在连接确认中声明的上限），
+ * 同一主题第二次起只发送两字节的别名，每次连接重新分配。
+ *
+ * 断线重连由网络线程（或反应器线程）按去相关抖动的指数退避（ReconnectBackoff）发起，连接确认后复位，
+ * broker 重启后大量客户端的重连分散到整个退避窗口，而不是按固定间隔同步涌入。
+ * 启用持久会话后 broker 在断线期间保留订阅和未送达的 QoS 1/2 消息，
+ * 重连时连接确认带有会话存在标志，此时无需重新订阅。
+ *
+ * 启用离线缓冲（OfflineSpool）后，待发送队列超过内存限额时最早的消息转存到内存映射的环形文件，
+ * 重连后先按速率上限重放文件中的消息，再发送内存中的消息，积压不会一次涌向 broker；
+ * 只保留最新值的主题在重放前丢弃已被更新值取代的旧值。
  */
 class MqttClient {
 public:
     // 消息回调函数类型定义
     using MessageCallback = std::function<void(const std::string& topic, const std::string& payload)>;
+    using MessageViewCallback = std::function<void(const MessageView& message)>;
     using ConnectionCallback = std::function<void(bool connected)>;
+    using PublishCallback = std::function<void(PublishResult result)>;
+    
+    static constexpr size_t DEFAULT_PUBLISH_QUEUE_LIMIT = 10000;   // 异步发布队列默认容量
+    static constexpr size_t PUBLISH_BATCH_SIZE = 256;              // 网络线程每批最多发出的消息数
+    static constexpr uint32_t DEFAULT_SESSION_EXPIRY = 3600;       // 默认会话保留时间（秒，MQTT v5）
+    static constexpr size_t DEFAULT_OFFLINE_MEMORY_LIMIT = 1000;   // 启用离线缓冲时内存中默认最多保留的待发送消息数
+    static constexpr int REPLAY_BURST_MS = 100;                    // 限速重放最多积累的额度（毫秒）
     
     /**
      * 构造函数
@@ -116,19 +196,134 @@ public:
      */
     void disconnect();
     
+    /**
+     * 设置遗嘱消息（需在connect()之前调用），连接异常断开时由服务器代为发布
+     * @param topic 主题
+     * @param payload 消息内容（保留消息的空内容表示清除该主题的保留消息）
+     * @param qos 服务质量等级
+     * @param retain 是否保留消息
+     * @return 设置是否成功
+     */
+    bool setWill(const std::string& topic, const std::string& payload, int qos = 1, bool retain = false);
+    
+    /**
+     * 启用或关闭 MQTT v5 协议（需在connect()之前调用，broker 须支持 MQTT v5）
+     * @param enable 是否使用 MQTT v5
+     * @return 设置是否成功
+     */
+    bool setMqtt5(bool enable);
+    
+    /**
+     * 检查是否使用 MQTT v5 协议
+     * @return 是否使用 MQTT v5
+     */
+    bool isMqtt5() const;
+    
     /**
      * 发布消息
+     * 启用离线缓冲时，未连接或离线缓冲尚未重放完时消息进入异步发布队列，保持发布顺序
      * @param topic 主题
      * @param payload 消息内容
      * @param qos 服务质量等级
      * @param retain 是否保留消息
-     * @return 发布是否成功
+     * @return 发布是否成功（进入队列时返回是否入队）
      */
     bool publish(const std::string& topic, 
                 const std::string& payload, 
                 int qos = 0, 
                 bool retain = false);
     
+    /**
+     * 发布带 MQTT v5 属性的消息
+     * @param topic 主题
+     * @param payload 消息内容
+     * @param qos 服务质量等级
+     * @param retain 是否保留消息
+     * @param properties 发布属性（MQTT 3.1.1 连接下忽略）
+     * @return 发布是否成功
+     */
+    bool publish(const std::string& topic,
+                 const std::string& payload,
+                 int qos,
+                 bool retain,
+                 const PublishProperties& properties);
+    
+    /**
+     * 异步发布消息
+     * 消息入队后立即返回，由网络线程成批发出；未连接时消息保留在队列中，连接后按入队顺序发出。
+     * latest_only 的主题只关心最新值：发出前同一主题的新消息替换队列中的旧消息（保留旧消息的位置），
+     * 旧消息的完成回调收到 COALESCED。完成回调在网络线程中执行，不应阻塞；
+     * 客户端析构时未完成的消息直接丢弃，不调用完成回调
+     * @param topic 主题
+     * @param payload 消息内容
+     * @param qos 服务质量等级
+     * @param retain 是否保留消息
+     * @param latest_only 是否按主题只保留最新值
+     * @param callback 完成回调（可为空）
+     * @return 是否入队（队列已满时返回false，不调用完成回调）
+     */
+    bool publishAsync(const std::string& topic,
+                      std::string payload,
+                      int qos = 0,
+                      bool retain = false,
+                      bool latest_only = false,
+                      PublishCallback callback = nullptr);
+    
+    /**
+     * 异步发布带 MQTT v5 属性的消息，其余同上
+     * @param topic 主题
+     * @param payload 消息内容
+     * @param qos 服务质量等级
+     * @param retain 是否保留消息
+     * @param properties 发布属性（MQTT 3.1.1 连接下忽略）
+     * @param callback 完成回调（可为空）
+     * @return 是否入队
+     */
+    bool publishAsync(const std::string& topic,
+                      std::string payload,
+                      int qos,
+                      bool retain,
+                      const PublishProperties& properties,
+                      PublishCallback callback = nullptr);
+    
+    /**
+     * 设置异步发布队列容量
+     * @param limit 最多排队的消息数
+     */
+    void setPublishQueueLimit(size_t limit);
+    
+    /**
+     * 获取异步发布队列统计
+     * @return 统计信息
+     */
+    PublishQueueStats publishQueueStats() const;
+    
+    /**
+     * 启用离线发布缓冲（需在start()之前调用）
+     * 待发送队列超过 memory_limit 条时最早的消息转存到内存映射的环形文件，文件写满时丢弃最旧的消息。
+     * 连接后先重放文件中的消息（受 setReplayRate 限速），再发送内存中的消息；停止时未发出的消息也写入文件，
+     * 下次启用同一文件时恢复并在连接后重放。memory_limit 应小于异步发布队列容量
+     * @param path 缓冲文件路径
+     * @param capacity_bytes 文件数据区容量（字节）
+     * @param memory_limit 内存中最多保留的待发送消息数
+     * @return 设置是否成功
+     */
+    bool setOfflineBuffer(const std::string& path,
+                          size_t capacity_bytes = OfflineSpool::DEFAULT_CAPACITY,
+                          size_t memory_limit = DEFAULT_OFFLINE_MEMORY_LIMIT);
+    
+    /**
+     * 检查是否启用了离线发布缓冲
+     * @return 是否启用
+     */
+    bool hasOfflineBuffer() const;
+    
+    /**
+     * 设置离线缓冲重放速率上限
+     * @param messages_per_second 每秒最多重放的消息数（0表示不限速）
+     */
+    void setReplayRate(uint32_t messages_per_second);
+    
     /**
      * 订阅主题
      * @param topic 主题
@@ -150,6 +345,28 @@ public:
      */
     void setMessageCallback(MessageCallback callback);
     
+    /**
+     * 设置消息接收回调函数（视图形式）
+     * 回调直接收到指向 mosquitto 消息缓冲区的主题和内容以及QoS、保留标志和消息ID，不复制消息；
+     * 视图只在回调期间有效。设置后代替复制形式的消息接收回调函数
+     * @param callback 回调函数
+     */
+    void setMessageViewCallback(MessageViewCallback callback);
+    
+    /**
+     * 注册主题路由，消息到达时按预编译的过滤器匹配并调用处理函数，处理函数收到不复制的消息视图；
+     * 未匹配任何路由的消息交给消息接收回调函数
+     * @param filter 主题过滤器（支持 '+' 和 '#' 通配符）
+     * @param handler 处理函数，参数中带有通配符捕获的层级
+     * @return 过滤器是否合法
+     */
+    bool addRoute(const std::string& filter, TopicRouter::Handler handler);
+    
+    /**
+     * 清空所有主题路由
+     */
+    void clearRoutes();
+    
     /**
      * 设置连接状态回调函数
      * @param callback 回调函数
@@ -172,13 +389,49 @@ public:
      */
     bool isConnected() const;
     
+    /**
+     * 获取自动重连的尝试次数
+     * @return 尝试次数
+     */
+    uint64_t reconnectAttempts() const;
+    
     /**
      * 设置自动重连
      * @param enable 是否启用自动重连
-     * @param retry_interval 重连间隔（秒）
+     * @param retry_interval 初始重连间隔（秒），之后按退避策略增长到上限
      */
     void setAutoReconnect(bool enable, int retry_interval = 5);
     
+    /**
+     * 设置重连退避参数
+     * @param initial_ms 初始重连间隔（毫秒）
+     * @param max_ms 重连间隔上限（毫秒）
+     */
+    void setReconnectBackoff(int initial_ms, int max_ms = ReconnectBackoff::DEFAULT_MAX_MS);
+    
+    /**
+     * 设置持久会话（须在 setWill() 和 connect() 之前调用；会重新初始化 mosquitto 实例，
+     * 之后恢复回调、协议版本、SSL/TLS 和身份验证配置）
+     * 启用后以 clean_session=false 连接，broker 在断线期间保留订阅和未送达的 QoS 1/2 消息；
+     * MQTT v5 下同时在连接属性中声明会话保留时间，此时 connect() 总是阻塞连接以便重连沿用该属性
+     * @param enable 是否启用持久会话
+     * @param session_expiry 会话保留时间（秒，仅 MQTT v5）
+     * @return 设置是否成功
+     */
+    bool setPersistentSession(bool enable, uint32_t session_expiry = DEFAULT_SESSION_EXPIRY);
+    
+    /**
+     * 检查是否启用持久会话
+     * @return 是否启用
+     */
+    bool isPersistentSession() const;
+    
+    /**
+     * 检查最近一次连接确认是否带有会话存在标志（broker 保留了上次的订阅）
+     * @return 会话是否存在
+     */
+    bool sessionPresent() const;
+    
     /**
      * 配置SSL/TLS
      * @param ssl_config SSL/TLS配置
@@ -204,20 +457,140 @@ public:
      * @return 身份验证配置
      */
     const AuthConfig& getAuthConfig() const;
+    
+    /**
+     * 设置驱动客户端的反应器（须在 start() 和异步发布之前调用，反应器须比客户端存活更久）
+     * 反应器模式下 connect() 使用非阻塞连接，自动重连由反应器按退避间隔发起
+     * @param reactor 反应器，为空表示使用独立的网络线程
+     */
+    void setReactor(MqttReactor* reactor);
+    
+    /**
+     * 获取驱动客户端的反应器
+     * @return 反应器，未设置时为空
+     */
+    MqttReactor* getReactor() const;
 
 protected:
     // MQTT回调函数
     static void onConnect(struct mosquitto* mosq, void* userdata, int result);
+    static void onConnectWithFlags(struct mosquitto* mosq, void* userdata, int result, int flags);
+    static void onConnectV5(struct mosquitto* mosq, void* userdata, int result, int flags, const mosquitto_property* properties);
     static void onDisconnect(struct mosquitto* mosq, void* userdata, int result);
     static void onMessage(struct mosquitto* mosq, void* userdata, const struct mosquitto_message* message);
+    static void onMessageV5(struct mosquitto* mosq, void* userdata, const struct mosquitto_message* message,
+                            const mosquitto_property* properties);
     static void onSubscribe(struct mosquitto* mosq, void* userdata, int mid, int qos_count, const int* granted_qos);
     static void onUnsubscribe(struct mosquitto* mosq, void* userdata, int mid);
     static void onPublish(struct mosquitto* mosq, void* userdata, int mid);
     
-    // 重连线程函数
-    void reconnectLoop();
+    // 网络线程函数
+    void networkLoop();
     
 private:
+    friend class MqttReactor;
+    
+    // 以下由网络线程或反应器线程调用
+    
+    // 发出入队的异步发布消息，返回是否仍有可立即发送的消息
+    bool servicePublishes();
+    
+    // 处理套接字读写事件并执行保活，返回 mosquitto 错误码
+    int serviceSocket(bool readable, bool writable);
+    
+    // 未连接时按退避间隔发起重连，返回下一次重连的时间（无需重连时为 time_point::max()）
+    std::chrono::steady_clock::time_point reconnectIfDue();
+    
+    // 停止时发出已入队的消息并尽量写出套接字缓冲，启用离线缓冲时未发出的消息写入文件
+    void flushPublishes();
+    
+    // 离线缓冲限速重放时下一条可重放的时间（无需等待时为 time_point::max()）
+    std::chrono::steady_clock::time_point replayDue() const;
+    
+    // 处理函数集合（注册后不再修改）
+    struct HandlerSet {
+        TopicRouter router;                         // 主题路由
+        MessageCallback message_callback;           // 消息回调
+        MessageViewCallback message_view_callback;  // 消息回调（视图形式）
+        ConnectionCallback connection_callback;     // 连接状态回调
+    };
+    
+    // 复制当前处理函数集合，修改成功后原子替换
+    template <typename Modify>
+    bool updateHandlers(Modify&& modify);
+    
+    // 分发期间持有当前处理函数集合：登记读者后再读取指针，析构时注销
+    class HandlerReader {
+    public:
+        explicit HandlerReader(MqttClient& client) : m_client(client) {
+            m_client.m_handler_readers.fetch_add(1);
+            m_set = m_client.m_handlers.load();
+        }
+        ~HandlerReader() { m_client.releaseHandlers(); }
+        HandlerReader(const HandlerReader&) = delete;
+        HandlerReader& operator=(const HandlerReader&) = delete;
+        const HandlerSet* get() const { return m_set; }
+    private:
+        MqttClient& m_client;
+        const HandlerSet* m_set;
+    };
+    
+    // 注销读者，最后一个读者退出时释放被替换的旧集合
+    void releaseHandlers();
+    
+    // 没有读者时释放被替换的旧集合（在锁外析构）
+    void reclaimHandlers();
+    
+    // 设置 mosquitto 回调函数（构造和重新初始化后调用）
+    void installCallbacks();
+    
+    // 按主题路由和消息回调分发入站消息
+    void dispatchMessage(const MessageView& view);
+    
+    // 调用 mosquitto 发布消息：MQTT v5 下附加发布属性，QoS 0 消息使用主题别名，返回 mosquitto 错误码
+    int sendPublish(int* mid, const std::string& topic, const std::string& payload, int qos, bool retain,
+                    const PublishProperties* properties);
+    
+    // 清除主题别名并设置新连接的别名上限
+    void resetTopicAliases(uint16_t limit);
+    
+    // 等待发送的异步发布消息
+    struct PendingPublish {
+        std::string topic;
+        std::string payload;
+        int qos = 0;
+        bool retain = false;
+        bool latest_only = false;
+        std::unique_ptr<PublishProperties> properties;  // MQTT v5 发布属性（可为空）
+        PublishCallback callback;
+        PendingPublish* next = nullptr;     // 入队栈中的前一条消息
+    };
+    
+    // 异步发布入队（两种 publishAsync 的共同实现）
+    bool enqueuePublish(const std::string& topic, std::string payload, int qos, bool retain, bool latest_only,
+                        const PublishProperties* properties, PublishCallback callback);
+    
+    // 创建唤醒网络线程的管道
+    bool openWakePipe();
+    
+    // 唤醒网络线程
+    void wakeNetworkLoop();
+    
+    // 取出入队栈中的全部消息，按入队顺序移入待发送队列并合并只保留最新值的主题（仅网络线程）
+    void drainPublishQueue();
+    
+    // 发出一批待发送消息，返回是否仍有可立即发送的消息（仅网络线程）
+    bool sendPendingPublishes();
+    
+    // 把待发送队列中超出 keep 条的最早消息转存到离线缓冲（仅网络线程）
+    void spillPublishes(size_t keep);
+    
+    // 按速率上限重放一批离线缓冲中的消息，返回是否仍有可立即重放的消息（仅网络线程）
+    bool replaySpool();
+    
+    // 调用完成回调
+    static void completePublish(const PublishCallback& callback, PublishResult result);
+
     struct mosquitto* m_mosquitto;          // mosquitto客户端实例
     std::string m_client_id;                // 客户端ID
     std::string m_host;                     // 服务器地址
@@ -229,16 +602,59 @@ private:
     std::atomic<bool> m_connected;          // 连接状态
     std::atomic<bool> m_running;            // 运行状态
     std::atomic<bool> m_auto_reconnect;     // 自动重连开关
-    int m_retry_interval;                   // 重连间隔
+    bool m_mqtt5 = false;                   // 是否使用 MQTT v5
+    bool m_persistent_session = false;      // 是否使用持久会话
+    uint32_t m_session_expiry = 0;          // 会话保留时间（秒，MQTT v5）
+    std::atomic<bool> m_session_present{false}; // 最近一次连接确认的会话存在标志
+    
+    std::unordered_map<std::string, uint16_t> m_topic_aliases;   // 本次连接已分配的主题别名
+    uint16_t m_topic_alias_limit = 0;                            // broker 允许的主题别名数量
+    std::mutex m_alias_mutex;                                    // 保护主题别名（分配别名的首次发布期间持有）
+    
+    std::atomic<const HandlerSet*> m_handlers{nullptr};          // 当前处理函数集合
+    std::unique_ptr<const HandlerSet> m_handler_set;             // 当前处理函数集合的所有权
+    std::vector<std::unique_ptr<const HandlerSet>> m_retired_handlers; // 被替换但可能仍被分发读取的旧集合
+    std::mutex m_retired_mutex;                                  // 保护旧集合列表（只在移入和取出时短暂持有）
+    std::atomic<bool> m_handlers_retired{false};                 // 是否有待释放的旧集合
+    std::atomic<int> m_handler_readers{0};                       // 正在读取处理函数集合的分发数量
+    std::atomic<uint64_t> m_reconnect_attempts{0};               // 自动重连尝试次数
+    std::atomic<bool> m_want_connection{false};                  // 是否应保持连接（connect() 成功后置位，disconnect() 清除）
+    
+    std::atomic<PendingPublish*> m_publish_head{nullptr};        // 异步发布入队栈（多生产者压入，网络线程整体取出）
+    std::deque<std::unique_ptr<PendingPublish>> m_outbox;        // 待发送队列（仅网络线程访问）
+    std::unordered_map<std::string, PendingPublish*> m_latest_pending; // 待发送队列中只保留最新值的主题
+    std::unordered_map<int, PublishCallback> m_inflight_callbacks; // 等待确认的 QoS 1/2 消息的完成回调（按消息ID）
+    mutable std::mutex m_inflight_mutex;                         // 保护等待确认的完成回调
+    int m_wake_pipe[2] = {-1, -1};                               // 唤醒网络线程的管道（读端, 写端），启动时创建
+    std::atomic<int> m_wake_fd{-1};                              // 唤醒管道写端（网络线程启动前为-1）
+    ReconnectBackoff m_reconnect_backoff;                        // 重连退避（退避状态仅网络线程或反应器线程访问）
+    bool m_reconnect_pending = false;                            // 已发现断线并排定重连（仅网络线程或反应器线程访问）
+    std::chrono::steady_clock::time_point m_next_reconnect;      // 下一次重连时间（仅网络线程或反应器线程访问）
+    
+    MqttReactor* m_reactor = nullptr;                            // 驱动客户端的反应器
+    std::atomic<int> m_reactor_loop{-1};                         // 所在的反应器线程序号（未加入时为-1，由反应器维护）
+    std::atomic<size_t> m_publish_limit{DEFAULT_PUBLISH_QUEUE_LIMIT}; // 异步发布队列容量
+    std::atomic<size_t> m_publish_depth{0};                      // 异步发布排队消息数
+    std::atomic<size_t> m_publish_max_depth{0};                  // 排队消息数峰值
+    std::atomic<uint64_t> m_publish_enqueued{0};                 // 累计入队
+    std::atomic<uint64_t> m_publish_sent{0};                     // 累计交给 mosquitto
+    std::atomic<uint64_t> m_publish_coalesced{0};                // 累计被新值替换
+    std::atomic<uint64_t> m_publish_rejected{0};                 // 累计因队列已满拒绝入队
+    std::atomic<uint64_t> m_publish_failed{0};                   // 累计发送失败
+    std::atomic<uint64_t> m_publish_batches{0};                  // 累计发送批次
     
-    MessageCallback m_message_callback;     // 消息回调
-    ConnectionCallback m_connection_callback; // 连接状态回调
+    std::unique_ptr<OfflineSpool> m_spool;                       // 离线缓冲（未启用时为空，启动后仅网络线程或反应器线程访问）
+    size_t m_spool_threshold = DEFAULT_OFFLINE_MEMORY_LIMIT;     // 内存中最多保留的待发送消息数
+    std::atomic<bool> m_spool_backlog{false};                    // 离线缓冲中有待重放的消息（同步发布据此排队）
+    std::atomic<uint32_t> m_replay_rate{0};                      // 重放速率上限（条/秒，0表示不限速）
+    std::chrono::steady_clock::time_point m_replay_due;          // 下一条可重放的时间（仅网络线程或反应器线程访问）
+    std::atomic<uint64_t> m_publish_spooled{0};                  // 累计转存到离线缓冲
+    std::atomic<uint64_t> m_publish_replayed{0};                 // 累计从离线缓冲重放
+    std::atomic<uint64_t> m_publish_stale{0};                    // 累计重放前丢弃的旧值
     
-    std::thread m_loop_thread;              // 消息循环线程
-    std::thread m_reconnect_thread;         // 重连线程
+    std::thread m_loop_thread;              // 网络线程
     
-    mutable std::mutex m_mutex;             // 互斥锁
-    std::condition_variable m_cv;           // 条件变量
+    mutable std::mutex m_mutex;             // 互斥锁（保护处理函数集合的替换，分发时不使用）
     
     static bool s_lib_initialized;          // 库初始化标志
     static std::mutex s_init_mutex;         // 初始化互斥锁
@@ -0,0 +1,136 @@
+#ifndef MQTT_REACTOR_H
+#define MQTT_REACTOR_H
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <chrono>
+#include <functional>
+#include <atomic>
+
+class MqttClient;
+
+/**
+ * MQTT客户端共享反应器
+ * 由少量线程驱动任意数量的 MqttClient：每个线程用 epoll（非Linux平台用 poll）等待所属客户端的套接字，
+ * 可读可写时调用 mosquitto_loop_read/mosquitto_loop_write，每秒为每个客户端执行一次
+ * mosquitto_loop_misc（保活）和断线重连检查，断线的客户端另按各自的退避时间排入唤醒队列（离线缓冲限速重放的客户端同样按下一条可重放的时间排入）；客户端异步发布时把自己加入所属线程的就绪列表并唤醒线程，
+ * 只有就绪的客户端才会被取出发送。客户端按轮询分配到线程，之后固定由该线程驱动。
+ *
+ * 反应器还提供周期定时器（如设备的状态上报和心跳），定时器回调在反应器线程中执行，不应阻塞。
+ * 线程数与客户端和定时器数量无关。
+ */
+class MqttReactor {
+public:
+    using TimerCallback = std::function<void()>;
+
+    static constexpr int TICK_INTERVAL_MS = 1000;   // 客户端保活和重连检查间隔（毫秒）
+
+    /**
+     * 构造函数
+     * @param thread_count 反应器线程数量
+     */
+    explicit MqttReactor(size_t thread_count = 1);
+
+    /**
+     * 析构函数（停止线程；仍在反应器中的客户端须先停止）
+     */
+    ~MqttReactor();
+
+    MqttReactor(const MqttReactor&) = delete;
+    MqttReactor& operator=(const MqttReactor&) = delete;
+
+    /**
+     * 启动反应器线程
+     * @return 是否启动成功
+     */
+    bool start();
+
+    /**
+     * 停止反应器线程，正在执行的回调返回后返回
+     */
+    void stop();
+
+    /**
+     * 获取反应器线程数量
+     * @return 线程数量
+     */
+    size_t threadCount() const { return m_loops.size(); }
+
+    /**
+     * 获取由反应器驱动的客户端数量
+     * @return 客户端数量
+     */
+    size_t clientCount() const;
+
+    /**
+     * 添加周期定时器，首次在一个周期后触发
+     * @param interval 触发周期
+     * @param callback 回调函数（在反应器线程中执行）
+     * @return 定时器ID
+     */
+    uint64_t addTimer(std::chrono::milliseconds interval, TimerCallback callback);
+
+    /**
+     * 取消定时器；返回后回调不会再开始执行，
+     * 在其他线程调用时若回调正在执行，等待其返回
+     * @param id 定时器ID
+     */
+    void cancelTimer(uint64_t id);
+
+private:
+    friend class MqttClient;
+
+    // 反应器线程和其中的客户端（定义见实现文件）
+    struct Loop;
+    struct Entry;
+
+    /**
+     * 加入客户端，由 MqttClient::start() 调用
+     * @param client 客户端
+     */
+    void addClient(MqttClient* client);
+
+    /**
+     * 移除客户端，由 MqttClient::stop() 调用；在其他线程调用时等待反应器线程不再访问该客户端
+     * @param client 客户端
+     * @return 客户端此前是否在反应器中
+     */
+    bool removeClient(MqttClient* client);
+
+    /**
+     * 客户端有待发送的异步发布消息，加入就绪列表并唤醒所属线程
+     * @param client 客户端
+     */
+    void wake(MqttClient* client);
+
+    // 反应器线程函数
+    void loopMain(Loop& loop);
+
+    // 处理其他线程提交的加入、移除和定时器变更，返回是否应退出
+    bool processCommands(Loop& loop, std::vector<Entry*>& service);
+
+    // 发出客户端入队的异步发布消息并更新套接字注册
+    void serviceEntry(Loop& loop, Entry& entry);
+
+    // 按客户端当前的套接字和写需求更新注册
+    void syncEntry(Loop& loop, Entry& entry);
+
+    // 断线的客户端按退避间隔重连，仍未连接时排入唤醒队列
+    void reconnectEntry(Loop& loop, Entry& entry);
+
+    // 把客户端按指定时间排入唤醒队列（time_point::max() 表示无需唤醒）
+    void scheduleEntry(Loop& loop, Entry& entry, std::chrono::steady_clock::time_point due);
+
+    // 处理唤醒队列中到期的客户端：断线的重连，已连接的继续重放离线缓冲
+    void runWakeups(Loop& loop);
+
+    // 执行到期的定时器
+    void runTimers(Loop& loop);
+
+    std::vector<std::unique_ptr<Loop>> m_loops;     // 反应器线程
+    std::atomic<size_t> m_next_loop{0};             // 下一个客户端分配到的线程
+    std::atomic<uint64_t> m_next_timer{1};          // 下一个定时器ID
+};
+
+#endif // MQTT_REACTOR_H
@@ -0,0 +1,146 @@
+#ifndef OFFLINE_SPOOL_H
+#define OFFLINE_SPOOL_H
+
+#include <string>
+#include <unordered_map>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * 离线发布缓冲文件
+ * 内存映射的环形文件，按先进先出保存断线期间未能发出的发布消息。
+ * 文件头记录读写位置（单调递增的逻辑字节位置，对容量取模得到文件内偏移），
+ * 每条记录带长度和 CRC32 校验，记录不跨越文件末尾（剩余空间不足时写入回绕标记）。
+ * 文件写满时丢弃最旧的消息，为新消息腾出空间。
+ *
+ * 记录写完后才推进写位置，进程崩溃后重新打开时从读位置起逐条校验，
+ * 恢复全部完整的记录；掉电时操作系统尚未写回的最后几条记录可能丢失。
+ *
+ * 只保留最新值的主题按主题记录最新一条的位置，重放前可以判断队首记录是否已被更新的值取代。
+ * 非线程安全，由 MqttClient 的网络线程（或反应器线程）独占访问；统计计数可在任意线程读取。
+ */
+class OfflineSpool {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = size_t(16) << 20;   // 默认数据区容量（字节）
+    static constexpr size_t MIN_CAPACITY = 4096;                   // 最小数据区容量（字节）
+
+    /**
+     * 缓冲中的一条发布消息
+     */
+    struct Record {
+        std::string topic;
+        std::string payload;
+        int qos = 0;
+        bool retain = false;
+        bool latest_only = false;               // 主题只关心最新值
+        bool has_properties = false;            // 带 MQTT v5 发布属性
+        std::string response_topic;             // 响应主题
+        std::string correlation_data;           // 关联数据
+        uint32_t message_expiry = 0;            // 消息过期时间（秒）
+    };
+
+    OfflineSpool();
+
+    /**
+     * 析构函数，写回并关闭文件
+     */
+    ~OfflineSpool();
+
+    OfflineSpool(const OfflineSpool&) = delete;
+    OfflineSpool& operator=(const OfflineSpool&) = delete;
+
+    /**
+     * 打开缓冲文件，不存在或格式、容量不符时重新创建，否则恢复其中的消息
+     * @param path 文件路径
+     * @param capacity 数据区容量（字节，按8字节对齐，不小于 MIN_CAPACITY）
+     * @return 是否成功
+     */
+    bool open(const std::string& path, size_t capacity = DEFAULT_CAPACITY);
+
+    /**
+     * 写回并关闭文件（未发出的消息保留在文件中）
+     */
+    void close();
+
+    /**
+     * 检查文件是否已打开
+     * @return 是否已打开
+     */
+    bool isOpen() const;
+
+    /**
+     * 追加一条消息，空间不足时丢弃最旧的消息
+     * @param record 消息
+     * @return 是否追加（消息超过容量的四分之一时返回false）
+     */
+    bool push(const Record& record);
+
+    /**
+     * 读取队首消息（不移除）
+     * @param record 输出消息
+     * @return 缓冲非空时返回true
+     */
+    bool front(Record& record) const;
+
+    /**
+     * 队首消息只保留最新值，且缓冲中有同一主题更新的值
+     * @return 是否已被取代
+     */
+    bool frontSuperseded() const;
+
+    /**
+     * 移除队首消息
+     */
+    void pop();
+
+    /**
+     * 检查缓冲是否为空
+     * @return 是否为空
+     */
+    bool empty() const;
+
+    /**
+     * 获取缓冲中的消息数
+     * @return 消息数
+     */
+    size_t size() const;
+
+    /**
+     * 获取打开后因文件已满丢弃的最旧消息数
+     * @return 累计丢弃数
+     */
+    uint64_t dropped() const;
+
+    /**
+     * 获取打开时从文件恢复的消息数
+     * @return 恢复的消息数
+     */
+    size_t recovered() const;
+
+private:
+    // 逻辑位置对应的记录起点
+    char* recordAt(uint64_t position) const;
+
+    // 更新文件头中的读写位置
+    void storePositions();
+
+    // 跳过队首的回绕标记，返回是否仍有记录
+    bool skipWrap();
+
+    // 解析 position 处的记录，格式错误（verify 时还包括校验失败）返回false；
+    // record、topic 可为空，flags 输出标志位，length 输出含对齐的记录总长度
+    bool parse(uint64_t position, bool verify, Record* record, std::string* topic,
+               uint8_t* flags, size_t* length) const;
+
+    int m_fd = -1;                          // 文件描述符
+    char* m_map = nullptr;                  // 整个文件的映射（文件头 + 数据区）
+    size_t m_capacity = 0;                  // 数据区容量
+    uint64_t m_head = 0;                    // 读位置（最旧记录）
+    uint64_t m_tail = 0;                    // 写位置
+    std::unordered_map<std::string, uint64_t> m_latest;    // 只保留最新值的主题 -> 最新一条记录的位置
+    std::atomic<size_t> m_count{0};         // 缓冲中的消息数
+    std::atomic<uint64_t> m_dropped{0};     // 因文件已满丢弃的消息数
+    size_t m_recovered = 0;                 // 打开时恢复的消息数
+};
+
+#endif // OFFLINE_SPOOL_H
@@ -0,0 +1,134 @@
+#ifndef PROPERTY_HISTORY_H
+#define PROPERTY_HISTORY_H
+
+#include "device_registry.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * 属性历史采样点
+ */
+struct HistorySample {
+    int64_t timestamp_ms;               // 采样时间（Unix毫秒）
+    double value;                       // 属性值
+};
+
+/**
+ * 降采样桶
+ */
+struct HistoryBucket {
+    int64_t start_ms = 0;               // 桶起始时间（Unix毫秒）
+    size_t count = 0;                   // 桶内样本数量
+    double min = 0.0;                   // 最小值
+    double max = 0.0;                   // 最大值
+    double avg = 0.0;                   // 平均值
+};
+
+/**
+ * 设备属性历史存储
+ * 每个设备的每个数值属性对应一个固定容量的环形缓冲区，写满后覆盖最旧的样本。
+ * 缓冲区在属性首次出现时一次性分配，此后写入不再分配内存；
+ * 内存上限为 设备数 x 每设备属性上限 x 每属性容量 x sizeof(HistorySample)
+ */
+class PropertyHistory {
+public:
+    /**
+     * 构造函数
+     * @param samples_per_property 每个属性保留的样本数量
+     * @param max_properties_per_device 每个设备最多记录的属性数量，超出的属性被忽略
+     */
+    explicit PropertyHistory(size_t samples_per_property = 1024, size_t max_properties_per_device = 32);
+
+    PropertyHistory(const PropertyHistory&) = delete;
+    PropertyHistory& operator=(const PropertyHistory&) = delete;
+
+    /**
+     * 设置每个属性保留的样本数量（只影响之后新建的属性）
+     * @param samples_per_property 样本数量
+     */
+    void setCapacity(size_t samples_per_property);
+
+    /**
+     * 记录一个样本
+     * 时间戳早于该属性最后一个样本时（设备时钟回拨、接收时间与设备采样时间混用）按最后一个样本的时间记录，
+     * 缓冲区始终按时间排序
+     * @param handle 设备句柄
+     * @param property 属性名称
+     * @param timestamp_ms 采样时间（Unix毫秒）
+     * @param value 属性值
+     */
+    void record(DeviceHandle handle, std::string_view property, int64_t timestamp_ms, double value);
+
+    /**
+     * 查询时间范围内的原始样本
+     * @param handle 设备句柄
+     * @param property 属性名称
+     * @param from_ms 起始时间（含）
+     * @param to_ms 结束时间（含）
+     * @return 按时间排序的样本
+     */
+    std::vector<HistorySample> query(DeviceHandle handle, std::string_view property,
+                                     int64_t from_ms, int64_t to_ms) const;
+
+    /**
+     * 按固定时间间隔分桶降采样
+     * @param handle 设备句柄
+     * @param property 属性名称
+     * @param from_ms 起始时间（含），桶按此对齐
+     * @param to_ms 结束时间（含）
+     * @param bucket_ms 桶宽度（毫秒）
+     * @return 非空的桶，按时间排序
+     */
+    std::vector<HistoryBucket> downsample(DeviceHandle handle, std::string_view property,
+                                          int64_t from_ms, int64_t to_ms, int64_t bucket_ms) const;
+
+    /**
+     * 获取设备已记录的属性名称
+     * @param handle 设备句柄
+     * @return 属性名称列表
+     */
+    std::vector<std::string> properties(DeviceHandle handle) const;
+
+    /**
+     * 获取已分配的样本缓冲区占用的内存（字节）
+     * @return 内存占用
+     */
+    size_t memoryUsage() const;
+
+private:
+    struct Series {
+        std::string property;                       // 属性名称
+        std::unique_ptr<HistorySample[]> ring;      // 环形缓冲区
+        size_t capacity = 0;                        // 缓冲区容量
+        size_t head = 0;                            // 下一个写入位置
+        size_t count = 0;                           // 有效样本数量
+
+        // 按时间顺序的第index个样本
+        const HistorySample& at(size_t index) const {
+            return ring[(head + capacity - count + index) % capacity];
+        }
+    };
+
+    struct DeviceHistory {
+        mutable std::mutex mutex;
+        std::vector<Series> series;
+    };
+
+    DeviceHistory* deviceFor(DeviceHandle handle) const;
+    DeviceHistory& deviceForWrite(DeviceHandle handle);
+    static const Series* findSeries(const DeviceHistory& device, std::string_view property);
+    static size_t lowerBound(const Series& series, int64_t timestamp_ms);
+
+    std::vector<std::unique_ptr<DeviceHistory>> m_devices;  // 按设备句柄索引
+    mutable std::shared_mutex m_devices_mutex;               // 保护 m_devices 的扩展
+    std::atomic<size_t> m_capacity;                          // 每个属性的样本数量
+    size_t m_max_properties;                                 // 每个设备的属性上限
+};
+
+#endif // PROPERTY_HISTORY_H
@@ -0,0 +1,167 @@
+#ifndef PROPERTY_SCHEMA_H
+#define PROPERTY_SCHEMA_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+#include <json/json.h>
+
+/**
+ * 属性值类型
+ */
+enum class PropertyType {
+    NUMBER,     // 整数或浮点数
+    BOOLEAN,    // 布尔值
+    STRING,     // 字符串
+    JSON        // 其他（数组、对象、空值）
+};
+
+/**
+ * 属性结构中的一个字段
+ */
+struct SchemaField {
+    std::string name;                   // 属性名称
+    PropertyType type;                  // 值类型
+    std::string unit;                   // 单位
+    bool writable;                      // 是否可写
+};
+
+/**
+ * 设备属性结构
+ * 设备按属性名顺序声明每个属性的名称、类型、单位和可写标志，结构哈希覆盖设备类型和全部字段；
+ * 之后的数值帧只携带结构哈希和按字段顺序排列的属性值：
+ *   [结构哈希, 时间戳, 状态, 值0, 值1, ...]
+ * 同一类型的设备属性结构相同，哈希相同，服务端按哈希缓存的结构可被同类型的所有设备共用。
+ */
+struct PropertySchema {
+    static constexpr size_t FRAME_HEADER = 3;   // 数值帧中属性值之前的固定字段数
+
+    uint64_t hash = 0;                  // 结构哈希（非零）
+    std::string device_type;            // 设备类型
+    std::vector<SchemaField> fields;    // 按属性名排序的字段
+    Json::Value properties;             // 服务端解码用的属性模板（含单位和可写标志，值为空）
+
+    /**
+     * 获取值所属的属性类型
+     * @param value 属性值
+     * @return 属性类型
+     */
+    static PropertyType typeOf(const Json::Value& value);
+
+    /**
+     * 获取属性类型名称
+     * @param type 属性类型
+     * @return 类型名称
+     */
+    static const char* typeName(PropertyType type);
+
+    /**
+     * 计算结构哈希（FNV-1a 64位）
+     * @param device_type 设备类型
+     * @param fields 字段列表
+     * @return 非零哈希值
+     */
+    static uint64_t computeHash(const std::string& device_type, const std::vector<SchemaField>& fields);
+
+    /**
+     * 判断值是否符合字段类型
+     * @param field 字段
+     * @param value 属性值
+     * @return 是否符合
+     */
+    static bool accepts(const SchemaField& field, const Json::Value& value);
+
+    /**
+     * 序列化为结构声明消息
+     * @param device_id 设备ID
+     * @return 结构声明消息
+     */
+    Json::Value toJson(const std::string& device_id) const;
+
+    /**
+     * 从结构声明消息解析，并校验声明的哈希与字段一致
+     * @param message 结构声明消息
+     * @param schema 输出的属性结构（含属性模板）
+     * @param errors 输出的错误信息
+     * @return 是否成功
+     */
+    static bool fromJson(const Json::Value& message, PropertySchema& schema, std::string& errors);
+};
+
+/**
+ * 增量计算结构哈希，逐个加入字段，结果与 PropertySchema::computeHash 一致；
+ * 设备每次上报时据此判断结构是否变化，无需构建字段列表
+ */
+class SchemaHasher {
+public:
+    /**
+     * 构造函数
+     * @param device_type 设备类型
+     */
+    explicit SchemaHasher(const std::string& device_type);
+
+    /**
+     * 加入一个字段（按属性名顺序）
+     * @param name 属性名称
+     * @param type 值类型
+     * @param unit 单位
+     * @param writable 是否可写
+     */
+    void addField(const std::string& name, PropertyType type, const std::string& unit, bool writable);
+
+    /**
+     * 获取结构哈希
+     * @return 非零哈希值
+     */
+    uint64_t hash() const;
+
+private:
+    uint64_t m_hash;                    // 当前哈希值
+};
+
+/**
+ * 属性结构缓存（服务端）
+ * 按结构哈希保存已声明的属性结构；遇到未知哈希时对每个哈希限频索取结构声明，
+ * 避免同类型的大量设备同时上报时产生请求风暴。
+ */
+class SchemaCache {
+public:
+    /**
+     * 查找属性结构
+     * @param hash 结构哈希
+     * @return 属性结构，未知时返回nullptr
+     */
+    std::shared_ptr<const PropertySchema> find(uint64_t hash) const;
+
+    /**
+     * 保存属性结构
+     * @param schema 属性结构
+     * @return 缓存中的属性结构
+     */
+    std::shared_ptr<const PropertySchema> insert(PropertySchema schema);
+
+    /**
+     * 判断是否需要为未知哈希索取结构声明（同一哈希在间隔内只索取一次）
+     * @param hash 结构哈希
+     * @param now_ms 当前时间（毫秒）
+     * @param interval_ms 最小索取间隔（毫秒）
+     * @return 是否需要索取
+     */
+    bool shouldRequest(uint64_t hash, int64_t now_ms, int64_t interval_ms = 5000);
+
+    /**
+     * 获取缓存的结构数量
+     * @return 结构数量
+     */
+    size_t size() const;
+
+private:
+    std::unordered_map<uint64_t, std::shared_ptr<const PropertySchema>> m_schemas; // 哈希 -> 属性结构
+    std::unordered_map<uint64_t, int64_t> m_requested;                            // 哈希 -> 最近一次索取时间
+    mutable std::mutex m_mutex;                                                    // 互斥锁
+};
+
+#endif // PROPERTY_SCHEMA_H
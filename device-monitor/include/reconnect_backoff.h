@@ -0,0 +1,67 @@
+#ifndef RECONNECT_BACKOFF_H
+#define RECONNECT_BACKOFF_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <random>
+
+/**
+ * 断线重连退避（去相关抖动的指数退避）
+ * 断线后第一次在 [0, 初始间隔) 内随机等待，之后每次在 [初始间隔, 上次等待×3] 内随机取值并以上限封顶，
+ * 连接成功后复位。同时断线的大量客户端各自独立取随机数，重连分散到整个退避窗口而不会同步涌入；
+ * 等待期望值按指数增长，broker 长时间不可用时重连频率逐步降到上限。
+ *
+ * 间隔参数可在其他线程修改，退避状态只应由一个线程访问。
+ */
+class ReconnectBackoff {
+public:
+    static constexpr int DEFAULT_INITIAL_MS = 1000;     // 默认初始间隔（毫秒）
+    static constexpr int DEFAULT_MAX_MS = 60000;        // 默认间隔上限（毫秒）
+
+    /**
+     * 构造函数
+     * @param initial_ms 初始间隔（毫秒）
+     * @param max_ms 间隔上限（毫秒）
+     * @param seed 随机数种子，为0时使用 std::random_device
+     */
+    explicit ReconnectBackoff(int initial_ms = DEFAULT_INITIAL_MS, int max_ms = DEFAULT_MAX_MS, uint64_t seed = 0);
+
+    /**
+     * 设置间隔参数，下一次计算时生效
+     * @param initial_ms 初始间隔（毫秒，至少1）
+     * @param max_ms 间隔上限（毫秒，不小于初始间隔）
+     */
+    void setLimits(int initial_ms, int max_ms);
+
+    /**
+     * 计算下一次重连前的等待
+     * @return 等待时间
+     */
+    std::chrono::milliseconds next();
+
+    /**
+     * 连接成功后复位，下一次断线重新从初始间隔开始
+     */
+    void reset();
+
+    /**
+     * 获取初始间隔
+     * @return 初始间隔（毫秒）
+     */
+    int initialMs() const { return m_initial_ms.load(std::memory_order_relaxed); }
+
+    /**
+     * 获取间隔上限
+     * @return 间隔上限（毫秒）
+     */
+    int maxMs() const { return m_max_ms.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int> m_initial_ms;      // 初始间隔
+    std::atomic<int> m_max_ms;          // 间隔上限
+    int m_last_ms = 0;                  // 上一次等待（0表示断线后尚未等待）
+    std::mt19937 m_rng;                 // 随机数发生器
+};
+
+#endif // RECONNECT_BACKOFF_H
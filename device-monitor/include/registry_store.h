@@ -0,0 +1,137 @@
+#ifndef REGISTRY_STORE_H
+#define REGISTRY_STORE_H
+
+#include "device_registry.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * 持久化统计信息
+ */
+struct RegistryStoreStats {
+    uint64_t generation = 0;            // 当前WAL代号
+    uint64_t wal_records = 0;           // 本次运行写入WAL的记录数
+    uint64_t wal_bytes = 0;             // 当前WAL文件大小（字节）
+    uint64_t syncs = 0;                 // 组提交fsync次数
+    uint64_t dropped_records = 0;       // 写入积压超限时丢弃的记录数（由下一次快照补齐）
+    uint64_t snapshots = 0;             // 本次运行写入的快照数
+    uint64_t last_snapshot_devices = 0; // 最近一次快照的设备数量
+    int64_t last_snapshot_ms = 0;       // 最近一次快照耗时（毫秒）
+    uint64_t recovered_devices = 0;     // 启动时恢复的设备数量
+    uint64_t replayed_records = 0;      // 启动时重放的WAL记录数
+    int64_t recovery_ms = 0;            // 启动恢复耗时（毫秒）
+};
+
+/**
+ * 设备注册表持久化
+ * 注册表的每次修改以紧凑二进制记录追加到预写日志（WAL），由后台线程按固定间隔成批写入并fsync（组提交），
+ * 调用方只做一次内存拷贝，不等待磁盘。后台快照线程定期切换到新的WAL代号，把整个注册表写入内存映射的快照文件，
+ * 快照落盘后删除更早的WAL和快照。
+ *
+ * 启动时加载最新的快照（内存映射只读解析），再按代号顺序重放快照之后的WAL；
+ * 文件末尾不完整或校验失败的记录视为崩溃时未写完的尾部并被忽略。
+ *
+ * 记录保存的是设备的完整状态，重放是幂等的；心跳快速路径只刷新最后活跃时间而不写日志，
+ * 该时间由快照保存，重放时取较新的值。
+ */
+class RegistryStore {
+public:
+    /**
+     * 构造函数
+     * @param data_dir 数据目录，不存在时自动创建
+     */
+    explicit RegistryStore(const std::string& data_dir);
+
+    /**
+     * 析构函数
+     */
+    ~RegistryStore();
+
+    RegistryStore(const RegistryStore&) = delete;
+    RegistryStore& operator=(const RegistryStore&) = delete;
+
+    /**
+     * 设置组提交间隔（需在open()之前调用）
+     * @param interval_ms 间隔（毫秒）
+     */
+    void setSyncInterval(int interval_ms);
+
+    /**
+     * 设置快照间隔（需在open()之前调用）
+     * @param interval_seconds 间隔（秒），0表示只在关闭时写快照
+     */
+    void setSnapshotInterval(int interval_seconds);
+
+    /**
+     * 从数据目录恢复注册表，然后打开新的WAL并启动后台线程
+     * @param registry 设备注册表（应为空）
+     * @return 是否成功
+     */
+    bool open(DeviceRegistry& registry);
+
+    /**
+     * 写入剩余日志、生成最终快照并停止后台线程
+     */
+    void close();
+
+    /**
+     * 记录设备的当前完整状态（应在分片锁内调用，以保证同一设备的记录顺序与修改顺序一致）
+     * @param status 设备状态
+     */
+    void logUpsert(const DeviceStatus& status);
+
+    /**
+     * 立即生成快照
+     * @return 是否成功
+     */
+    bool snapshot();
+
+    /**
+     * 获取统计信息
+     * @return 统计信息
+     */
+    RegistryStoreStats stats() const;
+
+private:
+    bool recover(DeviceRegistry& registry);
+    bool openLog(uint64_t generation);
+    bool writeLog(const std::string& data);
+    void flushLoop();
+    void snapshotLoop();
+    bool writeSnapshot(uint64_t generation);
+    void removeObsolete(uint64_t generation);
+    std::string logPath(uint64_t generation) const;
+    std::string snapshotPath(uint64_t generation) const;
+
+    std::string m_data_dir;                         // 数据目录
+    DeviceRegistry* m_registry;                     // 持久化的注册表
+    int m_sync_interval_ms;                         // 组提交间隔
+    int m_snapshot_interval_s;                      // 快照间隔
+
+    // 待写入的日志（加锁顺序：文件锁 -> 缓冲区锁）
+    std::string m_pending;                          // 待写入的记录
+    bool m_force_snapshot;                          // 丢弃过记录，需要尽快写快照
+    mutable std::mutex m_mutex;                     // 缓冲区互斥锁
+    std::condition_variable m_cv;                   // 唤醒写入线程
+
+    int m_log_fd;                                   // 当前WAL文件描述符
+    uint64_t m_generation;                          // 当前WAL代号
+    std::mutex m_file_mutex;                        // 保证日志按追加顺序落盘
+    std::mutex m_snapshot_mutex;                    // 同一时间只写一个快照
+
+    std::atomic<bool> m_running;                    // 运行状态
+    std::thread m_flush_thread;                     // 组提交线程
+    std::thread m_snapshot_thread;                  // 快照线程
+    std::condition_variable m_snapshot_cv;          // 唤醒快照线程
+
+    RegistryStoreStats m_stats;                     // 统计信息（由m_mutex保护）
+};
+
+#endif // REGISTRY_STORE_H
@@ -2,35 +2,33 @@
 #define SERVER_H
 
 #include "mqtt_client.h"
+#include "device_registry.h"
+#include "liveness_wheel.h"
+#include "command_tracker.h"
+#include "group_command_tracker.h"
+#include "ingress_pool.h"
+#include "property_history.h"
+#include "registry_store.h"
+#include "property_schema.h"
+#include "cluster_ring.h"
 #include <map>
+#include <set>
 #include <vector>
 #include <chrono>
 #include <memory>
 #include <json/json.h>
 
 /**
- * 设备状态信息结构
+ * 集群统计信息
  */
-struct DeviceStatus {
-    std::string device_id;              // 设备ID
-    std::string status;                 // 设备状态（online/offline/error）
-    std::chrono::system_clock::time_point last_seen; // 最后活跃时间
-    Json::Value properties;             // 设备属性
-    
-    DeviceStatus() : status("offline"), last_seen(std::chrono::system_clock::now()) {}
-};
-
-/**
- * 控制命令结构
- */
-struct ControlCommand {
-    std::string command_id;             // 命令ID
-    std::string device_id;              // 目标设备ID
-    std::string command_type;           // 命令类型
-    Json::Value parameters;             // 命令参数
-    std::chrono::system_clock::time_point timestamp; // 时间戳
-    
-    ControlCommand() : timestamp(std::chrono::system_clock::now()) {}
+struct ClusterStats {
+    uint64_t forwarded_commands = 0;    // 转发给归属实例的命令数
+    uint64_t forwarded_queries = 0;     // 转发给归属实例的状态查询数
+    uint64_t failed_queries = 0;        // 超时或归属实例无此设备的转发查询数
+    uint64_t rebalances = 0;            // 成员变化后的重新划分次数
+    uint64_t handed_off = 0;            // 移交给其他实例的设备数
+    uint64_t taken_over = 0;            // 从其他实例接收的设备数
+    uint64_t unowned_messages = 0;      // 丢弃的不归属本实例的设备消息数
 };
 
 /**
@@ -43,6 +41,10 @@ public:
     using DeviceStatusCallback = std::function<void(const std::string& device_id, const DeviceStatus& status)>;
     // 命令响应回调函数类型
     using CommandResponseCallback = std::function<void(const std::string& command_id, const Json::Value& response)>;
+    // 命令超时回调函数类型
+    using CommandTimeoutCallback = CommandTracker::TimeoutCallback;
+    // 群组命令汇总结果回调函数类型
+    using GroupCommandCallback = GroupCommandTracker::ResultCallback;
     
     /**
      * 构造函数
@@ -119,8 +121,38 @@ public:
                            const std::string& command_type, 
                            const Json::Value& parameters = Json::Value());
     
+    /**
+     * 发送控制命令到指定设备（指定超时和重发策略）
+     * @param device_id 设备ID
+     * @param command_type 命令类型
+     * @param parameters 命令参数
+     * @param options 发送选项（超时、重发次数、QoS）
+     * @return 命令ID（用于跟踪响应）
+     */
+    std::string sendCommand(const std::string& device_id,
+                           const std::string& command_type,
+                           const Json::Value& parameters,
+                           const CommandOptions& options);
+    
+    /**
+     * 向一组设备发送同一条控制命令
+     * 命令只序列化一次，组内所有设备共用一个命令ID；各设备的响应汇总后通过群组命令回调交付
+     * @param group 组名（不能包含 '/'、'+'、'#'）
+     * @param device_ids 期望响应的设备；使用群组主题时可为空，表示成员未知、在超时时交付已收到的响应
+     * @param command_type 命令类型
+     * @param parameters 命令参数
+     * @param options 发送选项（超时、QoS、是否经群组主题由代理扇出）
+     * @return 命令ID，发送失败返回空字符串
+     */
+    std::string sendCommandToGroup(const std::string& group,
+                                   const std::vector<std::string>& device_ids,
+                                   const std::string& command_type,
+                                   const Json::Value& parameters = Json::Value(),
+                                   const GroupCommandOptions& options = GroupCommandOptions());
+    
     /**
      * 获取设备状态
+     * 集群模式下不归属本实例的设备向归属实例查询并等待回复（不应在MQTT消息回调中调用）
      * @param device_id 设备ID
      * @return 设备状态，如果设备不存在返回nullptr
      */
@@ -138,6 +170,20 @@ public:
      */
     std::vector<std::string> getOnlineDevices() const;
     
+    /**
+     * 按状态和设备类型查询设备（如 "online" + "sensor"），耗时与结果数量成正比
+     * @param status 设备状态，为空表示不限
+     * @param device_type 设备类型，为空表示不限
+     * @return 匹配的设备ID列表（已排序）
+     */
+    std::vector<std::string> findDevices(const std::string& status, const std::string& device_type = "") const;
+    
+    /**
+     * 获取各状态的设备数量
+     * @return 状态到设备数量的映射
+     */
+    std::map<std::string, size_t> getDeviceCounts() const;
+    
     /**
      * 设置设备状态变化回调
      * @param callback 回调函数
@@ -150,12 +196,198 @@ public:
      */
     void setCommandResponseCallback(CommandResponseCallback callback);
     
+    /**
+     * 设置命令超时回调（重发次数用尽仍未收到响应时调用）
+     * @param callback 回调函数
+     */
+    void setCommandTimeoutCallback(CommandTimeoutCallback callback);
+    
+    /**
+     * 设置群组命令汇总结果回调
+     * @param callback 回调函数
+     */
+    void setGroupCommandCallback(GroupCommandCallback callback);
+    
+    /**
+     * 设置默认命令响应超时
+     * @param timeout_ms 超时时间（毫秒）
+     */
+    void setCommandTimeout(int timeout_ms);
+    
+    /**
+     * 获取各命令类型的往返延迟统计
+     * @return 命令类型到延迟统计的映射
+     */
+    std::map<std::string, LatencySummary> getCommandLatencyStats() const;
+    
+    /**
+     * 获取待响应命令数量
+     * @return 命令数量
+     */
+    size_t getPendingCommandCount() const;
+    
+    /**
+     * 获取正在汇总响应的群组命令数量
+     * @return 命令数量
+     */
+    size_t getPendingGroupCommandCount() const;
+    
     /**
      * 设置设备离线超时时间
      * @param timeout_seconds 超时时间（秒）
      */
     void setDeviceTimeout(int timeout_seconds);
     
+    /**
+     * 设置最大设备数量，按该数量预分配设备注册表容量
+     * @param max_devices 最大设备数量
+     */
+    void setMaxDevices(size_t max_devices);
+    
+    /**
+     * 设置入站消息工作线程数量（需在start()之前调用）
+     * 大于0时MQTT消息循环线程只负责投递，解析和回调由工作线程执行，
+     * 同一设备的消息保持到达顺序；设备状态回调可能在多个工作线程中并发调用
+     * @param worker_count 工作线程数量，0表示在消息循环线程中直接处理
+     */
+    void setIngressWorkers(size_t worker_count);
+    
+    /**
+     * 设置入站消息队列总容量（需在start()之前调用）
+     * 积压超过容量的3/4时开始合并心跳和状态，达到容量时丢弃无法合并的心跳和状态，命令响应不受限制
+     * @param capacity 队列容量
+     */
+    void setIngressQueueCapacity(size_t capacity);
+    
+    /**
+     * 设置共享订阅入站连接数量（需在start()之前调用）
+     * 大于0时服务端另开 connection_count 个MQTT连接，通过 $share/<group>/device/+/... 共享订阅接收设备消息，
+     * broker 在连接之间分摊消息，每个连接有独立的套接字和网络线程，处理结果汇入同一个设备注册表；
+     * 原有连接不再订阅设备主题，只用于发布命令和状态请求。
+     * 同一设备的消息可能经不同连接到达而乱序，状态增量按版本号丢弃旧消息
+     * @param connection_count 入站连接数量，0表示由原有连接直接订阅设备主题
+     * @param share_group 共享订阅组名，为空时使用 "server_<服务端ID>"（多个服务端实例各自收到完整的消息流）
+     */
+    void setIngestConnections(size_t connection_count, const std::string& share_group = "");
+    
+    /**
+     * 启用集群模式（需在start()之前调用）
+     * 同一集群的多个服务端实例通过保留消息 cluster/<集群名>/members/<服务端ID> 发现彼此（异常断开时由遗嘱消息清除），
+     * 按设备ID一致性哈希划分设备：每个实例只处理和保存归属自己的设备，成员变化后把不再归属自己的设备状态移交给新的归属实例，
+     * 有成员离开时请求所有设备重新上报。sendCommand 和 getDeviceStatus 对不归属本实例的设备转发给归属实例；
+     * 设备列表、统计和属性历史只包含本实例的设备，命令响应回调只交付本实例发出的命令
+     * @param cluster_name 集群名（不能包含 '/'、'+'、'#'），为空表示不启用
+     */
+    void setCluster(const std::string& cluster_name);
+    
+    /**
+     * 使用 MQTT v5 协议（需在start()之前调用，broker 须支持 MQTT v5）
+     * 命令带响应主题和以命令ID为内容的关联数据，支持的设备在响应中原样带回，服务端不解析响应内容即可匹配待响应命令；
+     * 命令按响应超时设置消息过期时间，broker 不会在超时后才把命令投递给重新上线的设备
+     * @param enable 是否启用
+     */
+    void setMqtt5(bool enable);
+    
+    /**
+     * 使用持久会话（需在start()之前调用，主连接和入站连接均生效）
+     * broker 在服务端离线期间保留订阅并排队 QoS 1 设备消息，重连后投递；会话仍在时重连不再重新订阅
+     * @param enable 是否启用
+     * @param session_expiry 会话保留时间（秒，仅 MQTT v5）
+     */
+    void setPersistentSession(bool enable, uint32_t session_expiry = MqttClient::DEFAULT_SESSION_EXPIRY);
+    
+    /**
+     * 设置转发状态查询的超时（默认2000毫秒）
+     * @param timeout_ms 超时时间（毫秒）
+     */
+    void setClusterRequestTimeout(int timeout_ms);
+    
+    /**
+     * 获取集群成员（含本实例）
+     * @return 成员ID（已排序），未启用集群时为空
+     */
+    std::vector<std::string> getClusterMembers() const;
+    
+    /**
+     * 获取设备的归属实例
+     * @param device_id 设备ID
+     * @return 服务端ID，未启用集群时为本实例ID
+     */
+    std::string getDeviceOwner(const std::string& device_id) const;
+    
+    /**
+     * 获取集群统计
+     * @return 统计信息
+     */
+    ClusterStats getClusterStats() const;
+    
+    /**
+     * 获取入站消息队列统计（未启用工作线程池时各项为0）
+     * @return 统计信息
+     */
+    IngressStats getIngressStats() const;
+    
+    /**
+     * 设置持久化数据目录（需在start()之前调用）
+     * 设置后启动时从该目录恢复设备注册表，运行期间注册表修改写入预写日志并定期生成快照
+     * @param data_dir 数据目录，为空表示不持久化
+     */
+    void setDataDirectory(const std::string& data_dir);
+    
+    /**
+     * 设置注册表快照间隔（需在start()之前调用）
+     * @param interval_seconds 间隔（秒），0表示只在停止时写快照
+     */
+    void setSnapshotInterval(int interval_seconds);
+    
+    /**
+     * 获取持久化统计（未设置数据目录时各项为0）
+     * @return 统计信息
+     */
+    RegistryStoreStats getPersistenceStats() const;
+    
+    /**
+     * 设置每个设备属性保留的历史样本数量（只影响之后首次出现的属性）
+     * @param samples_per_property 样本数量
+     */
+    void setHistoryCapacity(size_t samples_per_property);
+    
+    /**
+     * 查询设备属性在时间范围内的历史样本
+     * @param device_id 设备ID
+     * @param property 属性名称
+     * @param from_ms 起始时间（Unix毫秒，含）
+     * @param to_ms 结束时间（Unix毫秒，含）
+     * @return 按时间排序的样本，设备或属性不存在时为空
+     */
+    std::vector<HistorySample> getPropertyHistory(const std::string& device_id, const std::string& property,
+                                                  int64_t from_ms, int64_t to_ms) const;
+    
+    /**
+     * 按固定时间间隔对设备属性历史降采样
+     * @param device_id 设备ID
+     * @param property 属性名称
+     * @param from_ms 起始时间（Unix毫秒，含）
+     * @param to_ms 结束时间（Unix毫秒，含）
+     * @param bucket_ms 桶宽度（毫秒）
+     * @return 非空的桶（最小值/最大值/平均值），按时间排序
+     */
+    std::vector<HistoryBucket> getPropertyHistoryDownsampled(const std::string& device_id, const std::string& property,
+                                                             int64_t from_ms, int64_t to_ms, int64_t bucket_ms) const;
+    
+    /**
+     * 获取设备已记录历史的属性名称
+     * @param device_id 设备ID
+     * @return 属性名称列表
+     */
+    std::vector<std::string> getDeviceHistoryProperties(const std::string& device_id) const;
+    
+    /**
+     * 获取属性历史缓冲区占用的内存（字节）
+     * @return 内存占用
+     */
+    size_t getHistoryMemoryUsage() const;
+    
     /**
      * 请求设备状态更新
      * @param device_id 设备ID，为空则请求所有设备
@@ -164,57 +396,244 @@ public:
 
 private:
     /**
-     * 处理MQTT消息
-     * @param topic 主题
+     * 关闭持久化存储（写入最终快照，关闭预写日志），未打开时不做任何事
+     */
+    void closeStore();
+    
+    /**
+     * 注册设备主题路由
+     * @param client MQTT客户端
+     */
+    void registerRoutes(MqttClient& client);
+    
+    /**
+     * 订阅设备主题
+     * @param client MQTT客户端
+     * @param prefix 主题前缀（共享订阅为 "$share/<group>/"，否则为空）
+     */
+    void subscribeDeviceTopics(MqttClient& client, const std::string& prefix);
+    
+    /**
+     * 订阅服务端主题（连接和重连后调用）：未启用入站连接时订阅设备主题，集群模式下订阅集群主题并重新声明成员身份
+     */
+    void subscribeTopics();
+    
+    /**
+     * 创建共享订阅入站连接并连接MQTT服务器
+     * @return 是否全部连接成功
+     */
+    bool connectIngestClients();
+    
+    /**
+     * 接收入站消息：启用工作线程池时投递到设备所属的工作线程，否则直接处理
+     * @param kind 消息类型
+     * @param device_id 设备ID
      * @param payload 消息内容
+     * @param correlation_id 命令响应的关联数据（没有时为空）
      */
-    void handleMessage(const std::string& topic, const std::string& payload);
+    void ingest(IngressKind kind, std::string_view device_id, std::string_view payload,
+                std::string_view correlation_id = std::string_view());
+    
+    /**
+     * 按消息类型分派入站消息
+     * @param kind 消息类型
+     * @param device_id 设备ID
+     * @param payload 消息内容
+     * @param correlation_id 命令响应的关联数据（没有时为空）
+     */
+    void dispatchIngress(IngressKind kind, std::string_view device_id, std::string_view payload,
+                         std::string_view correlation_id = std::string_view());
     
     /**
      * 处理设备状态消息
      * @param device_id 设备ID
      * @param payload 消息内容
      */
-    void handleDeviceStatus(const std::string& device_id, const std::string& payload);
+    void handleDeviceStatus(std::string_view device_id, std::string_view payload);
     
     /**
      * 处理命令响应消息
      * @param device_id 设备ID
      * @param payload 消息内容
+     * @param correlation_id MQTT v5 关联数据（设备原样带回的命令ID，没有时从消息内容中读取）
      */
-    void handleCommandResponse(const std::string& device_id, const std::string& payload);
+    void handleCommandResponse(std::string_view device_id, std::string_view payload, std::string_view correlation_id);
     
     /**
      * 处理设备心跳消息
      * @param device_id 设备ID
      * @param payload 消息内容
      */
-    void handleDeviceHeartbeat(const std::string& device_id, const std::string& payload);
+    void handleDeviceHeartbeat(std::string_view device_id, std::string_view payload);
+    
+    /**
+     * 处理设备属性结构声明
+     * @param device_id 设备ID
+     * @param payload 消息内容
+     */
+    void handleDeviceSchema(std::string_view device_id, std::string_view payload);
     
     /**
-     * 设备超时检查线程函数
+     * 按缓存的属性结构把数值帧解码到设备属性，结构未知时向设备索取；
+     * 属性历史使用帧中的采样时间戳（不晚于接收时间），最后活跃时间使用接收时间
+     * @param device_id 设备ID
+     * @param frame 数值帧
+     * @param format 数值帧的负载格式
+     */
+    void applyValueFrame(std::string_view device_id, const Json::Value& frame, MessageFormat format);
+    
+    /**
+     * 向设备索取属性结构声明
+     * @param device_id 设备ID
+     * @param hash 未知的结构哈希
+     */
+    void requestDeviceSchema(std::string_view device_id, uint64_t hash);
+    
+    /**
+     * 设备超时检查线程函数（由时间轮驱动，每个刻度只处理到期的设备）
      */
     void deviceTimeoutCheck();
     
     /**
-     * 生成唯一命令ID
-     * @return 命令ID
+     * 按设备最后活跃时间将其挂到存活检测时间轮上
+     * @param handle 设备句柄
      */
-    std::string generateCommandId();
+    void armLiveness(DeviceHandle handle);
     
     /**
-     * 解析主题获取设备ID
-     * @param topic 主题
-     * @return 设备ID，解析失败返回空字符串
+     * 处理时间轮上到期的设备：仍在活跃则重新挂载，否则标记为离线
+     * @param handle 设备句柄
+     * @param now_ticks 当前时刻
      */
-    std::string parseDeviceIdFromTopic(const std::string& topic);
+    void expireDevice(DeviceHandle handle, int64_t now_ticks);
+    
+    /**
+     * 获取设备声明的负载格式，未知设备使用JSON
+     * @param device_id 设备ID
+     * @return 负载格式
+     */
+    MessageFormat deviceMessageFormat(std::string_view device_id) const;
+    
+    /**
+     * 发布控制命令；MQTT v5 下附加响应主题、关联数据和过期时间
+     * @param command_id 命令ID
+     * @param device_id 设备ID
+     * @param payload 编码后的命令
+     * @param qos 服务质量等级
+     * @param timeout_ms 响应超时（毫秒），命令在此之后过期
+     * @return 发布是否成功
+     */
+    bool publishCommand(const std::string& command_id, const std::string& device_id, const std::string& payload,
+                        int qos, int timeout_ms);
+    
+    /**
+     * 按设备声明的格式编码控制命令，写入线程复用的缓冲区
+     * @param command_id 命令ID
+     * @param device_id 设备ID
+     * @param command_type 命令类型
+     * @param parameters 命令参数
+     * @return 编码后的命令
+     */
+    const std::string& encodeCommand(const std::string& command_id, const std::string& device_id,
+                                     const std::string& command_type, const Json::Value& parameters);
+    
+    /**
+     * 设备是否归属本实例（未启用集群时总是归属）
+     * @param device_id 设备ID
+     * @return 是否归属
+     */
+    bool ownsDevice(std::string_view device_id) const;
+    
+    /**
+     * 发布本实例的成员声明（保留消息）
+     */
+    void announceMembership();
+    
+    /**
+     * 获取集群主题
+     * @param suffix 主题后缀（如 "members/server1"）
+     * @return cluster/<集群名>/<suffix>
+     */
+    std::string clusterTopic(const std::string& suffix) const;
+    
+    /**
+     * 向集群成员发送消息
+     * @param member_id 成员ID
+     * @param message 消息
+     * @return 是否发送成功
+     */
+    bool sendToMember(const std::string& member_id, const Json::Value& message) const;
+    
+    /**
+     * 转发控制命令给归属实例；命令在本实例跟踪，超时重发时重新转发
+     * @return 命令ID，发送失败返回空字符串
+     */
+    std::string forwardCommand(const std::string& owner, const std::string& command_id, const std::string& device_id,
+                               const std::string& command_type, const Json::Value& parameters,
+                               const CommandOptions& options);
+    
+    /**
+     * 向归属实例查询设备状态，等待回复或超时
+     * @param owner 归属实例ID
+     * @param device_id 设备ID
+     * @return 设备状态，超时或设备不存在返回nullptr
+     */
+    std::shared_ptr<DeviceStatus> queryOwner(const std::string& owner, const std::string& device_id) const;
+    
+    /**
+     * 处理成员声明（保留消息），空内容表示成员离开
+     * @param member_id 成员ID
+     * @param payload 消息内容
+     */
+    void handleClusterMember(std::string_view member_id, std::string_view payload);
+    
+    /**
+     * 处理其他成员发给本实例的消息（转发的命令、状态查询及回复、设备移交）
+     * @param payload 消息内容
+     */
+    void handleClusterMessage(std::string_view payload);
+    
+    /**
+     * 接收其他实例移交的设备状态
+     * @param devices 设备状态数组
+     */
+    void acceptHandoff(const Json::Value& devices);
+    
+    /**
+     * 按当前成员重新划分设备：不再归属本实例的设备移交给归属实例后从注册表删除
+     */
+    void rebalanceCluster();
+    
+    /**
+     * 按归属实例分批发送设备移交消息
+     * @param handoff 归属实例 -> 设备状态（发送时移出）
+     * @return 移交的设备数量
+     */
+    size_t sendHandoff(std::map<std::string, std::vector<Json::Value>>& handoff);
+    
+    /**
+     * 生成唯一命令ID
+     * @return 命令ID
+     */
+    std::string generateCommandId();
     
 private:
     std::string m_server_id;                        // 服务端ID
     std::unique_ptr<MqttClient> m_mqtt_client;      // MQTT客户端
+    std::function<std::unique_ptr<MqttClient>(const std::string&)> m_client_factory; // 按客户端ID创建相同配置的MQTT客户端
+    
+    size_t m_ingest_connections;                    // 共享订阅入站连接数量
+    std::string m_share_group;                      // 共享订阅组名
+    bool m_mqtt5 = false;                           // 是否使用 MQTT v5
+    bool m_persistent_session = false;              // 是否使用持久会话
+    uint32_t m_session_expiry = 0;                  // 会话保留时间（秒，MQTT v5）
+    std::vector<std::unique_ptr<MqttClient>> m_ingest_clients; // 共享订阅入站连接
     
-    std::map<std::string, DeviceStatus> m_devices;  // 设备状态映射
-    std::map<std::string, ControlCommand> m_pending_commands; // 待响应命令
+    DeviceRegistry m_devices;                       // 分片设备注册表
+    CommandTracker m_command_tracker;               // 待响应命令跟踪器
+    GroupCommandTracker m_group_commands;           // 群组命令响应汇总
+    PropertyHistory m_history;                      // 数值属性历史
+    SchemaCache m_schemas;                          // 按结构哈希缓存的设备属性结构
     
     DeviceStatusCallback m_device_status_callback;  // 设备状态回调
     CommandResponseCallback m_command_response_callback; // 命令响应回调
@@ -223,16 +642,50 @@ private:
     int m_device_timeout;                           // 设备超时时间（秒）
     
     std::thread m_timeout_check_thread;             // 超时检查线程
-    mutable std::mutex m_devices_mutex;             // 设备状态互斥锁
-    mutable std::mutex m_commands_mutex;            // 命令互斥锁
+    LivenessWheel m_liveness_wheel;                 // 设备存活检测时间轮
+    std::mutex m_timeout_mutex;                     // 超时检查线程互斥锁
+    std::condition_variable m_timeout_cv;           // 超时检查线程条件变量（用于立即停止）
     
     std::atomic<uint64_t> m_command_counter;        // 命令计数器
     
+    size_t m_ingress_workers;                       // 入站消息工作线程数量
+    size_t m_ingress_capacity;                      // 入站消息队列容量
+    std::unique_ptr<IngressPool> m_ingress_pool;    // 入站消息工作线程池
+    
+    std::string m_data_dir;                         // 持久化数据目录
+    int m_snapshot_interval;                        // 注册表快照间隔（秒）
+    std::unique_ptr<RegistryStore> m_store;         // 注册表持久化
+    
+    std::string m_cluster_name;                     // 集群名，为空表示未启用集群
+    ClusterRing m_cluster_ring;                     // 设备归属的一致性哈希环
+    std::set<std::string> m_cluster_members;        // 已知的集群成员
+    std::mutex m_cluster_mutex;                     // 保护成员集合和重新划分计划
+    std::mutex m_rebalance_mutex;                   // 串行化重新划分
+    int64_t m_rebalance_due{0};                     // 计划的重新划分时刻（nowTicks()），0表示无
+    bool m_rebalance_refresh{false};                // 重新划分后是否请求所有设备重新上报
+    std::atomic<int> m_cluster_request_timeout_ms{2000}; // 转发状态查询超时（毫秒）
+    mutable std::mutex m_cluster_request_mutex;     // 保护待回复的状态查询
+    mutable std::condition_variable m_cluster_request_cv; // 状态查询回复通知
+    mutable std::map<uint64_t, Json::Value> m_cluster_replies; // 待回复的状态查询（请求ID -> 回复，null表示未回复）
+    mutable std::atomic<uint64_t> m_cluster_request_counter{0}; // 状态查询请求ID计数器
+    std::atomic<uint64_t> m_forwarded_commands{0};              // 统计：转发的命令
+    mutable std::atomic<uint64_t> m_forwarded_queries{0};       // 统计：转发的状态查询
+    mutable std::atomic<uint64_t> m_failed_queries{0};          // 统计：失败的转发查询
+    std::atomic<uint64_t> m_rebalances{0};                      // 统计：重新划分次数
+    std::atomic<uint64_t> m_handed_off{0};                      // 统计：移交的设备
+    std::atomic<uint64_t> m_taken_over{0};                      // 统计：接收的设备
+    std::atomic<uint64_t> m_unowned_messages{0};                // 统计：丢弃的不归属本实例的消息
+    
+    static constexpr int REBALANCE_DELAY_MS = 1000; // 成员变化后延迟重新划分（合并短时间内的多次变化）
+    static constexpr size_t HANDOFF_BATCH = 256;    // 每条移交消息携带的设备数量
+    static constexpr int KEYFRAME_RETRY_MS = 5000;  // 索取完整上报后未收到关键帧时再次索取的间隔
+    
     // MQTT主题定义
     static const std::string TOPIC_DEVICE_STATUS;   // 设备状态主题
     static const std::string TOPIC_DEVICE_COMMAND;  // 设备命令主题
     static const std::string TOPIC_DEVICE_RESPONSE; // 设备响应主题
     static const std::string TOPIC_DEVICE_HEARTBEAT; // 设备心跳主题
+    static const std::string TOPIC_DEVICE_SCHEMA;   // 设备属性结构声明主题
 };
 
 #endif // SERVER_H
\ No newline at end of file
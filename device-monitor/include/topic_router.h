@@ -0,0 +1,129 @@
+#ifndef TOPIC_ROUTER_H
+#define TOPIC_ROUTER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <functional>
+#include <cstdint>
+
+/**
+ * 入站消息视图
+ * 主题和消息内容直接指向 mosquitto 的消息缓冲区，不复制内容，只在处理函数执行期间有效；
+ * 需要保留消息的处理函数自行复制一次（如投递到工作线程队列）
+ */
+struct MessageView {
+    std::string_view topic;             // 消息主题
+    std::string_view payload;           // 消息内容
+    int qos = 0;                        // 服务质量等级
+    bool retain = false;                // 是否为保留消息
+    int mid = 0;                        // 消息ID
+    std::string_view response_topic;    // MQTT v5 响应主题（没有时为空）
+    std::string_view correlation_data;  // MQTT v5 关联数据（没有时为空）
+};
+
+/**
+ * 主题通配符捕获结果
+ * 按过滤器中出现的顺序保存每个 '+' 匹配的层级，'#' 匹配的剩余部分作为最后一项；
+ * 各项均指向原始主题字符串，不复制内容
+ */
+class TopicCaptures {
+public:
+    static constexpr size_t MAX_CAPTURES = 8;
+
+    TopicCaptures() : m_count(0) {}
+
+    /**
+     * 获取第index个捕获的层级
+     * @param index 捕获序号
+     * @return 层级内容，越界时返回空
+     */
+    std::string_view operator[](size_t index) const {
+        return index < m_count ? m_segments[index] : std::string_view();
+    }
+
+    /**
+     * 获取捕获数量
+     * @return 捕获数量
+     */
+    size_t size() const { return m_count; }
+
+private:
+    friend class TopicRouter;
+
+    std::array<std::string_view, MAX_CAPTURES> m_segments;
+    size_t m_count;
+};
+
+/**
+ * MQTT主题路由器
+ * 将注册的主题过滤器（支持 '+' 和 '#' 通配符）预编译为按层级组织的前缀树，
+ * 分发时逐层匹配string_view主题，匹配过程不分配内存
+ */
+class TopicRouter {
+public:
+    // 路由处理函数类型
+    using Handler = std::function<void(const TopicCaptures& captures, const MessageView& message)>;
+
+    TopicRouter();
+
+    /**
+     * 注册主题过滤器
+     * @param filter 主题过滤器，如 "device/+/status"
+     * @param handler 处理函数
+     * @return 过滤器合法并注册成功返回true
+     */
+    bool addRoute(const std::string& filter, Handler handler);
+
+    /**
+     * 按主题分发消息，依次调用所有匹配的处理函数
+     * @param message 消息视图
+     * @return 匹配的处理函数数量
+     */
+    size_t dispatch(const MessageView& message) const;
+
+    /**
+     * 清空所有路由
+     */
+    void clear();
+
+    /**
+     * 获取已注册的路由数量
+     * @return 路由数量
+     */
+    size_t routeCount() const { return m_handlers.size(); }
+
+    /**
+     * 检查主题过滤器是否合法
+     * @param filter 主题过滤器
+     * @return 是否合法
+     */
+    static bool isValidFilter(std::string_view filter);
+
+private:
+    static constexpr uint32_t NIL = 0xffffffffu;
+
+    struct LiteralEdge {
+        std::string segment;
+        uint32_t child;
+    };
+
+    struct Node {
+        std::vector<LiteralEdge> literals;  // 按层级内容排序的普通子节点
+        uint32_t single_child = NIL;        // '+' 子节点
+        uint32_t multi_child = NIL;         // '#' 子节点
+        std::vector<uint32_t> routes;       // 在此结束的路由（处理函数下标）
+    };
+
+    uint32_t literalChild(uint32_t node, std::string_view segment) const;
+    uint32_t addLiteralChild(uint32_t node, std::string_view segment);
+    void match(uint32_t node, std::string_view topic, size_t pos, bool system_topic,
+               TopicCaptures& captures, const MessageView& message, size_t& matched) const;
+    void invoke(uint32_t node, const TopicCaptures& captures, const MessageView& message, size_t& matched) const;
+
+    std::vector<Node> m_nodes;          // 前缀树节点，下标0为根
+    std::vector<Handler> m_handlers;    // 处理函数
+};
+
+#endif // TOPIC_ROUTER_H
@@ -0,0 +1,37 @@
+#include "binary_io.h"
+#include <array>
+
+uint32_t crc32(const char* data, size_t length) {
+    using Tables = std::array<std::array<uint32_t, 256>, 8>;
+    static const Tables tables = []() {
+        Tables result{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t value = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                value = (value & 1) ? (0xedb88320u ^ (value >> 1)) : (value >> 1);
+            }
+            result[0][i] = value;
+        }
+        for (uint32_t i = 0; i < 256; ++i) {
+            for (size_t t = 1; t < 8; ++t) {
+                result[t][i] = (result[t - 1][i] >> 8) ^ result[0][result[t - 1][i] & 0xff];
+            }
+        }
+        return result;
+    }();
+
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+    uint32_t crc = 0xffffffffu;
+    for (; length >= 8; length -= 8, bytes += 8) {
+        uint32_t low = loadValue<uint32_t>(reinterpret_cast<const char*>(bytes)) ^ crc;
+        uint32_t high = loadValue<uint32_t>(reinterpret_cast<const char*>(bytes) + 4);
+        crc = tables[7][low & 0xff] ^ tables[6][(low >> 8) & 0xff] ^
+              tables[5][(low >> 16) & 0xff] ^ tables[4][low >> 24] ^
+              tables[3][high & 0xff] ^ tables[2][(high >> 8) & 0xff] ^
+              tables[1][(high >> 16) & 0xff] ^ tables[0][high >> 24];
+    }
+    for (; length > 0; --length, ++bytes) {
+        crc = tables[0][(crc ^ *bytes) & 0xff] ^ (crc >> 8);
+    }
+    return crc ^ 0xffffffffu;
+}
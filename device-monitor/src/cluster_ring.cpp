@@ -0,0 +1,80 @@
+#include "cluster_ring.h"
+#include <algorithm>
+
+ClusterRing::ClusterRing(size_t virtual_nodes)
+    : m_virtual_nodes(virtual_nodes == 0 ? 1 : virtual_nodes)
+    , m_ring(nullptr)
+{
+    m_versions.push_back(std::make_unique<Ring>());
+    m_ring.store(m_versions.back().get());
+}
+
+ClusterRing::~ClusterRing() {
+}
+
+bool ClusterRing::setMembers(std::vector<std::string> members) {
+    std::sort(members.begin(), members.end());
+    members.erase(std::unique(members.begin(), members.end()), members.end());
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_ring.load()->members == members) {
+        return false;
+    }
+
+    auto ring = std::make_unique<Ring>();
+    ring->points.reserve(members.size() * m_virtual_nodes);
+    for (size_t i = 0; i < members.size(); ++i) {
+        std::string point = members[i] + "#";
+        size_t prefix = point.size();
+        for (size_t v = 0; v < m_virtual_nodes; ++v) {
+            point.resize(prefix);
+            point += std::to_string(v);
+            ring->points.emplace_back(hash(point), static_cast<uint32_t>(i));
+        }
+    }
+    // 哈希值相同的虚拟节点按成员下标排序，各进程的结果一致
+    std::sort(ring->points.begin(), ring->points.end());
+    ring->members = std::move(members);
+
+    m_ring.store(ring.get());
+    m_versions.push_back(std::move(ring));
+    return true;
+}
+
+std::vector<std::string> ClusterRing::members() const {
+    return m_ring.load()->members;
+}
+
+const std::string& ClusterRing::owner(std::string_view key) const {
+    static const std::string none;
+    const Ring* ring = m_ring.load();
+    if (ring->points.empty()) {
+        return none;
+    }
+
+    // 顺时针方向第一个虚拟节点，越过环尾时回到第一个
+    uint64_t position = hash(key);
+    auto it = std::lower_bound(ring->points.begin(), ring->points.end(), position,
+        [](const std::pair<uint64_t, uint32_t>& point, uint64_t value) {
+            return point.first < value;
+        });
+    if (it == ring->points.end()) {
+        it = ring->points.begin();
+    }
+    return ring->members[it->second];
+}
+
+uint64_t ClusterRing::hash(std::string_view key) {
+    // FNV-1a，再用 MurmurHash3 的终结混合使相近的键分散到整个环上
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (char c : key) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 0x100000001b3ULL;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
@@ -0,0 +1,237 @@
+#include "command_tracker.h"
+#include <iostream>
+
+namespace {
+
+// 延迟直方图按命令类型区分的数量上限，超出的类型合并统计
+constexpr size_t kMaxLatencyTypes = 256;
+const char* const kOverflowType = "(other)";
+
+} // namespace
+
+CommandTracker::CommandTracker(size_t max_pending, int default_timeout_ms)
+    : m_max_pending(max_pending == 0 ? 1 : max_pending)
+    , m_default_timeout_ms(default_timeout_ms)
+    , m_running(false)
+{
+}
+
+CommandTracker::~CommandTracker() {
+    stop();
+}
+
+void CommandTracker::start() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_running) {
+        return;
+    }
+    m_running = true;
+    m_expiry_thread = std::thread(&CommandTracker::expiryLoop, this);
+}
+
+void CommandTracker::stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running) {
+            return;
+        }
+        m_running = false;
+    }
+    m_cv.notify_all();
+
+    if (m_expiry_thread.joinable()) {
+        m_expiry_thread.join();
+    }
+}
+
+void CommandTracker::setPublisher(PublishFunction publisher) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_publisher = publisher;
+}
+
+void CommandTracker::setTimeoutCallback(TimeoutCallback callback) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_timeout_callback = callback;
+}
+
+void CommandTracker::setDefaultTimeout(int timeout_ms) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_default_timeout_ms = timeout_ms;
+}
+
+int CommandTracker::defaultTimeout() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_default_timeout_ms;
+}
+
+void CommandTracker::track(const ControlCommand& command,
+                           const std::string& topic,
+                           const std::string& payload,
+                           const CommandOptions& options) {
+    std::vector<TimeoutItem> evicted;
+    TimeoutCallback callback;
+    bool notify = false;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        int64_t now_ns = nowNanos();
+
+        // 重复的命令ID视为重新跟踪
+        auto existing = m_pending.find(command.command_id);
+        if (existing != m_pending.end()) {
+            erase(existing);
+        }
+
+        // 达到上限时淘汰截止时间最早的命令，按超时处理
+        while (m_pending.size() >= m_max_pending && !m_deadlines.empty()) {
+            auto victim = m_pending.find(m_deadlines.begin()->second);
+            evicted.push_back(TimeoutItem{victim->second.command, victim->second.attempts});
+            erase(victim);
+        }
+
+        int timeout_ms = options.timeout_ms > 0 ? options.timeout_ms : m_default_timeout_ms;
+
+        PendingEntry entry;
+        entry.command = command;
+        entry.topic = topic;
+        entry.payload = payload;
+        entry.qos = options.qos;
+        entry.max_retries = options.max_retries > 0 ? options.max_retries : 0;
+        entry.timeout_ns = static_cast<int64_t>(timeout_ms) * 1000000;
+        entry.first_sent_ns = now_ns;
+
+        int64_t deadline = now_ns + entry.timeout_ns;
+        // 新命令成为最早截止的命令时需要唤醒超时线程重新计算等待时间
+        notify = m_deadlines.empty() || deadline < m_deadlines.begin()->first;
+        entry.deadline_it = m_deadlines.emplace(deadline, command.command_id);
+        m_pending.emplace(command.command_id, std::move(entry));
+
+        callback = m_timeout_callback;
+    }
+
+    if (notify) {
+        m_cv.notify_all();
+    }
+
+    for (const auto& item : evicted) {
+        std::cerr << "Command " << item.command.command_id << " evicted (pending limit reached)" << std::endl;
+        if (callback) {
+            callback(item.command, item.attempts);
+        }
+    }
+}
+
+bool CommandTracker::complete(const std::string& command_id, ControlCommand* command) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_pending.find(command_id);
+    if (it == m_pending.end()) {
+        return false;
+    }
+
+    uint64_t latency_us = static_cast<uint64_t>((nowNanos() - it->second.first_sent_ns) / 1000);
+    const std::string& type = it->second.command.command_type;
+    auto hist = m_latency.find(type);
+    if (hist == m_latency.end()) {
+        hist = m_latency.emplace(m_latency.size() < kMaxLatencyTypes ? type : kOverflowType,
+                                 LatencyHistogram()).first;
+    }
+    hist->second.record(latency_us);
+
+    if (command) {
+        *command = it->second.command;
+    }
+    erase(it);
+    return true;
+}
+
+void CommandTracker::cancel(const std::string& command_id) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_pending.find(command_id);
+    if (it != m_pending.end()) {
+        erase(it);
+    }
+}
+
+size_t CommandTracker::pendingCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pending.size();
+}
+
+std::map<std::string, LatencySummary> CommandTracker::latencyStats() const {
+    std::map<std::string, LatencySummary> stats;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& pair : m_latency) {
+        stats[pair.first] = pair.second.summary();
+    }
+    return stats;
+}
+
+int64_t CommandTracker::nowNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void CommandTracker::expiryLoop() {
+    std::vector<RetryItem> retries;
+    std::vector<TimeoutItem> timeouts;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (m_running) {
+        // 等待到最早的截止时间，或者被新命令/停止请求唤醒
+        if (m_deadlines.empty()) {
+            m_cv.wait(lock);
+            continue;
+        }
+        int64_t wait_ns = m_deadlines.begin()->first - nowNanos();
+        if (wait_ns > 0) {
+            m_cv.wait_for(lock, std::chrono::nanoseconds(wait_ns));
+            continue;
+        }
+
+        retries.clear();
+        timeouts.clear();
+        collectDue(nowNanos(), retries, timeouts);
+        PublishFunction publisher = m_publisher;
+        TimeoutCallback callback = m_timeout_callback;
+
+        // 在锁外执行重发和超时回调
+        lock.unlock();
+        for (const auto& retry : retries) {
+            if (!publisher || !publisher(retry.command, retry.topic, retry.payload, retry.qos, retry.timeout_ms)) {
+                std::cerr << "Failed to resend command on " << retry.topic << std::endl;
+            }
+        }
+        for (const auto& item : timeouts) {
+            std::cerr << "Command " << item.command.command_id << " to device " << item.command.device_id
+                      << " timed out after " << item.attempts << " attempt(s)" << std::endl;
+            if (callback) {
+                callback(item.command, item.attempts);
+            }
+        }
+        lock.lock();
+    }
+}
+
+void CommandTracker::collectDue(int64_t now_ns, std::vector<RetryItem>& retries, std::vector<TimeoutItem>& timeouts) {
+    while (!m_deadlines.empty() && m_deadlines.begin()->first <= now_ns) {
+        auto it = m_pending.find(m_deadlines.begin()->second);
+        PendingEntry& entry = it->second;
+
+        if (entry.attempts <= entry.max_retries) {
+            // 以相同的command_id重发，并重新计算截止时间
+            ++entry.attempts;
+            retries.push_back(RetryItem{entry.command, entry.topic, entry.payload, entry.qos,
+                                        static_cast<int>(entry.timeout_ns / 1000000)});
+            m_deadlines.erase(entry.deadline_it);
+            entry.deadline_it = m_deadlines.emplace(now_ns + entry.timeout_ns, entry.command.command_id);
+        } else {
+            timeouts.push_back(TimeoutItem{entry.command, entry.attempts});
+            erase(it);
+        }
+    }
+}
+
+void CommandTracker::erase(std::unordered_map<std::string, PendingEntry>::iterator it) {
+    m_deadlines.erase(it->second.deadline_it);
+    m_pending.erase(it);
+}
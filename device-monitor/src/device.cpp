@@ -1,9 +1,37 @@
 #include "device.h"
+#include "json_scanner.h"
+#include "mqtt_reactor.h"
 #include <iostream>
-#include <sstream>
 #include <iomanip>
+#include <algorithm>
 #include <json/json.h>
 
+namespace {
+
+// 快速路径：在原始负载上就地扫描JSON命令，只把参数转换为 Json::Value；
+// CBOR或字段类型不在支持范围内时返回false
+bool scanCommand(std::string_view payload, std::string& command_id, std::string& command_type, Json::Value& parameters) {
+    JsonScanner::ObjectReader reader(payload);
+    std::string_view key;
+    std::string_view value;
+    while (reader.next(key, value)) {
+        bool ok = true;
+        if (key == "command_id") {
+            ok = JsonScanner::toString(value, command_id);
+        } else if (key == "command_type") {
+            ok = JsonScanner::toString(value, command_type);
+        } else if (key == "parameters") {
+            ok = JsonScanner::toValue(value, parameters);
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    return reader.ok();
+}
+
+} // namespace
+
 Device::Device(const std::string& device_id, 
                const std::string& device_type,
                const std::string& mqtt_host, 
@@ -14,7 +42,18 @@ Device::Device(const std::string& device_id,
     , m_running(false)
     , m_status_report_interval(60)  // 默认60秒上报一次状态
     , m_heartbeat_interval(30)      // 默认30秒发送一次心跳
+    , m_reactor(nullptr)
+    , m_status_timer(0)
+    , m_heartbeat_timer(0)
     , m_start_time(std::chrono::system_clock::now())
+    , m_delta_reporting(false)
+    , m_keyframe_interval(10)
+    , m_status_version(0)
+    , m_reports_since_keyframe(0)
+    , m_force_keyframe(true)
+    , m_codec(&MessageCodec::get(MessageFormat::JSON))
+    , m_schema_reporting(false)
+    , m_announced_schema(0)
 {
     // 创建MQTT客户端
     m_mqtt_client = std::make_unique<MqttClient>("device_" + device_id, mqtt_host, mqtt_port);
@@ -25,13 +64,11 @@ Device::Device(const std::string& device_id,
     m_topic_response = "device/" + device_id + "/response";
     m_topic_heartbeat = "device/" + device_id + "/heartbeat";
     m_topic_status_request = "device/" + device_id + "/status_request";
+    m_topic_schema = "device/" + device_id + "/schema";
+    m_topic_schema_request = "device/" + device_id + "/schema_request";
     
-    // 设置消息回调
-    m_mqtt_client->setMessageCallback(
-        [this](const std::string& topic, const std::string& payload) {
-            handleMessage(topic, payload);
-        }
-    );
+    // 注册主题路由
+    registerRoutes();
     
     // 设置连接状态回调
     m_mqtt_client->setConnectionCallback(
@@ -83,7 +120,18 @@ Device::Device(const std::string& device_id,
     , m_running(false)
     , m_status_report_interval(60)  // 默认60秒上报一次状态
     , m_heartbeat_interval(30)      // 默认30秒发送一次心跳
+    , m_reactor(nullptr)
+    , m_status_timer(0)
+    , m_heartbeat_timer(0)
     , m_start_time(std::chrono::system_clock::now())
+    , m_delta_reporting(false)
+    , m_keyframe_interval(10)
+    , m_status_version(0)
+    , m_reports_since_keyframe(0)
+    , m_force_keyframe(true)
+    , m_codec(&MessageCodec::get(MessageFormat::JSON))
+    , m_schema_reporting(false)
+    , m_announced_schema(0)
 {
     // 创建MQTT客户端（支持认证）
     m_mqtt_client = std::make_unique<MqttClient>("device_" + device_id, mqtt_host, mqtt_port, auth_config);
@@ -94,13 +142,11 @@ Device::Device(const std::string& device_id,
     m_topic_response = "device/" + device_id + "/response";
     m_topic_heartbeat = "device/" + device_id + "/heartbeat";
     m_topic_status_request = "device/" + device_id + "/status_request";
+    m_topic_schema = "device/" + device_id + "/schema";
+    m_topic_schema_request = "device/" + device_id + "/schema_request";
     
-    // 设置消息回调
-    m_mqtt_client->setMessageCallback(
-        [this](const std::string& topic, const std::string& payload) {
-            handleMessage(topic, payload);
-        }
-    );
+    // 注册主题路由
+    registerRoutes();
     
     // 设置连接状态回调
     m_mqtt_client->setConnectionCallback(
@@ -153,7 +199,18 @@ Device::Device(const std::string& device_id,
     , m_running(false)
     , m_status_report_interval(60)  // 默认60秒上报一次状态
     , m_heartbeat_interval(30)      // 默认30秒发送一次心跳
+    , m_reactor(nullptr)
+    , m_status_timer(0)
+    , m_heartbeat_timer(0)
     , m_start_time(std::chrono::system_clock::now())
+    , m_delta_reporting(false)
+    , m_keyframe_interval(10)
+    , m_status_version(0)
+    , m_reports_since_keyframe(0)
+    , m_force_keyframe(true)
+    , m_codec(&MessageCodec::get(MessageFormat::JSON))
+    , m_schema_reporting(false)
+    , m_announced_schema(0)
 {
     // 创建MQTT客户端（支持SSL/TLS + 认证）
     m_mqtt_client = std::make_unique<MqttClient>("device_" + device_id, mqtt_host, mqtt_port, ssl_config, auth_config);
@@ -164,13 +221,11 @@ Device::Device(const std::string& device_id,
     m_topic_response = "device/" + device_id + "/response";
     m_topic_heartbeat = "device/" + device_id + "/heartbeat";
     m_topic_status_request = "device/" + device_id + "/status_request";
+    m_topic_schema = "device/" + device_id + "/schema";
+    m_topic_schema_request = "device/" + device_id + "/schema_request";
     
-    // 设置消息回调
-    m_mqtt_client->setMessageCallback(
-        [this](const std::string& topic, const std::string& payload) {
-            handleMessage(topic, payload);
-        }
-    );
+    // 注册主题路由
+    registerRoutes();
     
     // 设置连接状态回调
     m_mqtt_client->setConnectionCallback(
@@ -222,7 +277,18 @@ Device::Device(const std::string& device_id,
     , m_running(false)
     , m_status_report_interval(60)  // 默认60秒上报一次状态
     , m_heartbeat_interval(30)      // 默认30秒发送一次心跳
+    , m_reactor(nullptr)
+    , m_status_timer(0)
+    , m_heartbeat_timer(0)
     , m_start_time(std::chrono::system_clock::now())
+    , m_delta_reporting(false)
+    , m_keyframe_interval(10)
+    , m_status_version(0)
+    , m_reports_since_keyframe(0)
+    , m_force_keyframe(true)
+    , m_codec(&MessageCodec::get(MessageFormat::JSON))
+    , m_schema_reporting(false)
+    , m_announced_schema(0)
 {
     // 创建支持SSL的MQTT客户端
     m_mqtt_client = std::make_unique<MqttClient>("device_" + device_id, mqtt_host, mqtt_port, ssl_config);
@@ -233,13 +299,11 @@ Device::Device(const std::string& device_id,
     m_topic_response = "device/" + device_id + "/response";
     m_topic_heartbeat = "device/" + device_id + "/heartbeat";
     m_topic_status_request = "device/" + device_id + "/status_request";
+    m_topic_schema = "device/" + device_id + "/schema";
+    m_topic_schema_request = "device/" + device_id + "/schema_request";
     
-    // 设置消息回调
-    m_mqtt_client->setMessageCallback(
-        [this](const std::string& topic, const std::string& payload) {
-            handleMessage(topic, payload);
-        }
-    );
+    // 注册主题路由
+    registerRoutes();
     
     // 设置连接状态回调
     m_mqtt_client->setConnectionCallback(
@@ -302,18 +366,25 @@ bool Device::start() {
     m_mqtt_client->subscribe(m_topic_command, 1);
     m_mqtt_client->subscribe(m_topic_status_request, 0);
     m_mqtt_client->subscribe("server/status_request", 0); // 订阅服务端广播的状态请求
+    m_mqtt_client->subscribe(m_topic_schema_request, 1);
+    subscribeGroups();
     
     m_running = true;
     m_device_status = "online";
     
-    // 启动状态上报线程
-    m_status_report_thread = std::thread(&Device::statusReportLoop, this);
-    
-    // 启动心跳线程
-    m_heartbeat_thread = std::thread(&Device::heartbeatLoop, this);
+    if (m_reactor) {
+        // 由反应器定时器触发状态上报和心跳
+        scheduleReactorTimers();
+    } else {
+        // 启动状态上报线程
+        m_status_report_thread = std::thread(&Device::statusReportLoop, this);
+        
+        // 启动心跳线程
+        m_heartbeat_thread = std::thread(&Device::heartbeatLoop, this);
+    }
     
-    // 立即上报一次状态
-    reportStatus();
+    // 立即上报一次完整状态
+    publishStatus(true);
     
     std::cout << "Device " << m_device_id << " started successfully" << std::endl;
     return true;
@@ -326,9 +397,10 @@ void Device::stop() {
     
     m_running = false;
     m_device_status = "offline";
+    cancelReactorTimers();
     
     // 发送离线状态
-    reportStatus();
+    publishStatus(true);
     
     // 停止MQTT客户端
     if (m_mqtt_client) {
@@ -352,6 +424,12 @@ void Device::setProperty(const std::string& name,
                         const std::string& unit, 
                         bool writable) {
     std::lock_guard<std::mutex> lock(m_properties_mutex);
+    auto it = m_properties.find(name);
+    if (it == m_properties.end() || it->second.unit != unit || it->second.writable != writable) {
+        m_dirty_properties[name] = true;
+    } else if (it->second.value != value) {
+        m_dirty_properties.emplace(name, false);
+    }
     DeviceProperty prop(name, value, unit, writable);
     m_properties[name] = prop;
 }
@@ -369,7 +447,10 @@ bool Device::updateProperty(const std::string& name, const Json::Value& value) {
     std::lock_guard<std::mutex> lock(m_properties_mutex);
     auto it = m_properties.find(name);
     if (it != m_properties.end() && it->second.writable) {
-        it->second.value = value;
+        if (it->second.value != value) {
+            it->second.value = value;
+            m_dirty_properties.emplace(name, false);
+        }
         return true;
     }
     return false;
@@ -390,16 +471,59 @@ void Device::setStatusUpdateCallback(StatusUpdateCallback callback) {
 }
 
 void Device::reportStatus() {
-    if (!m_mqtt_client || !m_mqtt_client->isConnected()) {
+    publishStatus(false);
+}
+
+void Device::publishStatus(bool keyframe) {
+    // 启用离线缓冲时断线期间照常上报，消息排队或转存到文件，重连后重放
+    if (!m_mqtt_client || (!m_mqtt_client->isConnected() && !m_mqtt_client->hasOfflineBuffer())) {
         return;
     }
     
-    Json::Value status_msg = buildStatusMessage();
-    
-    Json::StreamWriterBuilder builder;
-    std::string payload = Json::writeString(builder, status_msg);
-    
-    m_mqtt_client->publish(m_topic_status, payload, 1);
+    {
+        std::lock_guard<std::mutex> report_lock(m_report_mutex);
+        if (m_schema_reporting) {
+            // 数值帧总是包含全部属性值，不需要变化集合
+            {
+                std::lock_guard<std::mutex> lock(m_properties_mutex);
+                m_dirty_properties.clear();
+            }
+            publishValueFrame();
+        } else {
+            bool full = !m_delta_reporting || keyframe || m_force_keyframe ||
+                        m_reports_since_keyframe + 1 >= m_keyframe_interval;
+            
+            // 取走变化集合；构建期间发生的变化留到下一次上报
+            std::map<std::string, bool> changed;
+            {
+                std::lock_guard<std::mutex> lock(m_properties_mutex);
+                changed.swap(m_dirty_properties);
+            }
+            
+            // 直接写入线程复用的缓冲区，不构建临时JSON树
+            std::string& payload = MessageWriter::threadBuffer();
+            MessageWriter writer(m_codec->format(), payload);
+            uint64_t version = m_delta_reporting ? ++m_status_version : 0;
+            writeStatusMessage(writer, full ? nullptr : &changed, m_delta_reporting ? &version : nullptr);
+            
+            // 异步发布：入队失败或发送失败时，本次变化已取走，下一次必须发送关键帧
+            bool queued = m_mqtt_client->publishAsync(m_topic_status, payload, 1, false, false,
+                [this](PublishResult result) {
+                    if (result == PublishResult::FAILED) {
+                        std::lock_guard<std::mutex> lock(m_report_mutex);
+                        m_force_keyframe = true;
+                    }
+                });
+            if (!queued) {
+                m_force_keyframe = true;
+            } else if (full) {
+                m_force_keyframe = false;
+                m_reports_since_keyframe = 0;
+            } else {
+                ++m_reports_since_keyframe;
+            }
+        }
+    }
     
     // 调用状态更新回调
     if (m_status_update_callback) {
@@ -407,45 +531,225 @@ void Device::reportStatus() {
     }
 }
 
+bool Device::publishValueFrame() {
+    // 数值帧：[结构哈希, 时间戳, 状态, 按属性名排序的属性值...]
+    int64_t timestamp = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    std::string& payload = MessageWriter::threadBuffer();
+    MessageWriter writer(m_codec->format(), payload);
+    PropertySchema schema;
+    {
+        std::lock_guard<std::mutex> lock(m_properties_mutex);
+        // 先计算结构哈希（帧的第一个元素），稳定状态下不分配内存
+        SchemaHasher hasher(m_device_type);
+        for (const auto& pair : m_properties) {
+            hasher.addField(pair.first, PropertySchema::typeOf(pair.second.value), pair.second.unit, pair.second.writable);
+        }
+        uint64_t hash = hasher.hash();
+        
+        writer.beginArray(PropertySchema::FRAME_HEADER + m_properties.size());
+        writer.writeUInt(hash);
+        writer.writeInt(timestamp);
+        writer.writeString(m_device_status);
+        for (const auto& pair : m_properties) {
+            writer.writeValue(pair.second.value);
+        }
+        writer.endArray();
+        
+        // 结构变化（含首次上报和服务端索取）时按同一份属性构建结构声明
+        if (hash != m_announced_schema) {
+            schema.hash = hash;
+            schema.device_type = m_device_type;
+            schema.fields.reserve(m_properties.size());
+            for (const auto& pair : m_properties) {
+                schema.fields.push_back(SchemaField{pair.first, PropertySchema::typeOf(pair.second.value),
+                                                    pair.second.unit, pair.second.writable});
+            }
+        }
+    }
+    
+    // 先发布结构声明；同一设备的消息按发布顺序到达服务端
+    if (schema.hash != 0) {
+        Json::Value message = schema.toJson(m_device_id);
+        message["codec"] = m_codec->name();
+        if (!m_mqtt_client->publish(m_topic_schema, m_codec->encode(message), 1)) {
+            return false;
+        }
+        m_announced_schema = schema.hash;
+    }
+    
+    return m_mqtt_client->publish(m_topic_status, payload, 1);
+}
+
 void Device::setStatusReportInterval(int interval_seconds) {
     m_status_report_interval = interval_seconds;
+    if (m_running && m_reactor) {
+        scheduleReactorTimers();
+    }
 }
 
 void Device::setHeartbeatInterval(int interval_seconds) {
     m_heartbeat_interval = interval_seconds;
+    if (m_running && m_reactor) {
+        scheduleReactorTimers();
+    }
+}
+
+void Device::setReactor(MqttReactor* reactor) {
+    if (m_running) {
+        std::cerr << "Cannot change the reactor of a running device" << std::endl;
+        return;
+    }
+    m_reactor = reactor;
+    m_mqtt_client->setReactor(reactor);
+}
+
+void Device::scheduleReactorTimers() {
+    cancelReactorTimers();
+    // 间隔至少1秒，与线程模式的等待粒度一致
+    m_status_timer = m_reactor->addTimer(std::chrono::seconds(std::max(m_status_report_interval, 1)), [this]() {
+        reportStatus();
+    });
+    m_heartbeat_timer = m_reactor->addTimer(std::chrono::seconds(std::max(m_heartbeat_interval, 1)), [this]() {
+        sendHeartbeat();
+    });
+}
+
+void Device::cancelReactorTimers() {
+    if (!m_reactor) {
+        return;
+    }
+    m_reactor->cancelTimer(m_status_timer);
+    m_reactor->cancelTimer(m_heartbeat_timer);
+    m_status_timer = 0;
+    m_heartbeat_timer = 0;
+}
+
+void Device::setDeltaReporting(bool enabled, int keyframe_interval) {
+    std::lock_guard<std::mutex> lock(m_report_mutex);
+    m_delta_reporting = enabled;
+    m_keyframe_interval = keyframe_interval > 0 ? keyframe_interval : 1;
+    m_force_keyframe = true;
+}
+
+void Device::setSchemaReporting(bool enabled) {
+    std::lock_guard<std::mutex> lock(m_report_mutex);
+    m_schema_reporting = enabled;
+    m_announced_schema = 0;
+    m_force_keyframe = true;
+}
+
+void Device::setMessageFormat(MessageFormat format) {
+    m_codec = &MessageCodec::get(format);
+}
+
+bool Device::setMqtt5(bool enable) {
+    return m_mqtt_client->setMqtt5(enable);
+}
+
+bool Device::setPersistentSession(bool enable, uint32_t session_expiry) {
+    return m_mqtt_client->setPersistentSession(enable, session_expiry);
+}
+
+bool Device::setOfflineBuffer(const std::string& path, size_t capacity_bytes, uint32_t replay_rate) {
+    if (!m_mqtt_client->setOfflineBuffer(path, capacity_bytes)) {
+        return false;
+    }
+    m_mqtt_client->setReplayRate(replay_rate);
+    return true;
 }
 
 void Device::setDeviceStatus(const std::string& status) {
     m_device_status = status;
 }
 
-void Device::handleMessage(const std::string& topic, const std::string& payload) {
-    try {
-        if (topic == m_topic_command) {
-            handleCommand(payload);
-        } else if (topic == m_topic_status_request || topic == "server/status_request") {
-            handleStatusRequest(payload);
+void Device::registerRoutes() {
+    m_mqtt_client->addRoute(m_topic_command,
+        [this](const TopicCaptures&, const MessageView& message) {
+            handleCommand(message);
+        });
+    
+    // 单设备状态请求和服务端广播的状态请求使用同一个处理函数
+    auto status_request = [this](const TopicCaptures&, const MessageView& message) {
+        handleStatusRequest(message.payload);
+    };
+    m_mqtt_client->addRoute(m_topic_status_request, status_request);
+    m_mqtt_client->addRoute("server/status_request", status_request);
+    m_mqtt_client->addRoute(m_topic_schema_request,
+        [this](const TopicCaptures&, const MessageView& message) {
+            handleSchemaRequest(message.payload);
+        });
+}
+
+bool Device::joinGroup(const std::string& group) {
+    if (group.empty() || group.find_first_of("/+#") != std::string::npos) {
+        std::cerr << "Invalid group name: " << group << std::endl;
+        return false;
+    }
+    
+    std::string topic = "group/" + group + "/command";
+    {
+        std::lock_guard<std::mutex> lock(m_groups_mutex);
+        if (!m_groups.insert(group).second) {
+            return true;
         }
-    } catch (const std::exception& e) {
-        std::cerr << "Error handling message: " << e.what() << std::endl;
+        // 群组命令与单设备命令使用相同的处理流程，响应仍发往本设备的响应主题
+        if (m_routed_groups.insert(group).second) {
+            m_mqtt_client->addRoute(topic,
+                [this](const TopicCaptures&, const MessageView& message) {
+                    handleCommand(message);
+                });
+        }
+    }
+    
+    if (m_mqtt_client->isConnected()) {
+        m_mqtt_client->subscribe(topic, 1);
     }
+    std::cout << "Device " << m_device_id << " joined group " << group << std::endl;
+    return true;
 }
 
-void Device::handleCommand(const std::string& payload) {
-    try {
-        Json::CharReaderBuilder builder;
-        Json::Value root;
-        std::string errors;
-        std::istringstream stream(payload);
-        
-        if (!Json::parseFromStream(builder, stream, &root, &errors)) {
-            std::cerr << "Failed to parse command JSON: " << errors << std::endl;
+void Device::leaveGroup(const std::string& group) {
+    {
+        std::lock_guard<std::mutex> lock(m_groups_mutex);
+        if (m_groups.erase(group) == 0) {
             return;
         }
+    }
+    
+    if (m_mqtt_client->isConnected()) {
+        m_mqtt_client->unsubscribe("group/" + group + "/command");
+    }
+    std::cout << "Device " << m_device_id << " left group " << group << std::endl;
+}
+
+void Device::subscribeGroups() {
+    std::lock_guard<std::mutex> lock(m_groups_mutex);
+    for (const auto& group : m_groups) {
+        m_mqtt_client->subscribe("group/" + group + "/command", 1);
+    }
+}
+
+void Device::handleCommand(const MessageView& message) {
+    std::string_view payload = message.payload;
+    try {
+        std::string command_id;
+        std::string command_type;
+        Json::Value parameters;
         
-        std::string command_id = root.get("command_id", "").asString();
-        std::string command_type = root.get("command_type", "").asString();
-        Json::Value parameters = root.get("parameters", Json::Value());
+        // JSON命令在原始负载上就地扫描；服务端按本设备声明的格式编码命令，CBOR等其他形式回退到完整解码
+        if (!scanCommand(payload, command_id, command_type, parameters)) {
+            Json::Value root;
+            std::string errors;
+            if (!MessageCodec::decodeAny(payload, root, &errors)) {
+                std::cerr << "Failed to parse command: " << errors << std::endl;
+                return;
+            }
+            
+            command_id = root.get("command_id", "").asString();
+            command_type = root.get("command_type", "").asString();
+            parameters = root.get("parameters", Json::Value());
+        }
         
         if (command_id.empty() || command_type.empty()) {
             std::cerr << "Invalid command: missing command_id or command_type" << std::endl;
@@ -470,40 +774,61 @@ void Device::handleCommand(const std::string& payload) {
             }
         }
         
-        // 发送响应
-        sendCommandResponse(result);
+        // 发送响应（命令处理在网络线程中同步执行，消息视图仍然有效）
+        sendCommandResponse(result, message.response_topic, message.correlation_data);
         
     } catch (const std::exception& e) {
         std::cerr << "Error handling command: " << e.what() << std::endl;
     }
 }
 
-void Device::handleStatusRequest(const std::string& payload) {
-    // 收到状态请求，立即上报状态
-    reportStatus();
+void Device::handleStatusRequest(std::string_view payload) {
+    // 收到状态请求，立即上报完整状态（服务端检测到增量版本缺口时也通过状态请求索取关键帧）
+    publishStatus(true);
 }
 
-void Device::sendCommandResponse(const CommandResult& result) {
+void Device::handleSchemaRequest(std::string_view /*payload*/) {
+    // 服务端没有本设备的结构（如服务端重启），重新声明后立即上报
+    {
+        std::lock_guard<std::mutex> lock(m_report_mutex);
+        m_announced_schema = 0;
+    }
+    publishStatus(true);
+}
+
+void Device::sendCommandResponse(const CommandResult& result, std::string_view response_topic,
+                                 std::string_view correlation_data) {
     if (!m_mqtt_client || !m_mqtt_client->isConnected()) {
         return;
     }
     
-    Json::Value response;
-    response["command_id"] = result.command_id;
-    response["success"] = result.success;
-    response["timestamp"] = std::chrono::duration_cast<std::chrono::seconds>(
-        result.timestamp.time_since_epoch()).count();
-    
+    // 键按字节序写入：command_id, error|result, success, timestamp
+    std::string& payload = MessageWriter::threadBuffer();
+    MessageWriter writer(m_codec->format(), payload);
+    writer.beginObject(4);
+    writer.key("command_id");
+    writer.writeString(result.command_id);
     if (result.success) {
-        response["result"] = result.result_data;
+        writer.key("result");
+        writer.writeValue(result.result_data);
     } else {
-        response["error"] = result.error_message;
+        writer.key("error");
+        writer.writeString(result.error_message);
+    }
+    writer.key("success");
+    writer.writeBool(result.success);
+    writer.key("timestamp");
+    writer.writeInt(std::chrono::duration_cast<std::chrono::seconds>(result.timestamp.time_since_epoch()).count());
+    writer.endObject();
+    
+    if (response_topic.empty() && correlation_data.empty()) {
+        m_mqtt_client->publishAsync(m_topic_response, payload, 1);
+    } else {
+        PublishProperties properties;
+        properties.correlation_data = std::string(correlation_data);
+        m_mqtt_client->publishAsync(response_topic.empty() ? m_topic_response : std::string(response_topic),
+                                    payload, 1, false, properties);
     }
-    
-    Json::StreamWriterBuilder builder;
-    std::string payload = Json::writeString(builder, response);
-    
-    m_mqtt_client->publish(m_topic_response, payload, 1);
     
     std::cout << "Response sent for command " << result.command_id << std::endl;
 }
@@ -519,16 +844,20 @@ void Device::statusReportLoop() {
     }
 }
 
+void Device::sendHeartbeat() {
+    if (m_mqtt_client && (m_mqtt_client->isConnected() || m_mqtt_client->hasOfflineBuffer())) {
+        std::string& payload = MessageWriter::threadBuffer();
+        MessageWriter writer(m_codec->format(), payload);
+        writeHeartbeatMessage(writer);
+        
+        // 心跳只关心最新值，积压时合并
+        m_mqtt_client->publishAsync(m_topic_heartbeat, payload, 0, false, true);
+    }
+}
+
 void Device::heartbeatLoop() {
     while (m_running) {
-        if (m_mqtt_client && m_mqtt_client->isConnected()) {
-            Json::Value heartbeat = buildHeartbeatMessage();
-            
-            Json::StreamWriterBuilder builder;
-            std::string payload = Json::writeString(builder, heartbeat);
-            
-            m_mqtt_client->publish(m_topic_heartbeat, payload, 0);
-        }
+        sendHeartbeat();
         
         // 等待指定间隔时间
         for (int i = 0; i < m_heartbeat_interval && m_running; ++i) {
@@ -550,6 +879,9 @@ Json::Value Device::buildStatusMessage() {
         std::chrono::system_clock::now() - m_start_time).count();
     status["uptime"] = static_cast<Json::Int64>(uptime);
     
+    // 声明本设备使用的负载格式，服务端按此格式发送命令
+    status["codec"] = m_codec->name();
+    
     // 添加设备属性
     Json::Value properties;
     {
@@ -567,14 +899,93 @@ Json::Value Device::buildStatusMessage() {
     return status;
 }
 
-Json::Value Device::buildHeartbeatMessage() {
-    Json::Value heartbeat;
-    heartbeat["device_id"] = m_device_id;
-    heartbeat["status"] = m_device_status;
-    heartbeat["timestamp"] = std::chrono::duration_cast<std::chrono::seconds>(
-        std::chrono::system_clock::now().time_since_epoch()).count();
+void Device::writeStatusMessage(MessageWriter& writer, const std::map<std::string, bool>* changed, const uint64_t* version) {
+    auto now = std::chrono::system_clock::now();
+    
+    // 键按字节序写入，与 Json::Value 对象的输出顺序一致：
+    // codec, device_id, device_type, [full], properties, status, timestamp, uptime, [version]
+    writer.beginObject(version ? 9 : 7);
+    writer.key("codec");
+    writer.writeString(m_codec->name());
+    writer.key("device_id");
+    writer.writeString(m_device_id);
+    writer.key("device_type");
+    writer.writeString(m_device_type);
+    if (version) {
+        writer.key("full");
+        writer.writeBool(changed == nullptr);
+    }
+    
+    writer.key("properties");
+    {
+        std::lock_guard<std::mutex> lock(m_properties_mutex);
+        if (changed) {
+            // 增量：只包含变化的属性，单位和可写标志未变化时只发送值
+            size_t count = 0;
+            for (const auto& pair : *changed) {
+                count += m_properties.count(pair.first);
+            }
+            writer.beginObject(count);
+            for (const auto& pair : *changed) {
+                auto it = m_properties.find(pair.first);
+                if (it == m_properties.end()) {
+                    continue;
+                }
+                writer.key(pair.first);
+                writer.beginObject(pair.second ? 3 : 1);
+                if (pair.second) {
+                    writer.key("unit");
+                    writer.writeString(it->second.unit);
+                }
+                writer.key("value");
+                writer.writeValue(it->second.value);
+                if (pair.second) {
+                    writer.key("writable");
+                    writer.writeBool(it->second.writable);
+                }
+                writer.endObject();
+            }
+            writer.endObject();
+        } else {
+            writer.beginObject(m_properties.size());
+            for (const auto& pair : m_properties) {
+                writer.key(pair.first);
+                writer.beginObject(3);
+                writer.key("unit");
+                writer.writeString(pair.second.unit);
+                writer.key("value");
+                writer.writeValue(pair.second.value);
+                writer.key("writable");
+                writer.writeBool(pair.second.writable);
+                writer.endObject();
+            }
+            writer.endObject();
+        }
+    }
     
-    return heartbeat;
+    writer.key("status");
+    writer.writeString(m_device_status);
+    writer.key("timestamp");
+    writer.writeInt(std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count());
+    writer.key("uptime");
+    writer.writeInt(std::chrono::duration_cast<std::chrono::seconds>(now - m_start_time).count());
+    if (version) {
+        writer.key("version");
+        writer.writeUInt(*version);
+    }
+    writer.endObject();
+}
+
+void Device::writeHeartbeatMessage(MessageWriter& writer) {
+    writer.beginObject(3);
+    writer.key("device_id");
+    writer.writeString(m_device_id);
+    writer.key("status");
+    writer.writeString(m_device_status);
+    writer.key("timestamp");
+    writer.writeInt(std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    writer.endObject();
 }
 
 void Device::handleConnectionChange(bool connected) {
@@ -582,13 +993,17 @@ void Device::handleConnectionChange(bool connected) {
         std::cout << "Device " << m_device_id << " MQTT client connected" << std::endl;
         m_device_status = "online";
         
-        // 重新订阅主题
-        m_mqtt_client->subscribe(m_topic_command, 1);
-        m_mqtt_client->subscribe(m_topic_status_request, 0);
-        m_mqtt_client->subscribe("server/status_request", 0);
+        // 重新订阅主题；持久会话仍在时 broker 保留了订阅，只补订离线期间加入的设备组
+        if (!m_mqtt_client->sessionPresent()) {
+            m_mqtt_client->subscribe(m_topic_command, 1);
+            m_mqtt_client->subscribe(m_topic_status_request, 0);
+            m_mqtt_client->subscribe("server/status_request", 0);
+            m_mqtt_client->subscribe(m_topic_schema_request, 1);
+        }
+        subscribeGroups();
         
-        // 立即上报状态
-        reportStatus();
+        // 重新连接期间的上报可能丢失，立即上报完整状态
+        publishStatus(true);
     } else {
         std::cout << "Device " << m_device_id << " MQTT client disconnected" << std::endl;
         // 注意：这里不立即设置为offline，因为可能会自动重连
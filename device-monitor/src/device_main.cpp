@@ -4,6 +4,9 @@
 #include <thread>
 #include <chrono>
 #include <random>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
 #include <json/json.h>
 
 // 全局设备实例
@@ -32,6 +35,16 @@ void printHelp() {
     std::cout << "  -s, --status <interval> Status report interval in seconds (default: 60)" << std::endl;
     std::cout << "  -b, --heartbeat <int>   Heartbeat interval in seconds (default: 30)" << std::endl;
     std::cout << "  --simulate              Enable simulation mode with random data" << std::endl;
+    std::cout << "  --delta                 Report only changed properties between full keyframes" << std::endl;
+    std::cout << "  --keyframe <n>          Send a full keyframe every n status reports (default: 10)" << std::endl;
+    std::cout << "  --codec <json|cbor>     Payload format for outgoing messages (default: json)" << std::endl;
+    std::cout << "  --schema                Announce the property schema once, then report positional value frames" << std::endl;
+    std::cout << "  -g, --group <name>      Join device group for group commands (repeatable)" << std::endl;
+    std::cout << "  --mqtt5                 Use MQTT v5 (topic aliases, command correlation data)" << std::endl;
+    std::cout << "  --persistent-session    Keep subscriptions and queued QoS 1 commands across reconnects" << std::endl;
+    std::cout << "  --offline-buffer <path> Spool reports to a memory-mapped ring file while disconnected" << std::endl;
+    std::cout << "  --offline-buffer-mb <n> Offline buffer capacity in MiB (default: 16)" << std::endl;
+    std::cout << "  --replay-rate <n>       Replay at most n buffered messages per second (default: unlimited)" << std::endl;
     std::cout << "  --ssl                   Enable SSL/TLS connection" << std::endl;
     std::cout << "  --ca-file <path>        CA certificate file path" << std::endl;
     std::cout << "  --cert-file <path>      Client certificate file path" << std::endl;
@@ -216,6 +229,16 @@ int main(int argc, char* argv[]) {
     int status_interval = 60;
     int heartbeat_interval = 30;
     bool simulate = false;
+    bool delta_reporting = false;
+    int keyframe_interval = 10;
+    std::string codec_name = "json";
+    bool schema_reporting = false;
+    std::vector<std::string> groups;
+    bool mqtt5 = false;
+    bool persistent_session = false;
+    std::string offline_buffer;
+    size_t offline_buffer_mb = OfflineSpool::DEFAULT_CAPACITY >> 20;
+    int replay_rate = 0;
     
     // SSL配置参数
     bool ssl_enabled = false;
@@ -259,6 +282,36 @@ int main(int argc, char* argv[]) {
         else if (arg == "--simulate") {
             simulate = true;
         }
+        else if (arg == "--delta") {
+            delta_reporting = true;
+        }
+        else if (arg == "--keyframe" && i + 1 < argc) {
+            keyframe_interval = std::atoi(argv[++i]);
+        }
+        else if (arg == "--codec" && i + 1 < argc) {
+            codec_name = argv[++i];
+        }
+        else if (arg == "--schema") {
+            schema_reporting = true;
+        }
+        else if ((arg == "-g" || arg == "--group") && i + 1 < argc) {
+            groups.push_back(argv[++i]);
+        }
+        else if (arg == "--mqtt5") {
+            mqtt5 = true;
+        }
+        else if (arg == "--persistent-session") {
+            persistent_session = true;
+        }
+        else if (arg == "--offline-buffer" && i + 1 < argc) {
+            offline_buffer = argv[++i];
+        }
+        else if (arg == "--offline-buffer-mb" && i + 1 < argc) {
+            offline_buffer_mb = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--replay-rate" && i + 1 < argc) {
+            replay_rate = std::atoi(argv[++i]);
+        }
         else if (arg == "--ssl") {
             ssl_enabled = true;
         }
@@ -300,6 +353,13 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
+    const MessageCodec* codec = MessageCodec::find(codec_name);
+    if (!codec) {
+        std::cerr << "Error: Unknown codec: " << codec_name << " (expected json or cbor)" << std::endl;
+        printHelp();
+        return 1;
+    }
+    
     // 设置信号处理
     signal(SIGINT, signalHandler);
     signal(SIGTERM, signalHandler);
@@ -372,6 +432,31 @@ int main(int argc, char* argv[]) {
         // 设置上报间隔
         g_device->setStatusReportInterval(status_interval);
         g_device->setHeartbeatInterval(heartbeat_interval);
+        g_device->setDeltaReporting(delta_reporting, keyframe_interval);
+        g_device->setMessageFormat(codec->format());
+        g_device->setSchemaReporting(schema_reporting);
+        
+        // 设置MQTT协议版本
+        if (mqtt5) {
+            g_device->setMqtt5(true);
+        }
+        
+        // 设置持久会话
+        if (persistent_session) {
+            g_device->setPersistentSession(true);
+        }
+        
+        // 设置离线发布缓冲
+        if (!offline_buffer.empty() &&
+            !g_device->setOfflineBuffer(offline_buffer, offline_buffer_mb << 20, std::max(replay_rate, 0))) {
+            std::cerr << "Failed to open offline buffer " << offline_buffer << std::endl;
+            return 1;
+        }
+        
+        // 加入设备组
+        for (const auto& group : groups) {
+            g_device->joinGroup(group);
+        }
         
         // 设置初始属性
         g_device->setProperty("temperature", 25.0, "°C", true);
@@ -417,6 +502,12 @@ int main(int argc, char* argv[]) {
         std::cout << "  MQTT Broker: " << mqtt_host << ":" << mqtt_port << std::endl;
         std::cout << "  Status Interval: " << status_interval << " seconds" << std::endl;
         std::cout << "  Heartbeat Interval: " << heartbeat_interval << " seconds" << std::endl;
+        std::cout << "  Payload Codec: " << codec->name() << std::endl;
+        if (schema_reporting) {
+            std::cout << "  Schema Reporting: positional value frames" << std::endl;
+        } else if (delta_reporting) {
+            std::cout << "  Delta Reporting: keyframe every " << keyframe_interval << " reports" << std::endl;
+        }
         
         // 启动模拟线程（如果启用）
         std::thread simulation_thread;
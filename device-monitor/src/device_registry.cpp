@@ -0,0 +1,465 @@
+#include "device_registry.h"
+#include <functional>
+#include <algorithm>
+
+namespace {
+
+// 分片最小容量
+constexpr size_t kMinShardCapacity = 16;
+
+// 句柄驻留表最小容量
+constexpr size_t kMinInternCapacity = 1024;
+
+size_t roundUpPow2(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+} // namespace
+
+DeviceRegistry::DeviceRegistry(size_t shard_count, size_t expected_devices)
+    : m_chunks(new std::atomic<HandleChunk*>[MAX_CHUNKS])
+    , m_handle_count(0)
+    , m_intern_table(nullptr)
+{
+    for (size_t i = 0; i < MAX_CHUNKS; ++i) {
+        m_chunks[i].store(nullptr, std::memory_order_relaxed);
+    }
+    m_intern_tables.push_back(std::make_unique<InternTable>(kMinInternCapacity));
+    m_intern_table.store(m_intern_tables.back().get(), std::memory_order_release);
+    
+    size_t count = roundUpPow2(shard_count == 0 ? 1 : shard_count);
+    m_shard_mask = count - 1;
+    m_shards.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        m_shards.push_back(std::make_unique<Shard>());
+    }
+    reserve(expected_devices);
+}
+
+DeviceRegistry::~DeviceRegistry() {
+    for (size_t i = 0; i < MAX_CHUNKS; ++i) {
+        delete m_chunks[i].load(std::memory_order_relaxed);
+    }
+}
+
+void DeviceRegistry::reserve(size_t expected_devices) {
+    // 按分片数平均分摊，并留出哈希不均匀的余量
+    size_t per_shard = expected_devices / m_shards.size();
+    per_shard += per_shard / 4 + 1;
+    size_t capacity = capacityFor(per_shard);
+
+    for (auto& shard : m_shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        if (shard->slots.size() < capacity) {
+            rehash(*shard, capacity);
+        }
+    }
+    
+    // 驻留表同样按装载因子 1/2 预分配
+    std::lock_guard<std::mutex> lock(m_intern_mutex);
+    InternTable* table = m_intern_table.load(std::memory_order_relaxed);
+    size_t intern_capacity = roundUpPow2(std::min(expected_devices, MAX_HANDLES) * 2);
+    if (intern_capacity > table->mask + 1) {
+        auto grown = std::make_unique<InternTable>(intern_capacity);
+        size_t count = m_handle_count.load(std::memory_order_relaxed);
+        for (DeviceHandle handle = 0; handle < count; ++handle) {
+            insertIntern(*grown, chunkFor(handle).hash[handle & CHUNK_MASK], handle);
+        }
+        m_intern_table.store(grown.get(), std::memory_order_release);
+        m_intern_tables.push_back(std::move(grown));
+    }
+}
+
+bool DeviceRegistry::get(std::string_view device_id, DeviceStatus& out) const {
+    return read(device_id, [&out](const DeviceStatus& status) { out = status; });
+}
+
+bool DeviceRegistry::contains(std::string_view device_id) const {
+    return read(device_id, [](const DeviceStatus&) {});
+}
+
+bool DeviceRegistry::erase(std::string_view device_id) {
+    uint64_t hash = hashKey(device_id);
+    Shard& shard = shardFor(hash);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    Slot* slot = const_cast<Slot*>(find(shard, hash, device_id));
+    if (!slot) {
+        return false;
+    }
+    eraseSlot(shard, slot);
+    return true;
+}
+
+void DeviceRegistry::eraseSlot(Shard& shard, Slot* slot) {
+    // 句柄保留不回收，但需清除在线标志，使后续心跳走慢路径重新建立记录
+    if (slot->handle != INVALID_HANDLE) {
+        chunkFor(slot->handle).online[slot->handle & CHUNK_MASK].store(0);
+        unindex(*slot);
+    }
+
+    // 线性探测的后移删除：把后续同一探测链上的元素前移填补空洞，无需墓碑
+    size_t mask = shard.slots.size() - 1;
+    size_t hole = static_cast<size_t>(slot - shard.slots.data());
+    size_t next = (hole + 1) & mask;
+    while (shard.slots[next].used) {
+        size_t home = shard.slots[next].hash & mask;
+        // 元素的理想位置不在 (hole, next] 区间内时才能移入空洞
+        bool movable = (next > hole) ? (home <= hole || home > next)
+                                     : (home <= hole && home > next);
+        if (movable) {
+            shard.slots[hole] = std::move(shard.slots[next]);
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+    shard.slots[hole] = Slot();
+    --shard.count;
+}
+
+void DeviceRegistry::forEach(const std::function<void(const DeviceStatus&)>& fn) const {
+    ClockPair clock = ClockPair::now();
+    for (const auto& shard : m_shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        for (const auto& slot : shard->slots) {
+            if (slot.used) {
+                refreshLastSeen(slot, clock);
+                fn(slot.status);
+            }
+        }
+    }
+}
+
+void DeviceRegistry::forEachMutable(const std::function<void(DeviceStatus&)>& fn) {
+    ClockPair clock = ClockPair::now();
+    for (auto& shard : m_shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        for (auto& slot : shard->slots) {
+            if (slot.used) {
+                refreshLastSeen(slot, clock);
+                fn(slot.status);
+                syncDerivedState(slot);
+            }
+        }
+    }
+}
+
+std::vector<std::string> DeviceRegistry::findDevices(std::string_view status, std::string_view device_type) const {
+    std::vector<std::string> result;
+    std::lock_guard<std::mutex> lock(m_index_mutex);
+    
+    if (status.empty() && device_type.empty()) {
+        // 每个设备恰好属于一个状态集合
+        for (const auto& pair : m_status_index) {
+            for (DeviceHandle handle : pair.second) {
+                result.push_back(deviceId(handle));
+            }
+        }
+        return result;
+    }
+    
+    const HandleSet* matched = lookup(status, device_type);
+    if (!matched) {
+        return result;
+    }
+    
+    result.reserve(matched->size());
+    for (DeviceHandle handle : *matched) {
+        result.push_back(deviceId(handle));
+    }
+    return result;
+}
+
+size_t DeviceRegistry::countDevices(std::string_view status, std::string_view device_type) const {
+    std::lock_guard<std::mutex> lock(m_index_mutex);
+    
+    if (status.empty() && device_type.empty()) {
+        size_t total = 0;
+        for (const auto& pair : m_status_index) {
+            total += pair.second.size();
+        }
+        return total;
+    }
+    
+    const HandleSet* matched = lookup(status, device_type);
+    return matched ? matched->size() : 0;
+}
+
+const DeviceRegistry::HandleSet* DeviceRegistry::lookup(std::string_view status, std::string_view device_type) const {
+    // 两个条件同时给出时直接使用组合索引
+    if (!status.empty() && !device_type.empty()) {
+        auto it = m_status_type_index.find(CompositeLess::View(status, device_type));
+        return it == m_status_type_index.end() ? nullptr : &it->second;
+    }
+    return status.empty() ? indexLookup(m_type_index, device_type) : indexLookup(m_status_index, status);
+}
+
+std::map<std::string, size_t> DeviceRegistry::statusCounts() const {
+    std::map<std::string, size_t> counts;
+    std::lock_guard<std::mutex> lock(m_index_mutex);
+    for (const auto& pair : m_status_index) {
+        if (!pair.second.empty()) {
+            counts[pair.first] = pair.second.size();
+        }
+    }
+    return counts;
+}
+
+size_t DeviceRegistry::size() const {
+    size_t total = 0;
+    for (const auto& shard : m_shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        total += shard->count;
+    }
+    return total;
+}
+
+uint64_t DeviceRegistry::hashKey(std::string_view device_id) {
+    uint64_t hash = std::hash<std::string_view>()(device_id);
+    // 混合高低位，保证分片（高位）和槽位（低位）都分布均匀
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+const DeviceRegistry::Slot* DeviceRegistry::find(const Shard& shard, uint64_t hash, std::string_view device_id) {
+    if (shard.slots.empty()) {
+        return nullptr;
+    }
+
+    size_t mask = shard.slots.size() - 1;
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+        const Slot& slot = shard.slots[i];
+        if (!slot.used) {
+            return nullptr;
+        }
+        if (slot.hash == hash && slot.status.device_id == device_id) {
+            return &slot;
+        }
+    }
+}
+
+DeviceRegistry::Slot& DeviceRegistry::findOrInsert(Shard& shard, uint64_t hash, std::string_view device_id) {
+    // 装载因子超过 3/4 时扩容
+    if ((shard.count + 1) * 4 > shard.slots.size() * 3) {
+        rehash(shard, capacityFor(shard.count + 1));
+    }
+
+    size_t mask = shard.slots.size() - 1;
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+        Slot& slot = shard.slots[i];
+        if (!slot.used) {
+            slot.used = true;
+            slot.hash = hash;
+            slot.handle = intern(device_id);
+            slot.status.device_id.assign(device_id.data(), device_id.size());
+            // 首次出现的设备以当前时间作为最后活跃时间
+            if (slot.handle != INVALID_HANDLE && lastSeenTicks(slot.handle) == 0) {
+                touch(slot.handle, nowTicks());
+            }
+            ++shard.count;
+            return slot;
+        }
+        if (slot.hash == hash && slot.status.device_id == device_id) {
+            return slot;
+        }
+    }
+}
+
+void DeviceRegistry::rehash(Shard& shard, size_t new_capacity) {
+    std::vector<Slot> old_slots(new_capacity);
+    old_slots.swap(shard.slots);
+
+    size_t mask = new_capacity - 1;
+    for (auto& old_slot : old_slots) {
+        if (!old_slot.used) {
+            continue;
+        }
+        size_t i = old_slot.hash & mask;
+        while (shard.slots[i].used) {
+            i = (i + 1) & mask;
+        }
+        shard.slots[i] = std::move(old_slot);
+    }
+}
+
+size_t DeviceRegistry::capacityFor(size_t count) {
+    // 保持装载因子不超过 1/2，为后续插入留出空间
+    return std::max(kMinShardCapacity, roundUpPow2(count * 2));
+}
+
+DeviceHandle DeviceRegistry::intern(std::string_view device_id) {
+    uint64_t hash = hashKey(device_id);
+    DeviceHandle handle = probeIntern(*m_intern_table.load(std::memory_order_acquire), hash, device_id);
+    if (handle != INVALID_HANDLE) {
+        return handle;
+    }
+    
+    std::lock_guard<std::mutex> lock(m_intern_mutex);
+    
+    // 加锁后重新检查（可能已被其他线程分配，或者读到的是扩容前的旧表）
+    InternTable* table = m_intern_table.load(std::memory_order_relaxed);
+    handle = probeIntern(*table, hash, device_id);
+    if (handle != INVALID_HANDLE) {
+        return handle;
+    }
+    
+    size_t count = m_handle_count.load(std::memory_order_relaxed);
+    if (count >= MAX_HANDLES) {
+        return INVALID_HANDLE;
+    }
+    
+    // 分配句柄数据块
+    handle = static_cast<DeviceHandle>(count);
+    size_t chunk_index = handle >> CHUNK_BITS;
+    HandleChunk* chunk = m_chunks[chunk_index].load(std::memory_order_relaxed);
+    if (!chunk) {
+        chunk = new HandleChunk();
+        m_chunks[chunk_index].store(chunk, std::memory_order_release);
+    }
+    chunk->hash[handle & CHUNK_MASK] = hash;
+    chunk->device_id[handle & CHUNK_MASK].assign(device_id.data(), device_id.size());
+    
+    // 装载因子超过 1/2 时扩容：新表构建完成后再原子发布，旧表保留给仍在读取的线程
+    if ((count + 1) * 2 > table->mask + 1) {
+        auto grown = std::make_unique<InternTable>((table->mask + 1) * 2);
+        for (DeviceHandle existing = 0; existing < count; ++existing) {
+            insertIntern(*grown, chunkFor(existing).hash[existing & CHUNK_MASK], existing);
+        }
+        table = grown.get();
+        m_intern_tables.push_back(std::move(grown));
+        insertIntern(*table, hash, handle);
+        m_intern_table.store(table, std::memory_order_release);
+    } else {
+        insertIntern(*table, hash, handle);
+    }
+    
+    m_handle_count.store(count + 1, std::memory_order_release);
+    return handle;
+}
+
+DeviceHandle DeviceRegistry::findHandle(std::string_view device_id) const {
+    return probeIntern(*m_intern_table.load(std::memory_order_acquire), hashKey(device_id), device_id);
+}
+
+const std::string& DeviceRegistry::deviceId(DeviceHandle handle) const {
+    return chunkFor(handle).device_id[handle & CHUNK_MASK];
+}
+
+int64_t DeviceRegistry::lastSeenTicks(DeviceHandle handle) const {
+    return chunkFor(handle).last_seen[handle & CHUNK_MASK].load();
+}
+
+DeviceHandle DeviceRegistry::probeIntern(const InternTable& table, uint64_t hash, std::string_view device_id) const {
+    for (size_t i = hash & table.mask; ; i = (i + 1) & table.mask) {
+        uint32_t entry = table.slots[i].load(std::memory_order_acquire);
+        if (entry == 0) {
+            return INVALID_HANDLE;
+        }
+        DeviceHandle handle = entry - 1;
+        const HandleChunk& chunk = chunkFor(handle);
+        size_t index = handle & CHUNK_MASK;
+        if (chunk.hash[index] == hash && chunk.device_id[index] == device_id) {
+            return handle;
+        }
+    }
+}
+
+void DeviceRegistry::insertIntern(InternTable& table, uint64_t hash, DeviceHandle handle) {
+    size_t i = hash & table.mask;
+    while (table.slots[i].load(std::memory_order_relaxed) != 0) {
+        i = (i + 1) & table.mask;
+    }
+    table.slots[i].store(handle + 1, std::memory_order_release);
+}
+
+void DeviceRegistry::refreshLastSeen(const Slot& slot, const ClockPair& clock) const {
+    if (slot.handle == INVALID_HANDLE) {
+        return;
+    }
+    int64_t ticks = lastSeenTicks(slot.handle);
+    if (ticks != 0) {
+        slot.status.last_seen = clock.toSystem(ticks);
+    }
+}
+
+void DeviceRegistry::syncDerivedState(Slot& slot) {
+    if (slot.handle == INVALID_HANDLE) {
+        return;
+    }
+    uint8_t online = slot.status.status != "offline" ? 1 : 0;
+    chunkFor(slot.handle).online[slot.handle & CHUNK_MASK].store(online);
+    
+    // 状态和类型未变化时（绝大多数更新）不触碰索引锁
+    bool status_changed = slot.indexed_status != slot.status.status;
+    bool type_changed = slot.indexed_type != slot.status.device_type;
+    if (!status_changed && !type_changed) {
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(m_index_mutex);
+    compositeMove(m_status_type_index, slot.indexed_status, slot.indexed_type,
+                  slot.status.status, slot.status.device_type, slot.handle);
+    if (status_changed) {
+        indexMove(m_status_index, slot.indexed_status, slot.status.status, slot.handle);
+        slot.indexed_status = slot.status.status;
+    }
+    if (type_changed) {
+        indexMove(m_type_index, slot.indexed_type, slot.status.device_type, slot.handle);
+        slot.indexed_type = slot.status.device_type;
+    }
+}
+
+void DeviceRegistry::unindex(const Slot& slot) {
+    std::lock_guard<std::mutex> lock(m_index_mutex);
+    indexMove(m_status_index, slot.indexed_status, std::string(), slot.handle);
+    indexMove(m_type_index, slot.indexed_type, std::string(), slot.handle);
+    compositeMove(m_status_type_index, slot.indexed_status, slot.indexed_type, std::string(), std::string(), slot.handle);
+}
+
+void DeviceRegistry::indexMove(SecondaryIndex& index, const std::string& from, const std::string& to, DeviceHandle handle) {
+    // 空值不进入索引
+    if (!from.empty()) {
+        auto it = index.find(from);
+        if (it != index.end()) {
+            it->second.erase(handle);
+            if (it->second.empty()) {
+                index.erase(it);
+            }
+        }
+    }
+    if (!to.empty()) {
+        index[to].insert(handle);
+    }
+}
+
+void DeviceRegistry::compositeMove(CompositeIndex& index, const std::string& from_status, const std::string& from_type,
+                                   const std::string& to_status, const std::string& to_type, DeviceHandle handle) {
+    // 状态或类型为空的设备不进入组合索引
+    if (!from_status.empty() && !from_type.empty()) {
+        auto it = index.find(CompositeLess::View(from_status, from_type));
+        if (it != index.end()) {
+            it->second.erase(handle);
+            if (it->second.empty()) {
+                index.erase(it);
+            }
+        }
+    }
+    if (!to_status.empty() && !to_type.empty()) {
+        auto it = index.find(CompositeLess::View(to_status, to_type));
+        if (it == index.end()) {
+            it = index.emplace(std::make_pair(to_status, to_type), HandleSet()).first;
+        }
+        it->second.insert(handle);
+    }
+}
+
+const DeviceRegistry::HandleSet* DeviceRegistry::indexLookup(const SecondaryIndex& index, std::string_view key) {
+    auto it = index.find(key);
+    return it == index.end() ? nullptr : &it->second;
+}
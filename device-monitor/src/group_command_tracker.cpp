@@ -0,0 +1,153 @@
+#include "group_command_tracker.h"
+#include <algorithm>
+
+GroupCommandTracker::GroupCommandTracker(int default_timeout_ms)
+    : m_deadlines(100000, default_timeout_ms)
+{
+    m_deadlines.setTimeoutCallback([this](const ControlCommand& command, int) {
+        onDeadline(command);
+    });
+}
+
+GroupCommandTracker::~GroupCommandTracker() {
+    stop();
+}
+
+void GroupCommandTracker::start() {
+    m_deadlines.start();
+}
+
+void GroupCommandTracker::stop() {
+    m_deadlines.stop();
+}
+
+void GroupCommandTracker::setResultCallback(ResultCallback callback) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_result_callback = callback;
+}
+
+void GroupCommandTracker::setDefaultTimeout(int timeout_ms) {
+    m_deadlines.setDefaultTimeout(timeout_ms);
+}
+
+void GroupCommandTracker::track(const std::string& command_id,
+                                const std::string& group,
+                                const std::string& command_type,
+                                const std::vector<std::string>& device_ids,
+                                int timeout_ms) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        GroupEntry& entry = m_pending[command_id];
+        entry = GroupEntry();
+        entry.result.command_id = command_id;
+        entry.result.group = group;
+        entry.result.command_type = command_type;
+        entry.outstanding.reserve(device_ids.size());
+        entry.outstanding.insert(device_ids.begin(), device_ids.end());
+        entry.result.target_count = entry.outstanding.size();
+        entry.sent = std::chrono::steady_clock::now();
+    }
+
+    // 在锁外登记截止时间：达到待响应上限时跟踪器会同步回调 onDeadline
+    ControlCommand command;
+    command.command_id = command_id;
+    command.device_id = "group/" + group;
+    command.command_type = command_type;
+    CommandOptions options;
+    options.timeout_ms = timeout_ms;
+    m_deadlines.track(command, std::string(), std::string(), options);
+}
+
+bool GroupCommandTracker::complete(const std::string& command_id, std::string_view device_id, const Json::Value& response) {
+    GroupCommandResult result;
+    ResultCallback callback;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_pending.find(command_id);
+        if (it == m_pending.end()) {
+            return false;
+        }
+
+        GroupEntry& entry = it->second;
+        std::string id(device_id);
+        bool expected = entry.outstanding.erase(id) > 0;
+        // 成员已知时忽略名单外设备；同一设备的重复响应只计一次
+        if (!expected && (entry.result.target_count > 0 || entry.result.responses.count(id))) {
+            return true;
+        }
+
+        if (response.get("success", false).asBool()) {
+            ++entry.result.success_count;
+        } else {
+            ++entry.result.failure_count;
+        }
+        entry.result.responses.emplace(std::move(id), response);
+
+        if (entry.result.target_count == 0 || !entry.outstanding.empty()) {
+            return true;
+        }
+
+        // 结束截止时间跟踪
+        m_deadlines.complete(command_id);
+        result = finish(it, false);
+        callback = m_result_callback;
+    }
+
+    // 在锁外调用回调
+    if (callback) {
+        callback(result);
+    }
+    return true;
+}
+
+bool GroupCommandTracker::isPending(const std::string& command_id) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pending.count(command_id) > 0;
+}
+
+void GroupCommandTracker::cancel(const std::string& command_id) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending.erase(command_id);
+    }
+    m_deadlines.cancel(command_id);
+}
+
+size_t GroupCommandTracker::pendingCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pending.size();
+}
+
+void GroupCommandTracker::onDeadline(const ControlCommand& command) {
+    GroupCommandResult result;
+    ResultCallback callback;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_pending.find(command.command_id);
+        // 已在截止前汇总完成或被取消
+        if (it == m_pending.end()) {
+            return;
+        }
+        result = finish(it, true);
+        callback = m_result_callback;
+    }
+
+    // 超时线程中、锁外交付汇总结果
+    if (callback) {
+        callback(result);
+    }
+}
+
+GroupCommandResult GroupCommandTracker::finish(std::unordered_map<std::string, GroupEntry>::iterator it, bool timed_out) {
+    GroupEntry& entry = it->second;
+    GroupCommandResult result = std::move(entry.result);
+    result.timed_out_devices.assign(entry.outstanding.begin(), entry.outstanding.end());
+    std::sort(result.timed_out_devices.begin(), result.timed_out_devices.end());
+    result.timed_out = timed_out;
+    result.completed = !timed_out;
+    result.elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - entry.sent).count();
+
+    m_pending.erase(it);
+    return result;
+}
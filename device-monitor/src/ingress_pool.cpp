@@ -0,0 +1,244 @@
+#include "ingress_pool.h"
+#include <iostream>
+#include <algorithm>
+
+IngressPool::IngressPool(size_t worker_count, size_t queue_capacity, Handler handler)
+    : m_handler(handler)
+    , m_running(false)
+    , m_enqueued(0)
+    , m_coalesced_heartbeats(0)
+    , m_coalesced_statuses(0)
+    , m_dropped_heartbeats(0)
+    , m_dropped_statuses(0)
+{
+    if (worker_count == 0) {
+        worker_count = 1;
+    }
+    for (size_t i = 0; i < worker_count; ++i) {
+        m_workers.push_back(std::make_unique<Worker>());
+    }
+    
+    // 容量平均分配到各工作线程，高水位为容量的3/4，低水位为1/2
+    m_worker_capacity = std::max<size_t>(queue_capacity / worker_count, 4);
+    m_high_watermark = m_worker_capacity - m_worker_capacity / 4;
+    m_low_watermark = m_worker_capacity / 2;
+}
+
+IngressPool::~IngressPool() {
+    stop();
+}
+
+void IngressPool::start() {
+    if (m_running.exchange(true)) {
+        return;
+    }
+    for (auto& worker : m_workers) {
+        worker->stopping = false;
+        worker->thread = std::thread(&IngressPool::workerLoop, this, std::ref(*worker));
+    }
+}
+
+void IngressPool::stop() {
+    if (!m_running.exchange(false)) {
+        return;
+    }
+    for (auto& worker : m_workers) {
+        {
+            std::lock_guard<std::mutex> lock(worker->mutex);
+            worker->stopping = true;
+        }
+        worker->cv.notify_one();
+    }
+    for (auto& worker : m_workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+}
+
+bool IngressPool::submit(IngressKind kind, std::string_view device_id, std::string_view payload,
+                         std::string_view correlation_id) {
+    if (!m_running) {
+        return false;
+    }
+
+    // 按设备ID哈希分区，保证同一设备的消息顺序
+    Worker& worker = *m_workers[std::hash<std::string_view>()(device_id) % m_workers.size()];
+
+    bool was_empty;
+    bool replaced = false;
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        size_t depth = worker.queue.size() - worker.superseded + worker.batch_size;
+
+        // 高低水位之间保持当前模式，避免在临界点反复切换
+        if (!worker.shedding && depth >= m_high_watermark) {
+            worker.shedding = true;
+            buildSlotIndex(worker);
+        } else if (worker.shedding && depth <= m_low_watermark) {
+            worker.shedding = false;
+            worker.slots.clear();
+        }
+
+        // 命令响应和结构声明从不降载
+        bool coalescable = kind != IngressKind::RESPONSE && kind != IngressKind::SCHEMA;
+        // 增量依赖之前的每一个增量，关键帧可能是服务端发现版本缺口后索取的，都不能被取代或取代其他状态
+        bool versioned = kind == IngressKind::STATUS && isVersionedStatus(payload);
+        std::string buffer;
+        if (worker.shedding && coalescable) {
+            auto it = worker.slots.find(device_id);
+            bool full = depth >= m_worker_capacity;
+
+            if (kind == IngressKind::HEARTBEAT) {
+                // 排队中的心跳或状态处理时都会刷新活跃时间，新心跳可直接合并
+                if (it != worker.slots.end()) {
+                    m_coalesced_heartbeats.fetch_add(1, std::memory_order_relaxed);
+                    return true;
+                }
+                if (full) {
+                    m_dropped_heartbeats.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+            } else {
+                // 只保留每个设备最新的状态：旧状态作废，新状态追加到队尾（复用旧状态的缓冲区），
+                // 不会越过其间到达的响应和结构声明；积压数量不变
+                if (!versioned && it != worker.slots.end() && it->second.status != NONE) {
+                    IngressMessage& old = worker.queue[it->second.status];
+                    old.superseded = true;
+                    buffer = std::move(old.payload);
+                    ++worker.superseded;
+                    replaced = true;
+                    m_coalesced_statuses.fetch_add(1, std::memory_order_relaxed);
+                } else if (full) {
+                    m_dropped_statuses.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+            }
+        }
+
+        buffer.assign(payload.data(), payload.size());
+        was_empty = worker.queue.empty();
+        bool grow = worker.queue.size() == worker.queue.capacity();
+        worker.queue.push_back(IngressMessage{kind, std::string(device_id), std::move(buffer),
+                                              std::string(correlation_id)});
+        if (worker.superseded >= m_worker_capacity) {
+            // 作废的状态累积到一个队列容量时移除，队列长度保持在容量的两倍以内
+            compactQueue(worker);
+        } else if (worker.shedding) {
+            if (grow) {
+                // 扩容后消息被移动，索引键引用的设备ID失效，重建索引（已包含新消息）
+                buildSlotIndex(worker);
+            } else if (coalescable && !versioned) {
+                QueuedSlots& slots = worker.slots[worker.queue.back().device_id];
+                if (kind == IngressKind::HEARTBEAT) {
+                    slots.heartbeat = worker.queue.size() - 1;
+                } else {
+                    slots.status = worker.queue.size() - 1;
+                }
+            }
+        }
+    }
+    if (!replaced) {
+        m_enqueued.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // 队列非空时消费者必然已被唤醒或正在处理，无需重复通知
+    if (was_empty) {
+        worker.cv.notify_one();
+    }
+    return true;
+}
+
+size_t IngressPool::queuedCount() const {
+    size_t total = 0;
+    for (const auto& worker : m_workers) {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        total += worker->queue.size() - worker->superseded + worker->batch_size;
+    }
+    return total;
+}
+
+IngressStats IngressPool::stats() const {
+    IngressStats result;
+    for (const auto& worker : m_workers) {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        result.queue_depth += worker->queue.size() - worker->superseded + worker->batch_size;
+        if (worker->shedding) {
+            ++result.shedding_workers;
+        }
+    }
+    result.queue_capacity = m_worker_capacity * m_workers.size();
+    result.enqueued = m_enqueued.load(std::memory_order_relaxed);
+    result.coalesced_heartbeats = m_coalesced_heartbeats.load(std::memory_order_relaxed);
+    result.coalesced_statuses = m_coalesced_statuses.load(std::memory_order_relaxed);
+    result.dropped_heartbeats = m_dropped_heartbeats.load(std::memory_order_relaxed);
+    result.dropped_statuses = m_dropped_statuses.load(std::memory_order_relaxed);
+    return result;
+}
+
+void IngressPool::workerLoop(Worker& worker) {
+    std::vector<IngressMessage> batch;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(worker.mutex);
+            worker.batch_size = 0;
+            worker.cv.wait(lock, [&worker]() { return worker.stopping || !worker.queue.empty(); });
+            if (worker.queue.empty()) {
+                // 已停止且队列已处理完
+                break;
+            }
+            // 整批交换，锁内只做一次指针交换，两个缓冲区的容量循环复用
+            batch.swap(worker.queue);
+            worker.batch_size = batch.size() - worker.superseded;
+            worker.superseded = 0;
+            // 已取走的消息不再参与合并
+            worker.slots.clear();
+        }
+
+        for (const auto& message : batch) {
+            if (message.superseded) {
+                continue;
+            }
+            try {
+                m_handler(message);
+            } catch (const std::exception& e) {
+                std::cerr << "Error handling ingress message from device " << message.device_id
+                          << ": " << e.what() << std::endl;
+            }
+        }
+        batch.clear();
+    }
+}
+
+void IngressPool::compactQueue(Worker& worker) {
+    worker.queue.erase(std::remove_if(worker.queue.begin(), worker.queue.end(),
+                                      [](const IngressMessage& message) { return message.superseded; }),
+                       worker.queue.end());
+    worker.superseded = 0;
+    // 消息被移动，重建索引
+    buildSlotIndex(worker);
+}
+
+void IngressPool::buildSlotIndex(Worker& worker) {
+    worker.slots.clear();
+    for (size_t pos = 0; pos < worker.queue.size(); ++pos) {
+        const IngressMessage& message = worker.queue[pos];
+        if (message.superseded || message.kind == IngressKind::RESPONSE || message.kind == IngressKind::SCHEMA ||
+            (message.kind == IngressKind::STATUS && isVersionedStatus(message.payload))) {
+            continue;
+        }
+        QueuedSlots& slots = worker.slots[message.device_id];
+        if (message.kind == IngressKind::HEARTBEAT) {
+            slots.heartbeat = pos;
+        } else {
+            slots.status = pos;
+        }
+    }
+}
+
+bool IngressPool::isVersionedStatus(std::string_view payload) {
+    // 增量和关键帧都带 "full" 键，JSON 和 CBOR 编码中键名都按原样出现；
+    // 只按字节查找不解析，属性名或字符串值恰好包含 full 时只是少合并一条状态
+    return payload.find("full") != std::string_view::npos;
+}
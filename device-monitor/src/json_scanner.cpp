@@ -0,0 +1,523 @@
+#include "json_scanner.h"
+#include <charconv>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+const char* skipWhitespace(const char* p, const char* end) {
+    while (p != end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) {
+        ++p;
+    }
+    return p;
+}
+
+// 查找下一个引号或反斜杠，找不到时返回end
+const char* findQuoteOrEscape(const char* p, const char* end) {
+#if defined(__SSE2__)
+    // 一次比较16字节，属性名、单位和状态字符串中绝大多数字节都在这里跳过
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i escape = _mm_set1_epi8('\\');
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, escape)));
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 16;
+    }
+#endif
+    while (p != end && *p != '"' && *p != '\\') {
+        ++p;
+    }
+    return p;
+}
+
+bool parseHex4(const char* p, unsigned int& code) {
+    code = 0;
+    for (int i = 0; i < 4; ++i) {
+        char c = p[i];
+        code <<= 4;
+        if (c >= '0' && c <= '9') {
+            code |= c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            code |= c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            code |= c - 'A' + 10;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+void appendUtf8(std::string& out, unsigned int code) {
+    if (code < 0x80) {
+        out.push_back(static_cast<char>(code));
+    } else if (code < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (code >> 6)));
+        out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xE0 | (code >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    }
+}
+
+// 跳过字符串内容（p 指向开头引号之后），返回结尾引号的位置，格式错误或含代理对转义时返回nullptr
+const char* scanString(const char* p, const char* end, bool& escaped) {
+    escaped = false;
+    for (;;) {
+        p = findQuoteOrEscape(p, end);
+        if (p == end) {
+            return nullptr;
+        }
+        if (*p == '"') {
+            return p;
+        }
+        escaped = true;
+        if (end - p < 2) {
+            return nullptr;
+        }
+        switch (p[1]) {
+        case '"': case '\\': case '/': case 'b': case 'f': case 'n': case 'r': case 't':
+            p += 2;
+            break;
+        case 'u': {
+            unsigned int code;
+            if (end - p < 6 || !parseHex4(p + 2, code) || (code >= 0xD800 && code <= 0xDFFF)) {
+                return nullptr;
+            }
+            p += 6;
+            break;
+        }
+        default:
+            return nullptr;
+        }
+    }
+}
+
+// 解码字符串内容（不含引号）；jsoncpp 对不成对的代理项另有规则，代理对转义交由 jsoncpp 处理
+bool decodeString(const char* p, const char* end, std::string& out) {
+    out.clear();
+    for (;;) {
+        const char* run = findQuoteOrEscape(p, end);
+        out.append(p, run - p);
+        if (run == end) {
+            return true;
+        }
+        if (*run == '"' || end - run < 2) {
+            return false;
+        }
+        switch (run[1]) {
+        case '"': out.push_back('"'); break;
+        case '\\': out.push_back('\\'); break;
+        case '/': out.push_back('/'); break;
+        case 'b': out.push_back('\b'); break;
+        case 'f': out.push_back('\f'); break;
+        case 'n': out.push_back('\n'); break;
+        case 'r': out.push_back('\r'); break;
+        case 't': out.push_back('\t'); break;
+        case 'u': {
+            unsigned int code;
+            if (end - run < 6 || !parseHex4(run + 2, code) || (code >= 0xD800 && code <= 0xDFFF)) {
+                return false;
+            }
+            appendUtf8(out, code);
+            p = run + 6;
+            continue;
+        }
+        default:
+            return false;
+        }
+        p = run + 2;
+    }
+}
+
+// 按严格JSON语法扫描数值，返回数值之后的位置，格式错误返回nullptr
+const char* scanNumber(const char* p, const char* end, bool& integer) {
+    integer = true;
+    if (p != end && *p == '-') {
+        ++p;
+    }
+    if (p == end) {
+        return nullptr;
+    }
+    if (*p == '0') {
+        ++p;
+    } else if (*p >= '1' && *p <= '9') {
+        while (p != end && *p >= '0' && *p <= '9') {
+            ++p;
+        }
+    } else {
+        return nullptr;
+    }
+    if (p != end && *p == '.') {
+        integer = false;
+        const char* digits = ++p;
+        while (p != end && *p >= '0' && *p <= '9') {
+            ++p;
+        }
+        if (p == digits) {
+            return nullptr;
+        }
+    }
+    if (p != end && (*p == 'e' || *p == 'E')) {
+        integer = false;
+        ++p;
+        if (p != end && (*p == '+' || *p == '-')) {
+            ++p;
+        }
+        const char* digits = p;
+        while (p != end && *p >= '0' && *p <= '9') {
+            ++p;
+        }
+        if (p == digits) {
+            return nullptr;
+        }
+    }
+    return p;
+}
+
+// 转换已通过语法检查的数值，与 jsoncpp 的数值类型相同：整数优先取有符号类型，超出有符号范围的非负整数取无符号类型；
+// 超出64位的整数和溢出的浮点数 jsoncpp 另有规则，返回失败。out 为空时只做检查
+bool convertNumber(const char* begin, const char* end, bool integer, Json::Value* out) {
+    if (integer) {
+        bool negative = *begin == '-';
+        uint64_t magnitude;
+        auto result = std::from_chars(begin + (negative ? 1 : 0), end, magnitude);
+        if (result.ec != std::errc()) {
+            return false;
+        }
+        if (negative && magnitude > static_cast<uint64_t>(INT64_MAX) + 1) {
+            return false;
+        }
+        if (!out) {
+            return true;
+        }
+        if (negative) {
+            *out = magnitude == static_cast<uint64_t>(INT64_MAX) + 1
+                ? Json::Value(static_cast<Json::Int64>(INT64_MIN))
+                : Json::Value(-static_cast<Json::Int64>(magnitude));
+        } else if (magnitude <= static_cast<uint64_t>(INT64_MAX)) {
+            *out = Json::Value(static_cast<Json::Int64>(magnitude));
+        } else {
+            *out = Json::Value(static_cast<Json::UInt64>(magnitude));
+        }
+        return true;
+    }
+    double number;
+    auto result = std::from_chars(begin, end, number);
+    if (result.ec != std::errc() || result.ptr != end) {
+        return false;
+    }
+    if (out) {
+        *out = Json::Value(number);
+    }
+    return true;
+}
+
+const char* scanLiteral(const char* p, const char* end, std::string_view literal) {
+    if (static_cast<size_t>(end - p) < literal.size() || std::string_view(p, literal.size()) != literal) {
+        return nullptr;
+    }
+    return p + literal.size();
+}
+
+// 校验并跳过一个值，返回值之后的位置，格式错误返回nullptr
+const char* skipValue(const char* p, const char* end, int depth) {
+    if (p == end) {
+        return nullptr;
+    }
+    switch (*p) {
+    case '"': {
+        bool escaped;
+        const char* close = scanString(p + 1, end, escaped);
+        return close ? close + 1 : nullptr;
+    }
+    case '{':
+    case '[': {
+        if (depth >= JsonScanner::MAX_DEPTH) {
+            return nullptr;
+        }
+        char close_char = *p == '{' ? '}' : ']';
+        bool object = *p == '{';
+        p = skipWhitespace(p + 1, end);
+        if (p != end && *p == close_char) {
+            return p + 1;
+        }
+        for (;;) {
+            if (object) {
+                bool escaped;
+                const char* close = p != end && *p == '"' ? scanString(p + 1, end, escaped) : nullptr;
+                if (!close) {
+                    return nullptr;
+                }
+                p = skipWhitespace(close + 1, end);
+                if (p == end || *p != ':') {
+                    return nullptr;
+                }
+                p = skipWhitespace(p + 1, end);
+            }
+            p = skipValue(p, end, depth + 1);
+            if (!p) {
+                return nullptr;
+            }
+            p = skipWhitespace(p, end);
+            if (p == end) {
+                return nullptr;
+            }
+            if (*p == close_char) {
+                return p + 1;
+            }
+            if (*p != ',') {
+                return nullptr;
+            }
+            p = skipWhitespace(p + 1, end);
+        }
+    }
+    case 't':
+        return scanLiteral(p, end, "true");
+    case 'f':
+        return scanLiteral(p, end, "false");
+    case 'n':
+        return scanLiteral(p, end, "null");
+    default: {
+        bool integer;
+        const char* number_end = scanNumber(p, end, integer);
+        return number_end && convertNumber(p, number_end, integer, nullptr) ? number_end : nullptr;
+    }
+    }
+}
+
+bool parseNumber(const char*& p, const char* end, Json::Value& out) {
+    bool integer;
+    const char* number_end = scanNumber(p, end, integer);
+    if (!number_end || !convertNumber(p, number_end, integer, &out)) {
+        return false;
+    }
+    p = number_end;
+    return true;
+}
+
+// 键和转义字符串的解码缓冲区，每个线程复用
+std::string& scratchBuffer() {
+    thread_local std::string buffer;
+    return buffer;
+}
+
+bool parseValue(const char*& p, const char* end, Json::Value& out, int depth) {
+    if (p == end) {
+        return false;
+    }
+    switch (*p) {
+    case '"': {
+        bool escaped;
+        const char* close = scanString(p + 1, end, escaped);
+        if (!close) {
+            return false;
+        }
+        if (escaped) {
+            std::string& text = scratchBuffer();
+            if (!decodeString(p + 1, close, text)) {
+                return false;
+            }
+            out = Json::Value(text.data(), text.data() + text.size());
+        } else {
+            out = Json::Value(p + 1, close);
+        }
+        p = close + 1;
+        return true;
+    }
+    case '{': {
+        if (depth >= JsonScanner::MAX_DEPTH) {
+            return false;
+        }
+        out = Json::Value(Json::objectValue);
+        p = skipWhitespace(p + 1, end);
+        if (p != end && *p == '}') {
+            ++p;
+            return true;
+        }
+        for (;;) {
+            bool escaped;
+            const char* close = p != end && *p == '"' ? scanString(p + 1, end, escaped) : nullptr;
+            if (!close) {
+                return false;
+            }
+            Json::Value* member;
+            if (escaped) {
+                std::string& key = scratchBuffer();
+                if (!decodeString(p + 1, close, key)) {
+                    return false;
+                }
+                member = out.demand(key.data(), key.data() + key.size());
+            } else {
+                member = out.demand(p + 1, close);
+            }
+            p = skipWhitespace(close + 1, end);
+            if (p == end || *p != ':') {
+                return false;
+            }
+            p = skipWhitespace(p + 1, end);
+            if (!parseValue(p, end, *member, depth + 1)) {
+                return false;
+            }
+            p = skipWhitespace(p, end);
+            if (p == end) {
+                return false;
+            }
+            if (*p == '}') {
+                ++p;
+                return true;
+            }
+            if (*p != ',') {
+                return false;
+            }
+            p = skipWhitespace(p + 1, end);
+        }
+    }
+    case '[': {
+        if (depth >= JsonScanner::MAX_DEPTH) {
+            return false;
+        }
+        out = Json::Value(Json::arrayValue);
+        p = skipWhitespace(p + 1, end);
+        if (p != end && *p == ']') {
+            ++p;
+            return true;
+        }
+        for (;;) {
+            Json::Value& element = out.append(Json::Value());
+            if (!parseValue(p, end, element, depth + 1)) {
+                return false;
+            }
+            p = skipWhitespace(p, end);
+            if (p == end) {
+                return false;
+            }
+            if (*p == ']') {
+                ++p;
+                return true;
+            }
+            if (*p != ',') {
+                return false;
+            }
+            p = skipWhitespace(p + 1, end);
+        }
+    }
+    case 't':
+    case 'f':
+    case 'n': {
+        std::string_view literal = *p == 't' ? "true" : *p == 'f' ? "false" : "null";
+        const char* next = scanLiteral(p, end, literal);
+        if (!next) {
+            return false;
+        }
+        out = *p == 'n' ? Json::Value() : Json::Value(*p == 't');
+        p = next;
+        return true;
+    }
+    default:
+        return parseNumber(p, end, out);
+    }
+}
+
+} // namespace
+
+JsonScanner::ObjectReader::ObjectReader(std::string_view text)
+    : m_pos(text.data())
+    , m_end(text.data() + text.size())
+    , m_state(State::FIRST)
+{
+    m_pos = skipWhitespace(m_pos, m_end);
+    if (m_pos == m_end || *m_pos != '{') {
+        m_state = State::FAILED;
+    } else {
+        ++m_pos;
+    }
+}
+
+bool JsonScanner::ObjectReader::fail() {
+    m_state = State::FAILED;
+    return false;
+}
+
+bool JsonScanner::ObjectReader::next(std::string_view& key, std::string_view& value) {
+    if (m_state == State::DONE || m_state == State::FAILED) {
+        return false;
+    }
+    const char* p = skipWhitespace(m_pos, m_end);
+    if (p == m_end) {
+        return fail();
+    }
+    if (*p == '}') {
+        // 顶层对象之后只允许空白
+        m_state = skipWhitespace(p + 1, m_end) == m_end ? State::DONE : State::FAILED;
+        return false;
+    }
+    if (m_state == State::MEMBERS) {
+        if (*p != ',') {
+            return fail();
+        }
+        p = skipWhitespace(p + 1, m_end);
+    }
+
+    bool escaped;
+    const char* close = p != m_end && *p == '"' ? scanString(p + 1, m_end, escaped) : nullptr;
+    if (!close || escaped) {
+        return fail();
+    }
+    key = std::string_view(p + 1, close - p - 1);
+    p = skipWhitespace(close + 1, m_end);
+    if (p == m_end || *p != ':') {
+        return fail();
+    }
+    p = skipWhitespace(p + 1, m_end);
+    const char* value_end = skipValue(p, m_end, 1);
+    if (!value_end) {
+        return fail();
+    }
+    value = std::string_view(p, value_end - p);
+    m_pos = value_end;
+    m_state = State::MEMBERS;
+    return true;
+}
+
+bool JsonScanner::toString(std::string_view raw, std::string& out) {
+    if (raw.size() < 2 || raw.front() != '"' || raw.back() != '"') {
+        return false;
+    }
+    return decodeString(raw.data() + 1, raw.data() + raw.size() - 1, out);
+}
+
+bool JsonScanner::toBool(std::string_view raw, bool& out) {
+    if (raw == "true") {
+        out = true;
+        return true;
+    }
+    if (raw == "false") {
+        out = false;
+        return true;
+    }
+    return false;
+}
+
+bool JsonScanner::toUInt64(std::string_view raw, uint64_t& out) {
+    // 只接受无前导零的十进制整数
+    if (raw.empty() || (raw.size() > 1 && raw.front() == '0')) {
+        return false;
+    }
+    auto result = std::from_chars(raw.data(), raw.data() + raw.size(), out);
+    return result.ec == std::errc() && result.ptr == raw.data() + raw.size();
+}
+
+bool JsonScanner::toValue(std::string_view raw, Json::Value& out) {
+    const char* end = raw.data() + raw.size();
+    const char* p = skipWhitespace(raw.data(), end);
+    if (!parseValue(p, end, out, 0)) {
+        return false;
+    }
+    return skipWhitespace(p, end) == end;
+}
@@ -0,0 +1,80 @@
+#include "latency_histogram.h"
+#include <algorithm>
+#include <limits>
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+void LatencyHistogram::record(uint64_t value_us) {
+    ++m_buckets[bucketIndex(value_us)];
+    ++m_count;
+    m_sum += value_us;
+    m_min = std::min(m_min, value_us);
+    m_max = std::max(m_max, value_us);
+}
+
+uint64_t LatencyHistogram::percentile(double percentile) const {
+    if (m_count == 0) {
+        return 0;
+    }
+
+    percentile = std::max(0.0, std::min(100.0, percentile));
+    uint64_t rank = static_cast<uint64_t>(percentile / 100.0 * static_cast<double>(m_count) + 0.5);
+    rank = std::max<uint64_t>(rank, 1);
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        seen += m_buckets[i];
+        if (seen >= rank) {
+            // 桶上界不应超过实际观测到的最大值
+            return std::min(bucketUpperBound(i), m_max);
+        }
+    }
+    return m_max;
+}
+
+LatencySummary LatencyHistogram::summary() const {
+    LatencySummary result;
+    result.count = m_count;
+    if (m_count == 0) {
+        return result;
+    }
+    result.min_us = m_min;
+    result.max_us = m_max;
+    result.mean_us = static_cast<double>(m_sum) / static_cast<double>(m_count);
+    result.p50_us = percentile(50.0);
+    result.p90_us = percentile(90.0);
+    result.p99_us = percentile(99.0);
+    return result;
+}
+
+void LatencyHistogram::reset() {
+    m_buckets.fill(0);
+    m_count = 0;
+    m_sum = 0;
+    m_min = std::numeric_limits<uint64_t>::max();
+    m_max = 0;
+}
+
+size_t LatencyHistogram::bucketIndex(uint64_t value) {
+    if (value < SUB_BUCKETS) {
+        return static_cast<size_t>(value);
+    }
+    // 最高有效位决定主区间，其后的 SUB_BUCKET_BITS 位决定子桶
+    unsigned msb = 63 - static_cast<unsigned>(__builtin_clzll(value));
+    unsigned shift = msb - SUB_BUCKET_BITS;
+    size_t major = msb - SUB_BUCKET_BITS + 1;
+    return major * SUB_BUCKETS + static_cast<size_t>((value >> shift) & (SUB_BUCKETS - 1));
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(size_t index) {
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+    size_t major = index / SUB_BUCKETS;
+    uint64_t sub = index % SUB_BUCKETS;
+    unsigned shift = static_cast<unsigned>(major - 1);
+    uint64_t lower = (SUB_BUCKETS + sub) << shift;
+    return lower + ((uint64_t(1) << shift) - 1);
+}
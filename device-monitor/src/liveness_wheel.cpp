@@ -0,0 +1,101 @@
+#include "liveness_wheel.h"
+#include <algorithm>
+
+LivenessWheel::LivenessWheel(size_t slot_count, int64_t tick_nanos)
+    : m_buckets(slot_count == 0 ? 1 : slot_count, NIL)
+    , m_tick_nanos(tick_nanos > 0 ? tick_nanos : 1)
+    , m_current_tick(DeviceRegistry::nowTicks() / m_tick_nanos)
+    , m_armed_count(0)
+{
+}
+
+void LivenessWheel::arm(DeviceHandle handle, int64_t deadline_ticks) {
+    // 向上取整到刻度，保证不会早于超时时刻到期
+    int64_t deadline_tick = (deadline_ticks + m_tick_nanos - 1) / m_tick_nanos;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (handle >= m_nodes.size()) {
+        m_nodes.resize(static_cast<size_t>(handle) + 1);
+    }
+    Node& node = m_nodes[handle];
+    if (node.armed) {
+        if (deadline_tick >= node.deadline_tick) {
+            return;
+        }
+        unlink(handle);
+    }
+    link(handle, deadline_tick);
+}
+
+void LivenessWheel::disarm(DeviceHandle handle) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (handle < m_nodes.size() && m_nodes[handle].armed) {
+        unlink(handle);
+    }
+}
+
+void LivenessWheel::advance(int64_t now_ticks, std::vector<DeviceHandle>& expired) {
+    int64_t target_tick = now_ticks / m_tick_nanos;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (target_tick < m_current_tick) {
+        return;
+    }
+
+    // 每个槽位最多访问一次：落后超过一整圈时，一次遍历所有槽位即可
+    int64_t steps = std::min<int64_t>(target_tick - m_current_tick + 1,
+                                      static_cast<int64_t>(m_buckets.size()));
+    for (int64_t step = 0; step < steps; ++step) {
+        size_t bucket = static_cast<size_t>((m_current_tick + step) % static_cast<int64_t>(m_buckets.size()));
+        uint32_t handle = m_buckets[bucket];
+        while (handle != NIL) {
+            uint32_t next = m_nodes[handle].next;
+            // 同一槽位中可能挂有后续轮次的设备，只摘除已到期的
+            if (m_nodes[handle].deadline_tick <= target_tick) {
+                unlink(handle);
+                expired.push_back(handle);
+            }
+            handle = next;
+        }
+    }
+    m_current_tick = target_tick + 1;
+}
+
+size_t LivenessWheel::size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_armed_count;
+}
+
+void LivenessWheel::link(DeviceHandle handle, int64_t deadline_tick) {
+    // 已经过去的刻度放到下一个待处理槽位
+    int64_t tick = std::max(deadline_tick, m_current_tick);
+    size_t bucket = static_cast<size_t>(tick % static_cast<int64_t>(m_buckets.size()));
+
+    Node& node = m_nodes[handle];
+    node.deadline_tick = deadline_tick;
+    node.bucket = static_cast<uint32_t>(bucket);
+    node.armed = true;
+    node.prev = NIL;
+    node.next = m_buckets[bucket];
+    if (node.next != NIL) {
+        m_nodes[node.next].prev = handle;
+    }
+    m_buckets[bucket] = handle;
+    ++m_armed_count;
+}
+
+void LivenessWheel::unlink(DeviceHandle handle) {
+    Node& node = m_nodes[handle];
+    if (node.prev != NIL) {
+        m_nodes[node.prev].next = node.next;
+    } else {
+        m_buckets[node.bucket] = node.next;
+    }
+    if (node.next != NIL) {
+        m_nodes[node.next].prev = node.prev;
+    }
+    node.prev = NIL;
+    node.next = NIL;
+    node.armed = false;
+    --m_armed_count;
+}
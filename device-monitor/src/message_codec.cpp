@@ -0,0 +1,355 @@
+#include "message_codec.h"
+#include "message_writer.h"
+#include <memory>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+
+namespace {
+
+// CBOR主类型
+constexpr uint8_t CBOR_UNSIGNED = 0;
+constexpr uint8_t CBOR_NEGATIVE = 1;
+constexpr uint8_t CBOR_BYTES = 2;
+constexpr uint8_t CBOR_TEXT = 3;
+constexpr uint8_t CBOR_ARRAY = 4;
+constexpr uint8_t CBOR_MAP = 5;
+constexpr uint8_t CBOR_TAG = 6;
+constexpr uint8_t CBOR_SIMPLE = 7;
+
+constexpr uint8_t CBOR_BREAK = 0xff;
+constexpr uint8_t CBOR_INDEFINITE = 31;
+
+constexpr int CBOR_MAX_DEPTH = 64;  // 解码时允许的最大嵌套深度，防止恶意负载耗尽栈空间
+
+/**
+ * JSON文本编解码器，输出不带缩进，与 indentation 为空的 Json::StreamWriterBuilder 一致
+ */
+class JsonCodec : public MessageCodec {
+public:
+    MessageFormat format() const override { return MessageFormat::JSON; }
+    const char* name() const override { return "json"; }
+
+    std::string encode(const Json::Value& message) const override {
+        std::string out;
+        MessageWriter(MessageFormat::JSON, out).writeValue(message);
+        return out;
+    }
+
+    bool decode(const char* data, size_t size, Json::Value& message, std::string* errors) const override {
+        // 每个线程复用一个解析器，避免每条消息构造解析器和字符串流
+        thread_local std::unique_ptr<Json::CharReader> reader(Json::CharReaderBuilder().newCharReader());
+        return reader->parse(data, data + size, &message, errors);
+    }
+};
+
+/**
+ * CBOR解码：支持定长和不定长的字符串、数组、映射，忽略标签，所有长度都做越界检查
+ */
+class CborReader {
+public:
+    CborReader(const char* data, size_t size)
+        : m_pos(reinterpret_cast<const uint8_t*>(data))
+        , m_end(reinterpret_cast<const uint8_t*>(data) + size) {}
+
+    bool read(Json::Value& value, std::string* errors) {
+        if (!readValue(value, 0)) {
+            if (errors) {
+                *errors = m_error;
+            }
+            return false;
+        }
+        if (m_pos != m_end) {
+            if (errors) {
+                *errors = "trailing bytes after CBOR item";
+            }
+            return false;
+        }
+        return true;
+    }
+
+private:
+    bool fail(const char* message) {
+        m_error = message;
+        return false;
+    }
+
+    bool readBigEndian(int bytes, uint64_t& value) {
+        if (m_end - m_pos < bytes) {
+            return fail("truncated CBOR item");
+        }
+        value = 0;
+        for (int i = 0; i < bytes; ++i) {
+            value = (value << 8) | *m_pos++;
+        }
+        return true;
+    }
+
+    bool readHead(uint8_t& major, uint8_t& info, uint64_t& argument) {
+        if (m_pos == m_end) {
+            return fail("truncated CBOR item");
+        }
+        uint8_t initial = *m_pos++;
+        major = initial >> 5;
+        info = initial & 0x1f;
+        if (info < 24) {
+            argument = info;
+            return true;
+        }
+        switch (info) {
+        case 24: return readBigEndian(1, argument);
+        case 25: return readBigEndian(2, argument);
+        case 26: return readBigEndian(4, argument);
+        case 27: return readBigEndian(8, argument);
+        case CBOR_INDEFINITE:
+            argument = 0;
+            return true;
+        default:
+            return fail("invalid CBOR additional information");
+        }
+    }
+
+    // 读取定长或不定长（分块）的字符串到 out
+    bool readString(uint8_t major, uint8_t info, uint64_t length, std::string& out) {
+        out.clear();
+        if (info != CBOR_INDEFINITE) {
+            if (length > static_cast<uint64_t>(m_end - m_pos)) {
+                return fail("truncated CBOR string");
+            }
+            out.assign(reinterpret_cast<const char*>(m_pos), length);
+            m_pos += length;
+            return true;
+        }
+        while (true) {
+            if (m_pos == m_end) {
+                return fail("truncated CBOR string");
+            }
+            if (*m_pos == CBOR_BREAK) {
+                ++m_pos;
+                return true;
+            }
+            uint8_t chunk_major;
+            uint8_t chunk_info;
+            uint64_t chunk_length;
+            if (!readHead(chunk_major, chunk_info, chunk_length)) {
+                return false;
+            }
+            if (chunk_major != major || chunk_info == CBOR_INDEFINITE) {
+                return fail("invalid CBOR string chunk");
+            }
+            if (chunk_length > static_cast<uint64_t>(m_end - m_pos)) {
+                return fail("truncated CBOR string");
+            }
+            out.append(reinterpret_cast<const char*>(m_pos), chunk_length);
+            m_pos += chunk_length;
+        }
+    }
+
+    // 不定长容器是否已到达结束标记
+    bool atBreak(bool indefinite, uint64_t index, uint64_t count) {
+        if (!indefinite) {
+            return index >= count;
+        }
+        if (m_pos != m_end && *m_pos == CBOR_BREAK) {
+            ++m_pos;
+            return true;
+        }
+        return false;
+    }
+
+    bool readValue(Json::Value& value, int depth) {
+        if (depth > CBOR_MAX_DEPTH) {
+            return fail("CBOR nesting too deep");
+        }
+        uint8_t major;
+        uint8_t info;
+        uint64_t argument;
+        if (!readHead(major, info, argument)) {
+            return false;
+        }
+        bool indefinite = info == CBOR_INDEFINITE;
+        if (indefinite && (major == CBOR_UNSIGNED || major == CBOR_NEGATIVE || major == CBOR_TAG)) {
+            return fail("invalid indefinite-length CBOR item");
+        }
+
+        switch (major) {
+        case CBOR_UNSIGNED:
+            // 与JSON解析结果保持一致：能用有符号数表示的整数按有符号数保存
+            if (argument <= static_cast<uint64_t>(INT64_MAX)) {
+                value = static_cast<Json::Int64>(argument);
+            } else {
+                value = static_cast<Json::UInt64>(argument);
+            }
+            return true;
+        case CBOR_NEGATIVE:
+            if (argument > static_cast<uint64_t>(INT64_MAX)) {
+                return fail("CBOR negative integer out of range");
+            }
+            value = static_cast<Json::Int64>(-1 - static_cast<int64_t>(argument));
+            return true;
+        case CBOR_BYTES:
+        case CBOR_TEXT:
+            if (!readString(major, info, argument, m_text)) {
+                return false;
+            }
+            value = Json::Value(m_text.data(), m_text.data() + m_text.size());
+            return true;
+        case CBOR_ARRAY: {
+            // 每个元素至少占一个字节，长度超过剩余字节数的必然是损坏数据
+            if (!indefinite && argument > static_cast<uint64_t>(m_end - m_pos)) {
+                return fail("truncated CBOR array");
+            }
+            value = Json::Value(Json::arrayValue);
+            for (uint64_t i = 0; !atBreak(indefinite, i, argument); ++i) {
+                if (m_pos == m_end) {
+                    return fail("truncated CBOR array");
+                }
+                if (!readValue(value[static_cast<Json::ArrayIndex>(i)], depth + 1)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        case CBOR_MAP: {
+            if (!indefinite && argument > static_cast<uint64_t>(m_end - m_pos) / 2) {
+                return fail("truncated CBOR map");
+            }
+            value = Json::Value(Json::objectValue);
+            std::string key;
+            for (uint64_t i = 0; !atBreak(indefinite, i, argument); ++i) {
+                uint8_t key_major;
+                uint8_t key_info;
+                uint64_t key_length;
+                if (!readHead(key_major, key_info, key_length)) {
+                    return false;
+                }
+                if (key_major != CBOR_TEXT && key_major != CBOR_BYTES) {
+                    return fail("unsupported CBOR map key");
+                }
+                if (!readString(key_major, key_info, key_length, key)) {
+                    return false;
+                }
+                if (!readValue(value[key], depth + 1)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        case CBOR_TAG:
+            // 标签（如日期、自描述前缀）不影响取值，直接解码被标记的数据项
+            return readValue(value, depth + 1);
+        case CBOR_SIMPLE:
+        default:
+            return readSimple(info, argument, value);
+        }
+    }
+
+    bool readSimple(uint8_t info, uint64_t argument, Json::Value& value) {
+        switch (info) {
+        case 20:
+            value = false;
+            return true;
+        case 21:
+            value = true;
+            return true;
+        case 22:
+        case 23:
+            value = Json::Value();
+            return true;
+        case 25:
+            value = halfToDouble(static_cast<uint16_t>(argument));
+            return true;
+        case 26: {
+            uint32_t bits = static_cast<uint32_t>(argument);
+            float single;
+            std::memcpy(&single, &bits, sizeof(single));
+            value = static_cast<double>(single);
+            return true;
+        }
+        case 27: {
+            double number;
+            std::memcpy(&number, &argument, sizeof(number));
+            value = number;
+            return true;
+        }
+        case CBOR_INDEFINITE:
+            return fail("unexpected CBOR break");
+        default:
+            return fail("unsupported CBOR simple value");
+        }
+    }
+
+    static double halfToDouble(uint16_t half) {
+        int exponent = (half >> 10) & 0x1f;
+        int mantissa = half & 0x3ff;
+        double number;
+        if (exponent == 0) {
+            number = std::ldexp(mantissa, -24);
+        } else if (exponent != 31) {
+            number = std::ldexp(mantissa + 1024, exponent - 25);
+        } else {
+            number = mantissa == 0 ? INFINITY : NAN;
+        }
+        return (half & 0x8000) ? -number : number;
+    }
+
+    const uint8_t* m_pos;
+    const uint8_t* m_end;
+    std::string m_text;
+    std::string m_error;
+};
+
+class CborCodec : public MessageCodec {
+public:
+    MessageFormat format() const override { return MessageFormat::CBOR; }
+    const char* name() const override { return "cbor"; }
+
+    std::string encode(const Json::Value& message) const override {
+        std::string out;
+        out.reserve(256);
+        MessageWriter(MessageFormat::CBOR, out).writeValue(message);
+        return out;
+    }
+
+    bool decode(const char* data, size_t size, Json::Value& message, std::string* errors) const override {
+        return CborReader(data, size).read(message, errors);
+    }
+};
+
+const JsonCodec json_codec{};
+const CborCodec cbor_codec{};
+
+} // namespace
+
+const MessageCodec& MessageCodec::get(MessageFormat format) {
+    return format == MessageFormat::CBOR ? static_cast<const MessageCodec&>(cbor_codec)
+                                         : static_cast<const MessageCodec&>(json_codec);
+}
+
+const MessageCodec* MessageCodec::find(const std::string& name) {
+    if (name == json_codec.name()) {
+        return &json_codec;
+    }
+    if (name == cbor_codec.name()) {
+        return &cbor_codec;
+    }
+    return nullptr;
+}
+
+MessageFormat MessageCodec::detect(std::string_view payload) {
+    if (payload.empty()) {
+        return MessageFormat::JSON;
+    }
+    // 0x80-0xbf 为CBOR数组和映射，0xc0-0xdf 为CBOR标签；这些字节不可能出现在JSON文本开头
+    uint8_t major = static_cast<uint8_t>(payload[0]) >> 5;
+    return (major == CBOR_ARRAY || major == CBOR_MAP || major == CBOR_TAG) ? MessageFormat::CBOR : MessageFormat::JSON;
+}
+
+bool MessageCodec::decodeAny(std::string_view payload, Json::Value& message,
+                             std::string* errors, MessageFormat* format) {
+    MessageFormat detected = detect(payload);
+    if (format) {
+        *format = detected;
+    }
+    return get(detected).decode(payload.data(), payload.size(), message, errors);
+}
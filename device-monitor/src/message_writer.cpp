@@ -0,0 +1,344 @@
+#include "message_writer.h"
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+
+namespace {
+
+// CBOR主类型及简单值
+constexpr uint8_t CBOR_UNSIGNED = 0;
+constexpr uint8_t CBOR_NEGATIVE = 1;
+constexpr uint8_t CBOR_TEXT = 3;
+constexpr uint8_t CBOR_ARRAY = 4;
+constexpr uint8_t CBOR_MAP = 5;
+constexpr uint8_t CBOR_FALSE = 0xf4;
+constexpr uint8_t CBOR_TRUE = 0xf5;
+constexpr uint8_t CBOR_NULL = 0xf6;
+constexpr uint8_t CBOR_FLOAT32 = 0xfa;
+constexpr uint8_t CBOR_FLOAT64 = 0xfb;
+
+void appendBigEndian(std::string& out, uint64_t value, int bytes) {
+    for (int shift = (bytes - 1) * 8; shift >= 0; shift -= 8) {
+        out.push_back(static_cast<char>((value >> shift) & 0xff));
+    }
+}
+
+void appendHex(std::string& out, unsigned int code) {
+    static const char digits[] = "0123456789abcdef";
+    char escape[6] = {'\\', 'u', digits[(code >> 12) & 0xf], digits[(code >> 8) & 0xf],
+                      digits[(code >> 4) & 0xf], digits[code & 0xf]};
+    out.append(escape, sizeof(escape));
+}
+
+// 与jsoncpp相同的UTF-8解码规则：不完整、超长编码和代理区码点都视为替换字符
+unsigned int utf8ToCodepoint(const char*& s, const char* e) {
+    const unsigned int REPLACEMENT_CHARACTER = 0xFFFD;
+    unsigned int first = static_cast<unsigned char>(*s);
+    if (first < 0x80) {
+        return first;
+    }
+    if (first < 0xE0) {
+        if (e - s < 2) {
+            return REPLACEMENT_CHARACTER;
+        }
+        unsigned int code = ((first & 0x1F) << 6) | (static_cast<unsigned int>(s[1]) & 0x3F);
+        s += 1;
+        return code < 0x80 ? REPLACEMENT_CHARACTER : code;
+    }
+    if (first < 0xF0) {
+        if (e - s < 3) {
+            return REPLACEMENT_CHARACTER;
+        }
+        unsigned int code = ((first & 0x0F) << 12) | ((static_cast<unsigned int>(s[1]) & 0x3F) << 6) |
+                            (static_cast<unsigned int>(s[2]) & 0x3F);
+        s += 2;
+        if (code >= 0xD800 && code <= 0xDFFF) {
+            return REPLACEMENT_CHARACTER;
+        }
+        return code < 0x800 ? REPLACEMENT_CHARACTER : code;
+    }
+    if (first < 0xF8) {
+        if (e - s < 4) {
+            return REPLACEMENT_CHARACTER;
+        }
+        unsigned int code = ((first & 0x07) << 18) | ((static_cast<unsigned int>(s[1]) & 0x3F) << 12) |
+                            ((static_cast<unsigned int>(s[2]) & 0x3F) << 6) | (static_cast<unsigned int>(s[3]) & 0x3F);
+        s += 3;
+        return code < 0x10000 ? REPLACEMENT_CHARACTER : code;
+    }
+    return REPLACEMENT_CHARACTER;
+}
+
+} // namespace
+
+MessageWriter::MessageWriter(MessageFormat format, std::string& out)
+    : m_format(format)
+    , m_out(out)
+    , m_need_comma(false)
+    , m_after_key(false)
+{
+}
+
+std::string& MessageWriter::threadBuffer() {
+    thread_local std::string buffer;
+    buffer.clear();
+    return buffer;
+}
+
+void MessageWriter::separator() {
+    if (m_after_key) {
+        m_after_key = false;
+    } else if (m_need_comma) {
+        m_out.push_back(',');
+    }
+    m_need_comma = true;
+}
+
+void MessageWriter::cborHead(uint8_t major, uint64_t argument) {
+    uint8_t initial = static_cast<uint8_t>(major << 5);
+    if (argument < 24) {
+        m_out.push_back(static_cast<char>(initial | argument));
+    } else if (argument <= 0xff) {
+        m_out.push_back(static_cast<char>(initial | 24));
+        appendBigEndian(m_out, argument, 1);
+    } else if (argument <= 0xffff) {
+        m_out.push_back(static_cast<char>(initial | 25));
+        appendBigEndian(m_out, argument, 2);
+    } else if (argument <= 0xffffffffull) {
+        m_out.push_back(static_cast<char>(initial | 26));
+        appendBigEndian(m_out, argument, 4);
+    } else {
+        m_out.push_back(static_cast<char>(initial | 27));
+        appendBigEndian(m_out, argument, 8);
+    }
+}
+
+void MessageWriter::beginObject(size_t members) {
+    if (m_format == MessageFormat::CBOR) {
+        cborHead(CBOR_MAP, members);
+        return;
+    }
+    separator();
+    m_out.push_back('{');
+    m_need_comma = false;
+}
+
+void MessageWriter::endObject() {
+    if (m_format == MessageFormat::JSON) {
+        m_out.push_back('}');
+        m_need_comma = true;
+    }
+}
+
+void MessageWriter::beginArray(size_t elements) {
+    if (m_format == MessageFormat::CBOR) {
+        cborHead(CBOR_ARRAY, elements);
+        return;
+    }
+    separator();
+    m_out.push_back('[');
+    m_need_comma = false;
+}
+
+void MessageWriter::endArray() {
+    if (m_format == MessageFormat::JSON) {
+        m_out.push_back(']');
+        m_need_comma = true;
+    }
+}
+
+void MessageWriter::key(std::string_view name) {
+    if (m_format == MessageFormat::CBOR) {
+        cborHead(CBOR_TEXT, name.size());
+        m_out.append(name.data(), name.size());
+        return;
+    }
+    if (m_need_comma) {
+        m_out.push_back(',');
+    }
+    jsonString(name);
+    m_out.push_back(':');
+    m_need_comma = true;
+    m_after_key = true;
+}
+
+void MessageWriter::writeString(std::string_view text) {
+    if (m_format == MessageFormat::CBOR) {
+        cborHead(CBOR_TEXT, text.size());
+        m_out.append(text.data(), text.size());
+        return;
+    }
+    separator();
+    jsonString(text);
+}
+
+void MessageWriter::jsonString(std::string_view text) {
+    m_out.push_back('"');
+    const char* end = text.data() + text.size();
+    const char* run = text.data();
+    for (const char* c = text.data(); c != end; ++c) {
+        unsigned char byte = static_cast<unsigned char>(*c);
+        if (byte >= 0x20 && byte < 0x80 && byte != '"' && byte != '\\') {
+            continue;
+        }
+        // 无需转义的连续字符整段追加
+        m_out.append(run, c - run);
+        switch (byte) {
+        case '"': m_out.append("\\\"", 2); break;
+        case '\\': m_out.append("\\\\", 2); break;
+        case '\b': m_out.append("\\b", 2); break;
+        case '\f': m_out.append("\\f", 2); break;
+        case '\n': m_out.append("\\n", 2); break;
+        case '\r': m_out.append("\\r", 2); break;
+        case '\t': m_out.append("\\t", 2); break;
+        default: {
+            unsigned int code = utf8ToCodepoint(c, end);
+            if (code < 0x20) {
+                appendHex(m_out, code);
+            } else if (code < 0x80) {
+                m_out.push_back(static_cast<char>(code));
+            } else if (code < 0x10000) {
+                appendHex(m_out, code);
+            } else {
+                // 基本多文种平面之外的字符编码为代理对
+                code -= 0x10000;
+                appendHex(m_out, 0xd800 + ((code >> 10) & 0x3ff));
+                appendHex(m_out, 0xdc00 + (code & 0x3ff));
+            }
+            break;
+        }
+        }
+        run = c + 1;
+    }
+    m_out.append(run, end - run);
+    m_out.push_back('"');
+}
+
+void MessageWriter::writeInt(int64_t number) {
+    if (m_format == MessageFormat::CBOR) {
+        if (number >= 0) {
+            cborHead(CBOR_UNSIGNED, static_cast<uint64_t>(number));
+        } else {
+            cborHead(CBOR_NEGATIVE, static_cast<uint64_t>(-1 - number));
+        }
+        return;
+    }
+    separator();
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), number);
+    m_out.append(digits, result.ptr - digits);
+}
+
+void MessageWriter::writeUInt(uint64_t number) {
+    if (m_format == MessageFormat::CBOR) {
+        cborHead(CBOR_UNSIGNED, number);
+        return;
+    }
+    separator();
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), number);
+    m_out.append(digits, result.ptr - digits);
+}
+
+void MessageWriter::writeDouble(double number) {
+    if (m_format == MessageFormat::CBOR) {
+        // 不损失精度时使用单精度
+        float single = static_cast<float>(number);
+        if (static_cast<double>(single) == number) {
+            uint32_t bits;
+            std::memcpy(&bits, &single, sizeof(bits));
+            m_out.push_back(static_cast<char>(CBOR_FLOAT32));
+            appendBigEndian(m_out, bits, 4);
+        } else {
+            uint64_t bits;
+            std::memcpy(&bits, &number, sizeof(bits));
+            m_out.push_back(static_cast<char>(CBOR_FLOAT64));
+            appendBigEndian(m_out, bits, 8);
+        }
+        return;
+    }
+    separator();
+    // 与jsoncpp一致：非有限值输出为null或超范围字面量，整数值补 ".0" 以保留浮点类型
+    if (!std::isfinite(number)) {
+        m_out.append(std::isnan(number) ? "null" : number < 0 ? "-1e+9999" : "1e+9999");
+        return;
+    }
+    char digits[40];
+    int length = std::snprintf(digits, sizeof(digits), "%.17g", number);
+    bool has_fraction = false;
+    for (int i = 0; i < length; ++i) {
+        if (digits[i] == ',') {
+            digits[i] = '.';
+        }
+        if (digits[i] == '.' || digits[i] == 'e') {
+            has_fraction = true;
+        }
+    }
+    m_out.append(digits, length);
+    if (!has_fraction) {
+        m_out.append(".0", 2);
+    }
+}
+
+void MessageWriter::writeBool(bool flag) {
+    if (m_format == MessageFormat::CBOR) {
+        m_out.push_back(static_cast<char>(flag ? CBOR_TRUE : CBOR_FALSE));
+        return;
+    }
+    separator();
+    m_out.append(flag ? "true" : "false");
+}
+
+void MessageWriter::writeNull() {
+    if (m_format == MessageFormat::CBOR) {
+        m_out.push_back(static_cast<char>(CBOR_NULL));
+        return;
+    }
+    separator();
+    m_out.append("null", 4);
+}
+
+void MessageWriter::writeValue(const Json::Value& value) {
+    switch (value.type()) {
+    case Json::nullValue:
+        writeNull();
+        break;
+    case Json::booleanValue:
+        writeBool(value.asBool());
+        break;
+    case Json::intValue:
+        writeInt(value.asInt64());
+        break;
+    case Json::uintValue:
+        writeUInt(value.asUInt64());
+        break;
+    case Json::realValue:
+        writeDouble(value.asDouble());
+        break;
+    case Json::stringValue: {
+        const char* begin = nullptr;
+        const char* end = nullptr;
+        value.getString(&begin, &end);
+        writeString(std::string_view(begin, end - begin));
+        break;
+    }
+    case Json::arrayValue:
+        beginArray(value.size());
+        for (const auto& element : value) {
+            writeValue(element);
+        }
+        endArray();
+        break;
+    case Json::objectValue:
+        beginObject(value.size());
+        for (auto it = value.begin(); it != value.end(); ++it) {
+            const char* end = nullptr;
+            const char* begin = it.memberName(&end);
+            key(std::string_view(begin, end - begin));
+            writeValue(*it);
+        }
+        endObject();
+        break;
+    }
+}
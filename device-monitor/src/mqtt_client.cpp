@@ -1,7 +1,14 @@
 #include "mqtt_client.h"
+#include "mqtt_reactor.h"
 #include <iostream>
 #include <sstream>
+#include <algorithm>
 #include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 // 静态成员初始化
 bool MqttClient::s_lib_initialized = false;
@@ -18,7 +25,6 @@ MqttClient::MqttClient(const std::string& client_id,
     , m_connected(false)
     , m_running(false)
     , m_auto_reconnect(false)
-    , m_retry_interval(5)
     , m_mosquitto(nullptr)
 {
     // 初始化mosquitto库（线程安全）
@@ -35,12 +41,7 @@ MqttClient::MqttClient(const std::string& client_id,
     }
     
     // 设置回调函数
-    mosquitto_connect_callback_set(m_mosquitto, onConnect);
-    mosquitto_disconnect_callback_set(m_mosquitto, onDisconnect);
-    mosquitto_message_callback_set(m_mosquitto, onMessage);
-    mosquitto_subscribe_callback_set(m_mosquitto, onSubscribe);
-    mosquitto_unsubscribe_callback_set(m_mosquitto, onUnsubscribe);
-    mosquitto_publish_callback_set(m_mosquitto, onPublish);
+    installCallbacks();
 }
 
 MqttClient::MqttClient(const std::string& client_id,
@@ -56,7 +57,6 @@ MqttClient::MqttClient(const std::string& client_id,
     , m_connected(false)
     , m_running(false)
     , m_auto_reconnect(false)
-    , m_retry_interval(5)
     , m_mosquitto(nullptr)
 {
     // 初始化mosquitto库（线程安全）
@@ -73,12 +73,7 @@ MqttClient::MqttClient(const std::string& client_id,
     }
     
     // 设置回调函数
-    mosquitto_connect_callback_set(m_mosquitto, onConnect);
-    mosquitto_disconnect_callback_set(m_mosquitto, onDisconnect);
-    mosquitto_message_callback_set(m_mosquitto, onMessage);
-    mosquitto_subscribe_callback_set(m_mosquitto, onSubscribe);
-    mosquitto_unsubscribe_callback_set(m_mosquitto, onUnsubscribe);
-    mosquitto_publish_callback_set(m_mosquitto, onPublish);
+    installCallbacks();
     
     // 配置SSL/TLS
     if (m_ssl_config.enabled) {
@@ -99,7 +94,6 @@ MqttClient::MqttClient(const std::string& client_id,
     , m_connected(false)
     , m_running(false)
     , m_auto_reconnect(false)
-    , m_retry_interval(5)
     , m_mosquitto(nullptr)
 {
     // 初始化mosquitto库（线程安全）
@@ -116,12 +110,7 @@ MqttClient::MqttClient(const std::string& client_id,
     }
     
     // 设置回调函数
-    mosquitto_connect_callback_set(m_mosquitto, onConnect);
-    mosquitto_disconnect_callback_set(m_mosquitto, onDisconnect);
-    mosquitto_message_callback_set(m_mosquitto, onMessage);
-    mosquitto_subscribe_callback_set(m_mosquitto, onSubscribe);
-    mosquitto_unsubscribe_callback_set(m_mosquitto, onUnsubscribe);
-    mosquitto_publish_callback_set(m_mosquitto, onPublish);
+    installCallbacks();
     
     // 配置身份验证
     if (m_auth_config.enabled) {
@@ -144,7 +133,6 @@ MqttClient::MqttClient(const std::string& client_id,
     , m_connected(false)
     , m_running(false)
     , m_auto_reconnect(false)
-    , m_retry_interval(5)
     , m_mosquitto(nullptr)
 {
     // 初始化mosquitto库（线程安全）
@@ -161,12 +149,7 @@ MqttClient::MqttClient(const std::string& client_id,
     }
     
     // 设置回调函数
-    mosquitto_connect_callback_set(m_mosquitto, onConnect);
-    mosquitto_disconnect_callback_set(m_mosquitto, onDisconnect);
-    mosquitto_message_callback_set(m_mosquitto, onMessage);
-    mosquitto_subscribe_callback_set(m_mosquitto, onSubscribe);
-    mosquitto_unsubscribe_callback_set(m_mosquitto, onUnsubscribe);
-    mosquitto_publish_callback_set(m_mosquitto, onPublish);
+    installCallbacks();
     
     // 配置SSL/TLS
     if (m_ssl_config.enabled) {
@@ -186,6 +169,18 @@ MqttClient::~MqttClient() {
         mosquitto_destroy(m_mosquitto);
     }
     
+    // 丢弃未发出的异步发布消息（不调用完成回调，回调引用的对象可能已析构）
+    PendingPublish* node = m_publish_head.exchange(nullptr, std::memory_order_acquire);
+    while (node) {
+        std::unique_ptr<PendingPublish> owned(node);
+        node = node->next;
+    }
+    for (int fd : m_wake_pipe) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+    
     // 清理mosquitto库
     std::lock_guard<std::mutex> lock(s_init_mutex);
     if (s_lib_initialized) {
@@ -194,38 +189,709 @@ MqttClient::~MqttClient() {
     }
 }
 
+void MqttClient::installCallbacks() {
+    // 连接确认使用带标志的回调以获取会话存在标志（MQTT v5 由 setMqtt5() 换成 v5 回调）
+    mosquitto_connect_with_flags_callback_set(m_mosquitto, onConnectWithFlags);
+    mosquitto_disconnect_callback_set(m_mosquitto, onDisconnect);
+    mosquitto_message_callback_set(m_mosquitto, onMessage);
+    mosquitto_subscribe_callback_set(m_mosquitto, onSubscribe);
+    mosquitto_unsubscribe_callback_set(m_mosquitto, onUnsubscribe);
+    mosquitto_publish_callback_set(m_mosquitto, onPublish);
+}
+
 bool MqttClient::connect() {
     if (!m_mosquitto) {
         return false;
     }
     
-    int result = mosquitto_connect(m_mosquitto, m_host.c_str(), m_port, m_keep_alive);
+    int result;
+    if (m_mqtt5 && m_persistent_session) {
+        // 会话保留时间只能放在连接属性中，mosquitto 保存该属性供之后的重连沿用；只有阻塞连接接受属性
+        mosquitto_property* properties = nullptr;
+        mosquitto_property_add_int32(&properties, MQTT_PROP_SESSION_EXPIRY_INTERVAL, m_session_expiry);
+        result = mosquitto_connect_bind_v5(m_mosquitto, m_host.c_str(), m_port, m_keep_alive, nullptr, properties);
+        mosquitto_property_free_all(&properties);
+    } else if (m_reactor) {
+        // 反应器模式下不阻塞调用线程，连接在反应器线程中完成
+        result = mosquitto_connect_async(m_mosquitto, m_host.c_str(), m_port, m_keep_alive);
+    } else {
+        result = mosquitto_connect(m_mosquitto, m_host.c_str(), m_port, m_keep_alive);
+    }
     if (result != MOSQ_ERR_SUCCESS) {
         std::cerr << "Failed to connect to MQTT broker: " << mosquitto_strerror(result) << std::endl;
         return false;
     }
     
+    m_want_connection = true;
+    wakeNetworkLoop();
     return true;
 }
 
 void MqttClient::disconnect() {
+    m_want_connection = false;
     if (m_mosquitto && m_connected) {
         mosquitto_disconnect(m_mosquitto);
     }
 }
 
+bool MqttClient::setWill(const std::string& topic, const std::string& payload, int qos, bool retain) {
+    if (!m_mosquitto) {
+        return false;
+    }
+    
+    int result = mosquitto_will_set(m_mosquitto, topic.c_str(), static_cast<int>(payload.size()),
+                                    payload.data(), qos, retain);
+    if (result != MOSQ_ERR_SUCCESS) {
+        std::cerr << "Failed to set will message: " << mosquitto_strerror(result) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool MqttClient::setMqtt5(bool enable) {
+    if (!m_mosquitto) {
+        return false;
+    }
+    
+    int result = mosquitto_int_option(m_mosquitto, MOSQ_OPT_PROTOCOL_VERSION,
+                                      enable ? MQTT_PROTOCOL_V5 : MQTT_PROTOCOL_V311);
+    if (result != MOSQ_ERR_SUCCESS) {
+        std::cerr << "Failed to set MQTT protocol version: " << mosquitto_strerror(result) << std::endl;
+        return false;
+    }
+    
+    // mosquitto 会依次调用所有设置了的回调，两种形式只保留一种
+    mosquitto_connect_with_flags_callback_set(m_mosquitto, enable ? nullptr : onConnectWithFlags);
+    mosquitto_connect_v5_callback_set(m_mosquitto, enable ? onConnectV5 : nullptr);
+    mosquitto_message_callback_set(m_mosquitto, enable ? nullptr : onMessage);
+    mosquitto_message_v5_callback_set(m_mosquitto, enable ? onMessageV5 : nullptr);
+    m_mqtt5 = enable;
+    return true;
+}
+
+bool MqttClient::isMqtt5() const {
+    return m_mqtt5;
+}
+
+bool MqttClient::setPersistentSession(bool enable, uint32_t session_expiry) {
+    if (!m_mosquitto) {
+        return false;
+    }
+    if (m_running || m_want_connection) {
+        std::cerr << "Persistent session must be configured before connecting" << std::endl;
+        return false;
+    }
+    
+    // clean_session 只能在创建时指定，重新初始化实例后恢复其余配置
+    int result = mosquitto_reinitialise(m_mosquitto, m_client_id.c_str(), !enable, this);
+    if (result != MOSQ_ERR_SUCCESS) {
+        std::cerr << "Failed to reinitialise MQTT client: " << mosquitto_strerror(result) << std::endl;
+        return false;
+    }
+    m_persistent_session = enable;
+    m_session_expiry = enable ? session_expiry : 0;
+    m_session_present = false;
+    
+    installCallbacks();
+    if (m_mqtt5 && !setMqtt5(true)) {
+        return false;
+    }
+    if (m_ssl_config.enabled && !configureSsl(m_ssl_config)) {
+        return false;
+    }
+    if (m_auth_config.enabled && !configureAuth(m_auth_config)) {
+        return false;
+    }
+    return true;
+}
+
+bool MqttClient::isPersistentSession() const {
+    return m_persistent_session;
+}
+
+bool MqttClient::sessionPresent() const {
+    return m_session_present;
+}
+
 bool MqttClient::publish(const std::string& topic, 
                         const std::string& payload, 
                         int qos, 
                         bool retain) {
-    if (!m_mosquitto || !m_connected) {
+    if (!m_mosquitto) {
+        return false;
+    }
+    if (m_spool && (!m_connected || m_spool_backlog)) {
+        // 离线缓冲启用时进入异步发布队列，排在积压消息之后
+        return enqueuePublish(topic, payload, qos, retain, false, nullptr, nullptr);
+    }
+    if (!m_connected) {
+        return false;
+    }
+    
+    return sendPublish(nullptr, topic, payload, qos, retain, nullptr) == MOSQ_ERR_SUCCESS;
+}
+
+bool MqttClient::publish(const std::string& topic,
+                         const std::string& payload,
+                         int qos,
+                         bool retain,
+                         const PublishProperties& properties) {
+    if (!m_mosquitto) {
+        return false;
+    }
+    if (m_spool && (!m_connected || m_spool_backlog)) {
+        return enqueuePublish(topic, payload, qos, retain, false, &properties, nullptr);
+    }
+    if (!m_connected) {
         return false;
     }
     
-    int result = mosquitto_publish(m_mosquitto, nullptr, topic.c_str(), 
-                                  payload.length(), payload.c_str(), qos, retain);
+    return sendPublish(nullptr, topic, payload, qos, retain, &properties) == MOSQ_ERR_SUCCESS;
+}
+
+int MqttClient::sendPublish(int* mid, const std::string& topic, const std::string& payload, int qos, bool retain,
+                            const PublishProperties* properties) {
+    if (!m_mqtt5) {
+        return mosquitto_publish(m_mosquitto, mid, topic.c_str(), static_cast<int>(payload.size()),
+                                 payload.data(), qos, retain);
+    }
     
-    return result == MOSQ_ERR_SUCCESS;
+    mosquitto_property* list = nullptr;
+    if (properties) {
+        if (properties->message_expiry > 0) {
+            mosquitto_property_add_int32(&list, MQTT_PROP_MESSAGE_EXPIRY_INTERVAL, properties->message_expiry);
+        }
+        if (!properties->response_topic.empty()) {
+            mosquitto_property_add_string(&list, MQTT_PROP_RESPONSE_TOPIC, properties->response_topic.c_str());
+        }
+        if (!properties->correlation_data.empty() && properties->correlation_data.size() <= UINT16_MAX) {
+            mosquitto_property_add_binary(&list, MQTT_PROP_CORRELATION_DATA, properties->correlation_data.data(),
+                                          static_cast<uint16_t>(properties->correlation_data.size()));
+        }
+    }
+    
+    // 主题别名只用于 QoS 0：QoS 1/2 消息断线后由 mosquitto 在新连接上原样重发，而别名只在原连接内有效。
+    // 分配别名的首次发布（带完整主题）完成前持有锁，其他线程不会先于它只发送别名
+    const char* wire_topic = topic.c_str();
+    bool assigned = false;
+    std::unique_lock<std::mutex> alias_lock(m_alias_mutex, std::defer_lock);
+    if (qos == 0) {
+        alias_lock.lock();
+        auto it = m_topic_aliases.find(topic);
+        if (it != m_topic_aliases.end()) {
+            mosquitto_property_add_int16(&list, MQTT_PROP_TOPIC_ALIAS, it->second);
+            wire_topic = nullptr;
+            alias_lock.unlock();
+        } else if (m_topic_aliases.size() < m_topic_alias_limit) {
+            mosquitto_property_add_int16(&list, MQTT_PROP_TOPIC_ALIAS, static_cast<uint16_t>(m_topic_aliases.size() + 1));
+            assigned = true;
+        } else {
+            alias_lock.unlock();
+        }
+    }
+    
+    int result = mosquitto_publish_v5(m_mosquitto, mid, wire_topic, static_cast<int>(payload.size()),
+                                      payload.data(), qos, retain, list);
+    if (assigned && result == MOSQ_ERR_SUCCESS) {
+        m_topic_aliases.emplace(topic, static_cast<uint16_t>(m_topic_aliases.size() + 1));
+    }
+    mosquitto_property_free_all(&list);
+    return result;
+}
+
+void MqttClient::resetTopicAliases(uint16_t limit) {
+    std::lock_guard<std::mutex> lock(m_alias_mutex);
+    m_topic_aliases.clear();
+    m_topic_alias_limit = limit;
+}
+
+bool MqttClient::publishAsync(const std::string& topic,
+                              std::string payload,
+                              int qos,
+                              bool retain,
+                              bool latest_only,
+                              PublishCallback callback) {
+    return enqueuePublish(topic, std::move(payload), qos, retain, latest_only, nullptr, std::move(callback));
+}
+
+bool MqttClient::publishAsync(const std::string& topic,
+                              std::string payload,
+                              int qos,
+                              bool retain,
+                              const PublishProperties& properties,
+                              PublishCallback callback) {
+    return enqueuePublish(topic, std::move(payload), qos, retain, false, &properties, std::move(callback));
+}
+
+bool MqttClient::enqueuePublish(const std::string& topic, std::string payload, int qos, bool retain, bool latest_only,
+                                const PublishProperties* properties, PublishCallback callback) {
+    // 先占用容量，超出时退回
+    size_t depth = m_publish_depth.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (depth > m_publish_limit.load(std::memory_order_relaxed)) {
+        m_publish_depth.fetch_sub(1, std::memory_order_relaxed);
+        m_publish_rejected.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    size_t max_depth = m_publish_max_depth.load(std::memory_order_relaxed);
+    while (depth > max_depth &&
+           !m_publish_max_depth.compare_exchange_weak(max_depth, depth, std::memory_order_relaxed)) {
+    }
+    
+    auto node = std::make_unique<PendingPublish>();
+    node->topic = topic;
+    node->payload = std::move(payload);
+    node->qos = qos;
+    node->retain = retain;
+    node->latest_only = latest_only;
+    if (properties) {
+        node->properties = std::make_unique<PublishProperties>(*properties);
+    }
+    node->callback = std::move(callback);
+    
+    // 压入无锁栈；栈原本为空说明网络线程已取走之前的消息，需要唤醒它
+    PendingPublish* head = m_publish_head.load(std::memory_order_relaxed);
+    do {
+        node->next = head;
+    } while (!m_publish_head.compare_exchange_weak(head, node.get(), std::memory_order_release,
+                                                   std::memory_order_relaxed));
+    node.release();
+    m_publish_enqueued.fetch_add(1, std::memory_order_relaxed);
+    if (!head) {
+        wakeNetworkLoop();
+    }
+    return true;
+}
+
+void MqttClient::setPublishQueueLimit(size_t limit) {
+    m_publish_limit = limit;
+}
+
+PublishQueueStats MqttClient::publishQueueStats() const {
+    PublishQueueStats stats;
+    stats.depth = m_publish_depth.load(std::memory_order_relaxed);
+    stats.max_depth = m_publish_max_depth.load(std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(m_inflight_mutex);
+        stats.inflight = m_inflight_callbacks.size();
+    }
+    stats.enqueued = m_publish_enqueued.load(std::memory_order_relaxed);
+    stats.sent = m_publish_sent.load(std::memory_order_relaxed);
+    stats.coalesced = m_publish_coalesced.load(std::memory_order_relaxed);
+    stats.rejected = m_publish_rejected.load(std::memory_order_relaxed);
+    stats.failed = m_publish_failed.load(std::memory_order_relaxed);
+    stats.batches = m_publish_batches.load(std::memory_order_relaxed);
+    if (m_spool) {
+        stats.spool_depth = m_spool->size();
+        stats.spool_dropped = m_spool->dropped();
+    }
+    stats.spooled = m_publish_spooled.load(std::memory_order_relaxed);
+    stats.replayed = m_publish_replayed.load(std::memory_order_relaxed);
+    stats.stale = m_publish_stale.load(std::memory_order_relaxed);
+    return stats;
+}
+
+bool MqttClient::setOfflineBuffer(const std::string& path, size_t capacity_bytes, size_t memory_limit) {
+    if (m_running) {
+        std::cerr << "Offline buffer must be configured before starting the client" << std::endl;
+        return false;
+    }
+    
+    auto spool = std::make_unique<OfflineSpool>();
+    if (!spool->open(path, capacity_bytes)) {
+        return false;
+    }
+    if (spool->recovered() > 0) {
+        std::cout << "Recovered " << spool->recovered() << " unsent messages from offline buffer " << path << std::endl;
+    }
+    m_spool_backlog = !spool->empty();
+    m_spool = std::move(spool);
+    m_spool_threshold = memory_limit;
+    return true;
+}
+
+bool MqttClient::hasOfflineBuffer() const {
+    return m_spool != nullptr;
+}
+
+void MqttClient::setReplayRate(uint32_t messages_per_second) {
+    m_replay_rate = messages_per_second;
+}
+
+bool MqttClient::openWakePipe() {
+    if (m_wake_pipe[0] >= 0) {
+        return true;
+    }
+    if (pipe(m_wake_pipe) != 0) {
+        m_wake_pipe[0] = m_wake_pipe[1] = -1;
+        return false;
+    }
+    for (int fd : m_wake_pipe) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+    m_wake_fd.store(m_wake_pipe[1], std::memory_order_release);
+    return true;
+}
+
+void MqttClient::wakeNetworkLoop() {
+    if (m_reactor) {
+        m_reactor->wake(this);
+        return;
+    }
+    
+    // 管道已满说明网络线程尚未处理之前的唤醒，不需要再写；网络线程启动前不需要唤醒
+    char byte = 1;
+    int fd = m_wake_fd.load(std::memory_order_acquire);
+    if (fd >= 0 && write(fd, &byte, 1) < 0 && errno != EAGAIN) {
+        std::cerr << "Failed to wake MQTT network thread: " << std::strerror(errno) << std::endl;
+    }
+}
+
+void MqttClient::completePublish(const PublishCallback& callback, PublishResult result) {
+    if (!callback) {
+        return;
+    }
+    try {
+        callback(result);
+    } catch (const std::exception& e) {
+        std::cerr << "Error in publish completion callback: " << e.what() << std::endl;
+    }
+}
+
+void MqttClient::drainPublishQueue() {
+    // 整体取走入队栈，反转为入队顺序
+    PendingPublish* node = m_publish_head.exchange(nullptr, std::memory_order_acquire);
+    PendingPublish* ordered = nullptr;
+    while (node) {
+        PendingPublish* next = node->next;
+        node->next = ordered;
+        ordered = node;
+        node = next;
+    }
+    
+    while (ordered) {
+        std::unique_ptr<PendingPublish> entry(ordered);
+        ordered = ordered->next;
+        entry->next = nullptr;
+        
+        if (entry->latest_only) {
+            auto it = m_latest_pending.find(entry->topic);
+            if (it != m_latest_pending.end()) {
+                // 新值替换队列中的旧值，保留旧值的位置
+                PendingPublish* queued = it->second;
+                PublishCallback superseded = std::move(queued->callback);
+                queued->payload = std::move(entry->payload);
+                queued->qos = entry->qos;
+                queued->retain = entry->retain;
+                queued->callback = std::move(entry->callback);
+                m_publish_depth.fetch_sub(1, std::memory_order_relaxed);
+                m_publish_coalesced.fetch_add(1, std::memory_order_relaxed);
+                completePublish(superseded, PublishResult::COALESCED);
+                continue;
+            }
+            m_latest_pending.emplace(entry->topic, entry.get());
+        }
+        m_outbox.push_back(std::move(entry));
+    }
+}
+
+bool MqttClient::sendPendingPublishes() {
+    if (m_spool) {
+        // 离线缓冲中的消息早于待发送队列，重放完之前队列中的消息继续等待
+        spillPublishes(m_spool_threshold);
+        if (!m_spool->empty()) {
+            bool more = replaySpool();
+            if (!m_spool->empty()) {
+                return more;
+            }
+        }
+    }
+    if (m_outbox.empty() || !m_connected) {
+        return false;
+    }
+    
+    size_t count = 0;
+    while (!m_outbox.empty() && count < PUBLISH_BATCH_SIZE) {
+        PendingPublish& entry = *m_outbox.front();
+        int mid = 0;
+        int result = sendPublish(&mid, entry.topic, entry.payload, entry.qos, entry.retain, entry.properties.get());
+        if (result == MOSQ_ERR_NO_CONN || result == MOSQ_ERR_CONN_LOST || result == MOSQ_ERR_NOMEM) {
+            // 连接断开或暂时无法发送，消息留在队首，之后重试
+            break;
+        }
+        
+        if (entry.latest_only) {
+            m_latest_pending.erase(entry.topic);
+        }
+        m_publish_depth.fetch_sub(1, std::memory_order_relaxed);
+        ++count;
+        
+        if (result != MOSQ_ERR_SUCCESS) {
+            std::cerr << "Failed to publish to " << entry.topic << ": " << mosquitto_strerror(result) << std::endl;
+            m_publish_failed.fetch_add(1, std::memory_order_relaxed);
+            completePublish(entry.callback, PublishResult::FAILED);
+        } else {
+            m_publish_sent.fetch_add(1, std::memory_order_relaxed);
+            if (entry.qos == 0) {
+                completePublish(entry.callback, PublishResult::SENT);
+            } else if (entry.callback) {
+                // 确认由网络线程读取，必然在登记之后到达
+                std::lock_guard<std::mutex> lock(m_inflight_mutex);
+                m_inflight_callbacks[mid] = std::move(entry.callback);
+            }
+        }
+        m_outbox.pop_front();
+    }
+    
+    if (count > 0) {
+        m_publish_batches.fetch_add(1, std::memory_order_relaxed);
+    }
+    return count == PUBLISH_BATCH_SIZE && !m_outbox.empty() && m_connected;
+}
+
+void MqttClient::spillPublishes(size_t keep) {
+    OfflineSpool::Record record;
+    while (m_outbox.size() > keep) {
+        std::unique_ptr<PendingPublish> entry = std::move(m_outbox.front());
+        m_outbox.pop_front();
+        if (entry->latest_only) {
+            m_latest_pending.erase(entry->topic);
+        }
+        m_publish_depth.fetch_sub(1, std::memory_order_relaxed);
+        
+        record.topic = std::move(entry->topic);
+        record.payload = std::move(entry->payload);
+        record.qos = entry->qos;
+        record.retain = entry->retain;
+        record.latest_only = entry->latest_only;
+        record.has_properties = entry->properties != nullptr;
+        if (entry->properties) {
+            record.response_topic = std::move(entry->properties->response_topic);
+            record.correlation_data = std::move(entry->properties->correlation_data);
+            record.message_expiry = entry->properties->message_expiry;
+        }
+        if (m_spool->push(record)) {
+            m_publish_spooled.fetch_add(1, std::memory_order_relaxed);
+            m_spool_backlog = true;
+            completePublish(entry->callback, PublishResult::SPOOLED);
+        } else {
+            std::cerr << "Message to " << record.topic << " is too large for the offline buffer" << std::endl;
+            m_publish_failed.fetch_add(1, std::memory_order_relaxed);
+            completePublish(entry->callback, PublishResult::FAILED);
+        }
+    }
+}
+
+bool MqttClient::replaySpool() {
+    using Clock = std::chrono::steady_clock;
+    if (!m_connected) {
+        return false;
+    }
+    
+    // 按速率上限计算本批可重放的条数，空闲期间最多积累 REPLAY_BURST_MS 的额度
+    size_t budget = PUBLISH_BATCH_SIZE;
+    uint32_t rate = m_replay_rate.load(std::memory_order_relaxed);
+    std::chrono::nanoseconds interval(0);
+    if (rate > 0) {
+        Clock::time_point now = Clock::now();
+        interval = std::max(std::chrono::nanoseconds(1000000000 / rate), std::chrono::nanoseconds(1));
+        m_replay_due = std::max(m_replay_due, now - std::chrono::milliseconds(REPLAY_BURST_MS));
+        if (m_replay_due > now) {
+            return false;
+        }
+        budget = std::min(budget, static_cast<size_t>((now - m_replay_due) / interval) + 1);
+    }
+    
+    OfflineSpool::Record record;
+    PublishProperties properties;
+    size_t sent = 0;
+    size_t visited = 0;
+    bool blocked = false;
+    while (sent < budget && visited < PUBLISH_BATCH_SIZE && !m_spool->empty()) {
+        ++visited;
+        if (!m_spool->front(record)) {
+            m_spool->pop();
+            continue;
+        }
+        if (record.latest_only && (m_spool->frontSuperseded() || m_latest_pending.count(record.topic))) {
+            // 同一主题已有更新的值（缓冲中更晚的记录或待发送队列中的消息），旧值不再发送
+            m_spool->pop();
+            m_publish_stale.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        
+        if (record.has_properties) {
+            properties.response_topic = record.response_topic;
+            properties.correlation_data = record.correlation_data;
+            properties.message_expiry = record.message_expiry;
+        }
+        int result = sendPublish(nullptr, record.topic, record.payload, record.qos, record.retain,
+                                 record.has_properties ? &properties : nullptr);
+        if (result == MOSQ_ERR_NO_CONN || result == MOSQ_ERR_CONN_LOST || result == MOSQ_ERR_NOMEM) {
+            // 连接断开或暂时无法发送，消息留在缓冲中，之后重试
+            blocked = true;
+            break;
+        }
+        m_spool->pop();
+        ++sent;
+        if (result != MOSQ_ERR_SUCCESS) {
+            std::cerr << "Failed to replay message to " << record.topic << ": " << mosquitto_strerror(result) << std::endl;
+            m_publish_failed.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            m_publish_replayed.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    
+    if (sent > 0) {
+        m_publish_batches.fetch_add(1, std::memory_order_relaxed);
+        m_replay_due += interval * sent;
+    }
+    if (blocked && rate > 0) {
+        // 暂时无法发送时隔一个重放间隔再试，不空转
+        m_replay_due = std::max(m_replay_due, Clock::now() + interval);
+    }
+    if (m_spool->empty()) {
+        m_spool_backlog = false;
+        return false;
+    }
+    return !blocked && m_connected && (rate == 0 || m_replay_due <= Clock::now());
+}
+
+std::chrono::steady_clock::time_point MqttClient::replayDue() const {
+    if (!m_spool || m_spool->empty() || !m_connected || m_replay_rate.load(std::memory_order_relaxed) == 0) {
+        return std::chrono::steady_clock::time_point::max();
+    }
+    return m_replay_due;
+}
+
+bool MqttClient::servicePublishes() {
+    drainPublishQueue();
+    return sendPendingPublishes();
+}
+
+int MqttClient::serviceSocket(bool readable, bool writable) {
+    int result = MOSQ_ERR_SUCCESS;
+    if (readable) {
+        result = mosquitto_loop_read(m_mosquitto, 1);
+    }
+    if (result == MOSQ_ERR_SUCCESS && writable) {
+        result = mosquitto_loop_write(m_mosquitto, 1);
+    }
+    if (result == MOSQ_ERR_SUCCESS) {
+        result = mosquitto_loop_misc(m_mosquitto);
+    }
+    if (result != MOSQ_ERR_SUCCESS && m_running) {
+        std::cerr << "MQTT loop error: " << mosquitto_strerror(result) << std::endl;
+    }
+    return result;
+}
+
+std::chrono::steady_clock::time_point MqttClient::reconnectIfDue() {
+    using Clock = std::chrono::steady_clock;
+    if (!m_running || mosquitto_socket(m_mosquitto) >= 0 || (!m_auto_reconnect && !m_want_connection)) {
+        return Clock::time_point::max();
+    }
+    
+    auto now = Clock::now();
+    if (!m_reconnect_pending) {
+        // 刚发现断线：先随机等待一段时间，broker 恢复时各客户端不会同时重连
+        m_reconnect_pending = true;
+        m_reconnect_backoff.reset();
+        m_next_reconnect = now + m_reconnect_backoff.next();
+    }
+    if (now < m_next_reconnect) {
+        return m_next_reconnect;
+    }
+    
+    m_next_reconnect = now + m_reconnect_backoff.next();
+    std::cout << "Attempting to reconnect to MQTT broker..." << std::endl;
+    m_reconnect_attempts.fetch_add(1, std::memory_order_relaxed);
+    // 反应器模式下使用非阻塞重连，连接在反应器线程中完成
+    int result = m_reactor ? mosquitto_reconnect_async(m_mosquitto) : mosquitto_reconnect(m_mosquitto);
+    if (result != MOSQ_ERR_SUCCESS) {
+        std::cerr << "Reconnection failed: " << mosquitto_strerror(result) << std::endl;
+    }
+    return m_next_reconnect;
+}
+
+void MqttClient::flushPublishes() {
+    // 发出已入队的消息，并在1秒内尽量写出套接字缓冲
+    drainPublishQueue();
+    while (sendPendingPublishes()) {
+    }
+    if (m_spool) {
+        // 未能发出的消息写入离线缓冲，下次启动后重放
+        spillPublishes(0);
+    }
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (mosquitto_want_write(m_mosquitto) && std::chrono::steady_clock::now() < deadline) {
+        int sock = mosquitto_socket(m_mosquitto);
+        if (sock < 0) {
+            break;
+        }
+        struct pollfd fd = {sock, POLLOUT, 0};
+        if (poll(&fd, 1, 100) > 0 && mosquitto_loop_write(m_mosquitto, 1) != MOSQ_ERR_SUCCESS) {
+            break;
+        }
+    }
+}
+
+void MqttClient::networkLoop() {
+    while (m_running) {
+        bool more = servicePublishes();
+        
+        // 超时不超过1秒，保证保活按时处理；断线时最多等到下一次重连，限速重放时最多等到下一条可重放的时间
+        int timeout = more ? 0 : 1000;
+        auto replay_due = replayDue();
+        if (replay_due != std::chrono::steady_clock::time_point::max()) {
+            auto now = std::chrono::steady_clock::now();
+            if (replay_due < now + std::chrono::milliseconds(timeout)) {
+                timeout = replay_due <= now ? 0 : static_cast<int>(
+                    std::chrono::duration_cast<std::chrono::milliseconds>(replay_due - now).count()) + 1;
+            }
+        }
+        int sock = mosquitto_socket(m_mosquitto);
+        if (sock < 0) {
+            auto next_reconnect = reconnectIfDue();
+            sock = mosquitto_socket(m_mosquitto);
+            auto now = std::chrono::steady_clock::now();
+            if (sock < 0 && next_reconnect < now + std::chrono::milliseconds(timeout)) {
+                timeout = next_reconnect <= now ? 0 : static_cast<int>(
+                    std::chrono::duration_cast<std::chrono::milliseconds>(next_reconnect - now).count()) + 1;
+            }
+        }
+        struct pollfd fds[2];
+        fds[0] = {m_wake_pipe[0], POLLIN, 0};
+        nfds_t count = 1;
+        if (sock >= 0) {
+            short events = POLLIN;
+            if (mosquitto_want_write(m_mosquitto)) {
+                events |= POLLOUT;
+            }
+            fds[1] = {sock, events, 0};
+            count = 2;
+        }
+        
+        int ready = poll(fds, count, timeout);
+        if (ready < 0 && errno != EINTR) {
+            std::cerr << "MQTT poll error: " << std::strerror(errno) << std::endl;
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            continue;
+        }
+        if (ready > 0 && (fds[0].revents & POLLIN)) {
+            char buffer[64];
+            while (read(m_wake_pipe[0], buffer, sizeof(buffer)) > 0) {
+            }
+        }
+        
+        if (sock < 0) {
+            continue;
+        }
+        serviceSocket(fds[1].revents & (POLLIN | POLLHUP | POLLERR), fds[1].revents & POLLOUT);
+    }
+    
+    // 停止前发出已入队的消息
+    flushPublishes();
 }
 
 bool MqttClient::subscribe(const std::string& topic, int qos) {
@@ -246,14 +912,77 @@ bool MqttClient::unsubscribe(const std::string& topic) {
     return result == MOSQ_ERR_SUCCESS;
 }
 
-void MqttClient::setMessageCallback(MessageCallback callback) {
+template <typename Modify>
+bool MqttClient::updateHandlers(Modify&& modify) {
     std::lock_guard<std::mutex> lock(m_mutex);
-    m_message_callback = callback;
+    const HandlerSet* current = m_handler_set.get();
+    auto next = current ? std::make_unique<HandlerSet>(*current) : std::make_unique<HandlerSet>();
+    if (!modify(*next)) {
+        return false;
+    }
+    // 正在执行的分发可能仍持有旧集合，旧集合在没有读者时释放
+    m_handlers.store(next.get());
+    if (m_handler_set) {
+        std::lock_guard<std::mutex> retired_lock(m_retired_mutex);
+        m_retired_handlers.push_back(std::move(m_handler_set));
+        m_handlers_retired = true;
+    }
+    m_handler_set = std::move(next);
+    reclaimHandlers();
+    return true;
+}
+
+void MqttClient::releaseHandlers() {
+    if (m_handler_readers.fetch_sub(1) == 1 && m_handlers_retired.load(std::memory_order_relaxed)) {
+        reclaimHandlers();
+    }
+}
+
+void MqttClient::reclaimHandlers() {
+    std::vector<std::unique_ptr<const HandlerSet>> retired;
+    {
+        std::lock_guard<std::mutex> lock(m_retired_mutex);
+        // 旧集合都已从 m_handlers 摘下：此时读者数为0，之后登记的读者只会读到当前集合
+        if (m_handler_readers.load() != 0) {
+            return;
+        }
+        retired.swap(m_retired_handlers);
+        m_handlers_retired = false;
+    }
+}
+
+void MqttClient::setMessageCallback(MessageCallback callback) {
+    updateHandlers([&](HandlerSet& handlers) {
+        handlers.message_callback = std::move(callback);
+        return true;
+    });
+}
+
+void MqttClient::setMessageViewCallback(MessageViewCallback callback) {
+    updateHandlers([&](HandlerSet& handlers) {
+        handlers.message_view_callback = std::move(callback);
+        return true;
+    });
+}
+
+bool MqttClient::addRoute(const std::string& filter, TopicRouter::Handler handler) {
+    return updateHandlers([&](HandlerSet& handlers) {
+        return handlers.router.addRoute(filter, std::move(handler));
+    });
+}
+
+void MqttClient::clearRoutes() {
+    updateHandlers([](HandlerSet& handlers) {
+        handlers.router.clear();
+        return true;
+    });
 }
 
 void MqttClient::setConnectionCallback(ConnectionCallback callback) {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    m_connection_callback = callback;
+    updateHandlers([&](HandlerSet& handlers) {
+        handlers.connection_callback = std::move(callback);
+        return true;
+    });
 }
 
 void MqttClient::start() {
@@ -261,55 +990,62 @@ void MqttClient::start() {
         return;
     }
     
-    m_running = true;
-    
-    // 启动消息循环线程，使用mosquitto_loop_forever
-    m_loop_thread = std::thread([this]() {
-        while (m_running) {
-            int result = mosquitto_loop_forever(m_mosquitto, 1000, 1);
-            if (result != MOSQ_ERR_SUCCESS) {
-                std::cerr << "MQTT loop error: " << mosquitto_strerror(result) << std::endl;
-                if (!m_running) break;
-                std::this_thread::sleep_for(std::chrono::milliseconds(1000));
-            }
-        }
-    });
+    // 反应器模式：由反应器线程驱动套接字、保活和重连，不创建线程
+    if (m_reactor) {
+        m_running = true;
+        m_reactor->addClient(this);
+        return;
+    }
     
-    // 启动重连线程（如果启用自动重连）
-    if (m_auto_reconnect) {
-        m_reconnect_thread = std::thread(&MqttClient::reconnectLoop, this);
+    if (!openWakePipe()) {
+        std::cerr << "Failed to create MQTT wakeup pipe: " << std::strerror(errno) << std::endl;
+        return;
     }
+    m_running = true;
+    
+    // 启动网络线程，驱动套接字读写、保活、断线重连并发出异步发布的消息
+    m_loop_thread = std::thread(&MqttClient::networkLoop, this);
 }
 
 void MqttClient::stop() {
     m_running = false;
     m_auto_reconnect = false;
     
-    disconnect();
-    
-    // 等待线程结束
-    if (m_loop_thread.joinable()) {
-        m_loop_thread.join();
+    if (m_reactor) {
+        // 从反应器移除后由当前线程发出已入队的消息
+        if (m_reactor->removeClient(this)) {
+            flushPublishes();
+        }
+    } else {
+        // 网络线程退出前发出已入队的消息，之后再断开连接
+        wakeNetworkLoop();
+        if (m_loop_thread.joinable()) {
+            m_loop_thread.join();
+        }
     }
     
-    if (m_reconnect_thread.joinable()) {
-        m_reconnect_thread.join();
-    }
+    disconnect();
 }
 
 bool MqttClient::isConnected() const {
     return m_connected;
 }
 
+uint64_t MqttClient::reconnectAttempts() const {
+    return m_reconnect_attempts.load(std::memory_order_relaxed);
+}
+
 void MqttClient::setAutoReconnect(bool enable, int retry_interval) {
     m_auto_reconnect = enable;
-    m_retry_interval = retry_interval;
-    
-    if (enable && m_running && !m_reconnect_thread.joinable()) {
-        m_reconnect_thread = std::thread(&MqttClient::reconnectLoop, this);
+    if (retry_interval > 0) {
+        m_reconnect_backoff.setLimits(retry_interval * 1000, m_reconnect_backoff.maxMs());
     }
 }
 
+void MqttClient::setReconnectBackoff(int initial_ms, int max_ms) {
+    m_reconnect_backoff.setLimits(initial_ms, max_ms);
+}
+
 // 静态回调函数实现
 void MqttClient::onConnect(struct mosquitto* mosq, void* userdata, int result) {
     MqttClient* client = static_cast<MqttClient*>(userdata);
@@ -318,16 +1054,43 @@ void MqttClient::onConnect(struct mosquitto* mosq, void* userdata, int result) {
     client->m_connected = (result == 0);
     
     if (result == 0) {
+        // 连接成功后退避复位，下次断线重新从初始间隔开始
+        client->m_reconnect_pending = false;
         std::cout << "Connected to MQTT broker successfully" << std::endl;
     } else {
         std::cerr << "Failed to connect to MQTT broker: " << mosquitto_connack_string(result) << std::endl;
     }
     
-    // 调用连接状态回调
-    std::lock_guard<std::mutex> lock(client->m_mutex);
-    if (client->m_connection_callback) {
-        client->m_connection_callback(client->m_connected);
+    // 调用连接状态回调（无锁读取当前处理函数集合）
+    HandlerReader reader(*client);
+    const HandlerSet* handlers = reader.get();
+    if (handlers && handlers->connection_callback) {
+        handlers->connection_callback(client->m_connected);
+    }
+}
+
+void MqttClient::onConnectWithFlags(struct mosquitto* mosq, void* userdata, int result, int flags) {
+    MqttClient* client = static_cast<MqttClient*>(userdata);
+    if (!client) return;
+    
+    // 连接确认标志的最低位为会话存在标志，须在连接状态回调之前更新
+    client->m_session_present = result == 0 && (flags & 0x01);
+    onConnect(mosq, userdata, result);
+}
+
+void MqttClient::onConnectV5(struct mosquitto* mosq, void* userdata, int result, int flags,
+                             const mosquitto_property* properties) {
+    MqttClient* client = static_cast<MqttClient*>(userdata);
+    if (!client) return;
+    
+    client->m_session_present = result == 0 && (flags & 0x01);
+    // 别名只在本次连接内有效；broker 未声明上限时不使用别名
+    uint16_t alias_limit = 0;
+    if (result == 0) {
+        mosquitto_property_read_int16(properties, MQTT_PROP_TOPIC_ALIAS_MAXIMUM, &alias_limit, false);
     }
+    client->resetTopicAliases(alias_limit);
+    onConnect(mosq, userdata, result);
 }
 
 void MqttClient::onDisconnect(struct mosquitto* mosq, void* userdata, int result) {
@@ -335,6 +1098,9 @@ void MqttClient::onDisconnect(struct mosquitto* mosq, void* userdata, int result
     if (!client) return;
     
     client->m_connected = false;
+    if (client->m_mqtt5) {
+        client->resetTopicAliases(0);
+    }
     
     if (result == 0) {
         std::cout << "Disconnected from MQTT broker" << std::endl;
@@ -342,10 +1108,11 @@ void MqttClient::onDisconnect(struct mosquitto* mosq, void* userdata, int result
         std::cerr << "Unexpected disconnection from MQTT broker: " << mosquitto_strerror(result) << std::endl;
     }
     
-    // 调用连接状态回调
-    std::lock_guard<std::mutex> lock(client->m_mutex);
-    if (client->m_connection_callback) {
-        client->m_connection_callback(false);
+    // 调用连接状态回调（无锁读取当前处理函数集合）
+    HandlerReader reader(*client);
+    const HandlerSet* handlers = reader.get();
+    if (handlers && handlers->connection_callback) {
+        handlers->connection_callback(false);
     }
 }
 
@@ -353,13 +1120,68 @@ void MqttClient::onMessage(struct mosquitto* mosq, void* userdata, const struct
     MqttClient* client = static_cast<MqttClient*>(userdata);
     if (!client || !message) return;
     
-    std::string topic(message->topic);
-    std::string payload(static_cast<const char*>(message->payload), message->payloadlen);
+    // 主题和内容直接引用 mosquitto 的缓冲区，回调返回后由 mosquitto 释放
+    MessageView view;
+    view.topic = message->topic;
+    if (message->payload && message->payloadlen > 0) {
+        view.payload = std::string_view(static_cast<const char*>(message->payload), message->payloadlen);
+    }
+    view.qos = message->qos;
+    view.retain = message->retain;
+    view.mid = message->mid;
+    client->dispatchMessage(view);
+}
+
+void MqttClient::onMessageV5(struct mosquitto*, void* userdata, const struct mosquitto_message* message,
+                             const mosquitto_property* properties) {
+    MqttClient* client = static_cast<MqttClient*>(userdata);
+    if (!client || !message) return;
+    
+    MessageView view;
+    view.topic = message->topic;
+    if (message->payload && message->payloadlen > 0) {
+        view.payload = std::string_view(static_cast<const char*>(message->payload), message->payloadlen);
+    }
+    view.qos = message->qos;
+    view.retain = message->retain;
+    view.mid = message->mid;
+    
+    // mosquitto 读取属性时复制一份，分发结束后释放
+    char* response_topic = nullptr;
+    void* correlation_data = nullptr;
+    uint16_t correlation_length = 0;
+    if (mosquitto_property_read_string(properties, MQTT_PROP_RESPONSE_TOPIC, &response_topic, false) && response_topic) {
+        view.response_topic = response_topic;
+    }
+    if (mosquitto_property_read_binary(properties, MQTT_PROP_CORRELATION_DATA, &correlation_data, &correlation_length,
+                                       false) && correlation_data) {
+        view.correlation_data = std::string_view(static_cast<const char*>(correlation_data), correlation_length);
+    }
     
-    // 调用消息回调
-    std::lock_guard<std::mutex> lock(client->m_mutex);
-    if (client->m_message_callback) {
-        client->m_message_callback(topic, payload);
+    client->dispatchMessage(view);
+    free(response_topic);
+    free(correlation_data);
+}
+
+void MqttClient::dispatchMessage(const MessageView& view) {
+    // 无锁读取当前处理函数集合，处理函数执行期间注册的路由和回调从下一条消息开始生效
+    HandlerReader reader(*this);
+    const HandlerSet* handlers = reader.get();
+    if (!handlers) {
+        return;
+    }
+    
+    try {
+        // 优先按主题路由分发，未匹配时调用消息回调；只有复制形式的回调才复制消息
+        if (handlers->router.dispatch(view) == 0) {
+            if (handlers->message_view_callback) {
+                handlers->message_view_callback(view);
+            } else if (handlers->message_callback) {
+                handlers->message_callback(std::string(view.topic), std::string(view.payload));
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error handling message on " << view.topic << ": " << e.what() << std::endl;
     }
 }
 
@@ -372,28 +1194,21 @@ void MqttClient::onUnsubscribe(struct mosquitto* mosq, void* userdata, int mid)
 }
 
 void MqttClient::onPublish(struct mosquitto* mosq, void* userdata, int mid) {
-    // 消息发布成功（可选择记录日志）
-}
-
-void MqttClient::reconnectLoop() {
-    while (m_auto_reconnect && m_running) {
-        if (!m_connected) {
-            std::cout << "Attempting to reconnect to MQTT broker..." << std::endl;
-            
-            int result = mosquitto_reconnect(m_mosquitto);
-            if (result == MOSQ_ERR_SUCCESS) {
-                std::cout << "Reconnection initiated" << std::endl;
-            } else {
-                std::cerr << "Reconnection failed: " << mosquitto_strerror(result) << std::endl;
-            }
+    MqttClient* client = static_cast<MqttClient*>(userdata);
+    if (!client) return;
+    
+    // QoS 1/2 的异步发布收到确认；QoS 0 和同步发布没有登记回调
+    PublishCallback callback;
+    {
+        std::lock_guard<std::mutex> lock(client->m_inflight_mutex);
+        auto it = client->m_inflight_callbacks.find(mid);
+        if (it == client->m_inflight_callbacks.end()) {
+            return;
         }
-        
-        // 等待重连间隔
-        std::unique_lock<std::mutex> lock(m_mutex);
-        m_cv.wait_for(lock, std::chrono::seconds(m_retry_interval), [this]() {
-            return !m_auto_reconnect || !m_running;
-        });
+        callback = std::move(it->second);
+        client->m_inflight_callbacks.erase(it);
     }
+    completePublish(callback, PublishResult::SENT);
 }
 
 // 静态密码回调函数
@@ -517,4 +1332,16 @@ bool MqttClient::configureAuth(const AuthConfig& auth_config) {
 
 const AuthConfig& MqttClient::getAuthConfig() const {
     return m_auth_config;
+}
+
+void MqttClient::setReactor(MqttReactor* reactor) {
+    if (m_running) {
+        std::cerr << "Cannot change the reactor of a running MQTT client" << std::endl;
+        return;
+    }
+    m_reactor = reactor;
+}
+
+MqttReactor* MqttClient::getReactor() const {
+    return m_reactor;
 }
\ No newline at end of file
@@ -0,0 +1,630 @@
+#include "mqtt_reactor.h"
+#include "mqtt_client.h"
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#else
+#include <poll.h>
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// 套接字就绪事件，tag 为空表示唤醒管道
+struct PollEvent {
+    void* tag;
+    bool readable;
+    bool writable;
+};
+
+// 套接字事件等待：Linux使用epoll，等待开销与套接字数量无关；其他平台退回 poll
+class Poller {
+public:
+#ifdef __linux__
+    Poller() : m_epoll_fd(epoll_create1(EPOLL_CLOEXEC)) {}
+
+    ~Poller() {
+        if (m_epoll_fd >= 0) {
+            close(m_epoll_fd);
+        }
+    }
+
+    bool valid() const { return m_epoll_fd >= 0; }
+
+    void set(int fd, void* tag, bool want_write) {
+        struct epoll_event event = {};
+        event.events = want_write ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+        event.data.ptr = tag;
+        // 已关闭的套接字会被内核自动移出，号码复用时按实际状态改用 ADD 或 MOD
+        bool registered = m_registered.count(fd) > 0;
+        int result = epoll_ctl(m_epoll_fd, registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &event);
+        if (result != 0 && (errno == ENOENT || errno == EEXIST)) {
+            result = epoll_ctl(m_epoll_fd, errno == ENOENT ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd, &event);
+        }
+        if (result != 0) {
+            std::cerr << "Failed to register socket " << fd << " with epoll: " << std::strerror(errno) << std::endl;
+            return;
+        }
+        m_registered.insert(fd);
+    }
+
+    void remove(int fd) {
+        // 套接字可能已被关闭，忽略错误
+        epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+        m_registered.erase(fd);
+    }
+
+    int wait(std::vector<PollEvent>& events, int timeout_ms) {
+        events.clear();
+        m_buffer.resize(std::max<size_t>(64, std::min<size_t>(m_registered.size(), 1024)));
+        int count = epoll_wait(m_epoll_fd, m_buffer.data(), static_cast<int>(m_buffer.size()), timeout_ms);
+        for (int i = 0; i < count; ++i) {
+            uint32_t flags = m_buffer[i].events;
+            events.push_back(PollEvent{m_buffer[i].data.ptr, (flags & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0,
+                                       (flags & EPOLLOUT) != 0});
+        }
+        return count;
+    }
+
+private:
+    int m_epoll_fd;
+    std::unordered_set<int> m_registered;
+    std::vector<struct epoll_event> m_buffer;
+#else
+    bool valid() const { return true; }
+
+    void set(int fd, void* tag, bool want_write) {
+        m_fds[fd] = std::make_pair(tag, static_cast<short>(POLLIN | (want_write ? POLLOUT : 0)));
+    }
+
+    void remove(int fd) {
+        m_fds.erase(fd);
+    }
+
+    int wait(std::vector<PollEvent>& events, int timeout_ms) {
+        events.clear();
+        m_buffer.clear();
+        m_tags.clear();
+        for (const auto& pair : m_fds) {
+            m_buffer.push_back(pollfd{pair.first, pair.second.second, 0});
+            m_tags.push_back(pair.second.first);
+        }
+        int count = poll(m_buffer.data(), m_buffer.size(), timeout_ms);
+        for (size_t i = 0; count > 0 && i < m_buffer.size(); ++i) {
+            short flags = m_buffer[i].revents;
+            if (flags != 0) {
+                events.push_back(PollEvent{m_tags[i], (flags & (POLLIN | POLLHUP | POLLERR | POLLNVAL)) != 0,
+                                           (flags & POLLOUT) != 0});
+            }
+        }
+        return count;
+    }
+
+private:
+    std::unordered_map<int, std::pair<void*, short>> m_fds;
+    std::vector<struct pollfd> m_buffer;
+    std::vector<void*> m_tags;
+#endif
+};
+
+} // namespace
+
+// 反应器中的客户端（仅所属反应器线程访问）
+struct MqttReactor::Entry {
+    MqttClient* client;
+    int fd = -1;                        // 已注册的套接字
+    bool want_write = false;            // 已注册写事件
+    bool busy = false;                  // 一批未发完，下一轮继续发送
+    bool removed = false;               // 已在反应器线程中移除，等待下一轮释放
+    Clock::time_point wakeup_due;       // 已排入唤醒队列的时间（重连或限速重放）
+};
+
+struct alignas(64) MqttReactor::Loop {
+    // 周期定时器
+    struct Timer {
+        std::chrono::milliseconds interval;
+        TimerCallback callback;
+        Clock::time_point due;
+    };
+    using TimerSlot = std::pair<Clock::time_point, uint64_t>;
+    using WakeupSlot = std::pair<Clock::time_point, MqttClient*>;
+
+    // 其他线程提交的变更（由互斥锁保护）
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<MqttClient*> added;                 // 待加入的客户端
+    std::vector<MqttClient*> removed;               // 待移除的客户端
+    std::vector<MqttClient*> ready;                 // 有待发送异步发布消息的客户端
+    std::vector<std::pair<uint64_t, Timer>> new_timers; // 待添加的定时器
+    std::unordered_set<uint64_t> cancelled_timers;  // 已取消的定时器
+    uint64_t running_timer = 0;                     // 正在执行回调的定时器
+    uint64_t generation = 0;                        // 已处理的变更批次
+    bool running = false;
+    bool stopping = false;
+    std::thread thread;
+
+    Poller poller;
+    int wake_pipe[2] = {-1, -1};                    // 唤醒管道（读端, 写端）
+    std::atomic<size_t> client_count{0};
+
+    // 以下仅反应器线程访问
+    std::unordered_map<MqttClient*, std::unique_ptr<Entry>> clients;
+    std::unordered_map<int, Entry*> fd_owner;       // 已注册套接字的所属客户端
+    std::vector<Entry*> busy;                       // 一批未发完的客户端
+    std::unordered_map<uint64_t, Timer> timers;
+    std::priority_queue<TimerSlot, std::vector<TimerSlot>, std::greater<TimerSlot>> timer_queue;
+    std::priority_queue<WakeupSlot, std::vector<WakeupSlot>, std::greater<WakeupSlot>> wakeup_queue;
+
+    ~Loop() {
+        for (int fd : wake_pipe) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+    }
+
+    void wake() {
+        char byte = 1;
+        if (wake_pipe[1] >= 0 && write(wake_pipe[1], &byte, 1) < 0 && errno != EAGAIN) {
+            std::cerr << "Failed to wake MQTT reactor thread: " << std::strerror(errno) << std::endl;
+        }
+    }
+
+    bool inThread() const {
+        return thread.get_id() == std::this_thread::get_id();
+    }
+};
+
+MqttReactor::MqttReactor(size_t thread_count) {
+    for (size_t i = 0; i < std::max<size_t>(thread_count, 1); ++i) {
+        m_loops.push_back(std::make_unique<Loop>());
+    }
+}
+
+MqttReactor::~MqttReactor() {
+    stop();
+}
+
+bool MqttReactor::start() {
+    for (auto& loop_ptr : m_loops) {
+        Loop& loop = *loop_ptr;
+        if (loop.thread.joinable()) {
+            continue;
+        }
+        if (!loop.poller.valid()) {
+            std::cerr << "Failed to create reactor poller: " << std::strerror(errno) << std::endl;
+            stop();
+            return false;
+        }
+        if (loop.wake_pipe[0] < 0) {
+            if (pipe(loop.wake_pipe) != 0) {
+                std::cerr << "Failed to create reactor wakeup pipe: " << std::strerror(errno) << std::endl;
+                loop.wake_pipe[0] = loop.wake_pipe[1] = -1;
+                stop();
+                return false;
+            }
+            for (int fd : loop.wake_pipe) {
+                fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+                fcntl(fd, F_SETFD, FD_CLOEXEC);
+            }
+            loop.poller.set(loop.wake_pipe[0], nullptr, false);
+        }
+        {
+            std::lock_guard<std::mutex> lock(loop.mutex);
+            loop.running = true;
+            loop.stopping = false;
+        }
+        loop.thread = std::thread(&MqttReactor::loopMain, this, std::ref(loop));
+    }
+    return true;
+}
+
+void MqttReactor::stop() {
+    for (auto& loop_ptr : m_loops) {
+        Loop& loop = *loop_ptr;
+        {
+            std::lock_guard<std::mutex> lock(loop.mutex);
+            loop.stopping = true;
+        }
+        loop.wake();
+        if (loop.thread.joinable()) {
+            loop.thread.join();
+        }
+    }
+}
+
+size_t MqttReactor::clientCount() const {
+    size_t count = 0;
+    for (const auto& loop : m_loops) {
+        count += loop->client_count.load(std::memory_order_relaxed);
+    }
+    return count;
+}
+
+uint64_t MqttReactor::addTimer(std::chrono::milliseconds interval, TimerCallback callback) {
+    uint64_t id = m_next_timer.fetch_add(1, std::memory_order_relaxed);
+    Loop& loop = *m_loops[id % m_loops.size()];
+    interval = std::max(interval, std::chrono::milliseconds(1));
+    {
+        std::lock_guard<std::mutex> lock(loop.mutex);
+        loop.new_timers.emplace_back(id, Loop::Timer{interval, std::move(callback), Clock::now() + interval});
+    }
+    loop.wake();
+    return id;
+}
+
+void MqttReactor::cancelTimer(uint64_t id) {
+    if (id == 0) {
+        return;
+    }
+    Loop& loop = *m_loops[id % m_loops.size()];
+    std::unique_lock<std::mutex> lock(loop.mutex);
+    loop.cancelled_timers.insert(id);
+    if (!loop.inThread()) {
+        loop.cv.wait(lock, [&]() { return loop.running_timer != id; });
+    }
+}
+
+void MqttReactor::addClient(MqttClient* client) {
+    size_t index = m_next_loop.fetch_add(1, std::memory_order_relaxed) % m_loops.size();
+    Loop& loop = *m_loops[index];
+    {
+        std::lock_guard<std::mutex> lock(loop.mutex);
+        client->m_reactor_loop.store(static_cast<int>(index), std::memory_order_release);
+        loop.added.push_back(client);
+    }
+    loop.client_count.fetch_add(1, std::memory_order_relaxed);
+    loop.wake();
+}
+
+bool MqttReactor::removeClient(MqttClient* client) {
+    int index = client->m_reactor_loop.load(std::memory_order_acquire);
+    if (index < 0) {
+        return false;
+    }
+    Loop& loop = *m_loops[index];
+    std::unique_lock<std::mutex> lock(loop.mutex);
+    client->m_reactor_loop.store(-1, std::memory_order_release);
+    loop.client_count.fetch_sub(1, std::memory_order_relaxed);
+    loop.ready.erase(std::remove(loop.ready.begin(), loop.ready.end(), client), loop.ready.end());
+
+    // 尚未被反应器线程接收
+    auto pending = std::find(loop.added.begin(), loop.added.end(), client);
+    if (pending != loop.added.end()) {
+        loop.added.erase(pending);
+        return true;
+    }
+
+    if (!loop.running) {
+        // 线程未运行，直接移除
+        auto it = loop.clients.find(client);
+        if (it != loop.clients.end()) {
+            if (it->second->fd >= 0) {
+                loop.poller.remove(it->second->fd);
+                loop.fd_owner.erase(it->second->fd);
+            }
+            loop.clients.erase(it);
+        }
+        return true;
+    }
+
+    if (loop.inThread()) {
+        // 在客户端回调或定时器中停止客户端：立即注销套接字，下一轮释放
+        auto it = loop.clients.find(client);
+        if (it != loop.clients.end()) {
+            it->second->removed = true;
+            syncEntry(loop, *it->second);
+        }
+        loop.removed.push_back(client);
+        return true;
+    }
+
+    // 等待反应器线程处理完本次移除，之后不再访问该客户端
+    loop.removed.push_back(client);
+    uint64_t target = loop.generation + 1;
+    lock.unlock();
+    loop.wake();
+    lock.lock();
+    loop.cv.wait(lock, [&]() { return loop.generation >= target || !loop.running; });
+    if (!loop.running) {
+        auto it = loop.clients.find(client);
+        if (it != loop.clients.end()) {
+            if (it->second->fd >= 0) {
+                loop.poller.remove(it->second->fd);
+                loop.fd_owner.erase(it->second->fd);
+            }
+            loop.clients.erase(it);
+        }
+    }
+    return true;
+}
+
+void MqttReactor::wake(MqttClient* client) {
+    int index = client->m_reactor_loop.load(std::memory_order_acquire);
+    if (index < 0) {
+        return;
+    }
+    Loop& loop = *m_loops[index];
+    bool notify;
+    {
+        std::lock_guard<std::mutex> lock(loop.mutex);
+        // 重新确认客户端仍在该线程中，避免把已移除的客户端加入就绪列表
+        if (client->m_reactor_loop.load(std::memory_order_relaxed) != index) {
+            return;
+        }
+        notify = loop.ready.empty();
+        loop.ready.push_back(client);
+    }
+    if (notify) {
+        loop.wake();
+    }
+}
+
+bool MqttReactor::processCommands(Loop& loop, std::vector<Entry*>& service) {
+    std::lock_guard<std::mutex> lock(loop.mutex);
+    if (loop.stopping) {
+        return true;
+    }
+
+    for (MqttClient* client : loop.removed) {
+        auto it = loop.clients.find(client);
+        if (it != loop.clients.end()) {
+            it->second->removed = true;
+            syncEntry(loop, *it->second);
+            loop.busy.erase(std::remove(loop.busy.begin(), loop.busy.end(), it->second.get()), loop.busy.end());
+            loop.clients.erase(it);
+        }
+    }
+    loop.removed.clear();
+
+    // 新加入的客户端发出加入前入队的消息并注册套接字
+    for (MqttClient* client : loop.added) {
+        auto entry = std::make_unique<Entry>();
+        entry->client = client;
+        service.push_back(entry.get());
+        loop.clients[client] = std::move(entry);
+    }
+    loop.added.clear();
+
+    for (MqttClient* client : loop.ready) {
+        auto it = loop.clients.find(client);
+        if (it != loop.clients.end()) {
+            service.push_back(it->second.get());
+        }
+    }
+    loop.ready.clear();
+
+    for (auto& pair : loop.new_timers) {
+        loop.timer_queue.emplace(pair.second.due, pair.first);
+        loop.timers.emplace(pair.first, std::move(pair.second));
+    }
+    loop.new_timers.clear();
+    for (uint64_t id : loop.cancelled_timers) {
+        loop.timers.erase(id);
+    }
+    loop.cancelled_timers.clear();
+
+    ++loop.generation;
+    loop.cv.notify_all();
+    return false;
+}
+
+void MqttReactor::syncEntry(Loop& loop, Entry& entry) {
+    int fd = entry.removed ? -1 : mosquitto_socket(entry.client->m_mosquitto);
+    bool want_write = fd >= 0 && mosquitto_want_write(entry.client->m_mosquitto);
+    if (fd == entry.fd && want_write == entry.want_write) {
+        return;
+    }
+
+    // 套接字变化（断线或重连）：注销旧套接字，除非号码已被其他客户端的新套接字复用
+    if (entry.fd >= 0 && fd != entry.fd) {
+        auto it = loop.fd_owner.find(entry.fd);
+        if (it != loop.fd_owner.end() && it->second == &entry) {
+            loop.poller.remove(entry.fd);
+            loop.fd_owner.erase(it);
+        }
+    }
+    if (fd >= 0) {
+        Entry*& owner = loop.fd_owner[fd];
+        if (owner && owner != &entry) {
+            // 原所属客户端的套接字已关闭，号码被复用
+            owner->fd = -1;
+        }
+        owner = &entry;
+        loop.poller.set(fd, &entry, want_write);
+    }
+    entry.fd = fd;
+    entry.want_write = want_write;
+}
+
+void MqttReactor::serviceEntry(Loop& loop, Entry& entry) {
+    if (entry.removed) {
+        return;
+    }
+    bool more = entry.client->servicePublishes();
+    if (entry.removed) {
+        return;
+    }
+    syncEntry(loop, entry);
+    if (more && !entry.busy) {
+        entry.busy = true;
+        loop.busy.push_back(&entry);
+    }
+    // 离线缓冲重放受速率限制时，到下一条可重放的时间再处理（仍有可立即发送的消息时下一轮继续）
+    if (!entry.busy) {
+        scheduleEntry(loop, entry, entry.client->replayDue());
+    }
+}
+
+void MqttReactor::scheduleEntry(Loop& loop, Entry& entry, Clock::time_point due) {
+    if (!entry.removed && due != Clock::time_point::max() && due != entry.wakeup_due) {
+        entry.wakeup_due = due;
+        loop.wakeup_queue.emplace(due, entry.client);
+    }
+}
+
+void MqttReactor::reconnectEntry(Loop& loop, Entry& entry) {
+    Clock::time_point due = entry.client->reconnectIfDue();
+    serviceEntry(loop, entry);
+    // 仍未连接时按客户端的退避时间排入唤醒队列，不必等到下一次每秒检查
+    if (entry.fd < 0) {
+        scheduleEntry(loop, entry, due);
+    }
+}
+
+void MqttReactor::runWakeups(Loop& loop) {
+    Clock::time_point now = Clock::now();
+    while (!loop.wakeup_queue.empty() && loop.wakeup_queue.top().first <= now) {
+        Loop::WakeupSlot slot = loop.wakeup_queue.top();
+        loop.wakeup_queue.pop();
+        auto it = loop.clients.find(slot.second);
+        if (it == loop.clients.end() || it->second->removed || it->second->wakeup_due != slot.first) {
+            continue;
+        }
+        Entry& entry = *it->second;
+        entry.wakeup_due = Clock::time_point();
+        if (entry.fd < 0) {
+            reconnectEntry(loop, entry);
+        } else {
+            serviceEntry(loop, entry);
+        }
+    }
+}
+
+void MqttReactor::runTimers(Loop& loop) {
+    Clock::time_point now = Clock::now();
+    while (!loop.timer_queue.empty() && loop.timer_queue.top().first <= now) {
+        Loop::TimerSlot slot = loop.timer_queue.top();
+        loop.timer_queue.pop();
+        auto it = loop.timers.find(slot.second);
+        if (it == loop.timers.end() || it->second.due != slot.first) {
+            continue;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(loop.mutex);
+            if (loop.cancelled_timers.count(slot.second)) {
+                continue;
+            }
+            loop.running_timer = slot.second;
+        }
+        try {
+            it->second.callback();
+        } catch (const std::exception& e) {
+            std::cerr << "Error in reactor timer: " << e.what() << std::endl;
+        }
+        {
+            std::lock_guard<std::mutex> lock(loop.mutex);
+            loop.running_timer = 0;
+            loop.cv.notify_all();
+        }
+
+        // 按周期排下一次；回调耗时超过周期时跳过错过的触发
+        Loop::Timer& timer = it->second;
+        timer.due += timer.interval;
+        if (timer.due <= now) {
+            timer.due = now + timer.interval;
+        }
+        loop.timer_queue.emplace(timer.due, slot.second);
+    }
+}
+
+void MqttReactor::loopMain(Loop& loop) {
+    std::vector<PollEvent> events;
+    std::vector<Entry*> service;
+    Clock::time_point next_tick = Clock::now() + std::chrono::milliseconds(TICK_INTERVAL_MS);
+
+    while (true) {
+        service.clear();
+        if (processCommands(loop, service)) {
+            break;
+        }
+
+        // 就绪和上一轮未发完的客户端发出异步发布消息
+        std::vector<Entry*> busy;
+        busy.swap(loop.busy);
+        for (Entry* entry : busy) {
+            entry->busy = false;
+            service.push_back(entry);
+        }
+        for (Entry* entry : service) {
+            serviceEntry(loop, *entry);
+        }
+
+        // 等待到下一次保活检查或定时器到期
+        Clock::time_point now = Clock::now();
+        Clock::time_point deadline = next_tick;
+        if (!loop.timer_queue.empty()) {
+            deadline = std::min(deadline, loop.timer_queue.top().first);
+        }
+        if (!loop.wakeup_queue.empty()) {
+            deadline = std::min(deadline, loop.wakeup_queue.top().first);
+        }
+        int timeout = 0;
+        if (loop.busy.empty() && deadline > now) {
+            timeout = static_cast<int>(
+                std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count()) + 1;
+        }
+        if (loop.poller.wait(events, timeout) < 0 && errno != EINTR) {
+            std::cerr << "MQTT reactor poll error: " << std::strerror(errno) << std::endl;
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+
+        for (const PollEvent& event : events) {
+            if (!event.tag) {
+                char buffer[256];
+                while (read(loop.wake_pipe[0], buffer, sizeof(buffer)) > 0) {
+                }
+                continue;
+            }
+            Entry& entry = *static_cast<Entry*>(event.tag);
+            if (entry.removed || entry.fd < 0) {
+                continue;
+            }
+            entry.client->serviceSocket(event.readable, event.writable);
+            serviceEntry(loop, entry);
+            // 连接断开时立即排定重连，不必等到下一次每秒检查
+            if (!entry.removed && entry.fd < 0) {
+                reconnectEntry(loop, entry);
+            }
+        }
+
+        // 每秒为每个客户端执行保活和断线重连检查
+        now = Clock::now();
+        if (now >= next_tick) {
+            next_tick = now + std::chrono::milliseconds(TICK_INTERVAL_MS);
+            for (auto& pair : loop.clients) {
+                Entry& entry = *pair.second;
+                if (entry.removed) {
+                    continue;
+                }
+                if (entry.fd >= 0) {
+                    entry.client->serviceSocket(false, false);
+                    serviceEntry(loop, entry);
+                }
+                if (!entry.removed && entry.fd < 0) {
+                    reconnectEntry(loop, entry);
+                }
+            }
+        }
+
+        runWakeups(loop);
+        runTimers(loop);
+    }
+
+    std::lock_guard<std::mutex> lock(loop.mutex);
+    loop.running = false;
+    loop.cv.notify_all();
+}
@@ -0,0 +1,355 @@
+#include "offline_spool.h"
+#include "binary_io.h"
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace {
+
+// 文件格式（按本机字节序写入）
+//   文件头: "DMSPOOL1" | u64 数据区容量 | u64 读位置 | u64 写位置 | 保留至64字节
+//   记录:   u32 正文长度 | u32 正文CRC32 | 正文 | 填充至8字节对齐；正文长度为 WRAP_MARKER 时表示回绕到数据区开头
+//   正文:   u8 标志 | u8 QoS | u16+主题 | [u16+响应主题 | u16+关联数据 | u32 过期时间] | 消息内容（其余字节）
+constexpr char SPOOL_MAGIC[8] = {'D', 'M', 'S', 'P', 'O', 'O', 'L', '1'};
+constexpr size_t HEADER_SIZE = 64;
+constexpr size_t CAPACITY_OFFSET = 8;
+constexpr size_t HEAD_OFFSET = 16;
+constexpr size_t TAIL_OFFSET = 24;
+constexpr size_t RECORD_HEADER_SIZE = 8;
+constexpr size_t BODY_FIXED_SIZE = 4;
+constexpr size_t PROPERTIES_FIXED_SIZE = 8;
+constexpr uint32_t WRAP_MARKER = 0xffffffffu;
+
+constexpr uint8_t FLAG_RETAIN = 0x01;
+constexpr uint8_t FLAG_LATEST_ONLY = 0x02;
+constexpr uint8_t FLAG_PROPERTIES = 0x04;
+
+size_t align8(size_t size) {
+    return (size + 7) & ~size_t(7);
+}
+
+// 写入 u16 长度前缀的字符串，返回写入后的位置
+char* writeString(char* out, const std::string& value) {
+    storeValue(out, static_cast<uint16_t>(value.size()));
+    std::memcpy(out + 2, value.data(), value.size());
+    return out + 2 + value.size();
+}
+
+// 读取 u16 长度前缀的字符串，越界时返回false
+bool readString(const char*& data, const char* end, std::string* value) {
+    if (end - data < 2) {
+        return false;
+    }
+    uint16_t length = loadValue<uint16_t>(data);
+    if (static_cast<size_t>(end - data - 2) < length) {
+        return false;
+    }
+    if (value) {
+        value->assign(data + 2, length);
+    }
+    data += 2 + length;
+    return true;
+}
+
+} // namespace
+
+OfflineSpool::OfflineSpool() = default;
+
+OfflineSpool::~OfflineSpool() {
+    close();
+}
+
+bool OfflineSpool::open(const std::string& path, size_t capacity) {
+    close();
+    capacity = std::max(capacity, MIN_CAPACITY) & ~size_t(7);
+    size_t file_size = HEADER_SIZE + capacity;
+
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cerr << "Failed to open offline buffer " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    // 已有文件的格式和容量一致时恢复，否则重新创建
+    bool reuse = false;
+    struct stat st{};
+    if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) == file_size) {
+        char header[HEADER_SIZE];
+        reuse = pread(fd, header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header)) &&
+                std::memcmp(header, SPOOL_MAGIC, sizeof(SPOOL_MAGIC)) == 0 &&
+                loadValue<uint64_t>(header + CAPACITY_OFFSET) == capacity;
+    }
+    if (!reuse) {
+        if (st.st_size > 0) {
+            std::cerr << "Offline buffer " << path << " has a different format or capacity, recreating" << std::endl;
+        }
+        if (ftruncate(fd, 0) != 0 || ftruncate(fd, file_size) != 0) {
+            std::cerr << "Failed to size offline buffer " << path << ": " << std::strerror(errno) << std::endl;
+            ::close(fd);
+            return false;
+        }
+    }
+
+    void* map = mmap(nullptr, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        std::cerr << "Failed to map offline buffer " << path << ": " << std::strerror(errno) << std::endl;
+        ::close(fd);
+        return false;
+    }
+    m_fd = fd;
+    m_map = static_cast<char*>(map);
+    m_capacity = capacity;
+    m_head = m_tail = 0;
+    m_latest.clear();
+    m_count = 0;
+    m_dropped = 0;
+    m_recovered = 0;
+
+    if (!reuse) {
+        std::memcpy(m_map, SPOOL_MAGIC, sizeof(SPOOL_MAGIC));
+        storeValue(m_map + CAPACITY_OFFSET, static_cast<uint64_t>(capacity));
+        storePositions();
+        return true;
+    }
+
+    // 从读位置起逐条校验，第一条不完整或校验失败的记录之后视为崩溃时未写完的部分
+    uint64_t head = loadValue<uint64_t>(m_map + HEAD_OFFSET);
+    uint64_t tail = loadValue<uint64_t>(m_map + TAIL_OFFSET);
+    if (tail < head || tail - head > capacity || head % 8 != 0 || tail % 8 != 0) {
+        std::cerr << "Offline buffer " << path << " has invalid positions, discarding its contents" << std::endl;
+        head = tail = 0;
+    }
+    m_head = head;
+    uint64_t position = head;
+    while (position < tail) {
+        if (loadValue<uint32_t>(recordAt(position)) == WRAP_MARKER) {
+            position += capacity - position % capacity;
+            continue;
+        }
+        uint8_t flags = 0;
+        size_t length = 0;
+        if (!parse(position, true, nullptr, nullptr, &flags, &length) || length > tail - position) {
+            std::cerr << "Offline buffer " << path << ": dropping " << tail - position
+                      << " bytes after the last intact record" << std::endl;
+            break;
+        }
+        std::string topic;
+        if ((flags & FLAG_LATEST_ONLY) && parse(position, false, nullptr, &topic, nullptr, nullptr)) {
+            m_latest[topic] = position;
+        }
+        m_count.fetch_add(1, std::memory_order_relaxed);
+        position += length;
+    }
+    m_tail = std::min(position, tail);
+    m_recovered = m_count.load(std::memory_order_relaxed);
+    skipWrap();
+    storePositions();
+    return true;
+}
+
+void OfflineSpool::close() {
+    if (m_map) {
+        size_t file_size = HEADER_SIZE + m_capacity;
+        msync(m_map, file_size, MS_SYNC);
+        munmap(m_map, file_size);
+        m_map = nullptr;
+    }
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    m_head = m_tail = 0;
+    m_latest.clear();
+    m_count = 0;
+}
+
+bool OfflineSpool::isOpen() const {
+    return m_map != nullptr;
+}
+
+char* OfflineSpool::recordAt(uint64_t position) const {
+    return m_map + HEADER_SIZE + position % m_capacity;
+}
+
+void OfflineSpool::storePositions() {
+    storeValue(m_map + HEAD_OFFSET, m_head);
+    storeValue(m_map + TAIL_OFFSET, m_tail);
+}
+
+bool OfflineSpool::skipWrap() {
+    while (m_head < m_tail && loadValue<uint32_t>(recordAt(m_head)) == WRAP_MARKER) {
+        m_head += m_capacity - m_head % m_capacity;
+    }
+    return m_head < m_tail;
+}
+
+bool OfflineSpool::parse(uint64_t position, bool verify, Record* record, std::string* topic,
+                         uint8_t* flags, size_t* length) const {
+    const char* data = recordAt(position);
+    uint32_t body_length = loadValue<uint32_t>(data);
+    size_t available = m_capacity - position % m_capacity;
+    if (body_length < BODY_FIXED_SIZE || available < RECORD_HEADER_SIZE ||
+        body_length > available - RECORD_HEADER_SIZE) {
+        return false;
+    }
+    const char* body = data + RECORD_HEADER_SIZE;
+    if (verify && crc32(body, body_length) != loadValue<uint32_t>(data + 4)) {
+        return false;
+    }
+
+    const char* end = body + body_length;
+    uint8_t record_flags = static_cast<uint8_t>(body[0]);
+    const char* cursor = body + 2;
+    if (!readString(cursor, end, record ? &record->topic : topic)) {
+        return false;
+    }
+    if (record && topic) {
+        *topic = record->topic;
+    }
+    if (record) {
+        record->qos = static_cast<uint8_t>(body[1]);
+        record->retain = record_flags & FLAG_RETAIN;
+        record->latest_only = record_flags & FLAG_LATEST_ONLY;
+        record->has_properties = record_flags & FLAG_PROPERTIES;
+    }
+    if (record_flags & FLAG_PROPERTIES) {
+        if (!readString(cursor, end, record ? &record->response_topic : nullptr) ||
+            !readString(cursor, end, record ? &record->correlation_data : nullptr) || end - cursor < 4) {
+            return false;
+        }
+        if (record) {
+            record->message_expiry = loadValue<uint32_t>(cursor);
+        }
+        cursor += 4;
+    }
+    if (record) {
+        record->payload.assign(cursor, end - cursor);
+    }
+    if (flags) {
+        *flags = record_flags;
+    }
+    if (length) {
+        *length = align8(RECORD_HEADER_SIZE + body_length);
+    }
+    return true;
+}
+
+bool OfflineSpool::push(const Record& record) {
+    if (!m_map) {
+        return false;
+    }
+    size_t body_length = BODY_FIXED_SIZE + record.topic.size() + record.payload.size();
+    if (record.has_properties) {
+        body_length += PROPERTIES_FIXED_SIZE + record.response_topic.size() + record.correlation_data.size();
+    }
+    size_t length = align8(RECORD_HEADER_SIZE + body_length);
+    if (length > m_capacity / 4 || record.topic.size() > UINT16_MAX ||
+        record.response_topic.size() > UINT16_MAX || record.correlation_data.size() > UINT16_MAX) {
+        return false;
+    }
+
+    // 到数据区末尾的空间放不下时整条写到开头，末尾留下回绕标记（位置按8字节对齐，剩余空间足够写标记）
+    size_t remaining = m_capacity - m_tail % m_capacity;
+    size_t skip = remaining < length ? remaining : 0;
+    while (m_capacity - (m_tail - m_head) < skip + length) {
+        pop();
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (skip > 0) {
+        storeValue(recordAt(m_tail), WRAP_MARKER);
+        m_tail += skip;
+    }
+
+    char* data = recordAt(m_tail);
+    char* body = data + RECORD_HEADER_SIZE;
+    uint8_t flags = (record.retain ? FLAG_RETAIN : 0) | (record.latest_only ? FLAG_LATEST_ONLY : 0) |
+                    (record.has_properties ? FLAG_PROPERTIES : 0);
+    body[0] = static_cast<char>(flags);
+    body[1] = static_cast<char>(record.qos);
+    char* cursor = writeString(body + 2, record.topic);
+    if (record.has_properties) {
+        cursor = writeString(cursor, record.response_topic);
+        cursor = writeString(cursor, record.correlation_data);
+        storeValue(cursor, record.message_expiry);
+        cursor += 4;
+    }
+    std::memcpy(cursor, record.payload.data(), record.payload.size());
+    storeValue(data, static_cast<uint32_t>(body_length));
+    storeValue(data + 4, crc32(body, body_length));
+
+    // 记录写完后再推进写位置
+    if (record.latest_only) {
+        m_latest[record.topic] = m_tail;
+    }
+    m_tail += length;
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    skipWrap();
+    storePositions();
+    return true;
+}
+
+bool OfflineSpool::front(Record& record) const {
+    return m_map && m_head < m_tail && parse(m_head, false, &record, nullptr, nullptr, nullptr);
+}
+
+bool OfflineSpool::frontSuperseded() const {
+    uint8_t flags = 0;
+    if (!m_map || m_head >= m_tail || !parse(m_head, false, nullptr, nullptr, &flags, nullptr) ||
+        !(flags & FLAG_LATEST_ONLY)) {
+        return false;
+    }
+    std::string topic;
+    parse(m_head, false, nullptr, &topic, nullptr, nullptr);
+    auto it = m_latest.find(topic);
+    return it != m_latest.end() && it->second != m_head;
+}
+
+void OfflineSpool::pop() {
+    if (!m_map || m_head >= m_tail) {
+        return;
+    }
+    uint8_t flags = 0;
+    size_t length = 0;
+    if (!parse(m_head, false, nullptr, nullptr, &flags, &length)) {
+        // 只有文件在外部被修改时才会发生：丢弃全部内容
+        std::cerr << "Offline buffer record is corrupt, discarding remaining records" << std::endl;
+        m_head = m_tail;
+        m_latest.clear();
+        m_count = 0;
+        storePositions();
+        return;
+    }
+    // 只有只保留最新值的记录才需要主题（维护最新位置索引）
+    std::string topic;
+    if ((flags & FLAG_LATEST_ONLY) && parse(m_head, false, nullptr, &topic, nullptr, nullptr)) {
+        auto it = m_latest.find(topic);
+        if (it != m_latest.end() && it->second == m_head) {
+            m_latest.erase(it);
+        }
+    }
+    m_head += length;
+    m_count.fetch_sub(1, std::memory_order_relaxed);
+    skipWrap();
+    storePositions();
+}
+
+bool OfflineSpool::empty() const {
+    return m_head >= m_tail;
+}
+
+size_t OfflineSpool::size() const {
+    return m_count.load(std::memory_order_relaxed);
+}
+
+uint64_t OfflineSpool::dropped() const {
+    return m_dropped.load(std::memory_order_relaxed);
+}
+
+size_t OfflineSpool::recovered() const {
+    return m_recovered;
+}
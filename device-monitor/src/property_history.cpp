@@ -0,0 +1,192 @@
+#include "property_history.h"
+#include <algorithm>
+
+PropertyHistory::PropertyHistory(size_t samples_per_property, size_t max_properties_per_device)
+    : m_capacity(samples_per_property == 0 ? 1 : samples_per_property)
+    , m_max_properties(max_properties_per_device)
+{
+}
+
+void PropertyHistory::setCapacity(size_t samples_per_property) {
+    m_capacity.store(samples_per_property == 0 ? 1 : samples_per_property, std::memory_order_relaxed);
+}
+
+void PropertyHistory::record(DeviceHandle handle, std::string_view property, int64_t timestamp_ms, double value) {
+    if (handle == DeviceRegistry::INVALID_HANDLE) {
+        return;
+    }
+
+    DeviceHistory& device = deviceForWrite(handle);
+    std::lock_guard<std::mutex> lock(device.mutex);
+
+    Series* series = const_cast<Series*>(findSeries(device, property));
+    if (!series) {
+        if (device.series.size() >= m_max_properties) {
+            return;
+        }
+        // 属性首次出现时一次性分配缓冲区
+        device.series.emplace_back();
+        series = &device.series.back();
+        series->property.assign(property.data(), property.size());
+        series->capacity = m_capacity.load(std::memory_order_relaxed);
+        series->ring.reset(new HistorySample[series->capacity]);
+    }
+
+    // 范围查询依赖按时间排序的缓冲区，不允许时间回退
+    if (series->count > 0) {
+        timestamp_ms = std::max(timestamp_ms, series->at(series->count - 1).timestamp_ms);
+    }
+    series->ring[series->head] = HistorySample{timestamp_ms, value};
+    series->head = (series->head + 1) % series->capacity;
+    if (series->count < series->capacity) {
+        ++series->count;
+    }
+}
+
+std::vector<HistorySample> PropertyHistory::query(DeviceHandle handle, std::string_view property,
+                                                  int64_t from_ms, int64_t to_ms) const {
+    std::vector<HistorySample> result;
+    DeviceHistory* device = deviceFor(handle);
+    if (!device) {
+        return result;
+    }
+
+    std::lock_guard<std::mutex> lock(device->mutex);
+    const Series* series = findSeries(*device, property);
+    if (!series) {
+        return result;
+    }
+
+    for (size_t i = lowerBound(*series, from_ms); i < series->count; ++i) {
+        const HistorySample& sample = series->at(i);
+        if (sample.timestamp_ms > to_ms) {
+            break;
+        }
+        result.push_back(sample);
+    }
+    return result;
+}
+
+std::vector<HistoryBucket> PropertyHistory::downsample(DeviceHandle handle, std::string_view property,
+                                                       int64_t from_ms, int64_t to_ms, int64_t bucket_ms) const {
+    std::vector<HistoryBucket> result;
+    DeviceHistory* device = deviceFor(handle);
+    if (!device || bucket_ms <= 0) {
+        return result;
+    }
+
+    std::lock_guard<std::mutex> lock(device->mutex);
+    const Series* series = findSeries(*device, property);
+    if (!series) {
+        return result;
+    }
+
+    double sum = 0.0;
+    for (size_t i = lowerBound(*series, from_ms); i < series->count; ++i) {
+        const HistorySample& sample = series->at(i);
+        if (sample.timestamp_ms > to_ms) {
+            break;
+        }
+
+        int64_t start = from_ms + (sample.timestamp_ms - from_ms) / bucket_ms * bucket_ms;
+        if (result.empty() || result.back().start_ms != start) {
+            if (!result.empty()) {
+                result.back().avg = sum / static_cast<double>(result.back().count);
+            }
+            HistoryBucket bucket;
+            bucket.start_ms = start;
+            bucket.min = sample.value;
+            bucket.max = sample.value;
+            result.push_back(bucket);
+            sum = 0.0;
+        }
+
+        HistoryBucket& bucket = result.back();
+        ++bucket.count;
+        bucket.min = std::min(bucket.min, sample.value);
+        bucket.max = std::max(bucket.max, sample.value);
+        sum += sample.value;
+    }
+    if (!result.empty()) {
+        result.back().avg = sum / static_cast<double>(result.back().count);
+    }
+    return result;
+}
+
+std::vector<std::string> PropertyHistory::properties(DeviceHandle handle) const {
+    std::vector<std::string> result;
+    DeviceHistory* device = deviceFor(handle);
+    if (!device) {
+        return result;
+    }
+
+    std::lock_guard<std::mutex> lock(device->mutex);
+    for (const auto& series : device->series) {
+        result.push_back(series.property);
+    }
+    return result;
+}
+
+size_t PropertyHistory::memoryUsage() const {
+    size_t total = 0;
+    std::shared_lock<std::shared_mutex> lock(m_devices_mutex);
+    for (const auto& device : m_devices) {
+        if (!device) {
+            continue;
+        }
+        std::lock_guard<std::mutex> device_lock(device->mutex);
+        for (const auto& series : device->series) {
+            total += series.capacity * sizeof(HistorySample);
+        }
+    }
+    return total;
+}
+
+PropertyHistory::DeviceHistory* PropertyHistory::deviceFor(DeviceHandle handle) const {
+    std::shared_lock<std::shared_mutex> lock(m_devices_mutex);
+    if (handle >= m_devices.size()) {
+        return nullptr;
+    }
+    return m_devices[handle].get();
+}
+
+PropertyHistory::DeviceHistory& PropertyHistory::deviceForWrite(DeviceHandle handle) {
+    DeviceHistory* device = deviceFor(handle);
+    if (device) {
+        return *device;
+    }
+
+    // 设备首次写入：扩展句柄表（DeviceHistory 地址在其生命周期内不变）
+    std::unique_lock<std::shared_mutex> lock(m_devices_mutex);
+    if (handle >= m_devices.size()) {
+        m_devices.resize(std::max<size_t>(handle + 1, m_devices.size() * 2));
+    }
+    if (!m_devices[handle]) {
+        m_devices[handle] = std::make_unique<DeviceHistory>();
+    }
+    return *m_devices[handle];
+}
+
+const PropertyHistory::Series* PropertyHistory::findSeries(const DeviceHistory& device, std::string_view property) {
+    // 每个设备的属性数量很少，线性查找即可
+    for (const auto& series : device.series) {
+        if (series.property == property) {
+            return &series;
+        }
+    }
+    return nullptr;
+}
+
+size_t PropertyHistory::lowerBound(const Series& series, int64_t timestamp_ms) {
+    size_t low = 0;
+    size_t high = series.count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (series.at(mid).timestamp_ms < timestamp_ms) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
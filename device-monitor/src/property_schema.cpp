@@ -0,0 +1,186 @@
+#include "property_schema.h"
+
+namespace {
+
+constexpr uint64_t FNV_OFFSET = 14695981039346656037ull;
+constexpr uint64_t FNV_PRIME = 1099511628211ull;
+
+void hashBytes(uint64_t& hash, const char* data, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<uint8_t>(data[i]);
+        hash *= FNV_PRIME;
+    }
+}
+
+// 字符串连同结尾的分隔符一起参与哈希，避免 "ab"+"c" 与 "a"+"bc" 冲突
+void hashString(uint64_t& hash, const std::string& value) {
+    hashBytes(hash, value.data(), value.size());
+    hashBytes(hash, "", 1);
+}
+
+bool parseType(const std::string& name, PropertyType& type) {
+    static const PropertyType types[] = {PropertyType::NUMBER, PropertyType::BOOLEAN,
+                                         PropertyType::STRING, PropertyType::JSON};
+    for (PropertyType candidate : types) {
+        if (name == PropertySchema::typeName(candidate)) {
+            type = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+PropertyType PropertySchema::typeOf(const Json::Value& value) {
+    if (value.isBool()) {
+        return PropertyType::BOOLEAN;
+    }
+    if (value.isNumeric()) {
+        return PropertyType::NUMBER;
+    }
+    if (value.isString()) {
+        return PropertyType::STRING;
+    }
+    return PropertyType::JSON;
+}
+
+const char* PropertySchema::typeName(PropertyType type) {
+    switch (type) {
+    case PropertyType::NUMBER: return "number";
+    case PropertyType::BOOLEAN: return "bool";
+    case PropertyType::STRING: return "string";
+    case PropertyType::JSON: return "json";
+    }
+    return "json";
+}
+
+uint64_t PropertySchema::computeHash(const std::string& device_type, const std::vector<SchemaField>& fields) {
+    SchemaHasher hasher(device_type);
+    for (const auto& field : fields) {
+        hasher.addField(field.name, field.type, field.unit, field.writable);
+    }
+    return hasher.hash();
+}
+
+bool PropertySchema::accepts(const SchemaField& field, const Json::Value& value) {
+    switch (field.type) {
+    case PropertyType::NUMBER: return value.isNumeric() && !value.isBool();
+    case PropertyType::BOOLEAN: return value.isBool();
+    case PropertyType::STRING: return value.isString();
+    case PropertyType::JSON: return true;
+    }
+    return false;
+}
+
+Json::Value PropertySchema::toJson(const std::string& device_id) const {
+    Json::Value message;
+    message["device_id"] = device_id;
+    message["device_type"] = device_type;
+    message["schema_hash"] = static_cast<Json::UInt64>(hash);
+    Json::Value& list = message["properties"];
+    list = Json::Value(Json::arrayValue);
+    for (const auto& field : fields) {
+        Json::Value entry;
+        entry["name"] = field.name;
+        entry["type"] = typeName(field.type);
+        entry["unit"] = field.unit;
+        entry["writable"] = field.writable;
+        list.append(entry);
+    }
+    return message;
+}
+
+bool PropertySchema::fromJson(const Json::Value& message, PropertySchema& schema, std::string& errors) {
+    const Json::Value& list = message["properties"];
+    if (!message["schema_hash"].isIntegral() || !list.isArray()) {
+        errors = "missing schema_hash or properties";
+        return false;
+    }
+
+    schema.device_type = message.get("device_type", "").asString();
+    schema.fields.clear();
+    schema.fields.reserve(list.size());
+    schema.properties = Json::Value(Json::objectValue);
+    for (const auto& entry : list) {
+        SchemaField field;
+        field.name = entry.get("name", "").asString();
+        field.unit = entry.get("unit", "").asString();
+        field.writable = entry.get("writable", false).asBool();
+        if (field.name.empty() || !parseType(entry.get("type", "").asString(), field.type)) {
+            errors = "invalid schema field";
+            return false;
+        }
+        // 属性模板与完整状态上报中的属性格式一致
+        Json::Value& property = schema.properties[field.name];
+        property["value"] = Json::Value();
+        property["unit"] = field.unit;
+        property["writable"] = field.writable;
+        schema.fields.push_back(std::move(field));
+    }
+
+    schema.hash = message["schema_hash"].asUInt64();
+    if (computeHash(schema.device_type, schema.fields) != schema.hash) {
+        errors = "schema hash mismatch";
+        return false;
+    }
+    return true;
+}
+
+SchemaHasher::SchemaHasher(const std::string& device_type)
+    : m_hash(FNV_OFFSET)
+{
+    hashString(m_hash, device_type);
+}
+
+void SchemaHasher::addField(const std::string& name, PropertyType type, const std::string& unit, bool writable) {
+    hashString(m_hash, name);
+    char flags[2] = {static_cast<char>(type), static_cast<char>(writable)};
+    hashBytes(m_hash, flags, sizeof(flags));
+    hashString(m_hash, unit);
+}
+
+uint64_t SchemaHasher::hash() const {
+    // 0 表示“没有结构”
+    return m_hash == 0 ? 1 : m_hash;
+}
+
+std::shared_ptr<const PropertySchema> SchemaCache::find(uint64_t hash) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_schemas.find(hash);
+    return it != m_schemas.end() ? it->second : nullptr;
+}
+
+std::shared_ptr<const PropertySchema> SchemaCache::insert(PropertySchema schema) {
+    auto entry = std::make_shared<const PropertySchema>(std::move(schema));
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_requested.erase(entry->hash);
+    // 哈希相同的结构内容相同，保留已有对象，正在使用它的解码不受影响
+    auto result = m_schemas.emplace(entry->hash, entry);
+    return result.first->second;
+}
+
+bool SchemaCache::shouldRequest(uint64_t hash, int64_t now_ms, int64_t interval_ms) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_schemas.count(hash)) {
+        return false;
+    }
+    // 伪造的哈希不应让索取记录无限增长
+    if (m_requested.size() >= 4096) {
+        m_requested.clear();
+    }
+    auto result = m_requested.emplace(hash, now_ms);
+    if (result.second) {
+        return true;
+    }
+    if (now_ms - result.first->second < interval_ms) {
+        return false;
+    }
+    result.first->second = now_ms;
+    return true;
+}
+
+size_t SchemaCache::size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_schemas.size();
+}
@@ -0,0 +1,35 @@
+#include "reconnect_backoff.h"
+#include <algorithm>
+
+ReconnectBackoff::ReconnectBackoff(int initial_ms, int max_ms, uint64_t seed)
+    : m_initial_ms(DEFAULT_INITIAL_MS)
+    , m_max_ms(DEFAULT_MAX_MS)
+    , m_rng(seed != 0 ? static_cast<std::mt19937::result_type>(seed) : std::random_device{}())
+{
+    setLimits(initial_ms, max_ms);
+}
+
+void ReconnectBackoff::setLimits(int initial_ms, int max_ms) {
+    initial_ms = std::max(initial_ms, 1);
+    m_initial_ms.store(initial_ms, std::memory_order_relaxed);
+    m_max_ms.store(std::max(max_ms, initial_ms), std::memory_order_relaxed);
+}
+
+std::chrono::milliseconds ReconnectBackoff::next() {
+    int initial = initialMs();
+    int cap = std::max(maxMs(), initial);
+    if (m_last_ms == 0) {
+        // 断线后的第一次在 [0, 初始间隔) 内随机
+        m_last_ms = initial;
+        return std::chrono::milliseconds(std::uniform_int_distribution<int>(0, initial - 1)(m_rng));
+    }
+
+    // 去相关抖动：在 [初始间隔, 上次等待×3] 内随机，不超过上限
+    int upper = static_cast<int>(std::min<int64_t>(cap, static_cast<int64_t>(m_last_ms) * 3));
+    m_last_ms = std::uniform_int_distribution<int>(initial, std::max(initial, upper))(m_rng);
+    return std::chrono::milliseconds(m_last_ms);
+}
+
+void ReconnectBackoff::reset() {
+    m_last_ms = 0;
+}
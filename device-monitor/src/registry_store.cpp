@@ -0,0 +1,749 @@
+#include "registry_store.h"
+#include "binary_io.h"
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+#include <cstdio>
+#include <filesystem>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace {
+
+// 文件格式（按本机字节序写入，数据目录不跨字节序的机器共享）
+//   WAL:  "DMWAL001" | u64 代号 | 记录...
+//   快照: "DMSNAP01" | u64 代号 | u64 设备数 | u64 数据字节数 | 记录...
+//   记录: u32 正文长度 | u32 正文CRC32 | 正文
+//   正文: u8 类型 | i64 最后活跃时间(Unix毫秒) | u16+设备ID | u16+设备类型 | u16+状态 | u32+属性JSON
+constexpr char WAL_MAGIC[8] = {'D', 'M', 'W', 'A', 'L', '0', '0', '1'};
+constexpr char SNAPSHOT_MAGIC[8] = {'D', 'M', 'S', 'N', 'A', 'P', '0', '1'};
+constexpr size_t WAL_HEADER_SIZE = 16;
+constexpr size_t SNAPSHOT_HEADER_SIZE = 32;
+constexpr size_t RECORD_HEADER_SIZE = 8;
+constexpr uint8_t RECORD_UPSERT = 1;
+
+// 待写入日志的上限，磁盘停滞时超出部分被丢弃并触发快照补齐
+constexpr size_t MAX_PENDING_BYTES = size_t(64) << 20;
+
+template <typename T>
+void appendValue(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+int64_t toUnixMillis(std::chrono::system_clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+}
+
+// 把设备完整状态编码为一条记录追加到out，字段超长时返回false
+bool encodeUpsert(std::string& out, const DeviceStatus& status) {
+    if (status.device_id.size() > 0xffff || status.device_type.size() > 0xffff || status.status.size() > 0xffff) {
+        return false;
+    }
+
+    thread_local Json::StreamWriterBuilder writer = []() {
+        Json::StreamWriterBuilder builder;
+        builder["indentation"] = "";
+        return builder;
+    }();
+    std::string properties;
+    if (!status.properties.isNull()) {
+        properties = Json::writeString(writer, status.properties);
+    }
+
+    size_t start = out.size();
+    appendValue<uint32_t>(out, 0);
+    appendValue<uint32_t>(out, 0);
+    appendValue<uint8_t>(out, RECORD_UPSERT);
+    appendValue<int64_t>(out, toUnixMillis(status.last_seen));
+    appendValue<uint16_t>(out, static_cast<uint16_t>(status.device_id.size()));
+    out += status.device_id;
+    appendValue<uint16_t>(out, static_cast<uint16_t>(status.device_type.size()));
+    out += status.device_type;
+    appendValue<uint16_t>(out, static_cast<uint16_t>(status.status.size()));
+    out += status.status;
+    appendValue<uint32_t>(out, static_cast<uint32_t>(properties.size()));
+    out += properties;
+
+    uint32_t length = static_cast<uint32_t>(out.size() - start - RECORD_HEADER_SIZE);
+    uint32_t crc = crc32(out.data() + start + RECORD_HEADER_SIZE, length);
+    std::memcpy(&out[start], &length, sizeof(length));
+    std::memcpy(&out[start + 4], &crc, sizeof(crc));
+    return true;
+}
+
+// 只读内存映射文件
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) : m_data(nullptr), m_size(0) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED) {
+                madvise(data, st.st_size, MADV_SEQUENTIAL);
+                m_data = static_cast<const char*>(data);
+                m_size = st.st_size;
+            }
+        }
+        ::close(fd);
+    }
+
+    ~MappedFile() {
+        if (m_data) {
+            munmap(const_cast<char*>(m_data), m_size);
+        }
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    const char* m_data;
+    size_t m_size;
+};
+
+// 恢复过程中把记录应用到注册表
+class RecordApplier {
+public:
+    explicit RecordApplier(DeviceRegistry& registry)
+        : m_registry(registry)
+        , m_reader(Json::CharReaderBuilder().newCharReader())
+        , m_now_ms(toUnixMillis(std::chrono::system_clock::now()))
+        , m_now_ticks(DeviceRegistry::nowTicks())
+    {
+    }
+
+    // 解析 [data, end) 中的记录，返回成功应用的记录数，consumed 为完整记录占用的字节数
+    size_t applyAll(const char* data, const char* end, size_t& consumed) {
+        const char* pos = data;
+        size_t applied = 0;
+        while (static_cast<size_t>(end - pos) >= RECORD_HEADER_SIZE) {
+            uint32_t length = loadValue<uint32_t>(pos);
+            uint32_t crc = loadValue<uint32_t>(pos + 4);
+            if (length > static_cast<size_t>(end - pos) - RECORD_HEADER_SIZE ||
+                crc32(pos + RECORD_HEADER_SIZE, length) != crc ||
+                !apply(pos + RECORD_HEADER_SIZE, pos + RECORD_HEADER_SIZE + length)) {
+                break;
+            }
+            pos += RECORD_HEADER_SIZE + length;
+            ++applied;
+        }
+        consumed = pos - data;
+        return applied;
+    }
+
+private:
+    static bool readField(const char*& pos, const char* end, size_t width, std::string_view& out) {
+        if (static_cast<size_t>(end - pos) < width) {
+            return false;
+        }
+        size_t length = width == 2 ? loadValue<uint16_t>(pos) : loadValue<uint32_t>(pos);
+        pos += width;
+        if (static_cast<size_t>(end - pos) < length) {
+            return false;
+        }
+        out = std::string_view(pos, length);
+        pos += length;
+        return true;
+    }
+
+    bool apply(const char* pos, const char* end) {
+        if (end - pos < 9 || static_cast<uint8_t>(*pos) != RECORD_UPSERT) {
+            return false;
+        }
+        int64_t last_seen_ms = loadValue<int64_t>(pos + 1);
+        pos += 9;
+
+        std::string_view device_id, device_type, status, properties;
+        if (!readField(pos, end, 2, device_id) || !readField(pos, end, 2, device_type) ||
+            !readField(pos, end, 2, status) || !readField(pos, end, 4, properties)) {
+            return false;
+        }
+
+        Json::Value value;
+        if (!properties.empty() &&
+            !m_reader->parse(properties.data(), properties.data() + properties.size(), &value, nullptr)) {
+            return false;
+        }
+
+        bool known = m_registry.findHandle(device_id) != DeviceRegistry::INVALID_HANDLE;
+        m_registry.update(device_id, [&](DeviceStatus& current) {
+            current.device_type.assign(device_type.data(), device_type.size());
+            current.status.assign(status.data(), status.size());
+            current.properties.swap(value);
+        });
+
+        // 最后活跃时间换算到单调时钟。新建的设备直接采用记录中的时间；
+        // 已存在的设备取较新的值（心跳不写日志，快照中的时间可能比之后的日志记录更新）
+        DeviceHandle handle = m_registry.findHandle(device_id);
+        if (handle != DeviceRegistry::INVALID_HANDLE) {
+            int64_t ticks = m_now_ticks - (m_now_ms - last_seen_ms) * 1000000;
+            if (ticks == 0) {
+                ticks = -1;
+            }
+            if (!known || ticks > m_registry.lastSeenTicks(handle)) {
+                m_registry.touch(handle, ticks);
+            }
+        }
+        return true;
+    }
+
+    DeviceRegistry& m_registry;
+    std::unique_ptr<Json::CharReader> m_reader;
+    int64_t m_now_ms;
+    int64_t m_now_ticks;
+};
+
+bool loadSnapshot(DeviceRegistry& registry, const std::string& path) {
+    MappedFile file(path);
+    if (!file.data() || file.size() < SNAPSHOT_HEADER_SIZE ||
+        std::memcmp(file.data(), SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+        std::cerr << "Ignoring invalid snapshot " << path << std::endl;
+        return false;
+    }
+
+    uint64_t count = loadValue<uint64_t>(file.data() + 16);
+    uint64_t data_bytes = loadValue<uint64_t>(file.data() + 24);
+    if (data_bytes > file.size() - SNAPSHOT_HEADER_SIZE) {
+        std::cerr << "Ignoring truncated snapshot " << path << std::endl;
+        return false;
+    }
+
+    // 按快照中的设备数一次性预分配，加载期间不再扩容
+    registry.reserve(count);
+
+    // 快照中每个设备只出现一次，记录之间互不依赖：按记录边界切成若干段并行解析和插入
+    const char* begin = file.data() + SNAPSHOT_HEADER_SIZE;
+    const char* end = begin + data_bytes;
+    size_t thread_count = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), 8));
+    size_t segment_bytes = data_bytes / thread_count + 1;
+    std::vector<const char*> bounds{begin};
+    for (const char* pos = begin; static_cast<size_t>(end - pos) >= RECORD_HEADER_SIZE; ) {
+        uint32_t length = loadValue<uint32_t>(pos);
+        if (length > static_cast<size_t>(end - pos) - RECORD_HEADER_SIZE) {
+            break;
+        }
+        pos += RECORD_HEADER_SIZE + length;
+        if (static_cast<size_t>(pos - bounds.back()) >= segment_bytes && pos != end) {
+            bounds.push_back(pos);
+        }
+    }
+    bounds.push_back(end);
+
+    size_t segments = bounds.size() - 1;
+    std::vector<size_t> applied(segments, 0);
+    std::vector<size_t> consumed(segments, 0);
+    auto load = [&](size_t segment) {
+        RecordApplier applier(registry);
+        applied[segment] = applier.applyAll(bounds[segment], bounds[segment + 1], consumed[segment]);
+    };
+    std::vector<std::thread> threads;
+    for (size_t segment = 1; segment < segments; ++segment) {
+        threads.emplace_back(load, segment);
+    }
+    load(0);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    size_t total = 0;
+    for (size_t segment = 0; segment < segments; ++segment) {
+        total += applied[segment];
+        if (consumed[segment] != static_cast<size_t>(bounds[segment + 1] - bounds[segment])) {
+            std::cerr << "Snapshot " << path << " is corrupt" << std::endl;
+            return false;
+        }
+    }
+    if (total != count) {
+        std::cerr << "Snapshot " << path << " holds " << total << " of " << count << " device(s)" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+size_t replayLog(DeviceRegistry& registry, const std::string& path) {
+    MappedFile file(path);
+    if (!file.data() || file.size() < WAL_HEADER_SIZE ||
+        std::memcmp(file.data(), WAL_MAGIC, sizeof(WAL_MAGIC)) != 0) {
+        return 0;
+    }
+
+    RecordApplier applier(registry);
+    const char* begin = file.data() + WAL_HEADER_SIZE;
+    size_t length = file.size() - WAL_HEADER_SIZE;
+    size_t consumed = 0;
+    size_t applied = applier.applyAll(begin, begin + length, consumed);
+
+    // 崩溃时可能留下写了一半的尾部记录
+    if (consumed != length) {
+        std::cerr << "Ignoring " << (length - consumed) << " trailing byte(s) in " << path << std::endl;
+    }
+    return applied;
+}
+
+bool writeAll(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = ::write(fd, data, length);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        length -= written;
+    }
+    return true;
+}
+
+void syncDirectory(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0) {
+        fsync(fd);
+        ::close(fd);
+    }
+}
+
+// 从 "<prefix><16位十六进制代号><suffix>" 形式的文件名解析代号
+bool parseGeneration(const std::string& name, const char* prefix, const char* suffix, uint64_t& generation) {
+    size_t prefix_len = std::strlen(prefix);
+    size_t suffix_len = std::strlen(suffix);
+    if (name.size() != prefix_len + 16 + suffix_len ||
+        name.compare(0, prefix_len, prefix) != 0 ||
+        name.compare(prefix_len + 16, suffix_len, suffix) != 0) {
+        return false;
+    }
+    char* end = nullptr;
+    std::string digits = name.substr(prefix_len, 16);
+    generation = std::strtoull(digits.c_str(), &end, 16);
+    return end && *end == '\0';
+}
+
+} // namespace
+
+RegistryStore::RegistryStore(const std::string& data_dir)
+    : m_data_dir(data_dir)
+    , m_registry(nullptr)
+    , m_sync_interval_ms(10)
+    , m_snapshot_interval_s(300)
+    , m_force_snapshot(false)
+    , m_log_fd(-1)
+    , m_generation(0)
+    , m_running(false)
+{
+}
+
+RegistryStore::~RegistryStore() {
+    close();
+}
+
+void RegistryStore::setSyncInterval(int interval_ms) {
+    m_sync_interval_ms = std::max(interval_ms, 1);
+}
+
+void RegistryStore::setSnapshotInterval(int interval_seconds) {
+    m_snapshot_interval_s = std::max(interval_seconds, 0);
+}
+
+bool RegistryStore::open(DeviceRegistry& registry) {
+    if (m_running) {
+        return true;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(m_data_dir, ec);
+    if (ec) {
+        std::cerr << "Failed to create data directory " << m_data_dir << ": " << ec.message() << std::endl;
+        return false;
+    }
+
+    m_registry = &registry;
+    if (!recover(registry)) {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = true;
+    }
+    m_flush_thread = std::thread(&RegistryStore::flushLoop, this);
+    m_snapshot_thread = std::thread(&RegistryStore::snapshotLoop, this);
+    return true;
+}
+
+void RegistryStore::close() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running) {
+            return;
+        }
+        m_running = false;
+    }
+    m_cv.notify_all();
+    m_snapshot_cv.notify_all();
+
+    // 写入线程退出前会写完剩余日志
+    if (m_flush_thread.joinable()) {
+        m_flush_thread.join();
+    }
+    if (m_snapshot_thread.joinable()) {
+        m_snapshot_thread.join();
+    }
+
+    // 关闭时写最终快照，下次启动无需重放日志
+    snapshot();
+
+    std::lock_guard<std::mutex> lock(m_file_mutex);
+    if (m_log_fd >= 0) {
+        ::close(m_log_fd);
+        m_log_fd = -1;
+    }
+}
+
+void RegistryStore::logUpsert(const DeviceStatus& status) {
+    thread_local std::string record;
+    record.clear();
+    if (!encodeUpsert(record, status)) {
+        std::cerr << "Device " << status.device_id << " state too large to persist" << std::endl;
+        return;
+    }
+
+    bool notify = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running) {
+            return;
+        }
+        if (m_pending.size() + record.size() > MAX_PENDING_BYTES) {
+            ++m_stats.dropped_records;
+            if (!m_force_snapshot) {
+                m_force_snapshot = true;
+                m_snapshot_cv.notify_one();
+            }
+            return;
+        }
+        notify = m_pending.empty();
+        m_pending += record;
+        ++m_stats.wal_records;
+    }
+
+    // 缓冲区非空时写入线程必然已被唤醒或正在等待提交间隔
+    if (notify) {
+        m_cv.notify_one();
+    }
+}
+
+bool RegistryStore::snapshot() {
+    if (!m_registry) {
+        return false;
+    }
+    std::lock_guard<std::mutex> snapshot_lock(m_snapshot_mutex);
+
+    // 切换到新的WAL代号：此后的修改写入新日志，快照覆盖此前所有日志
+    uint64_t generation;
+    {
+        std::lock_guard<std::mutex> lock(m_file_mutex);
+        std::string remaining;
+        {
+            std::lock_guard<std::mutex> pending_lock(m_mutex);
+            remaining.swap(m_pending);
+        }
+        if (!writeLog(remaining)) {
+            return false;
+        }
+        if (!openLog(m_generation + 1)) {
+            return false;
+        }
+        generation = m_generation;
+    }
+
+    if (!writeSnapshot(generation)) {
+        return false;
+    }
+    removeObsolete(generation);
+    return true;
+}
+
+RegistryStoreStats RegistryStore::stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+bool RegistryStore::recover(DeviceRegistry& registry) {
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<uint64_t> logs;
+    std::vector<uint64_t> snapshots;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(m_data_dir, ec)) {
+        std::string name = entry.path().filename().string();
+        uint64_t generation;
+        if (parseGeneration(name, "wal-", ".log", generation)) {
+            logs.push_back(generation);
+        } else if (parseGeneration(name, "snapshot-", ".dat", generation)) {
+            snapshots.push_back(generation);
+        }
+    }
+    if (ec) {
+        std::cerr << "Failed to list data directory " << m_data_dir << ": " << ec.message() << std::endl;
+        return false;
+    }
+    std::sort(logs.begin(), logs.end());
+    std::sort(snapshots.begin(), snapshots.end(), std::greater<uint64_t>());
+
+    // 从最新的有效快照开始，再按顺序重放其后的日志
+    uint64_t base = 0;
+    for (uint64_t generation : snapshots) {
+        if (loadSnapshot(registry, snapshotPath(generation))) {
+            base = generation;
+            break;
+        }
+    }
+
+    uint64_t replayed = 0;
+    for (uint64_t generation : logs) {
+        if (generation >= base) {
+            replayed += replayLog(registry, logPath(generation));
+        }
+    }
+
+    uint64_t last = base;
+    if (!logs.empty()) {
+        last = std::max(last, logs.back());
+    }
+    if (!snapshots.empty()) {
+        last = std::max(last, snapshots.front());
+    }
+
+    int64_t elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    size_t recovered = registry.size();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.recovered_devices = recovered;
+        m_stats.replayed_records = replayed;
+        m_stats.recovery_ms = elapsed_ms;
+    }
+    if (!snapshots.empty() || !logs.empty()) {
+        std::cout << "Recovered " << recovered << " device(s) from " << m_data_dir
+                  << " (" << replayed << " log record(s) replayed) in " << elapsed_ms << " ms" << std::endl;
+    }
+
+    std::lock_guard<std::mutex> lock(m_file_mutex);
+    return openLog(last + 1);
+}
+
+bool RegistryStore::openLog(uint64_t generation) {
+    std::string path = logPath(generation);
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cerr << "Failed to open write-ahead log " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    std::string header(WAL_MAGIC, sizeof(WAL_MAGIC));
+    appendValue<uint64_t>(header, generation);
+    if (!writeAll(fd, header.data(), header.size()) || fdatasync(fd) != 0) {
+        std::cerr << "Failed to write write-ahead log " << path << ": " << std::strerror(errno) << std::endl;
+        ::close(fd);
+        return false;
+    }
+    syncDirectory(m_data_dir);
+
+    if (m_log_fd >= 0) {
+        ::close(m_log_fd);
+    }
+    m_log_fd = fd;
+    m_generation = generation;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.generation = generation;
+    m_stats.wal_bytes = header.size();
+    return true;
+}
+
+bool RegistryStore::writeLog(const std::string& data) {
+    if (data.empty()) {
+        return true;
+    }
+    if (m_log_fd < 0 || !writeAll(m_log_fd, data.data(), data.size()) || fdatasync(m_log_fd) != 0) {
+        std::cerr << "Failed to write write-ahead log: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.wal_bytes += data.size();
+    ++m_stats.syncs;
+    return true;
+}
+
+void RegistryStore::flushLoop() {
+    std::string batch;
+    auto interval = std::chrono::milliseconds(m_sync_interval_ms);
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this]() { return !m_running || !m_pending.empty(); });
+        }
+
+        // 文件锁内交换缓冲区并写入，保证各批次按追加顺序落盘
+        {
+            std::lock_guard<std::mutex> file_lock(m_file_mutex);
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                batch.swap(m_pending);
+            }
+            writeLog(batch);
+            batch.clear();
+        }
+
+        // 等待一个提交间隔，期间追加的记录合并为下一次写入和fsync
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!m_running) {
+            if (m_pending.empty()) {
+                break;
+            }
+            continue;
+        }
+        m_cv.wait_for(lock, interval, [this]() { return !m_running; });
+    }
+}
+
+void RegistryStore::snapshotLoop() {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            auto ready = [this]() { return !m_running || m_force_snapshot; };
+            if (m_snapshot_interval_s > 0) {
+                m_snapshot_cv.wait_for(lock, std::chrono::seconds(m_snapshot_interval_s), ready);
+            } else {
+                m_snapshot_cv.wait(lock, ready);
+            }
+            if (!m_running) {
+                break;
+            }
+            m_force_snapshot = false;
+        }
+        snapshot();
+    }
+}
+
+bool RegistryStore::writeSnapshot(uint64_t generation) {
+    auto start = std::chrono::steady_clock::now();
+    std::string path = snapshotPath(generation);
+    std::string temp_path = path + ".tmp";
+
+    int fd = ::open(temp_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cerr << "Failed to create snapshot " << temp_path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    // 按设备数估算初始大小，写满时扩大文件并重新映射
+    size_t capacity = std::max<size_t>(SNAPSHOT_HEADER_SIZE + m_registry->size() * 128, size_t(1) << 20);
+    char* map = nullptr;
+    if (ftruncate(fd, capacity) == 0) {
+        void* data = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (data != MAP_FAILED) {
+            map = static_cast<char*>(data);
+        }
+    }
+    if (!map) {
+        std::cerr << "Failed to map snapshot " << temp_path << ": " << std::strerror(errno) << std::endl;
+        ::close(fd);
+        std::remove(temp_path.c_str());
+        return false;
+    }
+
+    size_t offset = SNAPSHOT_HEADER_SIZE;
+    uint64_t count = 0;
+    bool ok = true;
+    std::string record;
+    m_registry->forEach([&](const DeviceStatus& status) {
+        record.clear();
+        if (!ok || !encodeUpsert(record, status)) {
+            return;
+        }
+        if (offset + record.size() > capacity) {
+            size_t new_capacity = std::max(capacity * 2, offset + record.size());
+            void* data = MAP_FAILED;
+            if (ftruncate(fd, new_capacity) == 0) {
+                data = mremap(map, capacity, new_capacity, MREMAP_MAYMOVE);
+            }
+            if (data == MAP_FAILED) {
+                ok = false;
+                return;
+            }
+            map = static_cast<char*>(data);
+            capacity = new_capacity;
+        }
+        std::memcpy(map + offset, record.data(), record.size());
+        offset += record.size();
+        ++count;
+    });
+
+    if (ok) {
+        std::string header(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+        appendValue<uint64_t>(header, generation);
+        appendValue<uint64_t>(header, count);
+        appendValue<uint64_t>(header, offset - SNAPSHOT_HEADER_SIZE);
+        std::memcpy(map, header.data(), header.size());
+        ok = msync(map, offset, MS_SYNC) == 0;
+    }
+    munmap(map, capacity);
+    ok = ok && ftruncate(fd, offset) == 0 && fsync(fd) == 0;
+    ::close(fd);
+
+    // 完整落盘后再原子替换，崩溃时只会留下可忽略的临时文件
+    if (!ok || std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::cerr << "Failed to write snapshot " << path << ": " << std::strerror(errno) << std::endl;
+        std::remove(temp_path.c_str());
+        return false;
+    }
+    syncDirectory(m_data_dir);
+
+    int64_t elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_stats.snapshots;
+    m_stats.last_snapshot_devices = count;
+    m_stats.last_snapshot_ms = elapsed_ms;
+    return true;
+}
+
+void RegistryStore::removeObsolete(uint64_t generation) {
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(m_data_dir, ec)) {
+        std::string name = entry.path().filename().string();
+        uint64_t file_generation;
+        if ((parseGeneration(name, "wal-", ".log", file_generation) ||
+             parseGeneration(name, "snapshot-", ".dat", file_generation) ||
+             parseGeneration(name, "snapshot-", ".dat.tmp", file_generation)) &&
+            file_generation < generation) {
+            std::filesystem::remove(entry.path(), ec);
+        }
+    }
+}
+
+std::string RegistryStore::logPath(uint64_t generation) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "wal-%016llx.log", static_cast<unsigned long long>(generation));
+    return (std::filesystem::path(m_data_dir) / name).string();
+}
+
+std::string RegistryStore::snapshotPath(uint64_t generation) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "snapshot-%016llx.dat", static_cast<unsigned long long>(generation));
+    return (std::filesystem::path(m_data_dir) / name).string();
+}
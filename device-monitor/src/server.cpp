@@ -1,6 +1,7 @@
 #include "server.h"
+#include "message_writer.h"
+#include "json_scanner.h"
 #include <iostream>
-#include <sstream>
 #include <iomanip>
 #include <algorithm>
 #include <json/json.h>
@@ -10,34 +11,169 @@ const std::string Server::TOPIC_DEVICE_STATUS = "device/+/status";
 const std::string Server::TOPIC_DEVICE_COMMAND = "device/+/command";
 const std::string Server::TOPIC_DEVICE_RESPONSE = "device/+/response";
 const std::string Server::TOPIC_DEVICE_HEARTBEAT = "device/+/heartbeat";
+const std::string Server::TOPIC_DEVICE_SCHEMA = "device/+/schema";
+
+namespace {
+
+// 组名作为主题的一个层级，不能包含层级分隔符和通配符
+bool isValidGroupName(const std::string& group) {
+    return !group.empty() && group.find_first_of("/+#") == std::string::npos;
+}
+
+// 把增量上报中的属性合并到已知属性：对象形式的属性逐字段覆盖，保留增量中未携带的单位和可写标志
+void mergeProperties(Json::Value& target, const Json::Value& delta) {
+    if (!delta.isObject()) {
+        return;
+    }
+    if (!target.isObject()) {
+        target = Json::Value(Json::objectValue);
+    }
+    for (auto it = delta.begin(); it != delta.end(); ++it) {
+        Json::Value& current = target[it.name()];
+        if (current.isObject() && it->isObject()) {
+            for (auto field = it->begin(); field != it->end(); ++field) {
+                current[field.name()] = *field;
+            }
+        } else {
+            current = *it;
+        }
+    }
+}
+
+// 状态消息中服务端使用的字段
+struct StatusFields {
+    std::string codec;
+    std::string status = "unknown";
+    std::string device_type;
+    bool has_device_type = false;
+    bool full = true;                   // 未携带 full 字段的是不支持增量上报的设备，每次都是完整状态
+    uint64_t version = 0;
+    bool has_properties = false;
+    Json::Value properties;
+};
+
+// 快速路径：在原始负载上就地扫描JSON状态消息，只把属性转换为 Json::Value；
+// CBOR、数值帧或字段类型不在支持范围内时返回false
+bool scanStatusFields(std::string_view payload, StatusFields& fields) {
+    JsonScanner::ObjectReader reader(payload);
+    std::string_view key;
+    std::string_view value;
+    while (reader.next(key, value)) {
+        bool ok = true;
+        if (key == "status") {
+            ok = JsonScanner::toString(value, fields.status);
+        } else if (key == "codec") {
+            ok = JsonScanner::toString(value, fields.codec);
+        } else if (key == "device_type") {
+            ok = JsonScanner::toString(value, fields.device_type);
+            fields.has_device_type = true;
+        } else if (key == "full") {
+            ok = JsonScanner::toBool(value, fields.full);
+        } else if (key == "version") {
+            ok = JsonScanner::toUInt64(value, fields.version);
+        } else if (key == "properties") {
+            ok = JsonScanner::toValue(value, fields.properties);
+            fields.has_properties = true;
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    return reader.ok();
+}
+
+// 回退路径：从完整解码的消息中读取字段
+void readStatusFields(Json::Value& root, StatusFields& fields) {
+    fields.codec = root.get("codec", "").asString();
+    fields.status = root.get("status", "unknown").asString();
+    fields.has_device_type = root.isMember("device_type");
+    if (fields.has_device_type) {
+        fields.device_type = root["device_type"].asString();
+    }
+    fields.full = root.get("full", true).asBool();
+    fields.version = root.get("version", 0).asUInt64();
+    fields.has_properties = root.isMember("properties");
+    if (fields.has_properties) {
+        fields.properties.swap(root["properties"]);
+    }
+}
+
+// 快速路径：就地扫描JSON命令响应，只取命令ID
+bool scanCommandId(std::string_view payload, std::string& command_id) {
+    JsonScanner::ObjectReader reader(payload);
+    std::string_view key;
+    std::string_view value;
+    while (reader.next(key, value)) {
+        if (key == "command_id" && !JsonScanner::toString(value, command_id)) {
+            return false;
+        }
+    }
+    return reader.ok();
+}
+
+// 集群内移交和查询回复使用的设备状态表示；活跃时间以距今的毫秒数传递，不要求各主机时钟一致
+Json::Value statusToJson(const DeviceStatus& status) {
+    Json::Value value(Json::objectValue);
+    value["device_id"] = status.device_id;
+    value["device_type"] = status.device_type;
+    value["status"] = status.status;
+    value["idle_ms"] = Json::Int64(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now() - status.last_seen).count());
+    value["properties"] = status.properties;
+    value["status_version"] = Json::UInt64(status.status_version);
+    value["codec"] = MessageCodec::get(status.message_format).name();
+    value["schema_hash"] = Json::UInt64(status.schema_hash);
+    return value;
+}
+
+bool statusFromJson(const Json::Value& value, DeviceStatus& status) {
+    if (!value.isObject() || !value["device_id"].isString()) {
+        return false;
+    }
+    status.device_id = value["device_id"].asString();
+    status.device_type = value.get("device_type", "").asString();
+    status.status = value.get("status", "offline").asString();
+    status.last_seen = std::chrono::system_clock::now() -
+                       std::chrono::milliseconds(std::max<int64_t>(0, value.get("idle_ms", 0).asInt64()));
+    status.properties = value["properties"];
+    status.status_version = value.get("status_version", 0).asUInt64();
+    const MessageCodec* codec = MessageCodec::find(value.get("codec", "").asString());
+    status.message_format = codec ? codec->format() : MessageFormat::JSON;
+    status.schema_hash = value.get("schema_hash", 0).asUInt64();
+    status.awaiting_keyframe = false;
+    return true;
+}
+
+} // namespace
 
 Server::Server(const std::string& server_id, 
                const std::string& mqtt_host, 
                int mqtt_port)
     : m_server_id(server_id)
+    , m_ingest_connections(0)
     , m_running(false)
     , m_device_timeout(300) // 默认5分钟超时
     , m_command_counter(0)
+    , m_ingress_workers(0)
+    , m_ingress_capacity(65536)
+    , m_snapshot_interval(300)
 {
-    // 创建MQTT客户端
-    m_mqtt_client = std::make_unique<MqttClient>("server_" + server_id, mqtt_host, mqtt_port);
+    // 创建MQTT客户端（共享订阅入站连接使用相同的服务器和安全配置）
+    m_client_factory = [mqtt_host, mqtt_port](const std::string& client_id) {
+        return std::make_unique<MqttClient>(client_id, mqtt_host, mqtt_port);
+    };
+    m_mqtt_client = m_client_factory("server_" + server_id);
     
-    // 设置消息回调
-    m_mqtt_client->setMessageCallback(
-        [this](const std::string& topic, const std::string& payload) {
-            handleMessage(topic, payload);
-        }
-    );
+    // 注册主题路由
+    registerRoutes(*m_mqtt_client);
     
     // 设置连接状态回调
     m_mqtt_client->setConnectionCallback(
         [this](bool connected) {
             if (connected) {
                 std::cout << "Server MQTT client connected" << std::endl;
-                // 重新订阅所有主题
-                m_mqtt_client->subscribe(TOPIC_DEVICE_STATUS, 1);
-                m_mqtt_client->subscribe(TOPIC_DEVICE_RESPONSE, 1);
-                m_mqtt_client->subscribe(TOPIC_DEVICE_HEARTBEAT, 0);
+                // 重新订阅所有主题（启用共享订阅入站连接时由入站连接订阅设备主题）
+                subscribeTopics();
             } else {
                 std::cout << "Server MQTT client disconnected" << std::endl;
             }
@@ -53,29 +189,30 @@ Server::Server(const std::string& server_id,
                int mqtt_port,
                const SslConfig& ssl_config)
     : m_server_id(server_id)
+    , m_ingest_connections(0)
     , m_running(false)
     , m_device_timeout(300) // 默认5分钟超时
     , m_command_counter(0)
+    , m_ingress_workers(0)
+    , m_ingress_capacity(65536)
+    , m_snapshot_interval(300)
 {
     // 创建支持SSL的MQTT客户端
-    m_mqtt_client = std::make_unique<MqttClient>("server_" + server_id, mqtt_host, mqtt_port, ssl_config);
+    m_client_factory = [mqtt_host, mqtt_port, ssl_config](const std::string& client_id) {
+        return std::make_unique<MqttClient>(client_id, mqtt_host, mqtt_port, ssl_config);
+    };
+    m_mqtt_client = m_client_factory("server_" + server_id);
     
-    // 设置消息回调
-    m_mqtt_client->setMessageCallback(
-        [this](const std::string& topic, const std::string& payload) {
-            handleMessage(topic, payload);
-        }
-    );
+    // 注册主题路由
+    registerRoutes(*m_mqtt_client);
     
     // 设置连接状态回调
     m_mqtt_client->setConnectionCallback(
         [this](bool connected) {
             if (connected) {
                 std::cout << "Server MQTT client connected (SSL/TLS)" << std::endl;
-                // 重新订阅所有主题
-                m_mqtt_client->subscribe(TOPIC_DEVICE_STATUS, 1);
-                m_mqtt_client->subscribe(TOPIC_DEVICE_RESPONSE, 1);
-                m_mqtt_client->subscribe(TOPIC_DEVICE_HEARTBEAT, 0);
+                // 重新订阅所有主题（启用共享订阅入站连接时由入站连接订阅设备主题）
+                subscribeTopics();
             } else {
                 std::cout << "Server MQTT client disconnected" << std::endl;
             }
@@ -91,29 +228,30 @@ Server::Server(const std::string& server_id,
                int mqtt_port,
                const AuthConfig& auth_config)
     : m_server_id(server_id)
+    , m_ingest_connections(0)
     , m_running(false)
     , m_device_timeout(300) // 默认5分钟超时
     , m_command_counter(0)
+    , m_ingress_workers(0)
+    , m_ingress_capacity(65536)
+    , m_snapshot_interval(300)
 {
     // 创建支持身份验证的MQTT客户端
-    m_mqtt_client = std::make_unique<MqttClient>("server_" + server_id, mqtt_host, mqtt_port, auth_config);
+    m_client_factory = [mqtt_host, mqtt_port, auth_config](const std::string& client_id) {
+        return std::make_unique<MqttClient>(client_id, mqtt_host, mqtt_port, auth_config);
+    };
+    m_mqtt_client = m_client_factory("server_" + server_id);
     
-    // 设置消息回调
-    m_mqtt_client->setMessageCallback(
-        [this](const std::string& topic, const std::string& payload) {
-            handleMessage(topic, payload);
-        }
-    );
+    // 注册主题路由
+    registerRoutes(*m_mqtt_client);
     
     // 设置连接状态回调
     m_mqtt_client->setConnectionCallback(
         [this](bool connected) {
             if (connected) {
                 std::cout << "Server MQTT client connected (Auth)" << std::endl;
-                // 重新订阅所有主题
-                m_mqtt_client->subscribe(TOPIC_DEVICE_STATUS, 1);
-                m_mqtt_client->subscribe(TOPIC_DEVICE_RESPONSE, 1);
-                m_mqtt_client->subscribe(TOPIC_DEVICE_HEARTBEAT, 0);
+                // 重新订阅所有主题（启用共享订阅入站连接时由入站连接订阅设备主题）
+                subscribeTopics();
             } else {
                 std::cout << "Server MQTT client disconnected" << std::endl;
             }
@@ -130,29 +268,30 @@ Server::Server(const std::string& server_id,
                const SslConfig& ssl_config,
                const AuthConfig& auth_config)
     : m_server_id(server_id)
+    , m_ingest_connections(0)
     , m_running(false)
     , m_device_timeout(300) // 默认5分钟超时
     , m_command_counter(0)
+    , m_ingress_workers(0)
+    , m_ingress_capacity(65536)
+    , m_snapshot_interval(300)
 {
     // 创建支持SSL和身份验证的MQTT客户端
-    m_mqtt_client = std::make_unique<MqttClient>("server_" + server_id, mqtt_host, mqtt_port, ssl_config, auth_config);
+    m_client_factory = [mqtt_host, mqtt_port, ssl_config, auth_config](const std::string& client_id) {
+        return std::make_unique<MqttClient>(client_id, mqtt_host, mqtt_port, ssl_config, auth_config);
+    };
+    m_mqtt_client = m_client_factory("server_" + server_id);
     
-    // 设置消息回调
-    m_mqtt_client->setMessageCallback(
-        [this](const std::string& topic, const std::string& payload) {
-            handleMessage(topic, payload);
-        }
-    );
+    // 注册主题路由
+    registerRoutes(*m_mqtt_client);
     
     // 设置连接状态回调
     m_mqtt_client->setConnectionCallback(
         [this](bool connected) {
             if (connected) {
                 std::cout << "Server MQTT client connected (SSL/TLS + Auth)" << std::endl;
-                // 重新订阅所有主题
-                m_mqtt_client->subscribe(TOPIC_DEVICE_STATUS, 1);
-                m_mqtt_client->subscribe(TOPIC_DEVICE_RESPONSE, 1);
-                m_mqtt_client->subscribe(TOPIC_DEVICE_HEARTBEAT, 0);
+                // 重新订阅所有主题（启用共享订阅入站连接时由入站连接订阅设备主题）
+                subscribeTopics();
             } else {
                 std::cout << "Server MQTT client disconnected" << std::endl;
             }
@@ -172,22 +311,86 @@ bool Server::start() {
         return true;
     }
     
-    // 连接MQTT服务器
+    // 恢复持久化的设备注册表（在接收任何设备消息之前完成）
+    if (!m_data_dir.empty() && !m_store) {
+        m_store = std::make_unique<RegistryStore>(m_data_dir);
+        m_store->setSnapshotInterval(m_snapshot_interval);
+        if (!m_store->open(m_devices)) {
+            std::cerr << "Failed to open data directory " << m_data_dir << std::endl;
+            m_store.reset();
+            return false;
+        }
+        
+        // 恢复的在线设备按保存的最后活跃时间挂到时间轮，停机期间失联的设备会很快超时离线
+        for (const auto& pair : m_devices.statusCounts()) {
+            if (pair.first == "offline") {
+                continue;
+            }
+            for (const auto& device_id : m_devices.findDevices(pair.first)) {
+                armLiveness(m_devices.findHandle(device_id));
+            }
+        }
+    }
+    
+    // 集群模式：本实例先独占哈希环，收到其他成员的保留声明后重新划分（恢复的设备也在此时移交）；
+    // 异常断开时由遗嘱消息清除成员声明
+    if (!m_cluster_name.empty()) {
+        {
+            std::lock_guard<std::mutex> lock(m_cluster_mutex);
+            m_cluster_members.insert(m_server_id);
+            m_cluster_ring.setMembers(std::vector<std::string>(m_cluster_members.begin(), m_cluster_members.end()));
+            m_rebalance_due = DeviceRegistry::nowTicks() + REBALANCE_DELAY_MS * 1000000LL;
+        }
+        m_mqtt_client->setWill(clusterTopic("members/" + m_server_id), "", 1, true);
+    }
+    
+    // 连接MQTT服务器；失败时关闭已打开的持久化存储，重试 start() 时重新打开
     if (!m_mqtt_client->connect()) {
         std::cerr << "Failed to connect to MQTT broker" << std::endl;
+        closeStore();
+        return false;
+    }
+    if (!connectIngestClients()) {
+        m_mqtt_client->disconnect();
+        closeStore();
         return false;
     }
     
+    // 启动入站消息工作线程池（需在消息循环开始前就绪）
+    if (m_ingress_workers > 0) {
+        m_ingress_pool = std::make_unique<IngressPool>(m_ingress_workers, m_ingress_capacity,
+            [this](const IngressMessage& message) {
+                dispatchIngress(message.kind, message.device_id, message.payload, message.correlation_id);
+            });
+        m_ingress_pool->start();
+    }
+    
     // 启动MQTT客户端
     m_mqtt_client->start();
     
-    // 订阅设备主题
-    m_mqtt_client->subscribe(TOPIC_DEVICE_STATUS, 1);
-    m_mqtt_client->subscribe(TOPIC_DEVICE_RESPONSE, 1);
-    m_mqtt_client->subscribe(TOPIC_DEVICE_HEARTBEAT, 0);
+    // 订阅设备主题：启用入站连接时每个入站连接加入同一个共享订阅组
+    subscribeTopics();
+    for (auto& client : m_ingest_clients) {
+        client->start();
+        subscribeDeviceTopics(*client, "$share/" + m_share_group + "/");
+    }
     
     m_running = true;
     
+    // 启动命令超时处理（超时重发沿用同一个MQTT客户端）
+    m_command_tracker.setPublisher(
+        [this](const ControlCommand& command, const std::string& topic, const std::string& payload, int qos,
+               int timeout_ms) {
+            // 转发给归属实例的命令原样重新转发
+            if (topic != "device/" + command.device_id + "/command") {
+                return m_mqtt_client->publish(topic, payload, qos);
+            }
+            return publishCommand(command.command_id, command.device_id, payload, qos, timeout_ms);
+        }
+    );
+    m_command_tracker.start();
+    m_group_commands.start();
+    
     // 启动设备超时检查线程
     m_timeout_check_thread = std::thread(&Server::deviceTimeoutCheck, this);
     
@@ -200,24 +403,70 @@ void Server::stop() {
         return;
     }
     
-    m_running = false;
+    {
+        std::lock_guard<std::mutex> lock(m_timeout_mutex);
+        m_running = false;
+    }
+    m_timeout_cv.notify_all();
+    
+    // 离开集群：把设备移交给其余成员，再清除成员声明（正常断开不会触发遗嘱消息）
+    if (!m_cluster_name.empty() && m_mqtt_client->isConnected()) {
+        {
+            std::lock_guard<std::mutex> lock(m_cluster_mutex);
+            m_cluster_members.erase(m_server_id);
+            m_cluster_ring.setMembers(std::vector<std::string>(m_cluster_members.begin(), m_cluster_members.end()));
+        }
+        rebalanceCluster();
+        m_mqtt_client->publish(clusterTopic("members/" + m_server_id), "", 1, true);
+    }
     
     // 停止MQTT客户端
     if (m_mqtt_client) {
         m_mqtt_client->stop();
     }
+    for (auto& client : m_ingest_clients) {
+        client->stop();
+    }
+    m_ingest_clients.clear();
+    
+    // 消息循环结束后处理完已入队的消息
+    if (m_ingress_pool) {
+        m_ingress_pool->stop();
+        m_ingress_pool.reset();
+    }
     
     // 等待超时检查线程结束
     if (m_timeout_check_thread.joinable()) {
         m_timeout_check_thread.join();
     }
     
+    // 停止命令超时处理
+    m_command_tracker.stop();
+    m_group_commands.stop();
+    
+    // 所有修改注册表的线程都已停止，写入最终快照
+    closeStore();
+    
     std::cout << "Server stopped" << std::endl;
 }
 
+void Server::closeStore() {
+    if (m_store) {
+        m_store->close();
+        m_store.reset();
+    }
+}
+
 std::string Server::sendCommand(const std::string& device_id, 
                                const std::string& command_type, 
                                const Json::Value& parameters) {
+    return sendCommand(device_id, command_type, parameters, CommandOptions());
+}
+
+std::string Server::sendCommand(const std::string& device_id,
+                               const std::string& command_type,
+                               const Json::Value& parameters,
+                               const CommandOptions& options) {
     if (!m_mqtt_client || !m_mqtt_client->isConnected()) {
         std::cerr << "MQTT client not connected" << std::endl;
         return "";
@@ -226,64 +475,222 @@ std::string Server::sendCommand(const std::string& device_id,
     // 生成命令ID
     std::string command_id = generateCommandId();
     
-    // 构建命令消息
-    Json::Value command;
-    command["command_id"] = command_id;
-    command["command_type"] = command_type;
-    command["parameters"] = parameters;
-    command["timestamp"] = std::chrono::duration_cast<std::chrono::seconds>(
-        std::chrono::system_clock::now().time_since_epoch()).count();
+    // 不归属本实例的设备转发给归属实例，由其按设备声明的格式发布
+    if (!ownsDevice(device_id)) {
+        return forwardCommand(m_cluster_ring.owner(device_id), command_id, device_id, command_type, parameters, options);
+    }
+    const std::string& payload = encodeCommand(command_id, device_id, command_type, parameters);
     
-    // 序列化为JSON字符串
-    Json::StreamWriterBuilder builder;
-    std::string payload = Json::writeString(builder, command);
+    // 先登记待响应命令，避免响应先于登记到达
+    ControlCommand cmd;
+    cmd.command_id = command_id;
+    cmd.device_id = device_id;
+    cmd.command_type = command_type;
+    cmd.parameters = parameters;
     
-    // 发送命令
     std::string topic = "device/" + device_id + "/command";
-    if (m_mqtt_client->publish(topic, payload, 1)) {
-        // 记录待响应命令
-        std::lock_guard<std::mutex> lock(m_commands_mutex);
-        ControlCommand cmd;
-        cmd.command_id = command_id;
-        cmd.device_id = device_id;
-        cmd.command_type = command_type;
-        cmd.parameters = parameters;
-        cmd.timestamp = std::chrono::system_clock::now();
-        m_pending_commands[command_id] = cmd;
-        
+    m_command_tracker.track(cmd, topic, payload, options);
+    
+    // 发送命令
+    int timeout_ms = options.timeout_ms > 0 ? options.timeout_ms : m_command_tracker.defaultTimeout();
+    if (publishCommand(command_id, device_id, payload, options.qos, timeout_ms)) {
         std::cout << "Command sent to device " << device_id << ": " << command_type << std::endl;
         return command_id;
     } else {
+        m_command_tracker.cancel(command_id);
         std::cerr << "Failed to send command to device " << device_id << std::endl;
         return "";
     }
 }
 
-std::shared_ptr<DeviceStatus> Server::getDeviceStatus(const std::string& device_id) const {
-    std::lock_guard<std::mutex> lock(m_devices_mutex);
-    auto it = m_devices.find(device_id);
-    if (it != m_devices.end()) {
-        return std::make_shared<DeviceStatus>(it->second);
+bool Server::publishCommand(const std::string& command_id, const std::string& device_id, const std::string& payload,
+                            int qos, int timeout_ms) {
+    std::string topic = "device/" + device_id + "/command";
+    if (!m_mqtt5) {
+        return m_mqtt_client->publish(topic, payload, qos);
     }
-    return nullptr;
+    
+    // 超时后命令由跟踪器以同一命令ID重发或报告超时，未送达的旧命令随之过期
+    PublishProperties properties;
+    properties.response_topic = "device/" + device_id + "/response";
+    properties.correlation_data = command_id;
+    properties.message_expiry = timeout_ms > 0 ? static_cast<uint32_t>((timeout_ms + 999) / 1000) : 0;
+    return m_mqtt_client->publish(topic, payload, qos, false, properties);
 }
 
-std::map<std::string, DeviceStatus> Server::getAllDeviceStatus() const {
-    std::lock_guard<std::mutex> lock(m_devices_mutex);
-    return m_devices;
+const std::string& Server::encodeCommand(const std::string& command_id, const std::string& device_id,
+                                        const std::string& command_type, const Json::Value& parameters) {
+    // 按设备声明的格式直接写入线程复用的缓冲区，键按字节序写入
+    std::string& payload = MessageWriter::threadBuffer();
+    MessageWriter writer(deviceMessageFormat(device_id), payload);
+    writer.beginObject(4);
+    writer.key("command_id");
+    writer.writeString(command_id);
+    writer.key("command_type");
+    writer.writeString(command_type);
+    writer.key("parameters");
+    writer.writeValue(parameters);
+    writer.key("timestamp");
+    writer.writeInt(std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    writer.endObject();
+    return payload;
 }
 
-std::vector<std::string> Server::getOnlineDevices() const {
-    std::vector<std::string> online_devices;
-    std::lock_guard<std::mutex> lock(m_devices_mutex);
+std::string Server::forwardCommand(const std::string& owner, const std::string& command_id, const std::string& device_id,
+                                   const std::string& command_type, const Json::Value& parameters,
+                                   const CommandOptions& options) {
+    Json::Value message(Json::objectValue);
+    message["type"] = "command";
+    message["command_id"] = command_id;
+    message["device_id"] = device_id;
+    message["command_type"] = command_type;
+    message["parameters"] = parameters;
+    message["qos"] = options.qos;
+    message["timeout_ms"] = options.timeout_ms > 0 ? options.timeout_ms : m_command_tracker.defaultTimeout();
+    std::string payload = MessageCodec::get(MessageFormat::JSON).encode(message);
+    
+    // 命令在本实例跟踪：超时重发时重新转发，归属实例每次都以同一命令ID向设备发布
+    ControlCommand cmd;
+    cmd.command_id = command_id;
+    cmd.device_id = device_id;
+    cmd.command_type = command_type;
+    cmd.parameters = parameters;
+    
+    std::string topic = clusterTopic("rpc/" + owner);
+    m_command_tracker.track(cmd, topic, payload, options);
     
-    for (const auto& pair : m_devices) {
-        if (pair.second.status == "online") {
-            online_devices.push_back(pair.first);
+    if (m_mqtt_client->publish(topic, payload, 1)) {
+        m_forwarded_commands.fetch_add(1, std::memory_order_relaxed);
+        std::cout << "Command for device " << device_id << " forwarded to " << owner << ": " << command_type << std::endl;
+        return command_id;
+    }
+    m_command_tracker.cancel(command_id);
+    std::cerr << "Failed to forward command for device " << device_id << " to " << owner << std::endl;
+    return "";
+}
+
+std::string Server::sendCommandToGroup(const std::string& group,
+                                      const std::vector<std::string>& device_ids,
+                                      const std::string& command_type,
+                                      const Json::Value& parameters,
+                                      const GroupCommandOptions& options) {
+    if (!m_mqtt_client || !m_mqtt_client->isConnected()) {
+        std::cerr << "MQTT client not connected" << std::endl;
+        return "";
+    }
+    
+    if (!isValidGroupName(group)) {
+        std::cerr << "Invalid group name: " << group << std::endl;
+        return "";
+    }
+    
+    if (!options.use_group_topic && device_ids.empty()) {
+        std::cerr << "No target devices for group " << group << std::endl;
+        return "";
+    }
+    
+    std::string command_id = generateCommandId();
+    
+    // 每种格式最多序列化一次，同格式的设备共用同一份内容；组主题由代理扇出，使用所有设备都能识别的JSON
+    int64_t timestamp = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    auto write_command = [&](MessageFormat format, std::string& out) {
+        MessageWriter writer(format, out);
+        writer.beginObject(5);
+        writer.key("command_id");
+        writer.writeString(command_id);
+        writer.key("command_type");
+        writer.writeString(command_type);
+        writer.key("group");
+        writer.writeString(group);
+        writer.key("parameters");
+        writer.writeValue(parameters);
+        writer.key("timestamp");
+        writer.writeInt(timestamp);
+        writer.endObject();
+    };
+    std::string& payload = MessageWriter::threadBuffer();
+    write_command(MessageFormat::JSON, payload);
+    std::string cbor_payload;
+    
+    // 先登记，避免响应先于登记到达
+    m_group_commands.track(command_id, group, command_type, device_ids, options.timeout_ms);
+    
+    if (options.use_group_topic) {
+        // 只发布一次，由代理扇出到订阅了该组的设备
+        if (!m_mqtt_client->publish("group/" + group + "/command", payload, options.qos)) {
+            m_group_commands.cancel(command_id);
+            std::cerr << "Failed to send command to group " << group << std::endl;
+            return "";
+        }
+    } else {
+        // 逐个设备发布同一份内容，主题缓冲区循环复用
+        std::string topic;
+        size_t failed = 0;
+        for (const auto& device_id : device_ids) {
+            topic.assign("device/");
+            topic.append(device_id);
+            topic.append("/command");
+            const std::string* device_payload = &payload;
+            if (deviceMessageFormat(device_id) == MessageFormat::CBOR) {
+                if (cbor_payload.empty()) {
+                    write_command(MessageFormat::CBOR, cbor_payload);
+                }
+                device_payload = &cbor_payload;
+            }
+            if (!m_mqtt_client->publish(topic, *device_payload, options.qos)) {
+                ++failed;
+            }
+        }
+        if (failed == device_ids.size()) {
+            m_group_commands.cancel(command_id);
+            std::cerr << "Failed to send command to group " << group << std::endl;
+            return "";
+        }
+        if (failed > 0) {
+            std::cerr << "Failed to send command to " << failed << " of " << device_ids.size()
+                      << " device(s) in group " << group << std::endl;
         }
     }
     
-    return online_devices;
+    std::cout << "Command sent to group " << group << ": " << command_type
+              << " (" << (options.use_group_topic ? std::string("group topic") :
+                          std::to_string(device_ids.size()) + " device(s)") << ")" << std::endl;
+    return command_id;
+}
+
+std::shared_ptr<DeviceStatus> Server::getDeviceStatus(const std::string& device_id) const {
+    auto status = std::make_shared<DeviceStatus>();
+    if (m_devices.get(device_id, *status)) {
+        return status;
+    }
+    if (m_running && !ownsDevice(device_id)) {
+        return queryOwner(m_cluster_ring.owner(device_id), device_id);
+    }
+    return nullptr;
+}
+
+std::map<std::string, DeviceStatus> Server::getAllDeviceStatus() const {
+    std::map<std::string, DeviceStatus> devices;
+    m_devices.forEach([&devices](const DeviceStatus& status) {
+        devices.emplace(status.device_id, status);
+    });
+    return devices;
+}
+
+std::vector<std::string> Server::getOnlineDevices() const {
+    return findDevices("online");
+}
+
+std::vector<std::string> Server::findDevices(const std::string& status, const std::string& device_type) const {
+    std::vector<std::string> devices = m_devices.findDevices(status, device_type);
+    std::sort(devices.begin(), devices.end());
+    return devices;
+}
+
+std::map<std::string, size_t> Server::getDeviceCounts() const {
+    return m_devices.statusCounts();
 }
 
 void Server::setDeviceStatusCallback(DeviceStatusCallback callback) {
@@ -294,22 +701,207 @@ void Server::setCommandResponseCallback(CommandResponseCallback callback) {
     m_command_response_callback = callback;
 }
 
+void Server::setCommandTimeoutCallback(CommandTimeoutCallback callback) {
+    m_command_tracker.setTimeoutCallback(callback);
+}
+
+void Server::setGroupCommandCallback(GroupCommandCallback callback) {
+    m_group_commands.setResultCallback(callback);
+}
+
+void Server::setCommandTimeout(int timeout_ms) {
+    m_command_tracker.setDefaultTimeout(timeout_ms);
+    m_group_commands.setDefaultTimeout(timeout_ms);
+}
+
+std::map<std::string, LatencySummary> Server::getCommandLatencyStats() const {
+    return m_command_tracker.latencyStats();
+}
+
+size_t Server::getPendingCommandCount() const {
+    return m_command_tracker.pendingCount();
+}
+
+size_t Server::getPendingGroupCommandCount() const {
+    return m_group_commands.pendingCount();
+}
+
 void Server::setDeviceTimeout(int timeout_seconds) {
     m_device_timeout = timeout_seconds;
 }
 
+void Server::setMaxDevices(size_t max_devices) {
+    m_devices.reserve(max_devices);
+}
+
+void Server::setIngressWorkers(size_t worker_count) {
+    if (m_running) {
+        std::cerr << "Ingress workers must be configured before the server starts" << std::endl;
+        return;
+    }
+    m_ingress_workers = worker_count;
+}
+
+void Server::setIngestConnections(size_t connection_count, const std::string& share_group) {
+    if (m_running) {
+        std::cerr << "Ingest connections must be configured before the server starts" << std::endl;
+        return;
+    }
+    m_ingest_connections = connection_count;
+    m_share_group = share_group.empty() ? "server_" + m_server_id : share_group;
+}
+
+void Server::setCluster(const std::string& cluster_name) {
+    if (m_running) {
+        std::cerr << "Cluster must be configured before the server starts" << std::endl;
+        return;
+    }
+    if (cluster_name.empty() || cluster_name == m_cluster_name) {
+        return;
+    }
+    if (!m_cluster_name.empty()) {
+        std::cerr << "Server is already a member of cluster " << m_cluster_name << std::endl;
+        return;
+    }
+    // 集群名和服务端ID都是主题层级
+    if (!isValidGroupName(cluster_name) || !isValidGroupName(m_server_id)) {
+        std::cerr << "Invalid cluster name or server ID for clustering: " << cluster_name << std::endl;
+        return;
+    }
+    
+    m_cluster_name = cluster_name;
+    m_mqtt_client->addRoute(clusterTopic("members/+"),
+        [this](const TopicCaptures& captures, const MessageView& message) {
+            handleClusterMember(captures[0], message.payload);
+        });
+    m_mqtt_client->addRoute(clusterTopic("rpc/" + m_server_id),
+        [this](const TopicCaptures&, const MessageView& message) {
+            handleClusterMessage(message.payload);
+        });
+}
+
+void Server::setMqtt5(bool enable) {
+    if (m_running) {
+        std::cerr << "MQTT protocol version must be configured before the server starts" << std::endl;
+        return;
+    }
+    if (m_mqtt_client->setMqtt5(enable)) {
+        m_mqtt5 = enable;
+    }
+}
+
+void Server::setPersistentSession(bool enable, uint32_t session_expiry) {
+    if (m_running) {
+        std::cerr << "Persistent session must be configured before the server starts" << std::endl;
+        return;
+    }
+    if (m_mqtt_client->setPersistentSession(enable, session_expiry)) {
+        m_persistent_session = enable;
+        m_session_expiry = session_expiry;
+    }
+}
+
+void Server::setClusterRequestTimeout(int timeout_ms) {
+    m_cluster_request_timeout_ms = timeout_ms;
+}
+
+std::vector<std::string> Server::getClusterMembers() const {
+    if (m_cluster_name.empty()) {
+        return {};
+    }
+    return m_cluster_ring.members();
+}
+
+std::string Server::getDeviceOwner(const std::string& device_id) const {
+    if (m_cluster_name.empty()) {
+        return m_server_id;
+    }
+    return m_cluster_ring.owner(device_id);
+}
+
+ClusterStats Server::getClusterStats() const {
+    ClusterStats stats;
+    stats.forwarded_commands = m_forwarded_commands.load(std::memory_order_relaxed);
+    stats.forwarded_queries = m_forwarded_queries.load(std::memory_order_relaxed);
+    stats.failed_queries = m_failed_queries.load(std::memory_order_relaxed);
+    stats.rebalances = m_rebalances.load(std::memory_order_relaxed);
+    stats.handed_off = m_handed_off.load(std::memory_order_relaxed);
+    stats.taken_over = m_taken_over.load(std::memory_order_relaxed);
+    stats.unowned_messages = m_unowned_messages.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void Server::setIngressQueueCapacity(size_t capacity) {
+    if (m_running) {
+        std::cerr << "Ingress queue capacity must be configured before the server starts" << std::endl;
+        return;
+    }
+    m_ingress_capacity = capacity;
+}
+
+IngressStats Server::getIngressStats() const {
+    if (!m_ingress_pool) {
+        return IngressStats();
+    }
+    return m_ingress_pool->stats();
+}
+
+void Server::setDataDirectory(const std::string& data_dir) {
+    if (m_running) {
+        std::cerr << "Data directory must be configured before the server starts" << std::endl;
+        return;
+    }
+    m_data_dir = data_dir;
+}
+
+void Server::setSnapshotInterval(int interval_seconds) {
+    m_snapshot_interval = interval_seconds;
+}
+
+RegistryStoreStats Server::getPersistenceStats() const {
+    if (!m_store) {
+        return RegistryStoreStats();
+    }
+    return m_store->stats();
+}
+
+void Server::setHistoryCapacity(size_t samples_per_property) {
+    m_history.setCapacity(samples_per_property);
+}
+
+std::vector<HistorySample> Server::getPropertyHistory(const std::string& device_id, const std::string& property,
+                                                      int64_t from_ms, int64_t to_ms) const {
+    return m_history.query(m_devices.findHandle(device_id), property, from_ms, to_ms);
+}
+
+std::vector<HistoryBucket> Server::getPropertyHistoryDownsampled(const std::string& device_id, const std::string& property,
+                                                                 int64_t from_ms, int64_t to_ms, int64_t bucket_ms) const {
+    return m_history.downsample(m_devices.findHandle(device_id), property, from_ms, to_ms, bucket_ms);
+}
+
+std::vector<std::string> Server::getDeviceHistoryProperties(const std::string& device_id) const {
+    return m_history.properties(m_devices.findHandle(device_id));
+}
+
+size_t Server::getHistoryMemoryUsage() const {
+    return m_history.memoryUsage();
+}
+
 void Server::requestDeviceStatus(const std::string& device_id) {
     if (!m_mqtt_client || !m_mqtt_client->isConnected()) {
         return;
     }
     
-    Json::Value request;
-    request["type"] = "status_request";
-    request["timestamp"] = std::chrono::duration_cast<std::chrono::seconds>(
-        std::chrono::system_clock::now().time_since_epoch()).count();
-    
-    Json::StreamWriterBuilder builder;
-    std::string payload = Json::writeString(builder, request);
+    // 广播请求使用所有设备都能识别的JSON
+    std::string& payload = MessageWriter::threadBuffer();
+    MessageWriter writer(device_id.empty() ? MessageFormat::JSON : deviceMessageFormat(device_id), payload);
+    writer.beginObject(2);
+    writer.key("timestamp");
+    writer.writeInt(std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    writer.key("type");
+    writer.writeString("status_request");
+    writer.endObject();
     
     if (device_id.empty()) {
         // 请求所有设备状态
@@ -321,168 +913,879 @@ void Server::requestDeviceStatus(const std::string& device_id) {
     }
 }
 
-void Server::handleMessage(const std::string& topic, const std::string& payload) {
-    try {
-        // 解析设备ID
-        std::string device_id = parseDeviceIdFromTopic(topic);
-        if (device_id.empty()) {
-            return;
+void Server::registerRoutes(MqttClient& client) {
+    // 通配符 '+' 捕获设备ID，设备ID和消息内容都直接指向 mosquitto 的缓冲区，投递到工作线程时才复制一次
+    // 共享订阅投递的消息主题不带 $share 前缀，入站连接使用相同的路由
+    client.addRoute(TOPIC_DEVICE_STATUS,
+        [this](const TopicCaptures& captures, const MessageView& message) {
+            ingest(IngressKind::STATUS, captures[0], message.payload);
+        });
+    client.addRoute(TOPIC_DEVICE_RESPONSE,
+        [this](const TopicCaptures& captures, const MessageView& message) {
+            ingest(IngressKind::RESPONSE, captures[0], message.payload, message.correlation_data);
+        });
+    client.addRoute(TOPIC_DEVICE_HEARTBEAT,
+        [this](const TopicCaptures& captures, const MessageView& message) {
+            ingest(IngressKind::HEARTBEAT, captures[0], message.payload);
+        });
+    client.addRoute(TOPIC_DEVICE_SCHEMA,
+        [this](const TopicCaptures& captures, const MessageView& message) {
+            ingest(IngressKind::SCHEMA, captures[0], message.payload);
+        });
+}
+
+void Server::subscribeDeviceTopics(MqttClient& client, const std::string& prefix) {
+    client.subscribe(prefix + TOPIC_DEVICE_STATUS, 1);
+    client.subscribe(prefix + TOPIC_DEVICE_RESPONSE, 1);
+    client.subscribe(prefix + TOPIC_DEVICE_HEARTBEAT, 0);
+    client.subscribe(prefix + TOPIC_DEVICE_SCHEMA, 1);
+}
+
+void Server::subscribeTopics() {
+    // 持久会话仍在时 broker 保留了订阅，无需重新订阅
+    bool resubscribe = !m_mqtt_client->sessionPresent();
+    if (resubscribe && m_ingest_connections == 0) {
+        subscribeDeviceTopics(*m_mqtt_client, "");
+    }
+    if (!m_cluster_name.empty()) {
+        if (resubscribe) {
+            m_mqtt_client->subscribe(clusterTopic("members/+"), 1);
+            m_mqtt_client->subscribe(clusterTopic("rpc/" + m_server_id), 1);
         }
+        // 断线期间遗嘱消息可能已清除本实例的成员声明
+        announceMembership();
+    }
+}
+
+bool Server::connectIngestClients() {
+    std::string prefix = "$share/" + m_share_group + "/";
+    for (size_t i = 0; i < m_ingest_connections; ++i) {
+        std::string client_id = "server_" + m_server_id + "_ingest" + std::to_string(i);
+        std::unique_ptr<MqttClient> client = m_client_factory(client_id);
+        if (m_mqtt5) {
+            client->setMqtt5(true);
+        }
+        if (m_persistent_session) {
+            client->setPersistentSession(true, m_session_expiry);
+        }
+        registerRoutes(*client);
+        
+        // 重连后重新加入共享订阅组
+        MqttClient* raw = client.get();
+        client->setConnectionCallback(
+            [this, raw, client_id, prefix](bool connected) {
+                if (connected) {
+                    std::cout << "Server ingest connection " << client_id << " connected" << std::endl;
+                    if (!raw->sessionPresent()) {
+                        subscribeDeviceTopics(*raw, prefix);
+                    }
+                } else {
+                    std::cout << "Server ingest connection " << client_id << " disconnected" << std::endl;
+                }
+            }
+        );
+        client->setAutoReconnect(true, 5);
         
-        // 根据主题类型处理消息
-        if (topic.find("/status") != std::string::npos) {
-            handleDeviceStatus(device_id, payload);
-        } else if (topic.find("/response") != std::string::npos) {
-            handleCommandResponse(device_id, payload);
-        } else if (topic.find("/heartbeat") != std::string::npos) {
-            handleDeviceHeartbeat(device_id, payload);
+        if (!client->connect()) {
+            std::cerr << "Failed to connect ingest connection " << client_id << " to MQTT broker" << std::endl;
+            for (auto& connected : m_ingest_clients) {
+                connected->disconnect();
+            }
+            m_ingest_clients.clear();
+            return false;
         }
-    } catch (const std::exception& e) {
-        std::cerr << "Error handling message: " << e.what() << std::endl;
+        m_ingest_clients.push_back(std::move(client));
     }
+    return true;
 }
 
-void Server::handleDeviceStatus(const std::string& device_id, const std::string& payload) {
+void Server::ingest(IngressKind kind, std::string_view device_id, std::string_view payload,
+                    std::string_view correlation_id) {
+    // 集群模式下丢弃不归属本实例的设备消息；命令响应按命令ID交付给发出命令的实例
+    if (kind != IngressKind::RESPONSE && !ownsDevice(device_id)) {
+        m_unowned_messages.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    if (m_ingress_pool) {
+        m_ingress_pool->submit(kind, device_id, payload, correlation_id);
+    } else {
+        dispatchIngress(kind, device_id, payload, correlation_id);
+    }
+}
+
+void Server::dispatchIngress(IngressKind kind, std::string_view device_id, std::string_view payload,
+                             std::string_view correlation_id) {
+    switch (kind) {
+    case IngressKind::STATUS:
+        handleDeviceStatus(device_id, payload);
+        break;
+    case IngressKind::RESPONSE:
+        handleCommandResponse(device_id, payload, correlation_id);
+        break;
+    case IngressKind::HEARTBEAT:
+        handleDeviceHeartbeat(device_id, payload);
+        break;
+    case IngressKind::SCHEMA:
+        handleDeviceSchema(device_id, payload);
+        break;
+    }
+}
+
+void Server::handleDeviceStatus(std::string_view device_id, std::string_view payload) {
     try {
-        Json::CharReaderBuilder builder;
-        Json::Value root;
-        std::string errors;
-        std::istringstream stream(payload);
+        StatusFields fields;
+        MessageFormat detected = MessageFormat::JSON;
+        
+        // JSON对象在原始负载上就地扫描，CBOR、数值帧和其他形式回退到完整解码
+        if (!scanStatusFields(payload, fields)) {
+            Json::Value root;
+            std::string errors;
+            if (!MessageCodec::decodeAny(payload, root, &errors, &detected)) {
+                std::cerr << "Failed to parse device status: " << errors << std::endl;
+                return;
+            }
+            
+            // 结构声明模式下的数值帧是数组
+            if (root.isArray()) {
+                applyValueFrame(device_id, root, detected);
+                return;
+            }
+            
+            fields = StatusFields();
+            readStatusFields(root, fields);
+        }
+        
+        // 设备在状态消息中声明负载格式；旧设备不声明，沿用其上报所用的格式
+        const MessageCodec* advertised = MessageCodec::find(fields.codec);
+        MessageFormat format = advertised ? advertised->format() : detected;
+        
+        const std::string& new_status = fields.status;
+        bool full = fields.full;
+        uint64_t version = fields.version;
+        int64_t now_ticks = DeviceRegistry::nowTicks();
+        DeviceHandle handle = m_devices.intern(device_id);
+        if (handle != DeviceRegistry::INVALID_HANDLE) {
+            m_devices.touch(handle, now_ticks);
+        }
+        
+        DeviceStatus snapshot;
+        bool stale = false;
+        bool request_keyframe = false;
+        bool retry_keyframe = false;
+        m_devices.update(device_id, [&](DeviceStatus& status) {
+            status.last_seen = std::chrono::system_clock::now();
+            status.message_format = format;
+            
+            // 重复或乱序到达的旧增量只刷新活跃时间
+            if (!full && version <= status.status_version) {
+                stale = true;
+                return;
+            }
+            
+            status.status = new_status;
+            if (fields.has_device_type) {
+                status.device_type = fields.device_type;
+            }
+            
+            if (full) {
+                if (fields.has_properties) {
+                    status.properties = fields.properties;
+                }
+                status.awaiting_keyframe = false;
+                status.schema_hash = 0;
+            } else {
+                // 版本不连续说明丢失了增量（或服务端重启后尚无基准），先合并再索取完整关键帧；
+                // 请求或关键帧本身可能丢失（QoS 0、入站降载丢弃），等待超过重试间隔仍未收到时再次索取
+                if (status.awaiting_keyframe) {
+                    retry_keyframe = now_ticks - status.keyframe_requested_ticks >=
+                                     static_cast<int64_t>(KEYFRAME_RETRY_MS) * 1000000;
+                    request_keyframe = retry_keyframe;
+                } else if (version != status.status_version + 1) {
+                    status.awaiting_keyframe = true;
+                    request_keyframe = true;
+                }
+                if (request_keyframe) {
+                    status.keyframe_requested_ticks = now_ticks;
+                }
+                mergeProperties(status.properties, fields.properties);
+            }
+            status.status_version = version;
+            
+            if (m_store) {
+                m_store->logUpsert(status);
+            }
+            
+            if (m_device_status_callback) {
+                snapshot = status;
+            }
+        });
         
-        if (!Json::parseFromStream(builder, stream, &root, &errors)) {
-            std::cerr << "Failed to parse device status JSON: " << errors << std::endl;
+        if (stale) {
             return;
         }
         
-        std::lock_guard<std::mutex> lock(m_devices_mutex);
-        DeviceStatus& status = m_devices[device_id];
+        // 非离线状态的设备需要挂到时间轮上进行超时检测
+        if (handle != DeviceRegistry::INVALID_HANDLE && new_status != "offline") {
+            armLiveness(handle);
+        }
         
-        status.device_id = device_id;
-        status.status = root.get("status", "unknown").asString();
-        status.last_seen = std::chrono::system_clock::now();
+        if (request_keyframe) {
+            std::cout << "Device " << device_id
+                      << (retry_keyframe ? " still awaiting keyframe at version " : " status version gap at ")
+                      << version << ", requesting full report" << std::endl;
+            requestDeviceStatus(std::string(device_id));
+        }
         
-        if (root.isMember("properties")) {
-            status.properties = root["properties"];
+        // 记录数值属性历史（在分片锁外执行，属性名直接引用解析结果，不额外分配）
+        if (handle != DeviceRegistry::INVALID_HANDLE && fields.properties.isObject()) {
+            int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+            const Json::Value& properties = fields.properties;
+            for (auto it = properties.begin(); it != properties.end(); ++it) {
+                const Json::Value& value = it->isObject() ? (*it)["value"] : *it;
+                if (value.isNumeric() && !value.isBool()) {
+                    const char* end = nullptr;
+                    const char* name = it.memberName(&end);
+                    m_history.record(handle, std::string_view(name, end - name), now_ms, value.asDouble());
+                }
+            }
         }
         
-        std::cout << "Device " << device_id << " status updated: " << status.status << std::endl;
+        std::cout << "Device " << device_id << " status updated: " << new_status << std::endl;
         
-        // 调用状态变化回调
+        // 调用状态变化回调（在分片锁外执行）
         if (m_device_status_callback) {
-            m_device_status_callback(device_id, status);
+            m_device_status_callback(std::string(device_id), snapshot);
         }
     } catch (const std::exception& e) {
         std::cerr << "Error handling device status: " << e.what() << std::endl;
     }
 }
 
-void Server::handleCommandResponse(const std::string& device_id, const std::string& payload) {
+void Server::handleCommandResponse(std::string_view device_id, std::string_view payload, std::string_view correlation_id) {
     try {
-        Json::CharReaderBuilder builder;
+        // MQTT v5 设备带回的关联数据就是命令ID；否则JSON响应就地扫描只取命令ID。
+        // 完整的响应内容只在群组命令汇总或回调需要时才构建
+        std::string command_id(correlation_id);
         Json::Value root;
-        std::string errors;
-        std::istringstream stream(payload);
+        bool decoded = false;
         
-        if (!Json::parseFromStream(builder, stream, &root, &errors)) {
-            std::cerr << "Failed to parse command response JSON: " << errors << std::endl;
-            return;
+        if (command_id.empty() && !scanCommandId(payload, command_id)) {
+            std::string errors;
+            if (!MessageCodec::decodeAny(payload, root, &errors)) {
+                std::cerr << "Failed to parse command response: " << errors << std::endl;
+                return;
+            }
+            command_id = root.get("command_id", "").asString();
+            decoded = true;
         }
         
-        std::string command_id = root.get("command_id", "").asString();
         if (command_id.empty()) {
             return;
         }
         
-        // 移除待响应命令
-        {
-            std::lock_guard<std::mutex> lock(m_commands_mutex);
-            m_pending_commands.erase(command_id);
+        auto response = [&]() -> const Json::Value& {
+            // 扫描时已校验语法，只有不支持的转义或数值会转换失败，此时回退到完整解码
+            if (!decoded && !JsonScanner::toValue(payload, root)) {
+                std::string errors;
+                MessageCodec::decodeAny(payload, root, &errors);
+            }
+            decoded = true;
+            return root;
+        };
+        
+        // 群组命令的响应只计入汇总结果
+        if (m_group_commands.isPending(command_id) && m_group_commands.complete(command_id, device_id, response())) {
+            return;
+        }
+        
+        // 结束跟踪并记录往返延迟；集群中每个实例都收到所有设备的响应，只交付本实例发出的命令
+        if (!m_command_tracker.complete(command_id) && !m_cluster_name.empty()) {
+            return;
         }
         
         std::cout << "Received response for command " << command_id << " from device " << device_id << std::endl;
         
         // 调用命令响应回调
         if (m_command_response_callback) {
-            m_command_response_callback(command_id, root);
+            m_command_response_callback(command_id, response());
         }
     } catch (const std::exception& e) {
         std::cerr << "Error handling command response: " << e.what() << std::endl;
     }
 }
 
-void Server::handleDeviceHeartbeat(const std::string& device_id, const std::string& payload) {
-    std::lock_guard<std::mutex> lock(m_devices_mutex);
-    DeviceStatus& status = m_devices[device_id];
+void Server::handleDeviceHeartbeat(std::string_view device_id, std::string_view payload) {
+    // 快速路径：设备已在线时只原子刷新最后活跃时间，不加锁、不分配内存；
+    // 只查找不驻留，未知设备ID的句柄在慢路径建立设备记录时分配
+    DeviceHandle handle = m_devices.findHandle(device_id);
+    if (handle != DeviceRegistry::INVALID_HANDLE &&
+        m_devices.touch(handle, DeviceRegistry::nowTicks())) {
+        return;
+    }
     
-    status.device_id = device_id;
-    status.last_seen = std::chrono::system_clock::now();
+    // 慢路径：离线设备重新上线
+    bool became_online = false;
+    DeviceStatus snapshot;
     
-    // 如果设备之前是离线状态，现在收到心跳，更新为在线
-    if (status.status == "offline" || status.status.empty()) {
-        status.status = "online";
+    m_devices.update(device_id, [&](DeviceStatus& status) {
+        status.last_seen = std::chrono::system_clock::now();
+        
+        // 如果设备之前是离线状态，现在收到心跳，更新为在线
+        if (status.status == "offline" || status.status.empty()) {
+            status.status = "online";
+            became_online = true;
+            if (m_store) {
+                m_store->logUpsert(status);
+            }
+            if (m_device_status_callback) {
+                snapshot = status;
+            }
+        }
+    });
+    
+    if (became_online) {
+        armLiveness(m_devices.findHandle(device_id));
         std::cout << "Device " << device_id << " is now online (heartbeat received)" << std::endl;
         
         if (m_device_status_callback) {
-            m_device_status_callback(device_id, status);
+            m_device_status_callback(std::string(device_id), snapshot);
         }
     }
 }
 
+void Server::handleDeviceSchema(std::string_view device_id, std::string_view payload) {
+    Json::Value root;
+    std::string errors;
+    MessageFormat detected;
+    if (!MessageCodec::decodeAny(payload, root, &errors, &detected)) {
+        std::cerr << "Failed to parse device schema: " << errors << std::endl;
+        return;
+    }
+    
+    PropertySchema schema;
+    if (!PropertySchema::fromJson(root, schema, errors)) {
+        std::cerr << "Invalid schema from device " << device_id << ": " << errors << std::endl;
+        return;
+    }
+    
+    const MessageCodec* advertised = MessageCodec::find(root.get("codec", "").asString());
+    MessageFormat format = advertised ? advertised->format() : detected;
+    std::shared_ptr<const PropertySchema> cached = m_schemas.insert(std::move(schema));
+    
+    m_devices.update(device_id, [&](DeviceStatus& status) {
+        status.device_type = cached->device_type;
+        status.message_format = format;
+    });
+    
+    std::cout << "Device " << device_id << " announced schema " << std::hex << cached->hash << std::dec
+              << " (" << cached->fields.size() << " properties)" << std::endl;
+}
+
+void Server::applyValueFrame(std::string_view device_id, const Json::Value& frame, MessageFormat format) {
+    if (frame.size() < PropertySchema::FRAME_HEADER || !frame[0].isIntegral()) {
+        std::cerr << "Invalid value frame from device " << device_id << std::endl;
+        return;
+    }
+    
+    uint64_t hash = frame[0].asUInt64();
+    std::string new_status = frame[2].asString();
+    
+    // 帧时间戳（秒）是设备的采样时间，属性历史按采样时间记录（不晚于接收时间，
+    // 早于该属性上一个样本时由历史存储按上一个样本的时间记录）；
+    // 最后活跃时间和其他消息一样使用接收时间，设备时钟偏差不影响超时判定
+    auto now = std::chrono::system_clock::now();
+    int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
+    int64_t now_ticks = DeviceRegistry::nowTicks();
+    int64_t sample_ms = now_ms;
+    if (frame[1].isIntegral() && frame[1].asInt64() > 0) {
+        sample_ms = std::min(now_ms, frame[1].asInt64() * 1000);
+    }
+    // 已知设备先刷新活跃时间（帧无法解码时设备同样是活跃的）；新设备的句柄在建立记录时才分配
+    DeviceHandle handle = m_devices.findHandle(device_id);
+    if (handle != DeviceRegistry::INVALID_HANDLE) {
+        m_devices.touch(handle, now_ticks);
+    }
+    
+    // 结构未知（如服务端重启）或帧与结构不符时丢弃本帧的属性值，并向设备索取结构声明
+    std::shared_ptr<const PropertySchema> schema = m_schemas.find(hash);
+    bool valid = schema && frame.size() == PropertySchema::FRAME_HEADER + schema->fields.size();
+    for (size_t i = 0; valid && i < schema->fields.size(); ++i) {
+        valid = PropertySchema::accepts(schema->fields[i],
+                                        frame[static_cast<Json::ArrayIndex>(PropertySchema::FRAME_HEADER + i)]);
+    }
+    if (!valid) {
+        if (m_schemas.shouldRequest(hash, now_ms)) {
+            std::cout << "Unknown schema " << std::hex << hash << std::dec << " from device " << device_id
+                      << ", requesting schema" << std::endl;
+            requestDeviceSchema(device_id, hash);
+        }
+        return;
+    }
+    if (handle == DeviceRegistry::INVALID_HANDLE) {
+        handle = m_devices.intern(device_id);
+        if (handle != DeviceRegistry::INVALID_HANDLE) {
+            m_devices.touch(handle, now_ticks);
+        }
+    }
+    
+    DeviceStatus snapshot;
+    m_devices.update(device_id, [&](DeviceStatus& status) {
+        status.last_seen = now;
+        status.status = new_status;
+        status.device_type = schema->device_type;
+        status.message_format = format;
+        status.awaiting_keyframe = false;
+        
+        // 结构变化时从模板重建属性，之后只按位置覆盖属性值
+        if (status.schema_hash != hash) {
+            status.properties = schema->properties;
+            status.schema_hash = hash;
+        }
+        for (size_t i = 0; i < schema->fields.size(); ++i) {
+            status.properties[schema->fields[i].name]["value"] =
+                frame[static_cast<Json::ArrayIndex>(PropertySchema::FRAME_HEADER + i)];
+        }
+        
+        if (m_store) {
+            m_store->logUpsert(status);
+        }
+        
+        if (m_device_status_callback) {
+            snapshot = status;
+        }
+    });
+    
+    if (handle != DeviceRegistry::INVALID_HANDLE && new_status != "offline") {
+        armLiveness(handle);
+    }
+    
+    // 数值属性的位置和名称由结构给出，无需遍历属性对象
+    if (handle != DeviceRegistry::INVALID_HANDLE) {
+        for (size_t i = 0; i < schema->fields.size(); ++i) {
+            const Json::Value& value = frame[static_cast<Json::ArrayIndex>(PropertySchema::FRAME_HEADER + i)];
+            if (schema->fields[i].type == PropertyType::NUMBER) {
+                m_history.record(handle, schema->fields[i].name, sample_ms, value.asDouble());
+            }
+        }
+    }
+    
+    std::cout << "Device " << device_id << " status updated: " << new_status << std::endl;
+    
+    if (m_device_status_callback) {
+        m_device_status_callback(std::string(device_id), snapshot);
+    }
+}
+
+void Server::requestDeviceSchema(std::string_view device_id, uint64_t hash) {
+    if (!m_mqtt_client || !m_mqtt_client->isConnected()) {
+        return;
+    }
+    
+    Json::Value request;
+    request["type"] = "schema_request";
+    request["schema_hash"] = static_cast<Json::UInt64>(hash);
+    
+    std::string topic = "device/";
+    topic.append(device_id);
+    topic.append("/schema_request");
+    m_mqtt_client->publish(topic, MessageCodec::get(deviceMessageFormat(device_id)).encode(request), 1);
+}
+
+MessageFormat Server::deviceMessageFormat(std::string_view device_id) const {
+    MessageFormat format = MessageFormat::JSON;
+    m_devices.read(device_id, [&](const DeviceStatus& status) {
+        format = status.message_format;
+    });
+    return format;
+}
+
 void Server::deviceTimeoutCheck() {
+    std::vector<DeviceHandle> expired;
+    auto tick = std::chrono::nanoseconds(m_liveness_wheel.tickNanos());
+    
     while (m_running) {
-        auto now = std::chrono::system_clock::now();
-        std::vector<std::string> offline_devices;
-        
+        // 每个刻度推进一次时间轮，stop() 时立即唤醒退出
         {
-            std::lock_guard<std::mutex> lock(m_devices_mutex);
-            for (auto& pair : m_devices) {
-                auto& status = pair.second;
-                auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - status.last_seen).count();
-                
-                if (elapsed > m_device_timeout && status.status != "offline") {
-                    status.status = "offline";
-                    offline_devices.push_back(pair.first);
+            std::unique_lock<std::mutex> lock(m_timeout_mutex);
+            m_timeout_cv.wait_for(lock, tick, [this]() { return !m_running; });
+        }
+        if (!m_running) {
+            break;
+        }
+        
+        int64_t now_ticks = DeviceRegistry::nowTicks();
+        expired.clear();
+        m_liveness_wheel.advance(now_ticks, expired);
+        
+        for (DeviceHandle handle : expired) {
+            expireDevice(handle, now_ticks);
+        }
+        
+        // 集群成员变化后延迟重新划分设备
+        if (!m_cluster_name.empty()) {
+            bool due = false;
+            bool refresh = false;
+            {
+                std::lock_guard<std::mutex> lock(m_cluster_mutex);
+                if (m_rebalance_due != 0 && now_ticks >= m_rebalance_due) {
+                    due = true;
+                    refresh = m_rebalance_refresh;
+                    m_rebalance_due = 0;
+                    m_rebalance_refresh = false;
+                }
+            }
+            if (due) {
+                rebalanceCluster();
+                // 离开的成员（可能异常退出）未移交设备，请求所有设备重新上报，由新的归属实例接收
+                if (refresh) {
+                    requestDeviceStatus();
                 }
             }
         }
-        
-        // 通知设备离线
-        for (const auto& device_id : offline_devices) {
-            std::cout << "Device " << device_id << " is now offline (timeout)" << std::endl;
-            if (m_device_status_callback) {
-                auto status = getDeviceStatus(device_id);
-                if (status) {
-                    m_device_status_callback(device_id, *status);
+    }
+}
+
+void Server::armLiveness(DeviceHandle handle) {
+    if (handle == DeviceRegistry::INVALID_HANDLE) {
+        return;
+    }
+    int64_t timeout_ticks = static_cast<int64_t>(m_device_timeout) * 1000000000LL;
+    m_liveness_wheel.arm(handle, m_devices.lastSeenTicks(handle) + timeout_ticks);
+}
+
+void Server::expireDevice(DeviceHandle handle, int64_t now_ticks) {
+    int64_t timeout_ticks = static_cast<int64_t>(m_device_timeout) * 1000000000LL;
+    
+    // 到期期间收到过心跳或状态更新：按最新活跃时间重新挂载
+    if (m_devices.lastSeenTicks(handle) + timeout_ticks > now_ticks) {
+        armLiveness(handle);
+        return;
+    }
+    
+    const std::string& device_id = m_devices.deviceId(handle);
+    std::string previous_status;
+    bool went_offline = false;
+    DeviceStatus snapshot;
+    
+    m_devices.modify(device_id, [&](DeviceStatus& status) {
+        if (status.status != "offline" &&
+            m_devices.lastSeenTicks(handle) + timeout_ticks <= now_ticks) {
+            previous_status = status.status;
+            status.status = "offline";
+            went_offline = true;
+            snapshot = status;
+            if (m_store) {
+                m_store->logUpsert(status);
+            }
+        }
+    });
+    
+    if (!went_offline) {
+        return;
+    }
+    
+    // 在线标志清除后再次检查时间戳：若与并发心跳交错，恢复原状态而不是误报离线
+    if (m_devices.lastSeenTicks(handle) + timeout_ticks > now_ticks) {
+        m_devices.modify(device_id, [&](DeviceStatus& status) {
+            if (status.status == "offline") {
+                status.status = previous_status;
+                if (m_store) {
+                    m_store->logUpsert(status);
                 }
             }
+        });
+        armLiveness(handle);
+        return;
+    }
+    
+    std::cout << "Device " << device_id << " is now offline (timeout)" << std::endl;
+    if (m_device_status_callback) {
+        m_device_status_callback(device_id, snapshot);
+    }
+}
+
+bool Server::ownsDevice(std::string_view device_id) const {
+    return m_cluster_name.empty() || m_cluster_ring.owner(device_id) == m_server_id;
+}
+
+std::string Server::clusterTopic(const std::string& suffix) const {
+    return "cluster/" + m_cluster_name + "/" + suffix;
+}
+
+bool Server::sendToMember(const std::string& member_id, const Json::Value& message) const {
+    if (!m_mqtt_client || !m_mqtt_client->isConnected()) {
+        return false;
+    }
+    return m_mqtt_client->publish(clusterTopic("rpc/" + member_id),
+                                  MessageCodec::get(MessageFormat::JSON).encode(message), 1);
+}
+
+void Server::announceMembership() {
+    Json::Value member(Json::objectValue);
+    member["server_id"] = m_server_id;
+    member["timestamp"] = Json::Int64(std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    m_mqtt_client->publish(clusterTopic("members/" + m_server_id),
+                           MessageCodec::get(MessageFormat::JSON).encode(member), 1, true);
+}
+
+std::shared_ptr<DeviceStatus> Server::queryOwner(const std::string& owner, const std::string& device_id) const {
+    uint64_t request_id = m_cluster_request_counter.fetch_add(1) + 1;
+    Json::Value message(Json::objectValue);
+    message["type"] = "status_query";
+    message["request_id"] = Json::UInt64(request_id);
+    message["device_id"] = device_id;
+    message["reply_to"] = m_server_id;
+    m_forwarded_queries.fetch_add(1, std::memory_order_relaxed);
+    
+    // 先登记再发送，避免回复先于登记到达
+    Json::Value reply;
+    {
+        std::unique_lock<std::mutex> lock(m_cluster_request_mutex);
+        m_cluster_replies.emplace(request_id, Json::Value());
+        lock.unlock();
+        bool sent = sendToMember(owner, message);
+        lock.lock();
+        if (sent) {
+            m_cluster_request_cv.wait_for(lock, std::chrono::milliseconds(m_cluster_request_timeout_ms.load()),
+                [&]() { return !m_cluster_replies[request_id].isNull(); });
         }
-        
-        // 每30秒检查一次
-        std::this_thread::sleep_for(std::chrono::seconds(30));
+        reply.swap(m_cluster_replies[request_id]);
+        m_cluster_replies.erase(request_id);
+    }
+    
+    auto status = std::make_shared<DeviceStatus>();
+    if (!reply.isMember("status") || !statusFromJson(reply["status"], *status)) {
+        m_failed_queries.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
     }
+    return status;
 }
 
-std::string Server::generateCommandId() {
+void Server::handleClusterMember(std::string_view member_id, std::string_view payload) {
+    std::string id(member_id);
+    bool leaving = payload.empty();
+    
+    // 遗嘱消息或本实例的旧会话清除了成员声明：仍在运行时重新声明
+    if (id == m_server_id) {
+        if (leaving && m_running) {
+            announceMembership();
+        }
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(m_cluster_mutex);
+    bool changed = leaving ? m_cluster_members.erase(id) > 0 : m_cluster_members.insert(id).second;
+    if (!changed) {
+        return;
+    }
+    
+    // 哈希环立即更新（此后的消息按新的归属处理），设备移交合并短时间内的多次变化后进行
+    m_cluster_ring.setMembers(std::vector<std::string>(m_cluster_members.begin(), m_cluster_members.end()));
+    m_rebalance_due = DeviceRegistry::nowTicks() + REBALANCE_DELAY_MS * 1000000LL;
+    m_rebalance_refresh = m_rebalance_refresh || leaving;
+    std::cout << "Cluster member " << id << (leaving ? " left" : " joined") << ", "
+              << m_cluster_members.size() << " member(s)" << std::endl;
+}
+
+void Server::handleClusterMessage(std::string_view payload) {
+    Json::Value message;
+    std::string errors;
+    if (!MessageCodec::decodeAny(payload, message, &errors) || !message.isObject()) {
+        std::cerr << "Failed to parse cluster message: " << errors << std::endl;
+        return;
+    }
+    
+    const std::string type = message.get("type", "").asString();
+    if (type == "command") {
+        // 转发的命令由发起实例跟踪和重发，这里只按设备声明的格式发布
+        std::string device_id = message["device_id"].asString();
+        const std::string& command = encodeCommand(message["command_id"].asString(), device_id,
+                                                   message["command_type"].asString(), message["parameters"]);
+        if (!publishCommand(message["command_id"].asString(), device_id, command, message.get("qos", 1).asInt(),
+                            message.get("timeout_ms", 0).asInt())) {
+            std::cerr << "Failed to send forwarded command to device " << device_id << std::endl;
+        }
+    } else if (type == "status_query") {
+        Json::Value reply(Json::objectValue);
+        reply["type"] = "status_reply";
+        reply["request_id"] = message["request_id"];
+        DeviceStatus status;
+        if (m_devices.get(message["device_id"].asString(), status)) {
+            reply["status"] = statusToJson(status);
+        }
+        sendToMember(message["reply_to"].asString(), reply);
+    } else if (type == "status_reply") {
+        std::lock_guard<std::mutex> lock(m_cluster_request_mutex);
+        auto it = m_cluster_replies.find(message["request_id"].asUInt64());
+        if (it != m_cluster_replies.end()) {
+            it->second.swap(message);
+            m_cluster_request_cv.notify_all();
+        }
+    } else if (type == "handoff") {
+        // 离开的实例先移交设备再清除成员声明：按其已离开处理，避免因归属未更新而拒收
+        if (message.get("leaving", false).asBool()) {
+            handleClusterMember(message["from"].asString(), "");
+        }
+        acceptHandoff(message["devices"]);
+    }
+}
+
+void Server::acceptHandoff(const Json::Value& devices) {
+    if (!devices.isArray()) {
+        return;
+    }
+    
+    int64_t now_ticks = DeviceRegistry::nowTicks();
     auto now = std::chrono::system_clock::now();
-    auto timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
-    auto counter = m_command_counter.fetch_add(1);
+    size_t accepted = 0;
+    for (const auto& value : devices) {
+        DeviceStatus incoming;
+        // 移交途中成员可能再次变化，只接收仍归属本实例的设备
+        if (!statusFromJson(value, incoming) || !ownsDevice(incoming.device_id)) {
+            continue;
+        }
+        DeviceHandle handle = m_devices.intern(incoming.device_id);
+        if (handle == DeviceRegistry::INVALID_HANDLE) {
+            continue;
+        }
+        
+        // 设备已直接向本实例上报过更新的状态时保留本地记录
+        int64_t seen_ticks = now_ticks - std::chrono::duration_cast<std::chrono::nanoseconds>(now - incoming.last_seen).count();
+        if (m_devices.contains(incoming.device_id) && m_devices.lastSeenTicks(handle) >= seen_ticks) {
+            continue;
+        }
+        
+        m_devices.touch(handle, seen_ticks);
+        m_devices.update(incoming.device_id, [&](DeviceStatus& status) {
+            status.device_type = incoming.device_type;
+            status.status = incoming.status;
+            status.properties = incoming.properties;
+            status.status_version = incoming.status_version;
+            status.awaiting_keyframe = false;
+            status.message_format = incoming.message_format;
+            status.schema_hash = incoming.schema_hash;
+            if (m_store) {
+                m_store->logUpsert(status);
+            }
+        });
+        if (incoming.status != "offline") {
+            armLiveness(handle);
+        }
+        ++accepted;
+    }
     
-    std::ostringstream oss;
-    oss << "cmd_" << timestamp << "_" << counter;
-    return oss.str();
+    m_taken_over.fetch_add(accepted, std::memory_order_relaxed);
+    if (accepted > 0) {
+        std::cout << "Took over " << accepted << " device(s) from cluster member" << std::endl;
+    }
 }
 
-std::string Server::parseDeviceIdFromTopic(const std::string& topic) {
-    // 主题格式: device/{device_id}/{message_type}
-    size_t first_slash = topic.find('/');
-    if (first_slash == std::string::npos) {
-        return "";
+void Server::rebalanceCluster() {
+    std::lock_guard<std::mutex> rebalance_lock(m_rebalance_mutex);
+    
+    // 先在分片锁内收集不再归属本实例的设备及其版本和最后活跃时间，发送和删除在锁外进行
+    struct Released {
+        std::string device_id;
+        uint64_t status_version;
+        int64_t seen_ticks;
+    };
+    std::map<std::string, std::vector<Json::Value>> handoff;
+    std::vector<Released> released;
+    m_devices.forEach([&](const DeviceStatus& status) {
+        const std::string& owner = m_cluster_ring.owner(status.device_id);
+        if (owner == m_server_id) {
+            return;
+        }
+        DeviceHandle handle = m_devices.findHandle(status.device_id);
+        int64_t seen_ticks = handle != DeviceRegistry::INVALID_HANDLE ? m_devices.lastSeenTicks(handle) : 0;
+        released.push_back(Released{status.device_id, status.status_version, seen_ticks});
+        // 没有其他成员时（最后一个成员离开）设备直接丢弃
+        if (!owner.empty()) {
+            handoff[owner].push_back(statusToJson(status));
+        }
+    });
+    
+    size_t handed_off = sendHandoff(handoff);
+    
+    // 删除时在分片锁内重新检查：期间成员再次变化、设备重新归属本实例的保留；
+    // 期间收到状态或心跳的设备，把最新状态再移交一次
+    std::map<std::string, std::vector<Json::Value>> resend;
+    size_t erased = 0;
+    for (const auto& entry : released) {
+        DeviceHandle handle = m_devices.findHandle(entry.device_id);
+        bool removed = m_devices.eraseIf(entry.device_id, [&](const DeviceStatus& status) {
+            const std::string& owner = m_cluster_ring.owner(status.device_id);
+            if (owner == m_server_id) {
+                return false;
+            }
+            int64_t seen_ticks = handle != DeviceRegistry::INVALID_HANDLE ? m_devices.lastSeenTicks(handle) : 0;
+            if (!owner.empty() && (status.status_version != entry.status_version || seen_ticks != entry.seen_ticks)) {
+                resend[owner].push_back(statusToJson(status));
+            }
+            return true;
+        });
+        if (!removed) {
+            continue;
+        }
+        ++erased;
+        if (handle != DeviceRegistry::INVALID_HANDLE) {
+            m_liveness_wheel.disarm(handle);
+        }
     }
+    size_t refreshed = sendHandoff(resend);
     
-    size_t second_slash = topic.find('/', first_slash + 1);
-    if (second_slash == std::string::npos) {
-        return "";
+    // 快照只包含归属本实例的设备，之前日志中已移交的设备随之清除
+    if (m_store && erased > 0 && m_running) {
+        m_store->snapshot();
+    }
+    
+    m_rebalances.fetch_add(1, std::memory_order_relaxed);
+    m_handed_off.fetch_add(handed_off, std::memory_order_relaxed);
+    std::cout << "Cluster rebalanced across " << m_cluster_ring.members().size() << " member(s): handed off "
+              << handed_off << " device(s)";
+    if (refreshed > 0) {
+        std::cout << " (" << refreshed << " resent with newer state)";
     }
+    std::cout << ", " << m_devices.size() << " owned" << std::endl;
+}
+
+size_t Server::sendHandoff(std::map<std::string, std::vector<Json::Value>>& handoff) {
+    size_t count = 0;
+    for (auto& pair : handoff) {
+        count += pair.second.size();
+        for (size_t begin = 0; begin < pair.second.size(); begin += HANDOFF_BATCH) {
+            Json::Value message(Json::objectValue);
+            message["type"] = "handoff";
+            message["from"] = m_server_id;
+            message["leaving"] = !m_running;
+            Json::Value& devices = message["devices"] = Json::Value(Json::arrayValue);
+            size_t end = std::min(pair.second.size(), begin + HANDOFF_BATCH);
+            for (size_t i = begin; i < end; ++i) {
+                devices.append(std::move(pair.second[i]));
+            }
+            if (!sendToMember(pair.first, message)) {
+                std::cerr << "Failed to hand off devices to " << pair.first << std::endl;
+            }
+        }
+    }
+    return count;
+}
+
+std::string Server::generateCommandId() {
+    auto now = std::chrono::system_clock::now();
+    auto timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
+    auto counter = m_command_counter.fetch_add(1);
     
-    return topic.substr(first_slash + 1, second_slash - first_slash - 1);
-}
\ No newline at end of file
+    std::string command_id = "cmd_";
+    // 集群中各实例的命令ID互不重复
+    if (!m_cluster_name.empty()) {
+        command_id += m_server_id;
+        command_id += '_';
+    }
+    command_id += std::to_string(timestamp);
+    command_id += '_';
+    command_id += std::to_string(counter);
+    return command_id;
+}
@@ -3,6 +3,8 @@
 #include <signal.h>
 #include <thread>
 #include <chrono>
+#include <fstream>
+#include <algorithm>
 #include <json/json.h>
 
 // 全局服务端实例
@@ -28,6 +30,19 @@ void printHelp() {
     std::cout << "  -H, --host <host>    MQTT broker host (default: localhost)" << std::endl;
     std::cout << "  -p, --port <port>    MQTT broker port (default: 1883)" << std::endl;
     std::cout << "  -t, --timeout <sec>  Device timeout in seconds (default: 300)" << std::endl;
+    std::cout << "  -c, --config <path>  Load server settings from JSON config file" << std::endl;
+    std::cout << "  --max-devices <n>    Expected device count for registry pre-sizing" << std::endl;
+    std::cout << "  --command-timeout <ms> Command response timeout in milliseconds (default: 30000)" << std::endl;
+    std::cout << "  --workers <n>        Ingress worker threads for message handling (default: 0, inline)" << std::endl;
+    std::cout << "  --ingress-capacity <n> Ingress queue capacity before load shedding (default: 65536)" << std::endl;
+    std::cout << "  --ingest-connections <n> Broker connections sharing device subscriptions (default: 0, single connection)" << std::endl;
+    std::cout << "  --share-group <name> Shared subscription group (default: server_<id>)" << std::endl;
+    std::cout << "  --cluster <name>     Join a server cluster and split devices by consistent hashing" << std::endl;
+    std::cout << "  --mqtt5              Use MQTT v5 (command correlation data and message expiry)" << std::endl;
+    std::cout << "  --persistent-session Keep subscriptions and queued QoS 1 messages across reconnects" << std::endl;
+    std::cout << "  --history-capacity <n> Samples kept per numeric device property (default: 1024)" << std::endl;
+    std::cout << "  --data-dir <path>    Persist the device registry (write-ahead log + snapshots)" << std::endl;
+    std::cout << "  --snapshot-interval <sec> Registry snapshot interval in seconds (default: 300)" << std::endl;
     std::cout << "  --ssl                Enable SSL/TLS connection" << std::endl;
     std::cout << "  --ca-file <path>     CA certificate file path" << std::endl;
     std::cout << "  --cert-file <path>   Client certificate file path" << std::endl;
@@ -39,6 +54,29 @@ void printHelp() {
     std::cout << "  --password <pass>    MQTT password for authentication" << std::endl;
 }
 
+// 从JSON配置文件加载服务端设置
+bool loadServerConfig(const std::string& path, size_t& max_devices) {
+    std::ifstream config_file(path);
+    if (!config_file.is_open()) {
+        std::cerr << "Failed to open config file: " << path << std::endl;
+        return false;
+    }
+    
+    Json::CharReaderBuilder builder;
+    Json::Value config;
+    std::string errors;
+    if (!Json::parseFromStream(builder, config_file, &config, &errors)) {
+        std::cerr << "Failed to parse config file: " << errors << std::endl;
+        return false;
+    }
+    
+    const Json::Value& server_config = config["server"];
+    if (server_config.isMember("max_devices")) {
+        max_devices = server_config["max_devices"].asUInt64();
+    }
+    return true;
+}
+
 // 交互式命令处理
 void processInteractiveCommands(Server* server) {
     std::string input;
@@ -61,23 +99,35 @@ void processInteractiveCommands(Server* server) {
             std::cout << "  status                   - Show server status" << std::endl;
             std::cout << "  devices                  - List all devices" << std::endl;
             std::cout << "  online                   - List online devices" << std::endl;
+            std::cout << "  find <status|*> [type]   - List devices by status and type" << std::endl;
             std::cout << "  device <id>              - Show device details" << std::endl;
             std::cout << "  send <device_id> <cmd>   - Send command to device" << std::endl;
+            std::cout << "  broadcast <cmd>          - Send command to all online devices" << std::endl;
+            std::cout << "  group <name> <cmd>       - Send command via group topic" << std::endl;
             std::cout << "  refresh [device_id]      - Request device status update" << std::endl;
+            std::cout << "  latency                  - Show command round-trip latency" << std::endl;
+            std::cout << "  ingress                  - Show ingress queue statistics" << std::endl;
+            std::cout << "  history <id> [prop] [sec] [n] - Show property history" << std::endl;
+            std::cout << "  persist                  - Show persistence statistics" << std::endl;
+            std::cout << "  cluster [device_id]      - Show cluster members or a device's owner" << std::endl;
             std::cout << "  quit                     - Exit server" << std::endl;
         }
         else if (command == "status") {
-            auto devices = server->getAllDeviceStatus();
+            auto counts = server->getDeviceCounts();
+            size_t total = 0;
+            for (const auto& pair : counts) {
+                total += pair.second;
+            }
             std::cout << "Server Status:" << std::endl;
-            std::cout << "  Total devices: " << devices.size() << std::endl;
-            
-            int online_count = 0;
-            for (const auto& pair : devices) {
-                if (pair.second.status == "online") {
-                    online_count++;
+            std::cout << "  Total devices: " << total << std::endl;
+            std::cout << "  Online devices: " << counts["online"] << std::endl;
+            for (const auto& pair : counts) {
+                if (pair.first != "online") {
+                    std::cout << "  " << pair.first << " devices: " << pair.second << std::endl;
                 }
             }
-            std::cout << "  Online devices: " << online_count << std::endl;
+            std::cout << "  Pending commands: " << server->getPendingCommandCount() << std::endl;
+            std::cout << "  Pending group commands: " << server->getPendingGroupCommandCount() << std::endl;
         }
         else if (command == "devices") {
             auto devices = server->getAllDeviceStatus();
@@ -98,6 +148,22 @@ void processInteractiveCommands(Server* server) {
                 std::cout << "  " << device_id << std::endl;
             }
         }
+        else if (command == "find") {
+            std::string status, device_type;
+            iss >> status >> device_type;
+            if (status.empty()) {
+                std::cout << "Usage: find <status|*> [device_type]" << std::endl;
+            } else {
+                if (status == "*") {
+                    status.clear();
+                }
+                auto devices = server->findDevices(status, device_type);
+                std::cout << "Matched " << devices.size() << " device(s):" << std::endl;
+                for (const auto& device_id : devices) {
+                    std::cout << "  " << device_id << std::endl;
+                }
+            }
+        }
         else if (command == "device") {
             std::string device_id;
             iss >> device_id;
@@ -108,6 +174,9 @@ void processInteractiveCommands(Server* server) {
                 if (status) {
                     std::cout << "Device " << device_id << ":" << std::endl;
                     std::cout << "  Status: " << status->status << std::endl;
+                    if (!status->device_type.empty()) {
+                        std::cout << "  Type: " << status->device_type << std::endl;
+                    }
                     
                     auto now = std::chrono::system_clock::now();
                     auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - status->last_seen).count();
@@ -164,6 +233,131 @@ void processInteractiveCommands(Server* server) {
                 std::cout << "Requested status update from device " << device_id << std::endl;
             }
         }
+        else if (command == "broadcast") {
+            std::string cmd_type;
+            iss >> cmd_type;
+            if (cmd_type.empty()) {
+                std::cout << "Usage: broadcast <command_type>" << std::endl;
+            } else {
+                auto devices = server->getOnlineDevices();
+                std::string cmd_id = server->sendCommandToGroup("online", devices, cmd_type);
+                if (!cmd_id.empty()) {
+                    std::cout << "Command " << cmd_id << " sent to " << devices.size() << " online device(s)" << std::endl;
+                } else {
+                    std::cout << "Failed to send command" << std::endl;
+                }
+            }
+        }
+        else if (command == "group") {
+            std::string group, cmd_type;
+            iss >> group >> cmd_type;
+            if (group.empty() || cmd_type.empty()) {
+                std::cout << "Usage: group <name> <command_type>" << std::endl;
+            } else {
+                GroupCommandOptions options;
+                options.use_group_topic = true;
+                std::string cmd_id = server->sendCommandToGroup(group, {}, cmd_type, Json::Value(), options);
+                if (!cmd_id.empty()) {
+                    std::cout << "Command " << cmd_id << " published to group " << group << std::endl;
+                } else {
+                    std::cout << "Failed to send command" << std::endl;
+                }
+            }
+        }
+        else if (command == "latency") {
+            auto stats = server->getCommandLatencyStats();
+            std::cout << "Command Latency (ms):" << std::endl;
+            if (stats.empty()) {
+                std::cout << "  (no responses yet)" << std::endl;
+            }
+            for (const auto& pair : stats) {
+                const auto& summary = pair.second;
+                std::cout << "  " << pair.first << ": count=" << summary.count
+                         << " p50=" << summary.p50_us / 1000.0
+                         << " p90=" << summary.p90_us / 1000.0
+                         << " p99=" << summary.p99_us / 1000.0
+                         << " max=" << summary.max_us / 1000.0 << std::endl;
+            }
+        }
+        else if (command == "ingress") {
+            IngressStats stats = server->getIngressStats();
+            std::cout << "Ingress Queue:" << std::endl;
+            std::cout << "  Depth: " << stats.queue_depth << " / " << stats.queue_capacity << std::endl;
+            std::cout << "  Enqueued: " << stats.enqueued << std::endl;
+            std::cout << "  Coalesced heartbeats: " << stats.coalesced_heartbeats << std::endl;
+            std::cout << "  Coalesced statuses: " << stats.coalesced_statuses << std::endl;
+            std::cout << "  Dropped heartbeats: " << stats.dropped_heartbeats << std::endl;
+            std::cout << "  Dropped statuses: " << stats.dropped_statuses << std::endl;
+            std::cout << "  Shedding workers: " << stats.shedding_workers << std::endl;
+        }
+        else if (command == "persist") {
+            RegistryStoreStats stats = server->getPersistenceStats();
+            std::cout << "Persistence:" << std::endl;
+            std::cout << "  Log generation: " << stats.generation << " (" << stats.wal_bytes << " bytes)" << std::endl;
+            std::cout << "  Log records: " << stats.wal_records << " in " << stats.syncs << " sync(s)" << std::endl;
+            std::cout << "  Dropped records: " << stats.dropped_records << std::endl;
+            std::cout << "  Snapshots: " << stats.snapshots << " (last: " << stats.last_snapshot_devices
+                     << " devices in " << stats.last_snapshot_ms << " ms)" << std::endl;
+            std::cout << "  Recovery: " << stats.recovered_devices << " devices, " << stats.replayed_records
+                     << " log records in " << stats.recovery_ms << " ms" << std::endl;
+        }
+        else if (command == "cluster") {
+            std::string device_id;
+            iss >> device_id;
+            auto members = server->getClusterMembers();
+            if (members.empty()) {
+                std::cout << "Clustering is not enabled" << std::endl;
+            } else if (!device_id.empty()) {
+                std::cout << "Device " << device_id << " is owned by " << server->getDeviceOwner(device_id) << std::endl;
+            } else {
+                ClusterStats stats = server->getClusterStats();
+                std::cout << "Cluster Members:" << std::endl;
+                for (const auto& member : members) {
+                    std::cout << "  " << member << std::endl;
+                }
+                std::cout << "  Rebalances: " << stats.rebalances << std::endl;
+                std::cout << "  Devices handed off / taken over: " << stats.handed_off << " / " << stats.taken_over << std::endl;
+                std::cout << "  Forwarded commands: " << stats.forwarded_commands << std::endl;
+                std::cout << "  Forwarded queries: " << stats.forwarded_queries << " (" << stats.failed_queries
+                         << " failed)" << std::endl;
+                std::cout << "  Ignored messages for other members' devices: " << stats.unowned_messages << std::endl;
+            }
+        }
+        else if (command == "history") {
+            std::string device_id, property;
+            int64_t seconds = 3600;
+            int64_t buckets = 0;
+            iss >> device_id >> property >> seconds >> buckets;
+            if (device_id.empty()) {
+                std::cout << "Usage: history <device_id> [property] [seconds] [buckets]" << std::endl;
+            } else if (property.empty()) {
+                auto properties = server->getDeviceHistoryProperties(device_id);
+                std::cout << "Recorded properties for " << device_id << ":" << std::endl;
+                for (const auto& name : properties) {
+                    std::cout << "  " << name << std::endl;
+                }
+            } else {
+                int64_t to_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::system_clock::now().time_since_epoch()).count();
+                int64_t from_ms = to_ms - seconds * 1000;
+                if (buckets > 0) {
+                    int64_t bucket_ms = std::max<int64_t>(seconds * 1000 / buckets, 1);
+                    auto result = server->getPropertyHistoryDownsampled(device_id, property, from_ms, to_ms, bucket_ms);
+                    std::cout << device_id << "." << property << " (" << result.size() << " buckets):" << std::endl;
+                    for (const auto& bucket : result) {
+                        std::cout << "  " << (bucket.start_ms - from_ms) / 1000 << "s: count=" << bucket.count
+                                 << " min=" << bucket.min << " max=" << bucket.max
+                                 << " avg=" << bucket.avg << std::endl;
+                    }
+                } else {
+                    auto samples = server->getPropertyHistory(device_id, property, from_ms, to_ms);
+                    std::cout << device_id << "." << property << " (" << samples.size() << " samples):" << std::endl;
+                    for (const auto& sample : samples) {
+                        std::cout << "  -" << (to_ms - sample.timestamp_ms) / 1000.0 << "s: " << sample.value << std::endl;
+                    }
+                }
+            }
+        }
         else if (command == "quit" || command == "exit") {
             g_running = false;
             break;
@@ -184,6 +378,18 @@ int main(int argc, char* argv[]) {
     std::string mqtt_host = "localhost";
     int mqtt_port = 1883;
     int device_timeout = 300;
+    size_t max_devices = 0;
+    int command_timeout_ms = 30000;
+    size_t ingress_workers = 0;
+    size_t ingress_capacity = 65536;
+    size_t ingest_connections = 0;
+    std::string share_group;
+    std::string cluster_name;
+    bool mqtt5 = false;
+    bool persistent_session = false;
+    size_t history_capacity = 1024;
+    std::string data_dir;
+    int snapshot_interval = 300;
     
     // SSL配置参数
     bool ssl_enabled = false;
@@ -218,6 +424,47 @@ int main(int argc, char* argv[]) {
         else if ((arg == "-t" || arg == "--timeout") && i + 1 < argc) {
             device_timeout = std::atoi(argv[++i]);
         }
+        else if ((arg == "-c" || arg == "--config") && i + 1 < argc) {
+            if (!loadServerConfig(argv[++i], max_devices)) {
+                return 1;
+            }
+        }
+        else if (arg == "--max-devices" && i + 1 < argc) {
+            max_devices = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--command-timeout" && i + 1 < argc) {
+            command_timeout_ms = std::atoi(argv[++i]);
+        }
+        else if (arg == "--workers" && i + 1 < argc) {
+            ingress_workers = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--ingress-capacity" && i + 1 < argc) {
+            ingress_capacity = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--ingest-connections" && i + 1 < argc) {
+            ingest_connections = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--share-group" && i + 1 < argc) {
+            share_group = argv[++i];
+        }
+        else if (arg == "--cluster" && i + 1 < argc) {
+            cluster_name = argv[++i];
+        }
+        else if (arg == "--mqtt5") {
+            mqtt5 = true;
+        }
+        else if (arg == "--persistent-session") {
+            persistent_session = true;
+        }
+        else if (arg == "--history-capacity" && i + 1 < argc) {
+            history_capacity = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--data-dir" && i + 1 < argc) {
+            data_dir = argv[++i];
+        }
+        else if (arg == "--snapshot-interval" && i + 1 < argc) {
+            snapshot_interval = std::atoi(argv[++i]);
+        }
         else if (arg == "--ssl") {
             ssl_enabled = true;
         }
@@ -323,6 +570,39 @@ int main(int argc, char* argv[]) {
         // 设置设备超时时间
         g_server->setDeviceTimeout(device_timeout);
         
+        // 设置命令响应超时
+        g_server->setCommandTimeout(command_timeout_ms);
+        
+        // 预分配设备注册表容量
+        if (max_devices > 0) {
+            g_server->setMaxDevices(max_devices);
+        }
+        
+        // 设置入站消息工作线程数量
+        g_server->setIngressWorkers(ingress_workers);
+        g_server->setIngressQueueCapacity(ingress_capacity);
+        
+        // 设置共享订阅入站连接
+        g_server->setIngestConnections(ingest_connections, share_group);
+        
+        // 加入服务端集群
+        g_server->setCluster(cluster_name);
+        
+        // 设置MQTT协议版本
+        g_server->setMqtt5(mqtt5);
+        
+        // 设置持久会话
+        if (persistent_session) {
+            g_server->setPersistentSession(true);
+        }
+        
+        // 设置属性历史容量
+        g_server->setHistoryCapacity(history_capacity);
+        
+        // 设置注册表持久化
+        g_server->setDataDirectory(data_dir);
+        g_server->setSnapshotInterval(snapshot_interval);
+        
         // 设置回调函数
         g_server->setDeviceStatusCallback([](const std::string& device_id, const DeviceStatus& status) {
             std::cout << "\nDevice " << device_id << " status changed to: " << status.status << std::endl;
@@ -338,6 +618,27 @@ int main(int argc, char* argv[]) {
             std::cout << "server> " << std::flush;
         });
         
+        g_server->setGroupCommandCallback([](const GroupCommandResult& result) {
+            std::cout << "\nGroup command " << result.command_id << " (" << result.command_type
+                     << ") to " << result.group << ": " << result.success_count << " succeeded, "
+                     << result.failure_count << " failed";
+            if (result.target_count > 0) {
+                std::cout << ", " << result.timed_out_devices.size() << " of "
+                         << result.target_count << " timed out";
+            } else if (result.timed_out) {
+                std::cout << ", collected until timeout";
+            }
+            std::cout << " (" << result.elapsed_ms << " ms)" << std::endl;
+            std::cout << "server> " << std::flush;
+        });
+        
+        g_server->setCommandTimeoutCallback([](const ControlCommand& command, int attempts) {
+            std::cout << "\nCommand " << command.command_id << " (" << command.command_type
+                     << ") to device " << command.device_id << " timed out after "
+                     << attempts << " attempt(s)" << std::endl;
+            std::cout << "server> " << std::flush;
+        });
+        
         // 启动服务端
         if (!g_server->start()) {
             std::cerr << "Failed to start server" << std::endl;
@@ -348,6 +649,24 @@ int main(int argc, char* argv[]) {
         std::cout << "  Server ID: " << server_id << std::endl;
         std::cout << "  MQTT Broker: " << mqtt_host << ":" << mqtt_port << std::endl;
         std::cout << "  Device Timeout: " << device_timeout << " seconds" << std::endl;
+        if (max_devices > 0) {
+            std::cout << "  Max Devices: " << max_devices << std::endl;
+        }
+        if (ingress_workers > 0) {
+            std::cout << "  Ingress Workers: " << ingress_workers << std::endl;
+        }
+        if (ingest_connections > 0) {
+            std::cout << "  Ingest Connections: " << ingest_connections << std::endl;
+        }
+        if (!cluster_name.empty()) {
+            std::cout << "  Cluster: " << cluster_name << std::endl;
+        }
+        if (mqtt5) {
+            std::cout << "  Protocol: MQTT v5" << std::endl;
+        }
+        if (persistent_session) {
+            std::cout << "  Persistent Session: enabled" << std::endl;
+        }
         
         // 处理交互式命令
         processInteractiveCommands(g_server.get());
@@ -0,0 +1,175 @@
+#include "topic_router.h"
+#include <algorithm>
+#include <iostream>
+
+TopicRouter::TopicRouter() {
+    m_nodes.emplace_back();
+}
+
+bool TopicRouter::addRoute(const std::string& filter, Handler handler) {
+    if (!handler || !isValidFilter(filter)) {
+        std::cerr << "Invalid topic filter: " << filter << std::endl;
+        return false;
+    }
+
+    uint32_t node = 0;
+    std::string_view rest(filter);
+    while (true) {
+        size_t slash = rest.find('/');
+        std::string_view segment = rest.substr(0, slash);
+
+        if (segment == "+") {
+            if (m_nodes[node].single_child == NIL) {
+                m_nodes[node].single_child = static_cast<uint32_t>(m_nodes.size());
+                m_nodes.emplace_back();
+            }
+            node = m_nodes[node].single_child;
+        } else if (segment == "#") {
+            if (m_nodes[node].multi_child == NIL) {
+                m_nodes[node].multi_child = static_cast<uint32_t>(m_nodes.size());
+                m_nodes.emplace_back();
+            }
+            node = m_nodes[node].multi_child;
+        } else {
+            node = addLiteralChild(node, segment);
+        }
+
+        if (slash == std::string_view::npos) {
+            break;
+        }
+        rest.remove_prefix(slash + 1);
+    }
+
+    m_nodes[node].routes.push_back(static_cast<uint32_t>(m_handlers.size()));
+    m_handlers.push_back(std::move(handler));
+    return true;
+}
+
+size_t TopicRouter::dispatch(const MessageView& message) const {
+    std::string_view topic = message.topic;
+    if (topic.empty()) {
+        return 0;
+    }
+
+    TopicCaptures captures;
+    size_t matched = 0;
+    match(0, topic, 0, topic.front() == '$', captures, message, matched);
+    return matched;
+}
+
+void TopicRouter::clear() {
+    m_nodes.clear();
+    m_nodes.emplace_back();
+    m_handlers.clear();
+}
+
+bool TopicRouter::isValidFilter(std::string_view filter) {
+    if (filter.empty()) {
+        return false;
+    }
+
+    size_t wildcards = 0;
+    size_t start = 0;
+    while (true) {
+        size_t slash = filter.find('/', start);
+        std::string_view segment = filter.substr(start, slash == std::string_view::npos ? slash : slash - start);
+
+        if (segment == "+") {
+            ++wildcards;
+        } else if (segment == "#") {
+            // '#' 必须是最后一个层级
+            if (slash != std::string_view::npos) {
+                return false;
+            }
+            ++wildcards;
+        } else if (segment.find_first_of("+#") != std::string_view::npos) {
+            // 通配符必须独占一个层级
+            return false;
+        }
+
+        if (slash == std::string_view::npos) {
+            break;
+        }
+        start = slash + 1;
+    }
+
+    return wildcards <= TopicCaptures::MAX_CAPTURES;
+}
+
+uint32_t TopicRouter::literalChild(uint32_t node, std::string_view segment) const {
+    const auto& literals = m_nodes[node].literals;
+    auto it = std::lower_bound(literals.begin(), literals.end(), segment,
+        [](const LiteralEdge& edge, std::string_view value) {
+            return std::string_view(edge.segment) < value;
+        });
+    if (it != literals.end() && it->segment == segment) {
+        return it->child;
+    }
+    return NIL;
+}
+
+uint32_t TopicRouter::addLiteralChild(uint32_t node, std::string_view segment) {
+    uint32_t existing = literalChild(node, segment);
+    if (existing != NIL) {
+        return existing;
+    }
+
+    uint32_t child = static_cast<uint32_t>(m_nodes.size());
+    m_nodes.emplace_back();
+
+    // 保持有序以便分发时二分查找
+    auto& literals = m_nodes[node].literals;
+    auto it = std::lower_bound(literals.begin(), literals.end(), segment,
+        [](const LiteralEdge& edge, std::string_view value) {
+            return std::string_view(edge.segment) < value;
+        });
+    literals.insert(it, LiteralEdge{std::string(segment), child});
+    return child;
+}
+
+void TopicRouter::match(uint32_t node_index,
+                        std::string_view topic,
+                        size_t pos,
+                        bool system_topic,
+                        TopicCaptures& captures,
+                        const MessageView& message,
+                        size_t& matched) const {
+    const Node& node = m_nodes[node_index];
+    // 以 '$' 开头的系统主题不被首层通配符匹配
+    bool wildcard_allowed = !(system_topic && pos == 0);
+
+    // '#' 匹配剩余的所有层级，也匹配父层级本身（"a/#" 匹配 "a"）
+    if (node.multi_child != NIL && wildcard_allowed) {
+        captures.m_segments[captures.m_count++] =
+            pos == std::string_view::npos ? std::string_view() : topic.substr(pos);
+        invoke(node.multi_child, captures, message, matched);
+        --captures.m_count;
+    }
+
+    if (pos == std::string_view::npos) {
+        invoke(node_index, captures, message, matched);
+        return;
+    }
+
+    size_t slash = topic.find('/', pos);
+    std::string_view segment = topic.substr(pos, slash == std::string_view::npos ? slash : slash - pos);
+    size_t next = slash == std::string_view::npos ? std::string_view::npos : slash + 1;
+
+    uint32_t literal = literalChild(node_index, segment);
+    if (literal != NIL) {
+        match(literal, topic, next, system_topic, captures, message, matched);
+    }
+
+    if (node.single_child != NIL && wildcard_allowed) {
+        captures.m_segments[captures.m_count++] = segment;
+        match(node.single_child, topic, next, system_topic, captures, message, matched);
+        --captures.m_count;
+    }
+}
+
+void TopicRouter::invoke(uint32_t node, const TopicCaptures& captures, const MessageView& message, size_t& matched) const {
+    for (uint32_t route : m_nodes[node].routes) {
+        m_handlers[route](captures, message);
+        ++matched;
+    }
+}